@@ -465,8 +465,8 @@ setup_return(struct pt_regs *regs, struct k_sigaction *ka,
 			 * Ensure that the instruction cache sees
 			 * the return code written onto the stack.
 			 */
-			flush_icache_range((unsigned long)rc,
-					   (unsigned long)(rc + 2));
+			flush_icache_range(fcse_va_to_mva(current->mm, rc),
+					   fcse_va_to_mva(current->mm, rc + 2));
 
 			retcode = ((unsigned long)rc) + thumb;
 		}
@@ -692,8 +692,8 @@ static int do_signal(sigset_t *oldset, struct pt_regs *regs, int syscall)
 				/* ldr	pc, [sp], #12 */
 				put_user(0xe49df00c, &usp[2]);
 
-				flush_icache_range((unsigned long)usp,
-						   (unsigned long)(usp + 3));
+				flush_icache_range(fcse_va_to_mva(current->mm, usp),
+						   fcse_va_to_mva(current->mm, usp + 3));
 
 				regs->ARM_pc = regs->ARM_sp + 4;
 #endif
@@ -0,0 +1,50 @@
+/*
+ * arch/arm/kernel/stacktrace.c
+ *
+ * Stack trace management functions.  The kernel is always built with
+ * APCS frame pointers on ARM, so walk the frame chain: each frame
+ * stores fp, sp, lr and pc just below the address fp points to.
+ */
+#include <linux/sched.h>
+#include <linux/stacktrace.h>
+
+struct stackframe {
+	unsigned long fp;
+	unsigned long sp;
+	unsigned long lr;
+	unsigned long pc;
+};
+
+void save_stack_trace(struct stack_trace *trace, struct task_struct *task)
+{
+	struct thread_info *ti;
+	struct stackframe *frame;
+	unsigned long fp, low, high;
+	int skip = trace->skip;
+
+	if (!task || task == current) {
+		ti = current_thread_info();
+		asm("mov %0, fp" : "=r" (fp));
+	} else {
+		ti = task_thread_info(task);
+		fp = thread_saved_fp(task);
+	}
+
+	low = (unsigned long)(ti + 1);
+	high = (unsigned long)ti + THREAD_SIZE;
+
+	while (fp && trace->nr_entries < trace->max_entries) {
+		/* frames must stay on this stack and move towards its top */
+		if (fp < low + 12 || fp > high - 4)
+			break;
+		frame = (struct stackframe *)(fp - 12);
+
+		if (skip)
+			skip--;
+		else
+			trace->entries[trace->nr_entries++] = frame->lr;
+
+		low = fp + 4;
+		fp = frame->fp;
+	}
+}
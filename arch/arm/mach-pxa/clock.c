@@ -113,6 +113,34 @@ static struct clk clk_gpio27 = {
 	.disable	= clk_gpio27_disable,
 };
 
+/*
+ * Unit clocks gated through CKEN.  Drivers that idle their unit at
+ * runtime use these rather than pxa_set_cken(), so the enable count
+ * keeps the clock on for as long as any user needs it.
+ */
+static void clk_cken_enable(struct clk *clk)
+{
+	pxa_set_cken(clk->ctrlbit, 1);
+}
+
+static void clk_cken_disable(struct clk *clk)
+{
+	pxa_set_cken(clk->ctrlbit, 0);
+}
+
+#define INIT_CKEN(_name, _bit)				\
+	{						\
+		.name		= _name,		\
+		.ctrlbit	= _bit,			\
+		.enable		= clk_cken_enable,	\
+		.disable	= clk_cken_disable,	\
+	}
+
+static struct clk clk_cken[] = {
+	INIT_CKEN("MMCCLK", CKEN12_MMC),
+	INIT_CKEN("I2CCLK", CKEN14_I2C),
+};
+
 int clk_register(struct clk *clk)
 {
 	down(&clocks_sem);
@@ -132,7 +160,11 @@ EXPORT_SYMBOL(clk_unregister);
 
 static int __init clk_init(void)
 {
+	int i;
+
 	clk_register(&clk_gpio27);
+	for (i = 0; i < ARRAY_SIZE(clk_cken); i++)
+		clk_register(&clk_cken[i]);
 	return 0;
 }
 arch_initcall(clk_init);
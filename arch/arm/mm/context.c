@@ -10,10 +10,14 @@
 #include <linux/init.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
+#include <linux/proc_fs.h>
+#include <linux/spinlock.h>
 
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
 
+#if __LINUX_ARM_ARCH__ >= 6
+
 unsigned int cpu_last_asid = { 1 << ASID_BITS };
 
 /*
@@ -51,3 +55,147 @@ void __new_context(struct mm_struct *mm)
 
 	mm->context.id = asid;
 }
+
+#endif
+
+#ifdef CONFIG_ARM_FCSE
+
+static DEFINE_SPINLOCK(fcse_lock);
+static unsigned long fcse_pids[BITS_TO_LONGS(FCSE_NR_PIDS)];
+static unsigned int fcse_pids_used;
+static unsigned int fcse_fallbacks;	/* live processes on PID 0 */
+static unsigned long fcse_relocated;	/* gave up their PID to grow */
+
+/*
+ * PID 0 is never handed out: its slot overlaps the low 32MB of the
+ * processes running without one.  Returns the shifted PID, or 0 with
+ * the process counted as a fallback if the slots are all in use.
+ */
+static unsigned long fcse_pid_alloc(void)
+{
+	unsigned long pid;
+
+	spin_lock(&fcse_lock);
+	pid = find_next_zero_bit(fcse_pids, FCSE_NR_PIDS, 1);
+	if (pid < FCSE_NR_PIDS) {
+		__set_bit(pid, fcse_pids);
+		fcse_pids_used++;
+		pid <<= FCSE_PID_SHIFT;
+	} else {
+		fcse_fallbacks++;
+		pid = 0;
+	}
+	spin_unlock(&fcse_lock);
+
+	return pid;
+}
+
+static void fcse_pid_free(unsigned long pid)
+{
+	__clear_bit(pid >> FCSE_PID_SHIFT, fcse_pids);
+	fcse_pids_used--;
+}
+
+/*
+ * mm is either zeroed by mm_alloc() for exec(), or a copy of the
+ * parent's for fork().  A child of a process running without a PID
+ * may have mappings anywhere, so it goes without one too.
+ */
+int fcse_init_new_context(struct task_struct *tsk, struct mm_struct *mm)
+{
+	if (!vectors_high() || mm->context.fallback) {
+		spin_lock(&fcse_lock);
+		fcse_fallbacks++;
+		spin_unlock(&fcse_lock);
+		mm->context.pid = 0;
+		mm->context.fallback = 1;
+	} else {
+		mm->context.pid = fcse_pid_alloc();
+		mm->context.fallback = mm->context.pid == 0;
+	}
+	return 0;
+}
+
+/*
+ * exit_mmap() has already flushed the caches of the slot, so it can
+ * be handed out straight away.
+ */
+void fcse_destroy_context(struct mm_struct *mm)
+{
+	spin_lock(&fcse_lock);
+	if (mm->context.pid)
+		fcse_pid_free(mm->context.pid);
+	else if (mm->context.fallback)
+		fcse_fallbacks--;
+	spin_unlock(&fcse_lock);
+}
+
+/*
+ * mm (the current one, mmap_sem held for writing) needs more than its
+ * 32MB slot.  Move its page tables from the slot to the bottom of the
+ * pgd and carry on with PID 0, like the processes that never had one.
+ */
+void fcse_relocate_mm_to_null_pid(struct mm_struct *mm)
+{
+	unsigned long pid = mm->context.pid;
+	pgd_t *to = mm->pgd, *from = mm->pgd + pgd_index(pid);
+	size_t size = pgd_index(FCSE_PID_TASK_SIZE) * sizeof(pgd_t);
+
+	if (!pid)
+		return;
+
+	preempt_disable();
+	flush_cache_all();
+	memcpy(to, from, size);
+	memzero(from, size);
+	clean_dcache_area(to, size);
+	clean_dcache_area(from, size);
+	mm->context.pid = 0;
+	mm->context.fallback = 1;
+	fcse_pid_set(0);
+	local_flush_tlb_all();
+	preempt_enable();
+
+	spin_lock(&fcse_lock);
+	fcse_pid_free(pid);
+	fcse_fallbacks++;
+	fcse_relocated++;
+	spin_unlock(&fcse_lock);
+
+	mm->free_area_cache = TASK_UNMAPPED_BASE;
+	mm->cached_hole_size = 0;
+}
+
+#ifdef CONFIG_PROC_FS
+static int proc_fcse_read(char *page, char **start, off_t off, int count,
+			  int *eof, void *data)
+{
+	char *p = page;
+	int len;
+
+	p += sprintf(p, "PIDs:\t\t%u/%lu\n", fcse_pids_used, FCSE_NR_PIDS - 1);
+	p += sprintf(p, "Fallback:\t%u\n", fcse_fallbacks);
+	p += sprintf(p, "Relocated:\t%lu\n", fcse_relocated);
+
+	len = (p - page) - off;
+	if (len < 0)
+		len = 0;
+
+	*eof = (len <= count) ? 1 : 0;
+	*start = page + off;
+
+	return len;
+}
+
+/* /proc/cpu is created by the alignment trap code at fs_initcall time */
+static int __init fcse_proc_init(void)
+{
+	create_proc_read_entry("cpu/fcse", S_IRUGO, NULL,
+			       proc_fcse_read, NULL);
+	return 0;
+}
+
+late_initcall(fcse_proc_init);
+#endif
+
+#endif
@@ -16,6 +16,7 @@
 
 #include <asm/system.h>
 #include <asm/pgtable.h>
+#include <asm/fcse.h>
 #include <asm/tlbflush.h>
 #include <asm/uaccess.h>
 
@@ -444,6 +445,9 @@ do_DataAbort(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 	const struct fsr_info *inf = fsr_info + (fsr & 15) + ((fsr & (1 << 10)) >> 6);
 	struct siginfo info;
 
+	/* the FAR holds the address after FCSE relocation */
+	addr = fcse_mva_to_va(current->active_mm, addr);
+
 	if (!inf->fn(addr, fsr, regs))
 		return;
 
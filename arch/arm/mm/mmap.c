@@ -5,13 +5,52 @@
 #include <linux/mm.h>
 #include <linux/mman.h>
 #include <linux/shm.h>
+#include <linux/sched.h>
 
 #include <asm/system.h>
+#include <asm/fcse.h>
 
 #define COLOUR_ALIGN(addr,pgoff)		\
 	((((addr)+SHMLBA-1)&~(SHMLBA-1)) +	\
 	 (((pgoff)<<PAGE_SHIFT) & (SHMLBA-1)))
 
+#ifdef CONFIG_ARM_FCSE
+/*
+ * A process with an FCSE PID has its stack at the top of its 32MB
+ * slot.  mmap() searches from 8MB, leaving room below for brk(), up
+ * to the room the stack may grow into.
+ */
+#define FCSE_TASK_UNMAPPED_BASE	(FCSE_PID_TASK_SIZE / 4)
+
+static unsigned long fcse_mmap_limit(void)
+{
+	unsigned long gap = current->signal->rlim[RLIMIT_STACK].rlim_cur;
+
+	if (gap > FCSE_PID_TASK_SIZE / 2)
+		gap = FCSE_PID_TASK_SIZE / 2;
+	return (FCSE_PID_TASK_SIZE - gap) & PAGE_MASK;
+}
+
+/*
+ * Called by do_mmap_pgoff(), do_brk() and do_mremap() with mmap_sem
+ * held for writing.  A fixed mapping beyond the slot can only be had
+ * by giving the slot up.  The lines of a shared mapping are written
+ * back whenever the process is switched out, see switch_mm().
+ */
+int fcse_mmap_check(unsigned long addr, unsigned long len,
+		    unsigned long flags)
+{
+	struct mm_struct *mm = current->mm;
+
+	if (flags & MAP_SHARED)
+		mm->context.shared = 1;
+	if (mm->context.pid && flags & MAP_FIXED &&
+	    addr + len > FCSE_PID_TASK_SIZE)
+		fcse_relocate_mm_to_null_pid(mm);
+	return 0;
+}
+#endif
+
 /*
  * We need to ensure that shared mappings are correctly aligned to
  * avoid aliasing issues with VIPT caches.  We need to ensure that
@@ -28,6 +67,7 @@ arch_get_unmapped_area(struct file *filp, unsigned long addr,
 	struct mm_struct *mm = current->mm;
 	struct vm_area_struct *vma;
 	unsigned long start_addr;
+	unsigned long base = TASK_UNMAPPED_BASE, limit = TASK_SIZE;
 #ifdef CONFIG_CPU_V6
 	unsigned int cache_type;
 	int do_align = 0, aliasing = 0;
@@ -58,8 +98,15 @@ arch_get_unmapped_area(struct file *filp, unsigned long addr,
 		return addr;
 	}
 
-	if (len > TASK_SIZE)
-		return -ENOMEM;
+#ifdef CONFIG_ARM_FCSE
+	if (mm->context.pid) {
+		base = FCSE_TASK_UNMAPPED_BASE;
+		limit = fcse_mmap_limit();
+	}
+retry:
+#endif
+	if (len > limit)
+		goto no_space;
 
 	if (addr) {
 		if (do_align)
@@ -68,14 +115,14 @@ arch_get_unmapped_area(struct file *filp, unsigned long addr,
 			addr = PAGE_ALIGN(addr);
 
 		vma = find_vma(mm, addr);
-		if (TASK_SIZE - len >= addr &&
+		if (limit - len >= addr &&
 		    (!vma || addr + len <= vma->vm_start))
 			return addr;
 	}
 	if (len > mm->cached_hole_size) {
 	        start_addr = addr = mm->free_area_cache;
 	} else {
-	        start_addr = addr = TASK_UNMAPPED_BASE;
+	        start_addr = addr = base;
 	        mm->cached_hole_size = 0;
 	}
 
@@ -87,17 +134,17 @@ full_search:
 
 	for (vma = find_vma(mm, addr); ; vma = vma->vm_next) {
 		/* At this point:  (!vma || addr < vma->vm_end). */
-		if (TASK_SIZE - len < addr) {
+		if (limit - len < addr) {
 			/*
 			 * Start a new search - just in case we missed
 			 * some holes.
 			 */
-			if (start_addr != TASK_UNMAPPED_BASE) {
-				start_addr = addr = TASK_UNMAPPED_BASE;
+			if (start_addr != base) {
+				start_addr = addr = base;
 				mm->cached_hole_size = 0;
 				goto full_search;
 			}
-			return -ENOMEM;
+			goto no_space;
 		}
 		if (!vma || addr + len <= vma->vm_start) {
 			/*
@@ -112,6 +159,19 @@ full_search:
 		if (do_align)
 			addr = COLOUR_ALIGN(addr, pgoff);
 	}
+
+no_space:
+#ifdef CONFIG_ARM_FCSE
+	/* the slot is full: fall back to the whole address space */
+	if (mm->context.pid) {
+		fcse_relocate_mm_to_null_pid(mm);
+		base = TASK_UNMAPPED_BASE;
+		limit = TASK_SIZE;
+		addr = 0;
+		goto retry;
+	}
+#endif
+	return -ENOMEM;
 }
 
 
@@ -82,6 +82,21 @@ void free_pgd_slow(pgd_t *pgd)
 
 	/* pgd is always present and good */
 	pmd = pmd_off(pgd, 0);
+#ifdef CONFIG_ARM_FCSE
+	/*
+	 * For a process that had an FCSE PID, the page table for the
+	 * first page is at the start of its slot instead.
+	 */
+	if (pmd_none(*pmd)) {
+		unsigned long pid;
+
+		for (pid = 1; pid < FCSE_NR_PIDS; pid++) {
+			pmd = pmd_off(pgd + pgd_index(pid << FCSE_PID_SHIFT), 0);
+			if (!pmd_none(*pmd))
+				break;
+		}
+	}
+#endif
 	if (pmd_none(*pmd))
 		goto free;
 	if (pmd_bad(*pmd)) {
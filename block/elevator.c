@@ -92,6 +92,20 @@ inline int elv_rq_merge_ok(struct request *rq, struct bio *bio)
 }
 EXPORT_SYMBOL(elv_rq_merge_ok);
 
+/*
+ * Query io scheduler to see if next may be appended to rq.
+ */
+int elv_allow_rq_merge(request_queue_t *q, struct request *rq,
+		       struct request *next)
+{
+	elevator_t *e = q->elevator;
+
+	if (e->ops->elevator_allow_rq_merge_fn)
+		return e->ops->elevator_allow_rq_merge_fn(q, rq, next);
+
+	return 1;
+}
+
 static inline int elv_try_merge(struct request *__rq, struct bio *bio)
 {
 	int ret = ELEVATOR_NO_MERGE;
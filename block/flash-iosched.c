@@ -0,0 +1,552 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  For devices without seek cost: SD/MMC, CompactFlash, mtdblock.
+ *  Reads are dispatched oldest first and ahead of writes; writes are
+ *  grouped by allocation unit (erase block) and issued in ascending
+ *  order within a unit, and writes are never merged across a unit
+ *  boundary.  Read latency is kept as a histogram in sysfs.
+ *
+ *  Based on the deadline scheduler, Copyright (C) 2002 Jens Axboe.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/ktime.h>
+#include <asm/div64.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int read_expire = HZ / 4;  /* max time before a read is submitted. */
+static const int write_expire = 2 * HZ; /* ditto for writes */
+static const int writes_starved = 8;    /* max reads dispatched while writes wait */
+static const int write_batch = 16;      /* writes issued in a row once started */
+static const int au_kb = 128;           /* allocation unit / erase block size */
+
+#define FLASH_LAT_BUCKETS	12	/* <1ms, <2ms, ... <1024ms, more */
+
+struct flash_data {
+	request_queue_t *q;
+
+	/*
+	 * requests are present on both sort_list and fifo_list
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[2];
+
+	unsigned int starved;		/* reads dispatched while writes wait */
+	unsigned int batching;		/* writes dispatched in this batch */
+	sector_t next_write;		/* end of the last write dispatched */
+	int in_au;			/* ... and it is worth continuing */
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[2];
+	int writes_starved;
+	int write_batch;
+	unsigned int au_sectors;	/* power of two */
+
+	/*
+	 * read latency, insertion to completion
+	 */
+	unsigned long lat_hist[FLASH_LAT_BUCKETS];
+	unsigned long lat_count;
+	unsigned long long lat_total_us;
+	unsigned long lat_max_us;
+};
+
+#define RQ_RB_ROOT(fd, rq)	(&(fd)->sort_list[rq_data_dir((rq))])
+
+static inline sector_t flash_au(struct flash_data *fd, sector_t sector)
+{
+	return sector & ~((sector_t)fd->au_sectors - 1);
+}
+
+static inline unsigned long flash_now_us(void)
+{
+	struct timeval tv = ktime_to_timeval(ktime_get());
+
+	return (unsigned long)tv.tv_sec * USEC_PER_SEC + tv.tv_usec;
+}
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = RQ_RB_ROOT(fd, rq);
+	struct request *__alias;
+
+	/*
+	 * An alias (same start sector) cannot be merged; send the old one
+	 * on its way, there is no ordering to lose on flash.
+	 */
+	while (unlikely(__alias = elv_rb_add(root, rq))) {
+		rq_fifo_clear(__alias);
+		elv_rb_del(root, __alias);
+		elv_dispatch_add_tail(fd->q, __alias);
+	}
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int data_dir = rq_data_dir(rq);
+
+	flash_add_rq_rb(fd, rq);
+
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[data_dir]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[data_dir]);
+
+	if (data_dir == READ)
+		rq->elevator_private = (void *)flash_now_us();
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(request_queue_t *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	elv_rb_del(RQ_RB_ROOT(fd, rq), rq);
+}
+
+static int
+flash_merge(request_queue_t *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	sector_t sector = bio->bi_sector + bio_sectors(bio);
+	struct request *__rq;
+
+	/*
+	 * check for front merge; back merges are found by the core
+	 */
+	__rq = elv_rb_find(&fd->sort_list[bio_data_dir(bio)], sector);
+	if (__rq) {
+		BUG_ON(sector != __rq->sector);
+
+		if (elv_rq_merge_ok(__rq, bio)) {
+			*req = __rq;
+			return ELEVATOR_FRONT_MERGE;
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+/*
+ * Writes that straddle an allocation unit cost the card a second
+ * read-modify-write cycle, so never grow one across a boundary.
+ */
+static int
+flash_allow_merge(request_queue_t *q, struct request *rq, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	sector_t start, end;
+
+	if (bio_data_dir(bio) == READ)
+		return 1;
+
+	start = min(rq->sector, bio->bi_sector);
+	end = max(rq->sector + rq->nr_sectors,
+		  bio->bi_sector + bio_sectors(bio));
+
+	return flash_au(fd, start) == flash_au(fd, end - 1);
+}
+
+/* the same for two requests made adjacent by a bio merge */
+static int
+flash_allow_rq_merge(request_queue_t *q, struct request *rq,
+		     struct request *next)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (rq_data_dir(rq) == READ)
+		return 1;
+
+	return flash_au(fd, rq->sector) ==
+		flash_au(fd, next->sector + next->nr_sectors - 1);
+}
+
+static void flash_merged_request(request_queue_t *q, struct request *req,
+				 int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(RQ_RB_ROOT(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(request_queue_t *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/* keep the older insertion time for the latency histogram */
+	if (rq_data_dir(req) == READ &&
+	    (long)((unsigned long)next->elevator_private -
+		   (unsigned long)req->elevator_private) < 0)
+		req->elevator_private = next->elevator_private;
+
+	flash_remove_request(q, next);
+}
+
+static inline void
+flash_move_to_dispatch(struct flash_data *fd, struct request *rq)
+{
+	request_queue_t *q = rq->q;
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+static inline int flash_fifo_expired(struct flash_data *fd, int ddir)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[ddir].next);
+
+	return time_after(jiffies, rq_fifo_time(rq));
+}
+
+/* lowest queued write at or after sector */
+static struct request *flash_find_write(struct flash_data *fd, sector_t sector)
+{
+	struct rb_node *node = fd->sort_list[WRITE].rb_node;
+	struct request *rq, *best = NULL;
+
+	while (node) {
+		rq = rb_entry_rq(node);
+		if (rq->sector < sector) {
+			node = node->rb_right;
+		} else {
+			best = rq;
+			node = node->rb_left;
+		}
+	}
+	return best;
+}
+
+/*
+ * Pick the next write: carry on in the allocation unit we are in, in
+ * ascending order, otherwise start on the unit of the oldest write.
+ */
+static struct request *flash_next_write(struct flash_data *fd)
+{
+	struct request *rq;
+
+	if (fd->in_au) {
+		rq = flash_find_write(fd, fd->next_write);
+		if (rq && flash_au(fd, rq->sector) ==
+			  flash_au(fd, fd->next_write - 1))
+			return rq;
+	}
+
+	rq = rq_entry_fifo(fd->fifo_list[WRITE].next);
+	fd->in_au = 1;
+	return flash_find_write(fd, flash_au(fd, rq->sector));
+}
+
+static int flash_dispatch_requests(request_queue_t *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int reads = !list_empty(&fd->fifo_list[READ]);
+	const int writes = !list_empty(&fd->fifo_list[WRITE]);
+	struct request *rq;
+
+	/*
+	 * A write batch runs to write_batch requests unless a read has
+	 * expired; otherwise reads go first until writes have waited for
+	 * writes_starved reads or expired.
+	 */
+	if (writes) {
+		if (fd->batching && fd->batching < fd->write_batch &&
+		    !(reads && flash_fifo_expired(fd, READ)))
+			goto dispatch_write;
+		if (!reads || fd->starved >= fd->writes_starved ||
+		    flash_fifo_expired(fd, WRITE))
+			goto dispatch_write;
+	}
+
+	if (reads) {
+		fd->batching = 0;
+		if (writes)
+			fd->starved++;
+		rq = rq_entry_fifo(fd->fifo_list[READ].next);
+		flash_move_to_dispatch(fd, rq);
+		return 1;
+	}
+
+	return 0;
+
+dispatch_write:
+	if (fd->batching >= fd->write_batch)
+		fd->batching = 0;
+	rq = flash_next_write(fd);
+	BUG_ON(!rq);
+	fd->starved = 0;
+	fd->batching++;
+	fd->next_write = rq->sector + rq->nr_sectors;
+	flash_move_to_dispatch(fd, rq);
+	return 1;
+}
+
+static void flash_completed_request(request_queue_t *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	unsigned long us, ms;
+	int bucket = 0;
+
+	if (rq_data_dir(rq) != READ)
+		return;
+
+	us = flash_now_us() - (unsigned long)rq->elevator_private;
+	for (ms = us / 1000; ms && bucket < FLASH_LAT_BUCKETS - 1; ms >>= 1)
+		bucket++;
+
+	fd->lat_hist[bucket]++;
+	fd->lat_count++;
+	fd->lat_total_us += us;
+	if (us > fd->lat_max_us)
+		fd->lat_max_us = us;
+}
+
+static int flash_queue_empty(request_queue_t *q)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	return list_empty(&fd->fifo_list[WRITE])
+		&& list_empty(&fd->fifo_list[READ]);
+}
+
+static void flash_exit_queue(elevator_t *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	BUG_ON(!list_empty(&fd->fifo_list[READ]));
+	BUG_ON(!list_empty(&fd->fifo_list[WRITE]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(request_queue_t *q)
+{
+	struct flash_data *fd;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL, q->node);
+	if (!fd)
+		return NULL;
+	memset(fd, 0, sizeof(*fd));
+
+	fd->q = q;
+	INIT_LIST_HEAD(&fd->fifo_list[READ]);
+	INIT_LIST_HEAD(&fd->fifo_list[WRITE]);
+	fd->sort_list[READ] = RB_ROOT;
+	fd->sort_list[WRITE] = RB_ROOT;
+	fd->fifo_expire[READ] = read_expire;
+	fd->fifo_expire[WRITE] = write_expire;
+	fd->writes_starved = writes_starved;
+	fd->write_batch = write_batch;
+	fd->au_sectors = au_kb * 2;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(elevator_t *e, char *page)			\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_read_expire_show, fd->fifo_expire[READ], 1);
+SHOW_FUNCTION(flash_write_expire_show, fd->fifo_expire[WRITE], 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_write_batch_show, fd->write_batch, 0);
+SHOW_FUNCTION(flash_au_kb_show, fd->au_sectors / 2, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(elevator_t *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_read_expire_store, &fd->fifo_expire[READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_write_expire_store, &fd->fifo_expire[WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_write_batch_store, &fd->write_batch, 1, INT_MAX, 0);
+#undef STORE_FUNCTION
+
+static ssize_t flash_au_kb_store(elevator_t *e, const char *page, size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+	int kb;
+
+	flash_var_store(&kb, page, count);
+	if (kb < 1)
+		kb = 1;
+	else if (kb > 65536)
+		kb = 65536;
+
+	/* round down to a power of two */
+	spin_lock_irq(fd->q->queue_lock);
+	fd->au_sectors = 1 << fls(kb * 2 - 1);
+	if (fd->au_sectors > kb * 2)
+		fd->au_sectors >>= 1;
+	fd->in_au = 0;
+	spin_unlock_irq(fd->q->queue_lock);
+	return count;
+}
+
+static ssize_t flash_read_lat_show(elevator_t *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+	unsigned long hist[FLASH_LAT_BUCKETS], count, max;
+	unsigned long long total;
+	char *p = page;
+	int i;
+
+	spin_lock_irq(fd->q->queue_lock);
+	memcpy(hist, fd->lat_hist, sizeof(hist));
+	count = fd->lat_count;
+	total = fd->lat_total_us;
+	max = fd->lat_max_us;
+	spin_unlock_irq(fd->q->queue_lock);
+
+	for (i = 0; i < FLASH_LAT_BUCKETS - 1; i++)
+		p += sprintf(p, "<%dms\t%lu\n", 1 << i, hist[i]);
+	p += sprintf(p, ">=%dms\t%lu\n", 1 << i, hist[i]);
+
+	if (count)
+		do_div(total, count);
+	p += sprintf(p, "count\t%lu\nmean_us\t%llu\nmax_us\t%lu\n",
+		     count, total, max);
+	return p - page;
+}
+
+/* any write resets the histogram */
+static ssize_t flash_read_lat_store(elevator_t *e, const char *page,
+				    size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	spin_lock_irq(fd->q->queue_lock);
+	memset(fd->lat_hist, 0, sizeof(fd->lat_hist));
+	fd->lat_count = 0;
+	fd->lat_total_us = 0;
+	fd->lat_max_us = 0;
+	spin_unlock_irq(fd->q->queue_lock);
+	return count;
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(read_expire),
+	FD_ATTR(write_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(write_batch),
+	FD_ATTR(au_kb),
+	FD_ATTR(read_lat),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_allow_rq_merge_fn =	flash_allow_rq_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_queue_empty_fn =	flash_queue_empty,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	return elv_register(&iosched_flash);
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
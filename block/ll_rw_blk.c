@@ -636,6 +636,7 @@ void blk_queue_max_sectors(request_queue_t *q, unsigned int max_sectors)
 		q->max_sectors = BLK_DEF_MAX_SECTORS;
 		q->max_hw_sectors = max_sectors;
 	}
+	q->backing_dev_info.io_pages = q->max_sectors >> (PAGE_CACHE_SHIFT - 9);
 }
 
 EXPORT_SYMBOL(blk_queue_max_sectors);
@@ -739,6 +740,7 @@ void blk_queue_stack_limits(request_queue_t *t, request_queue_t *b)
 	/* zero is "infinity" */
 	t->max_sectors = min_not_zero(t->max_sectors,b->max_sectors);
 	t->max_hw_sectors = min_not_zero(t->max_hw_sectors,b->max_hw_sectors);
+	t->backing_dev_info.io_pages = t->max_sectors >> (PAGE_CACHE_SHIFT - 9);
 
 	t->max_phys_segments = min(t->max_phys_segments,b->max_phys_segments);
 	t->max_hw_segments = min(t->max_hw_segments,b->max_hw_segments);
@@ -2812,6 +2814,9 @@ static int attempt_merge(request_queue_t *q, struct request *req,
 	    || next->special)
 		return 0;
 
+	if (!elv_allow_rq_merge(q, req, next))
+		return 0;
+
 	/*
 	 * If we are allowed to merge, then append bio list
 	 * from next to rq and release next. merge_requests_fn
@@ -3910,6 +3915,7 @@ queue_max_sectors_store(struct request_queue *q, const char *page, size_t count)
 				max_sectors_kb >> (PAGE_CACHE_SHIFT - 10);
 
 	q->max_sectors = max_sectors_kb << 1;
+	q->backing_dev_info.io_pages = max_sectors_kb >> (PAGE_CACHE_SHIFT - 10);
 	spin_unlock_irq(q->queue_lock);
 
 	return ret;
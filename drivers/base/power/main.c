@@ -20,6 +20,9 @@
  */
 
 #include <linux/device.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/resume-trace.h>
 #include "power.h"
 
 LIST_HEAD(dpm_active);
@@ -29,6 +32,15 @@ LIST_HEAD(dpm_off_irq);
 DECLARE_MUTEX(dpm_sem);
 DECLARE_MUTEX(dpm_list_sem);
 
+/* async suspend/resume threads still running, and the first error */
+static atomic_t dpm_async_count = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(dpm_async_wq);
+int dpm_async_error;
+
+/* duration of the last device_suspend() and device_resume() */
+unsigned long dpm_suspend_usecs;
+unsigned long dpm_resume_usecs;
+
 /**
  *	device_pm_set_parent - Specify power dependency.
  *	@dev:		Device who needs power.
@@ -56,6 +68,8 @@ int device_pm_add(struct device * dev)
 	pr_debug("PM: Adding info for %s:%s\n",
 		 dev->bus ? dev->bus->name : "No Bus",
 		 kobject_name(&dev->kobj));
+	init_completion(&dev->power.done);
+	complete_all(&dev->power.done);
 	down(&dpm_list_sem);
 	list_add_tail(&dev->power.entry, &dpm_active);
 	device_pm_set_parent(dev, dev->parent);
@@ -75,6 +89,134 @@ void device_pm_remove(struct device * dev)
 	put_device(dev->power.pm_parent);
 	list_del_init(&dev->power.entry);
 	up(&dpm_list_sem);
+	complete_all(&dev->power.done);
+}
+
+/*
+ * A device goes async only if its driver said so and its power
+ * dependency is its parent, which is what the suspend side can
+ * wait for.  TRACE_DEVICE() records a single current device, so
+ * everything runs in order while pm_trace is on.
+ */
+int dpm_async_ok(struct device * dev)
+{
+#ifdef CONFIG_PM_TRACE
+	if (pm_trace_enabled)
+		return 0;
+#endif
+	return dev->power.async_suspend && dev->power.pm_parent == dev->parent;
+}
+
+/* Start a pass over list: nobody on it is done yet */
+void dpm_reset_list(struct list_head * list)
+{
+	struct list_head * entry;
+
+	list_for_each(entry, list) {
+		struct device * dev = to_device(entry);
+
+		INIT_COMPLETION(dev->power.done);
+		dev->power.async_started = 0;
+	}
+}
+
+/* ... and end it, for devices the pass never got to */
+void dpm_complete_list(struct list_head * list)
+{
+	struct list_head * entry;
+
+	list_for_each(entry, list)
+		complete_all(&to_device(entry)->power.done);
+}
+
+/**
+ *	dpm_async_run - Suspend or resume one device in its own thread.
+ *	@fn:	Thread function, ends with dpm_async_done(dev).
+ *	@dev:	Device.
+ *
+ *	If no thread can be had, @fn runs in the caller instead.
+ */
+void dpm_async_run(int (*fn)(void *), struct device * dev)
+{
+	struct task_struct * task;
+
+	get_device(dev);
+	atomic_inc(&dpm_async_count);
+	dev->power.async_started = 1;
+	task = kthread_run(fn, dev, "kpm/%s", dev->bus_id);
+	if (IS_ERR(task))
+		fn(dev);
+}
+
+void dpm_async_done(struct device * dev, int error)
+{
+	if (error && !dpm_async_error)
+		dpm_async_error = error;
+	complete_all(&dev->power.done);
+	put_device(dev);
+	if (atomic_dec_and_test(&dpm_async_count))
+		wake_up(&dpm_async_wq);
+}
+
+void dpm_async_wait(void)
+{
+	wait_event(dpm_async_wq, !atomic_read(&dpm_async_count));
+}
+
+/**
+ *	dpm_wait - Wait for a device the pass depends on.
+ *	@dev:	Child (suspend) or parent (resume).
+ *
+ *	Only a device already handed to a thread is waited for.  A
+ *	synchronous one earlier on the list is done by now, and one later
+ *	on it (after device_move(), say) keeps the old list order, which
+ *	must not block the walk that has yet to reach it.
+ */
+void dpm_wait(struct device * dev)
+{
+	if (dev->power.async_started)
+		wait_for_completion(&dev->power.done);
+}
+
+unsigned long dpm_usecs_since(ktime_t start)
+{
+	struct timeval tv = ktime_to_timeval(ktime_sub(ktime_get(), start));
+
+	return tv.tv_sec * USEC_PER_SEC + tv.tv_usec;
+}
+
+/**
+ *	dpm_show_times - Report how long suspend and resume took.
+ *	@buf:	Page to fill in.
+ *
+ *	The totals for the last system suspend and resume, then every
+ *	device that needed a millisecond or more for either, with 'a'
+ *	marking the ones that ran asynchronously.
+ */
+ssize_t dpm_show_times(char * buf)
+{
+	struct list_head * entry;
+	char * s = buf;
+
+	s += sprintf(s, "suspend %lu us, resume %lu us\n",
+		     dpm_suspend_usecs, dpm_resume_usecs);
+
+	down(&dpm_list_sem);
+	list_for_each(entry, &dpm_active) {
+		struct device * dev = to_device(entry);
+
+		if (dev->power.suspend_usecs < 1000 &&
+		    dev->power.resume_usecs < 1000)
+			continue;
+		if (s - buf > PAGE_SIZE - 64)
+			break;
+		s += sprintf(s, "%-20s %c %8lu %8lu\n", dev->bus_id,
+			     dpm_async_ok(dev) ? 'a' : '-',
+			     dev->power.suspend_usecs,
+			     dev->power.resume_usecs);
+	}
+	up(&dpm_list_sem);
+	return s - buf;
 }
 
 
@@ -42,6 +42,23 @@ static inline struct device * to_device(struct list_head * entry)
 extern int device_pm_add(struct device *);
 extern void device_pm_remove(struct device *);
 
+/*
+ * Async suspend/resume, also main.c
+ */
+
+extern int dpm_async_error;
+extern unsigned long dpm_suspend_usecs;
+extern unsigned long dpm_resume_usecs;
+
+extern int dpm_async_ok(struct device *);
+extern void dpm_reset_list(struct list_head *);
+extern void dpm_complete_list(struct list_head *);
+extern void dpm_async_run(int (*fn)(void *), struct device *);
+extern void dpm_async_done(struct device *, int);
+extern void dpm_async_wait(void);
+extern void dpm_wait(struct device *);
+extern unsigned long dpm_usecs_since(ktime_t);
+
 /*
  * sysfs.c
  */
@@ -67,6 +84,8 @@ extern int suspend_device(struct device *, pm_message_t);
  * runtime.c
  */
 
+extern ssize_t dpm_runtime_show(struct device *, char *);
+
 #else /* CONFIG_PM */
 
 
@@ -10,6 +10,7 @@
 
 #include <linux/device.h>
 #include <linux/resume-trace.h>
+#include <linux/sched.h>
 #include "../base.h"
 #include "power.h"
 
@@ -22,6 +23,7 @@
 
 int resume_device(struct device * dev)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -44,6 +46,7 @@ int resume_device(struct device * dev)
 	}
 	up(&dev->sem);
 	TRACE_RESUME(error);
+	dev->power.resume_usecs = dpm_usecs_since(start);
 	return error;
 }
 
@@ -62,6 +65,29 @@ static int resume_device_early(struct device * dev)
 	return error;
 }
 
+/*
+ * Resume one device from dpm_off once the device it draws power
+ * from is back; the parent may be resuming in another thread.
+ */
+static void dpm_resume_one(struct device * dev)
+{
+	if (dev->power.pm_parent)
+		dpm_wait(dev->power.pm_parent);
+	if (!dev->power.prev_state.event && !dev->power.suspend_failed)
+		resume_device(dev);
+	dev->power.suspend_failed = 0;
+}
+
+static int async_resume(void * data)
+{
+	struct device * dev = data;
+
+	current->flags |= PF_NOFREEZE;
+	dpm_resume_one(dev);
+	dpm_async_done(dev, 0);
+	return 0;
+}
+
 /*
  * Resume the devices that have either not gone through
  * the late suspend, or that did go through it but also
@@ -70,6 +96,7 @@ static int resume_device_early(struct device * dev)
 void dpm_resume(void)
 {
 	down(&dpm_list_sem);
+	dpm_reset_list(&dpm_off);
 	while(!list_empty(&dpm_off)) {
 		struct list_head * entry = dpm_off.next;
 		struct device * dev = to_device(entry);
@@ -78,12 +105,17 @@ void dpm_resume(void)
 		list_move_tail(entry, &dpm_active);
 
 		up(&dpm_list_sem);
-		if (!dev->power.prev_state.event)
-			resume_device(dev);
+		if (dpm_async_ok(dev))
+			dpm_async_run(async_resume, dev);
+		else {
+			dpm_resume_one(dev);
+			complete_all(&dev->power.done);
+		}
 		down(&dpm_list_sem);
 		put_device(dev);
 	}
 	up(&dpm_list_sem);
+	dpm_async_wait();
 }
 
 
@@ -96,9 +128,12 @@ void dpm_resume(void)
 
 void device_resume(void)
 {
+	ktime_t start = ktime_get();
+
 	might_sleep();
 	down(&dpm_sem);
 	dpm_resume();
+	dpm_resume_usecs = dpm_usecs_since(start);
 	up(&dpm_sem);
 }
 
@@ -7,6 +7,7 @@
  */
 
 #include <linux/device.h>
+#include <linux/jiffies.h>
 #include "power.h"
 
 
@@ -65,6 +66,201 @@ int dpm_runtime_suspend(struct device * dev, pm_message_t state)
 EXPORT_SYMBOL(dpm_runtime_suspend);
 
 
+/*
+ * Usage counted runtime PM.  The spinlock covers the counters so
+ * dpm_runtime_put() can be called from interrupt handlers; the mutex
+ * orders ->suspend() against ->resume().
+ */
+
+/* Charge the time since the last change to the state we were in */
+static void runtime_account(struct dev_pm_runtime * rt)
+{
+	unsigned long now = jiffies;
+
+	if (rt->suspended)
+		rt->idle_jiffies += now - rt->stamp;
+	else
+		rt->active_jiffies += now - rt->stamp;
+	rt->stamp = now;
+}
+
+static void runtime_idle_work(struct work_struct * work)
+{
+	struct dev_pm_runtime * rt =
+		container_of(work, struct dev_pm_runtime, work.work);
+	unsigned long idle = msecs_to_jiffies(rt->idle_ms);
+	unsigned long flags;
+	int error;
+
+	mutex_lock(&rt->mutex);
+	spin_lock_irqsave(&rt->lock, flags);
+	if (rt->usage || rt->suspended) {
+		spin_unlock_irqrestore(&rt->lock, flags);
+		goto out;
+	}
+	/* used again since the timer was set */
+	if (time_before(jiffies, rt->last_busy + idle)) {
+		schedule_delayed_work(&rt->work,
+				      rt->last_busy + idle - jiffies);
+		spin_unlock_irqrestore(&rt->lock, flags);
+		goto out;
+	}
+	/* a get() arriving from now on waits on the mutex and resumes us */
+	rt->suspending = 1;
+	spin_unlock_irqrestore(&rt->lock, flags);
+
+	error = rt->suspend(rt->dev);
+
+	spin_lock_irqsave(&rt->lock, flags);
+	rt->suspending = 0;
+	if (!error) {
+		runtime_account(rt);
+		rt->suspended = 1;
+		rt->suspend_count++;
+	}
+	spin_unlock_irqrestore(&rt->lock, flags);
+	if (!error)
+		dev_dbg(rt->dev, "runtime idle\n");
+ out:
+	mutex_unlock(&rt->mutex);
+}
+
+/**
+ *	dpm_runtime_init - Start runtime PM for a device.
+ *	@dev:	Device, powered up.
+ *	@rt:	Callbacks and idle timeout filled in by the driver.
+ *
+ *	The device is considered active and unused; it is suspended once
+ *	it has been idle for rt->idle_ms.
+ */
+void dpm_runtime_init(struct device * dev, struct dev_pm_runtime * rt)
+{
+	rt->dev = dev;
+	spin_lock_init(&rt->lock);
+	mutex_init(&rt->mutex);
+	INIT_DELAYED_WORK_DEFERRABLE(&rt->work, runtime_idle_work);
+	rt->usage = 0;
+	rt->suspended = 0;
+	rt->suspending = 0;
+	rt->stamp = rt->last_busy = jiffies;
+	rt->active_jiffies = rt->idle_jiffies = rt->suspend_count = 0;
+	dev->power.runtime = rt;
+	schedule_delayed_work(&rt->work, msecs_to_jiffies(rt->idle_ms));
+}
+EXPORT_SYMBOL_GPL(dpm_runtime_init);
+
+/**
+ *	dpm_runtime_exit - Stop runtime PM, leaving the device powered.
+ *	@dev:	Device.
+ */
+void dpm_runtime_exit(struct device * dev)
+{
+	struct dev_pm_runtime * rt = dev->power.runtime;
+
+	if (!rt)
+		return;
+	dpm_runtime_get(dev);
+	cancel_delayed_work(&rt->work);
+	flush_scheduled_work();
+	dev->power.runtime = NULL;
+}
+EXPORT_SYMBOL_GPL(dpm_runtime_exit);
+
+/**
+ *	dpm_runtime_get - Make sure a device is powered and keep it so.
+ *	@dev:	Device.
+ *
+ *	May sleep, to run ->resume().  Every successful call must be
+ *	paired with dpm_runtime_put().
+ */
+int dpm_runtime_get(struct device * dev)
+{
+	struct dev_pm_runtime * rt = dev->power.runtime;
+	unsigned long flags;
+	int error = 0;
+
+	if (!rt)
+		return 0;
+
+	spin_lock_irqsave(&rt->lock, flags);
+	rt->usage++;
+	if (!rt->suspended && !rt->suspending) {
+		spin_unlock_irqrestore(&rt->lock, flags);
+		return 0;
+	}
+	spin_unlock_irqrestore(&rt->lock, flags);
+
+	mutex_lock(&rt->mutex);
+	if (rt->suspended) {
+		error = rt->resume(dev);
+		if (!error) {
+			spin_lock_irqsave(&rt->lock, flags);
+			runtime_account(rt);
+			rt->suspended = 0;
+			spin_unlock_irqrestore(&rt->lock, flags);
+			dev_dbg(dev, "runtime active\n");
+		}
+	}
+	mutex_unlock(&rt->mutex);
+
+	if (error) {
+		spin_lock_irqsave(&rt->lock, flags);
+		rt->usage--;
+		spin_unlock_irqrestore(&rt->lock, flags);
+	}
+	return error;
+}
+EXPORT_SYMBOL_GPL(dpm_runtime_get);
+
+/**
+ *	dpm_runtime_put - Drop a reference taken by dpm_runtime_get().
+ *	@dev:	Device.
+ *
+ *	Safe from interrupt context; the device is suspended later, from
+ *	keventd, if nobody takes it again within the idle timeout.
+ */
+void dpm_runtime_put(struct device * dev)
+{
+	struct dev_pm_runtime * rt = dev->power.runtime;
+	unsigned long flags;
+
+	if (!rt)
+		return;
+
+	spin_lock_irqsave(&rt->lock, flags);
+	WARN_ON(rt->usage <= 0);
+	rt->last_busy = jiffies;
+	if (--rt->usage == 0)
+		schedule_delayed_work(&rt->work, msecs_to_jiffies(rt->idle_ms));
+	spin_unlock_irqrestore(&rt->lock, flags);
+}
+EXPORT_SYMBOL_GPL(dpm_runtime_put);
+
+/* power/runtime in sysfs */
+ssize_t dpm_runtime_show(struct device * dev, char * buf)
+{
+	struct dev_pm_runtime * rt = dev->power.runtime;
+	unsigned long flags, active, idle;
+	int usage, suspended;
+
+	if (!rt)
+		return sprintf(buf, "unsupported\n");
+
+	spin_lock_irqsave(&rt->lock, flags);
+	runtime_account(rt);
+	usage = rt->usage;
+	suspended = rt->suspended;
+	active = rt->active_jiffies;
+	idle = rt->idle_jiffies;
+	spin_unlock_irqrestore(&rt->lock, flags);
+
+	return sprintf(buf, "%s usage %d suspends %lu active_ms %u idle_ms %u\n",
+		       suspended ? "idle" : "active", usage,
+		       rt->suspend_count, jiffies_to_msecs(active),
+		       jiffies_to_msecs(idle));
+}
+
+
 #if 0
 /**
  *	dpm_set_power_state - Update power_state field.
@@ -11,6 +11,7 @@
 #include <linux/device.h>
 #include <linux/kallsyms.h>
 #include <linux/pm.h>
+#include <linux/sched.h>
 #include "../base.h"
 #include "power.h"
 
@@ -27,6 +28,12 @@
  * Things are the reverse on the resume path - iterations are done in
  * forward order, and nodes are inserted at the back of their destination
  * lists. This way, the ancestors will be accessed before their descendents.
+ *
+ * Devices flagged with device_set_async_suspend() leave the walk early:
+ * they are moved to dpm_off at once and suspended by a thread of their
+ * own, which first waits for the device's children.  Every device waits
+ * for its children the same way, so a parent is never suspended before
+ * a child that is still busy in another thread.
  */
 
 static inline char *suspend_verb(u32 event)
@@ -48,6 +55,7 @@ static inline char *suspend_verb(u32 event)
 
 int suspend_device(struct device * dev, pm_message_t state)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	down(&dev->sem);
@@ -90,10 +98,47 @@ int suspend_device(struct device * dev, pm_message_t state)
 		suspend_report_result(dev->bus->suspend, error);
 	}
 	up(&dev->sem);
+	dev->power.suspend_usecs = dpm_usecs_since(start);
 	return error;
 }
 
 
+static int dpm_wait_child(struct device * child, void * data)
+{
+	dpm_wait(child);
+	return 0;
+}
+
+static void dpm_wait_children(struct device * dev)
+{
+	device_for_each_child(dev, NULL, dpm_wait_child);
+}
+
+static pm_message_t dpm_async_state;
+
+static int async_suspend(void * data)
+{
+	struct device * dev = data;
+	int error = 0;
+
+	current->flags |= PF_NOFREEZE;
+	dpm_wait_children(dev);
+
+	/* dpm_resume() must not wake what never went to sleep */
+	if (dpm_async_error)
+		dev->power.suspend_failed = 1;
+	else
+		error = suspend_device(dev, dpm_async_state);
+	if (error) {
+		dev->power.suspend_failed = 1;
+		printk(KERN_ERR "Could not suspend device %s: error %d\n",
+			kobject_name(&dev->kobj), error);
+	}
+	dpm_async_done(dev, error);
+	return 0;
+}
+
+
 /*
  * This is called with interrupts off, only a single CPU
  * running. We can't do down() on a semaphore (and we don't
@@ -138,19 +183,41 @@ static int suspend_device_late(struct device *dev, pm_message_t state)
 
 int device_suspend(pm_message_t state)
 {
+	ktime_t start = ktime_get();
 	int error = 0;
 
 	might_sleep();
 	down(&dpm_sem);
 	down(&dpm_list_sem);
+	dpm_async_error = 0;
+	dpm_async_state = state;
+	dpm_reset_list(&dpm_active);
 	while (!list_empty(&dpm_active) && error == 0) {
 		struct list_head * entry = dpm_active.prev;
 		struct device * dev = to_device(entry);
 
 		get_device(dev);
+
+		if (dpm_async_ok(dev)) {
+			list_move(&dev->power.entry, &dpm_off);
+			up(&dpm_list_sem);
+			dpm_async_run(async_suspend, dev);
+			down(&dpm_list_sem);
+			put_device(dev);
+			error = dpm_async_error;
+			continue;
+		}
 		up(&dpm_list_sem);
 
+		dpm_wait_children(dev);
+		if (dpm_async_error) {
+			/* a child failed in its own thread, back out */
+			down(&dpm_list_sem);
+			put_device(dev);
+			break;
+		}
 		error = suspend_device(dev, state);
+		complete_all(&dev->power.done);
 
 		down(&dpm_list_sem);
 
@@ -168,9 +235,17 @@ int device_suspend(pm_message_t state)
 		put_device(dev);
 	}
 	up(&dpm_list_sem);
+
+	dpm_async_wait();
+	if (!error)
+		error = dpm_async_error;
+	down(&dpm_list_sem);
+	dpm_complete_list(&dpm_active);
+	up(&dpm_list_sem);
 	if (error)
 		dpm_resume();
 
+	dpm_suspend_usecs = dpm_usecs_since(start);
 	up(&dpm_sem);
 	return error;
 }
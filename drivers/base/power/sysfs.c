@@ -142,11 +142,60 @@ wake_store(struct device * dev, struct device_attribute *attr,
 static DEVICE_ATTR(wakeup, 0644, wake_show, wake_store);
 
 
+/*
+ *	async - Report/change whether the device suspends in parallel
+ *
+ *	"1" lets system suspend and resume handle the device in a thread
+ *	of its own, ordered only against its parent and children; "0"
+ *	keeps it in the usual one-device-at-a-time walk.  Drivers set the
+ *	default with device_set_async_suspend().
+ */
+
+static ssize_t
+async_show(struct device * dev, struct device_attribute *attr, char * buf)
+{
+	return sprintf(buf, "%d\n", dev->power.async_suspend);
+}
+
+static ssize_t
+async_store(struct device * dev, struct device_attribute *attr,
+	const char * buf, size_t n)
+{
+	int val;
+
+	if (sscanf(buf, "%d", &val) != 1)
+		return -EINVAL;
+	device_set_async_suspend(dev, val);
+	return n;
+}
+
+static DEVICE_ATTR(async, 0644, async_show, async_store);
+
+
+/*
+ *	runtime - Report runtime power management state
+ *
+ *	For drivers using dpm_runtime_get()/put(): whether the device is
+ *	active or idle right now, its usage count, how often it went
+ *	idle, and the time spent active and idle since the driver started.
+ */
+
+static ssize_t
+runtime_show(struct device * dev, struct device_attribute *attr, char * buf)
+{
+	return dpm_runtime_show(dev, buf);
+}
+
+static DEVICE_ATTR(runtime, 0444, runtime_show, NULL);
+
+
 static struct attribute * power_attrs[] = {
 #ifdef	CONFIG_PM_SYSFS_DEPRECATED
 	&dev_attr_state.attr,
 #endif
 	&dev_attr_wakeup.attr,
+	&dev_attr_async.attr,
+	&dev_attr_runtime.attr,
 	NULL,
 };
 static struct attribute_group pm_attr_group = {
@@ -0,0 +1,483 @@
+/*
+ * ramzswap.c - compressed RAM block device for swap
+ *
+ * Pages written to the device are compressed with LZF and kept in
+ * RAM, so a box without a usable swap disk can still push its idle
+ * anonymous memory somewhere and get back 50-70% of it.
+ *
+ * Storage: every compressed page is rounded up to 64 byte chunks and
+ * stored in a "buddied" page that holds at most two objects, one
+ * growing from the start and one from the end.  Pages with one free
+ * half sit on a list indexed by how many chunks they have free, and a
+ * new object goes into the tightest one that fits.  This bounds the
+ * best case at 2:1 but never fragments, and freeing is O(1).
+ *
+ * Zero-filled pages take no storage at all, and pages that do not
+ * compress to 3/4 of their size are stored as they are.
+ *
+ * The device only accepts page-sized, page-aligned I/O, which is what
+ * the swap code issues.  It is used like any other swap partition:
+ *
+ *	mkswap /dev/ramzswap0 && swapon /dev/ramzswap0
+ *
+ * The swap code does not tell block devices when a slot is freed, so
+ * the space held by a stale slot is only returned when that slot is
+ * written again.  Statistics are in /proc/ramzswap.
+ *
+ * This source code is licensed under the GNU General Public License,
+ * Version 2. See the file COPYING for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/highmem.h>
+#include <linux/string.h>
+#include <linux/mutex.h>
+#include <linux/list.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/swap.h>
+#include <linux/proc_fs.h>
+#include <linux/lzf.h>
+
+#define RZS_CHUNK_SHIFT	6
+#define RZS_CHUNK_SIZE	(1 << RZS_CHUNK_SHIFT)
+#define RZS_NCHUNKS	(PAGE_SIZE >> RZS_CHUNK_SHIFT)
+
+/* Pages that do not compress below this are stored uncompressed. */
+#define RZS_MAX_ZSIZE	(PAGE_SIZE / 4 * 3)
+
+#define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - 9)
+
+/* A storage page holding up to two compressed objects. */
+struct rzs_zpage {
+	struct list_head list;		/* on unbuddied[] if one half free */
+	struct page *page;
+	unsigned short first;		/* chunks used from the start */
+	unsigned short last;		/* chunks used from the end */
+};
+
+/* slot flags */
+#define RZS_ZERO	0x01		/* zero-filled, nothing stored */
+#define RZS_LAST	0x02		/* object is the zpage's last half */
+
+struct rzs_slot {
+	struct rzs_zpage *zp;
+	unsigned short len;		/* bytes; PAGE_SIZE if uncompressed */
+	unsigned short flags;
+};
+
+struct rzs_stats {
+	unsigned long num_reads;
+	unsigned long num_writes;
+	unsigned long failed_reads;
+	unsigned long failed_writes;
+	unsigned long pages_zero;	/* slots holding a zero page */
+	unsigned long pages_stored;	/* slots with an object */
+	unsigned long pages_expand;	/* ... of which uncompressed */
+	unsigned long good_compress;	/* ... of which <= PAGE_SIZE/2 */
+	unsigned long zpages;		/* storage pages allocated */
+	unsigned long compr_size;	/* sum of object sizes */
+};
+
+struct ramzswap {
+	struct mutex lock;
+	struct request_queue *queue;
+	struct gendisk *disk;
+	struct rzs_slot *table;
+	unsigned long npages;
+	void *wrkmem;			/* LZF hash table */
+	void *cbuf;			/* compression output */
+	struct list_head unbuddied[RZS_NCHUNKS];
+	struct rzs_stats stats;
+};
+
+static struct ramzswap rzs;
+static int rzs_major;
+static struct kmem_cache *rzs_zpage_cache;
+
+static unsigned long disksize_kb;
+module_param(disksize_kb, ulong, 0);
+MODULE_PARM_DESC(disksize_kb, "Disk size in kB (default: 25% of RAM)");
+
+static inline unsigned int rzs_chunks(size_t len)
+{
+	return (len + RZS_CHUNK_SIZE - 1) >> RZS_CHUNK_SHIFT;
+}
+
+static inline unsigned int rzs_free_chunks(struct rzs_zpage *zp)
+{
+	return RZS_NCHUNKS - zp->first - zp->last;
+}
+
+/*
+ * Find room for @len bytes.  Returns the zpage and sets *last and
+ * *offset to where the object goes.
+ */
+static struct rzs_zpage *rzs_alloc(size_t len, int *last, unsigned int *offset)
+{
+	unsigned int chunks = rzs_chunks(len);
+	struct rzs_zpage *zp;
+	unsigned int i;
+
+	for (i = chunks; i < RZS_NCHUNKS; i++) {
+		if (list_empty(&rzs.unbuddied[i]))
+			continue;
+		zp = list_entry(rzs.unbuddied[i].next, struct rzs_zpage, list);
+		list_del_init(&zp->list);
+		if (zp->first) {
+			zp->last = chunks;
+			*last = 1;
+			*offset = PAGE_SIZE - (chunks << RZS_CHUNK_SHIFT);
+		} else {
+			zp->first = chunks;
+			*last = 0;
+			*offset = 0;
+		}
+		return zp;
+	}
+
+	zp = kmem_cache_alloc(rzs_zpage_cache, GFP_NOIO);
+	if (!zp)
+		return NULL;
+	zp->page = alloc_page(GFP_NOIO | __GFP_HIGHMEM | __GFP_NOWARN);
+	if (!zp->page) {
+		kmem_cache_free(rzs_zpage_cache, zp);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&zp->list);
+	zp->first = chunks;
+	zp->last = 0;
+	if (rzs_free_chunks(zp))
+		list_add(&zp->list, &rzs.unbuddied[rzs_free_chunks(zp)]);
+	rzs.stats.zpages++;
+
+	*last = 0;
+	*offset = 0;
+	return zp;
+}
+
+static void rzs_free(struct rzs_zpage *zp, int last)
+{
+	if (last)
+		zp->last = 0;
+	else
+		zp->first = 0;
+
+	list_del_init(&zp->list);
+	if (!zp->first && !zp->last) {
+		__free_page(zp->page);
+		kmem_cache_free(rzs_zpage_cache, zp);
+		rzs.stats.zpages--;
+		return;
+	}
+	list_add(&zp->list, &rzs.unbuddied[rzs_free_chunks(zp)]);
+}
+
+static void rzs_free_slot(unsigned long index)
+{
+	struct rzs_slot *slot = &rzs.table[index];
+
+	if (slot->flags & RZS_ZERO) {
+		rzs.stats.pages_zero--;
+	} else if (slot->zp) {
+		rzs_free(slot->zp, slot->flags & RZS_LAST);
+		rzs.stats.pages_stored--;
+		rzs.stats.compr_size -= slot->len;
+		if (slot->len == PAGE_SIZE)
+			rzs.stats.pages_expand--;
+		else if (slot->len <= PAGE_SIZE / 2)
+			rzs.stats.good_compress--;
+	}
+	slot->zp = NULL;
+	slot->len = 0;
+	slot->flags = 0;
+}
+
+static int rzs_page_zero_filled(const void *ptr)
+{
+	const unsigned long *p = ptr;
+	unsigned int i;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(*p); i++)
+		if (p[i])
+			return 0;
+	return 1;
+}
+
+static int rzs_read(unsigned long index, struct page *page)
+{
+	struct rzs_slot *slot = &rzs.table[index];
+	unsigned char *src, *dst;
+	int ret = 0;
+
+	dst = kmap_atomic(page, KM_USER0);
+	if (!slot->zp) {
+		/* never written, or zero-filled */
+		memset(dst, 0, PAGE_SIZE);
+	} else {
+		unsigned int offset = 0;
+
+		if (slot->flags & RZS_LAST)
+			offset = PAGE_SIZE - (rzs_chunks(slot->len) << RZS_CHUNK_SHIFT);
+		src = kmap_atomic(slot->zp->page, KM_USER1);
+		if (slot->len == PAGE_SIZE)
+			memcpy(dst, src, PAGE_SIZE);
+		else if (lzf_decompress(src + offset, slot->len,
+					dst, PAGE_SIZE) != PAGE_SIZE)
+			ret = -EIO;
+		kunmap_atomic(src, KM_USER1);
+	}
+	kunmap_atomic(dst, KM_USER0);
+	flush_dcache_page(page);
+
+	if (ret) {
+		printk(KERN_ERR "ramzswap: corrupt page %lu\n", index);
+		rzs.stats.failed_reads++;
+	}
+	return ret;
+}
+
+static int rzs_write(unsigned long index, struct page *page)
+{
+	struct rzs_slot *slot = &rzs.table[index];
+	struct rzs_zpage *zp;
+	unsigned char *src, *dst;
+	unsigned int offset;
+	size_t clen;
+	int last;
+
+	/* The old contents of this slot are dead either way. */
+	rzs_free_slot(index);
+
+	src = kmap_atomic(page, KM_USER0);
+	if (rzs_page_zero_filled(src)) {
+		kunmap_atomic(src, KM_USER0);
+		slot->flags = RZS_ZERO;
+		rzs.stats.pages_zero++;
+		return 0;
+	}
+	clen = lzf_compress(src, PAGE_SIZE, rzs.cbuf, RZS_MAX_ZSIZE,
+			    rzs.wrkmem);
+	if (!clen) {
+		memcpy(rzs.cbuf, src, PAGE_SIZE);
+		clen = PAGE_SIZE;
+	}
+	kunmap_atomic(src, KM_USER0);
+
+	zp = rzs_alloc(clen, &last, &offset);
+	if (!zp) {
+		rzs.stats.failed_writes++;
+		return -ENOMEM;
+	}
+
+	dst = kmap_atomic(zp->page, KM_USER0);
+	memcpy(dst + offset, rzs.cbuf, clen);
+	kunmap_atomic(dst, KM_USER0);
+
+	slot->zp = zp;
+	slot->len = clen;
+	slot->flags = last ? RZS_LAST : 0;
+
+	rzs.stats.pages_stored++;
+	rzs.stats.compr_size += clen;
+	if (clen == PAGE_SIZE)
+		rzs.stats.pages_expand++;
+	else if (clen <= PAGE_SIZE / 2)
+		rzs.stats.good_compress++;
+	return 0;
+}
+
+static int rzs_make_request(request_queue_t *q, struct bio *bio)
+{
+	unsigned long index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	int rw = bio_data_dir(bio);
+	struct bio_vec *bvec;
+	int ret = 0, i;
+
+	if (bio->bi_sector & ((1 << SECTORS_PER_PAGE_SHIFT) - 1) ||
+	    index + (bio->bi_size >> PAGE_SHIFT) > rzs.npages)
+		goto fail;
+
+	mutex_lock(&rzs.lock);
+	bio_for_each_segment(bvec, bio, i) {
+		if (bvec->bv_len != PAGE_SIZE || bvec->bv_offset) {
+			ret = -EIO;
+			break;
+		}
+		if (rw == WRITE) {
+			rzs.stats.num_writes++;
+			ret = rzs_write(index, bvec->bv_page);
+		} else {
+			rzs.stats.num_reads++;
+			ret = rzs_read(index, bvec->bv_page);
+		}
+		if (ret)
+			break;
+		index++;
+	}
+	mutex_unlock(&rzs.lock);
+	if (ret)
+		goto fail;
+
+	bio_endio(bio, bio->bi_size, 0);
+	return 0;
+fail:
+	bio_io_error(bio, bio->bi_size);
+	return 0;
+}
+
+static struct block_device_operations rzs_fops = {
+	.owner	= THIS_MODULE,
+};
+
+static int rzs_read_proc(char *page, char **start, off_t off, int count,
+			 int *eof, void *data)
+{
+	struct rzs_stats s;
+	unsigned long orig, compr, mem, ratio;
+	int len;
+
+	mutex_lock(&rzs.lock);
+	s = rzs.stats;
+	mutex_unlock(&rzs.lock);
+
+	/* what the stored data would take uncompressed, and what it takes */
+	orig = (s.pages_stored + s.pages_zero) << (PAGE_SHIFT - 10);
+	compr = s.compr_size >> 10;
+	mem = (s.zpages << (PAGE_SHIFT - 10)) +
+	      ((rzs.npages * sizeof(struct rzs_slot) +
+		s.zpages * sizeof(struct rzs_zpage)) >> 10);
+	ratio = mem ? orig * 100 / mem : 0;
+
+	len = sprintf(page,
+		"DiskSize:      %8lu kB\n"
+		"NumReads:      %8lu\n"
+		"NumWrites:     %8lu\n"
+		"FailedReads:   %8lu\n"
+		"FailedWrites:  %8lu\n"
+		"ZeroPages:     %8lu\n"
+		"PagesStored:   %8lu\n"
+		"GoodCompress:  %8lu\n"
+		"NoCompress:    %8lu\n"
+		"OrigDataSize:  %8lu kB\n"
+		"ComprDataSize: %8lu kB\n"
+		"MemUsedTotal:  %8lu kB\n"
+		"Ratio:         %5lu.%02lu\n",
+		rzs.npages << (PAGE_SHIFT - 10),
+		s.num_reads, s.num_writes,
+		s.failed_reads, s.failed_writes,
+		s.pages_zero, s.pages_stored,
+		s.good_compress, s.pages_expand,
+		orig, compr, mem,
+		ratio / 100, ratio % 100);
+
+	*eof = 1;
+	return len;
+}
+
+static int __init rzs_init(void)
+{
+	int i, err = -ENOMEM;
+
+	if (!disksize_kb)
+		disksize_kb = (totalram_pages / 4) << (PAGE_SHIFT - 10);
+	rzs.npages = disksize_kb >> (PAGE_SHIFT - 10);
+	if (!rzs.npages)
+		return -EINVAL;
+
+	mutex_init(&rzs.lock);
+	for (i = 0; i < RZS_NCHUNKS; i++)
+		INIT_LIST_HEAD(&rzs.unbuddied[i]);
+
+	rzs_zpage_cache = kmem_cache_create("ramzswap_zpage",
+					    sizeof(struct rzs_zpage), 0, 0,
+					    NULL, NULL);
+	if (!rzs_zpage_cache)
+		return -ENOMEM;
+
+	rzs.table = vmalloc(rzs.npages * sizeof(struct rzs_slot));
+	if (!rzs.table)
+		goto out_cache;
+	memset(rzs.table, 0, rzs.npages * sizeof(struct rzs_slot));
+
+	rzs.wrkmem = kmalloc(LZF_WRKMEM_SIZE, GFP_KERNEL);
+	rzs.cbuf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!rzs.wrkmem || !rzs.cbuf)
+		goto out_bufs;
+
+	rzs.queue = blk_alloc_queue(GFP_KERNEL);
+	if (!rzs.queue)
+		goto out_bufs;
+	blk_queue_make_request(rzs.queue, rzs_make_request);
+	blk_queue_hardsect_size(rzs.queue, PAGE_SIZE);
+	rzs.queue->queuedata = &rzs;
+
+	rzs.disk = alloc_disk(1);
+	if (!rzs.disk)
+		goto out_queue;
+
+	rzs_major = register_blkdev(0, "ramzswap");
+	if (rzs_major < 0) {
+		err = rzs_major;
+		goto out_disk;
+	}
+
+	rzs.disk->major = rzs_major;
+	rzs.disk->first_minor = 0;
+	rzs.disk->fops = &rzs_fops;
+	rzs.disk->queue = rzs.queue;
+	rzs.disk->private_data = &rzs;
+	rzs.disk->flags |= GENHD_FL_SUPPRESS_PARTITION_INFO;
+	sprintf(rzs.disk->disk_name, "ramzswap0");
+	set_capacity(rzs.disk, rzs.npages << SECTORS_PER_PAGE_SHIFT);
+	add_disk(rzs.disk);
+
+	create_proc_read_entry("ramzswap", 0, NULL, rzs_read_proc, NULL);
+
+	printk(KERN_INFO "ramzswap: %lu kB device, major %d\n",
+	       disksize_kb, rzs_major);
+	return 0;
+
+out_disk:
+	put_disk(rzs.disk);
+out_queue:
+	blk_cleanup_queue(rzs.queue);
+out_bufs:
+	kfree(rzs.cbuf);
+	kfree(rzs.wrkmem);
+	vfree(rzs.table);
+out_cache:
+	kmem_cache_destroy(rzs_zpage_cache);
+	return err;
+}
+
+static void __exit rzs_exit(void)
+{
+	unsigned long i;
+
+	remove_proc_entry("ramzswap", NULL);
+	del_gendisk(rzs.disk);
+	put_disk(rzs.disk);
+	blk_cleanup_queue(rzs.queue);
+	unregister_blkdev(rzs_major, "ramzswap");
+
+	for (i = 0; i < rzs.npages; i++)
+		rzs_free_slot(i);
+
+	kfree(rzs.cbuf);
+	kfree(rzs.wrkmem);
+	vfree(rzs.table);
+	kmem_cache_destroy(rzs_zpage_cache);
+}
+
+module_init(rzs_init);
+module_exit(rzs_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compressed RAM block device for swap");
@@ -31,6 +31,8 @@
 #include <linux/interrupt.h>
 #include <linux/i2c-pxa.h>
 #include <linux/platform_device.h>
+#include <linux/clk.h>
+#include <linux/err.h>
 
 #include <asm/hardware.h>
 #include <asm/irq.h>
@@ -62,6 +64,8 @@ struct pxa_i2c {
 	unsigned long		iosize;
 
 	int			irq;
+	struct clk		*clk;		/* bus 0 only */
+	struct dev_pm_runtime	rt;
 };
 
 #define _IBMR(i2c)	((i2c)->reg_base + 0)
@@ -794,6 +798,10 @@ static int i2c_pxa_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num
 	struct pxa_i2c *i2c = adap->algo_data;
 	int ret, i;
 
+	ret = dpm_runtime_get(adap->dev.parent);
+	if (ret)
+		return ret;
+
 	/* If the I2C controller is disabled we need to reset it (probably due
  	   to a suspend/resume destroying state). We do this here as we can then
  	   avoid worrying about resuming the controller before its users. */
@@ -813,9 +821,33 @@ static int i2c_pxa_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num
 	ret = -EREMOTEIO;
  out:
 	i2c_pxa_set_slave(i2c, ret);
+	dpm_runtime_put(adap->dev.parent);
 	return ret;
 }
 
+#ifndef CONFIG_I2C_PXA_SLAVE
+/*
+ * Gate the unit clock between transfers.  The unit loses nothing
+ * we care about, but is reset on the way back to be safe.
+ */
+static int i2c_pxa_runtime_suspend(struct device *dev)
+{
+	struct pxa_i2c *i2c = dev_get_drvdata(dev);
+
+	clk_disable(i2c->clk);
+	return 0;
+}
+
+static int i2c_pxa_runtime_resume(struct device *dev)
+{
+	struct pxa_i2c *i2c = dev_get_drvdata(dev);
+
+	clk_enable(i2c->clk);
+	i2c_pxa_reset(i2c);
+	return 0;
+}
+#endif
+
 static u32 i2c_pxa_functionality(struct i2c_adapter *adap)
 {
 	return I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL | I2C_FUNC_PROTOCOL_MANGLING;
@@ -891,7 +923,12 @@ static int i2c_pxa_probe(struct platform_device *dev)
 		pxa_gpio_mode(GPIO117_I2CSCL_MD);
 		pxa_gpio_mode(GPIO118_I2CSDA_MD);
 #endif
-		pxa_set_cken(CKEN14_I2C, 1);
+		i2c->clk = clk_get(&dev->dev, "I2CCLK");
+		if (IS_ERR(i2c->clk)) {
+			ret = PTR_ERR(i2c->clk);
+			goto eremap;
+		}
+		clk_enable(i2c->clk);
 		break;
 #ifdef CONFIG_PXA27x
 	case 1:
@@ -921,6 +958,17 @@ static int i2c_pxa_probe(struct platform_device *dev)
 
 	platform_set_drvdata(dev, i2c);
 
+#ifndef CONFIG_I2C_PXA_SLAVE
+	/* a slave must hear its address at any time, and the power I2C
+	 * unit is also driven directly by the voltage change code */
+	if (dev->id == 0) {
+		i2c->rt.suspend = i2c_pxa_runtime_suspend;
+		i2c->rt.resume = i2c_pxa_runtime_resume;
+		i2c->rt.idle_ms = 50;
+		dpm_runtime_init(&dev->dev, &i2c->rt);
+	}
+#endif
+
 #ifdef CONFIG_I2C_PXA_SLAVE
 	printk(KERN_INFO "I2C: %s: PXA I2C adapter, slave address %d\n",
 	       i2c->adap.dev.bus_id, i2c->slave_addr);
@@ -935,7 +983,8 @@ eadapt:
 ereqirq:
 	switch (dev->id) {
 	case 0:
-		pxa_set_cken(CKEN14_I2C, 0);
+		clk_disable(i2c->clk);
+		clk_put(i2c->clk);
 		break;
 #ifdef CONFIG_PXA27x
 	case 1:
@@ -956,13 +1005,15 @@ static int i2c_pxa_remove(struct platform_device *dev)
 {
 	struct pxa_i2c *i2c = platform_get_drvdata(dev);
 
+	dpm_runtime_exit(&dev->dev);
 	platform_set_drvdata(dev, NULL);
 
 	i2c_del_adapter(&i2c->adap);
 	free_irq(i2c->irq, i2c);
 	switch (dev->id) {
 	case 0:
-		pxa_set_cken(CKEN14_I2C, 0);
+		clk_disable(i2c->clk);
+		clk_put(i2c->clk);
 		break;
 #ifdef CONFIG_PXA27x
 	case 1:
@@ -981,7 +1032,10 @@ static int i2c_pxa_remove(struct platform_device *dev)
 #ifdef CONFIG_PM
 static int i2c_pxa_resume(struct platform_device *dev)
 {
+	/* the unit may have been idle, with its clock off */
+	dpm_runtime_get(&dev->dev);
 	i2c_pxa_reset(dev_get_drvdata(&dev->dev));
+	dpm_runtime_put(&dev->dev);
 	return 0;
 }
 
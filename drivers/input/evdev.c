@@ -11,9 +11,13 @@
 #define EVDEV_MINOR_BASE	64
 #define EVDEV_MINORS		32
 #define EVDEV_BUFFER_SIZE	64
+#define EVDEV_RING_SIZE		256
+#define EVDEV_RING_MASK		(EVDEV_RING_SIZE - 1)
 
 #include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/input.h>
@@ -21,6 +25,7 @@
 #include <linux/smp_lock.h>
 #include <linux/device.h>
 #include <linux/compat.h>
+#include <linux/mutex.h>
 
 struct evdev {
 	int exist;
@@ -37,6 +42,14 @@ struct evdev_list {
 	struct input_event buffer[EVDEV_BUFFER_SIZE];
 	int head;
 	int tail;
+	struct input_ring *ring;	/* replaces buffer once set up */
+	struct mutex ring_mutex;	/* serializes EVIOCSRING */
+	unsigned int ring_flags;
+	unsigned int ring_head;		/* next free slot, not yet published */
+	unsigned int ring_pkt;		/* first slot of the open packet */
+	unsigned int ring_prev;		/* first slot of the last published one */
+	unsigned int ring_pub;		/* head published at the last EV_SYN */
+	int ring_drop;			/* the open packet did not fit */
 	struct fasync_struct *fasync;
 	struct evdev *evdev;
 	struct list_head node;
@@ -44,34 +57,179 @@ struct evdev_list {
 
 static struct evdev *evdev_table[EVDEV_MINORS];
 
+/*
+ * The reader is more than half a ring behind: fold the packet just closed
+ * into the previous one if both carry nothing but EV_ABS and the previous
+ * one has every axis of the new one.  The previous packet must still be
+ * well clear of the reader, as it is rewritten in place.
+ */
+static int evdev_ring_coalesce(struct evdev_list *list, unsigned int tail)
+{
+	struct input_event *ev = list->ring->events;
+	unsigned int prev = list->ring_prev;
+	unsigned int pkt = list->ring_pkt;
+	unsigned int syn = (list->ring_head - 1) & EVDEV_RING_MASK;
+	unsigned int prev_syn = (pkt - 1) & EVDEV_RING_MASK;
+	unsigned int i, j;
+
+	if (((list->ring_head - tail) & EVDEV_RING_MASK) < EVDEV_RING_SIZE / 2)
+		return 0;
+	if (prev == pkt ||
+	    ((prev - tail) & EVDEV_RING_MASK) >= ((pkt - tail) & EVDEV_RING_MASK) ||
+	    ((prev - tail) & EVDEV_RING_MASK) < EVDEV_RING_SIZE / 4)
+		return 0;
+
+	for (j = prev; j != prev_syn; j = (j + 1) & EVDEV_RING_MASK)
+		if (ev[j].type != EV_ABS)
+			return 0;
+
+	for (i = pkt; i != syn; i = (i + 1) & EVDEV_RING_MASK) {
+		if (ev[i].type != EV_ABS)
+			return 0;
+		for (j = prev; j != prev_syn; j = (j + 1) & EVDEV_RING_MASK)
+			if (ev[j].code == ev[i].code)
+				break;
+		if (j == prev_syn)
+			return 0;
+	}
+
+	for (i = pkt; i != syn; i = (i + 1) & EVDEV_RING_MASK)
+		for (j = prev; j != prev_syn; j = (j + 1) & EVDEV_RING_MASK)
+			if (ev[j].code == ev[i].code) {
+				ev[j] = ev[i];
+				break;
+			}
+	ev[prev_syn].time = ev[syn].time;
+
+	return 1;
+}
+
+/*
+ * Events collect behind ring->head and are published a packet at a time.
+ * Returns 1 if the reader may be asleep waiting for this packet, that is
+ * if it had consumed everything published up to the previous EV_SYN.
+ */
+static int evdev_ring_event(struct evdev_list *list, unsigned int type,
+			    unsigned int code, int value)
+{
+	struct input_ring *ring = list->ring;
+	unsigned int tail = ring->tail & EVDEV_RING_MASK;
+	struct input_event *ev;
+	int wake;
+
+	if (((list->ring_head + 1) & EVDEV_RING_MASK) == tail)
+		list->ring_drop = 1;
+
+	if (!list->ring_drop) {
+		ev = &ring->events[list->ring_head];
+		do_gettimeofday(&ev->time);
+		ev->type = type;
+		ev->code = code;
+		ev->value = value;
+		list->ring_head = (list->ring_head + 1) & EVDEV_RING_MASK;
+	}
+
+	if (type != EV_SYN || code != SYN_REPORT)
+		return 0;
+
+	if (list->ring_drop) {
+		list->ring_head = list->ring_pkt;
+		list->ring_drop = 0;
+		ring->dropped++;
+		return 0;
+	}
+
+	if ((list->ring_flags & INPUT_RING_COALESCE) &&
+	    evdev_ring_coalesce(list, tail)) {
+		list->ring_head = list->ring_pkt;
+		ring->coalesced++;
+		return 0;
+	}
+
+	smp_wmb();
+	ring->head = list->ring_head;
+	list->ring_prev = list->ring_pkt;
+	list->ring_pkt = list->ring_head;
+
+	wake = tail == list->ring_pub;
+	list->ring_pub = list->ring_head;
+	if (wake)
+		kill_fasync(&list->fasync, SIGIO, POLL_IN);
+
+	return wake;
+}
+
+static int evdev_pass_event(struct evdev_list *list, unsigned int type,
+			    unsigned int code, int value)
+{
+	if (list->ring)
+		return evdev_ring_event(list, type, code, value);
+
+	do_gettimeofday(&list->buffer[list->head].time);
+	list->buffer[list->head].type = type;
+	list->buffer[list->head].code = code;
+	list->buffer[list->head].value = value;
+	list->head = (list->head + 1) & (EVDEV_BUFFER_SIZE - 1);
+
+	kill_fasync(&list->fasync, SIGIO, POLL_IN);
+
+	return 1;
+}
+
 static void evdev_event(struct input_handle *handle, unsigned int type, unsigned int code, int value)
 {
 	struct evdev *evdev = handle->private;
 	struct evdev_list *list;
+	int wake = 0;
 
-	if (evdev->grab) {
-		list = evdev->grab;
+	if (evdev->grab)
+		wake = evdev_pass_event(evdev->grab, type, code, value);
+	else
+		list_for_each_entry(list, &evdev->list, node)
+			wake |= evdev_pass_event(list, type, code, value);
 
-		do_gettimeofday(&list->buffer[list->head].time);
-		list->buffer[list->head].type = type;
-		list->buffer[list->head].code = code;
-		list->buffer[list->head].value = value;
-		list->head = (list->head + 1) & (EVDEV_BUFFER_SIZE - 1);
+	if (wake)
+		wake_up_interruptible(&evdev->wait);
+}
 
-		kill_fasync(&list->fasync, SIGIO, POLL_IN);
-	} else
-		list_for_each_entry(list, &evdev->list, node) {
+static int evdev_ring_setup(struct evdev_list *list, unsigned int flags)
+{
+	struct input_ring *ring;
+	int retval = 0;
 
-			do_gettimeofday(&list->buffer[list->head].time);
-			list->buffer[list->head].type = type;
-			list->buffer[list->head].code = code;
-			list->buffer[list->head].value = value;
-			list->head = (list->head + 1) & (EVDEV_BUFFER_SIZE - 1);
+	if (flags & ~INPUT_RING_COALESCE)
+		return -EINVAL;
 
-			kill_fasync(&list->fasync, SIGIO, POLL_IN);
-		}
+	mutex_lock(&list->ring_mutex);
+	if (list->ring) {
+		retval = -EBUSY;
+		goto out;
+	}
+
+	ring = vmalloc_user(sizeof(struct input_ring) +
+			    EVDEV_RING_SIZE * sizeof(struct input_event));
+	if (!ring) {
+		retval = -ENOMEM;
+		goto out;
+	}
+
+	ring->size = EVDEV_RING_SIZE;
+	ring->flags = flags;
+	list->ring_flags = flags;
 
-	wake_up_interruptible(&evdev->wait);
+	smp_wmb();
+	list->ring = ring;
+ out:
+	mutex_unlock(&list->ring_mutex);
+	return retval;
+}
+
+static int evdev_has_events(struct evdev_list *list)
+{
+	if (list->ring)
+		return list->ring_pub != (list->ring->tail & EVDEV_RING_MASK);
+
+	return list->head != list->tail;
 }
 
 static int evdev_fasync(int fd, struct file *file, int on)
@@ -112,6 +270,9 @@ static int evdev_release(struct inode * inode, struct file * file)
 	evdev_fasync(-1, file, 0);
 	list_del(&list->node);
 
+	if (list->ring)
+		vfree(list->ring);
+
 	if (!--list->evdev->open) {
 		if (list->evdev->exist)
 			input_close_device(&list->evdev->handle);
@@ -133,6 +294,7 @@ static int evdev_open(struct inode * inode, struct file * file)
 
 	if (!(list = kzalloc(sizeof(struct evdev_list), GFP_KERNEL)))
 		return -ENOMEM;
+	mutex_init(&list->ring_mutex);
 
 	list->evdev = evdev_table[i];
 	list_add_tail(&list->node, &evdev_table[i]->list);
@@ -271,11 +433,11 @@ static ssize_t evdev_read(struct file * file, char __user * buffer, size_t count
 	if (count < evdev_event_size())
 		return -EINVAL;
 
-	if (list->head == list->tail && list->evdev->exist && (file->f_flags & O_NONBLOCK))
+	if (!evdev_has_events(list) && list->evdev->exist && (file->f_flags & O_NONBLOCK))
 		return -EAGAIN;
 
 	retval = wait_event_interruptible(list->evdev->wait,
-		list->head != list->tail || (!list->evdev->exist));
+		evdev_has_events(list) || (!list->evdev->exist));
 
 	if (retval)
 		return retval;
@@ -283,6 +445,24 @@ static ssize_t evdev_read(struct file * file, char __user * buffer, size_t count
 	if (!list->evdev->exist)
 		return -ENODEV;
 
+	if (list->ring) {
+		struct input_ring *ring = list->ring;
+		unsigned int tail = ring->tail & EVDEV_RING_MASK;
+
+		while (tail != list->ring_pub && retval + evdev_event_size() <= count) {
+
+			smp_rmb();
+			if (evdev_event_to_user(buffer + retval, &ring->events[tail]))
+				return -EFAULT;
+
+			tail = (tail + 1) & EVDEV_RING_MASK;
+			retval += evdev_event_size();
+		}
+
+		ring->tail = tail;
+		return retval;
+	}
+
 	while (list->head != list->tail && retval + evdev_event_size() <= count) {
 
 		struct input_event *event = (struct input_event *) list->buffer + list->tail;
@@ -303,10 +483,20 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	struct evdev_list *list = file->private_data;
 
 	poll_wait(file, &list->evdev->wait, wait);
-	return ((list->head == list->tail) ? 0 : (POLLIN | POLLRDNORM)) |
+	return (evdev_has_events(list) ? (POLLIN | POLLRDNORM) : 0) |
 		(list->evdev->exist ? 0 : (POLLHUP | POLLERR));
 }
 
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_list *list = file->private_data;
+
+	if (!list->ring)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, list->ring, vma->vm_pgoff);
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -497,6 +687,12 @@ static long evdev_ioctl_handler(struct file *file, unsigned int cmd,
 				return 0;
 			}
 
+		case EVIOCSRING:
+			/* the mmap'd layout is the native struct input_event */
+			if (compat_mode)
+				return -EINVAL;
+			return evdev_ring_setup(list, (unsigned long)p);
+
 		default:
 
 			if (_IOC_TYPE(cmd) != 'E')
@@ -606,6 +802,7 @@ static const struct file_operations evdev_fops = {
 	.read =		evdev_read,
 	.write =	evdev_write,
 	.poll =		evdev_poll,
+	.mmap =		evdev_mmap,
 	.open =		evdev_open,
 	.release =	evdev_release,
 	.unlocked_ioctl = evdev_ioctl,
@@ -21,8 +21,10 @@
 
 struct heartbeat_trig_data {
 	unsigned int phase;
+	unsigned int stopping;
 	unsigned int period;
-	struct timer_list timer;
+	struct timer_list timer;	/* ends a beat */
+	struct timer_list pause;	/* starts the next one, deferrable */
 };
 
 static void led_heartbeat_function(unsigned long data)
@@ -66,7 +68,17 @@ static void led_heartbeat_function(unsigned long data)
 	}
 
 	led_set_brightness(led_cdev, brightness);
-	mod_timer(&heartbeat_data->timer, jiffies + delay);
+	if (heartbeat_data->stopping)
+		return;
+
+	/*
+	 * A lit LED has to go dark on time, but the pauses between beats
+	 * may stretch while the CPU is idle rather than wake it up.
+	 */
+	if (brightness == LED_FULL)
+		mod_timer(&heartbeat_data->timer, jiffies + delay);
+	else
+		mod_timer(&heartbeat_data->pause, jiffies + delay);
 }
 
 static void heartbeat_trig_activate(struct led_classdev *led_cdev)
@@ -80,6 +92,9 @@ static void heartbeat_trig_activate(struct led_classdev *led_cdev)
 	led_cdev->trigger_data = heartbeat_data;
 	setup_timer(&heartbeat_data->timer,
 		    led_heartbeat_function, (unsigned long) led_cdev);
+	init_timer_deferrable(&heartbeat_data->pause);
+	heartbeat_data->pause.function = led_heartbeat_function;
+	heartbeat_data->pause.data = (unsigned long) led_cdev;
 	heartbeat_data->phase = 0;
 	led_heartbeat_function(heartbeat_data->timer.data);
 }
@@ -89,6 +104,11 @@ static void heartbeat_trig_deactivate(struct led_classdev *led_cdev)
 	struct heartbeat_trig_data *heartbeat_data = led_cdev->trigger_data;
 
 	if (heartbeat_data) {
+		/* each timer rearms the other: stop them, then recheck */
+		heartbeat_data->stopping = 1;
+		smp_wmb();
+		del_timer_sync(&heartbeat_data->timer);
+		del_timer_sync(&heartbeat_data->pause);
 		del_timer_sync(&heartbeat_data->timer);
 		kfree(heartbeat_data);
 	}
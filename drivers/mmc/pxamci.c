@@ -26,6 +26,8 @@
 #include <linux/mmc/host.h>
 #include <linux/mmc/protocol.h>
 #include <linux/leds.h>
+#include <linux/clk.h>
+#include <linux/err.h>
 
 #include <asm/dma.h>
 #include <asm/io.h>
@@ -54,6 +56,10 @@ struct pxamci_host {
 	unsigned int		power_mode;
 	struct pxamci_platform_data *pdata;
 
+	struct clk		*clk;
+	unsigned int		clk_on;		/* as set_ios() wants it */
+	struct dev_pm_runtime	rt;
+
 	struct mmc_request	*mrq;
 	struct mmc_command	*cmd;
 	struct mmc_data		*data;
@@ -202,6 +208,7 @@ static void pxamci_finish_request(struct pxamci_host *host, struct mmc_request *
 	host->cmd = NULL;
 	host->data = NULL;
 	mmc_request_done(host->mmc, mrq);
+	dpm_runtime_put(mmc_dev(host->mmc));
 }
 
 static int pxamci_cmd_done(struct pxamci_host *host, unsigned int stat)
@@ -331,6 +338,12 @@ static void pxamci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	WARN_ON(host->mrq != NULL);
 
+	if (dpm_runtime_get(mmc_dev(mmc))) {
+		mrq->cmd->error = MMC_ERR_FAILED;
+		mmc_request_done(mmc, mrq);
+		return;
+	}
+
 	host->mrq = mrq;
 
 	pxamci_stop_clock(host);
@@ -367,19 +380,28 @@ static void pxamci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 {
 	struct pxamci_host *host = mmc_priv(mmc);
 
+	if (dpm_runtime_get(mmc_dev(mmc)))
+		return;
+
 	if (ios->clock) {
 		unsigned int clk = CLOCKRATE / ios->clock;
 		if (CLOCKRATE / clk > ios->clock)
 			clk <<= 1;
 		host->clkrt = fls(clk) - 1;
-		pxa_set_cken(CKEN12_MMC, 1);
+		if (!host->clk_on) {
+			clk_enable(host->clk);
+			host->clk_on = 1;
+		}
 
 		/*
 		 * we write clkrt on the next command
 		 */
 	} else {
 		pxamci_stop_clock(host);
-		pxa_set_cken(CKEN12_MMC, 0);
+		if (host->clk_on) {
+			clk_disable(host->clk);
+			host->clk_on = 0;
+		}
 	}
 
 	if (host->power_mode != ios->power_mode) {
@@ -394,6 +416,8 @@ static void pxamci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 
 	pr_debug("PXAMCI: clkrt = %x cmdat = %x\n",
 		 host->clkrt, host->cmdat);
+
+	dpm_runtime_put(mmc_dev(mmc));
 }
 
 static const struct mmc_host_ops pxamci_ops = {
@@ -408,6 +432,30 @@ static void pxamci_dma_irq(int dma, void *devid)
 	DCSR(dma) = DCSR_STARTINTR|DCSR_ENDINTR|DCSR_BUSERR;
 }
 
+/*
+ * Between requests the unit clock is gated; the card keeps its state
+ * as the bus clock is stopped anyway after each command.
+ */
+static int pxamci_runtime_suspend(struct device *dev)
+{
+	struct pxamci_host *host = mmc_priv(dev_get_drvdata(dev));
+
+	if (host->clk_on) {
+		pxamci_stop_clock(host);
+		clk_disable(host->clk);
+	}
+	return 0;
+}
+
+static int pxamci_runtime_resume(struct device *dev)
+{
+	struct pxamci_host *host = mmc_priv(dev_get_drvdata(dev));
+
+	if (host->clk_on)
+		clk_enable(host->clk);
+	return 0;
+}
+
 static irqreturn_t pxamci_detect_irq(int irq, void *devid)
 {
 	struct pxamci_host *host = mmc_priv(devid);
@@ -488,6 +536,13 @@ static int pxamci_probe(struct platform_device *pdev)
 		goto out;
 	}
 
+	host->clk = clk_get(&pdev->dev, "MMCCLK");
+	if (IS_ERR(host->clk)) {
+		ret = PTR_ERR(host->clk);
+		host->clk = NULL;
+		goto out;
+	}
+
 	/*
 	 * Ensure that the host controller is shut down, and setup
 	 * with our defaults.
@@ -513,6 +568,14 @@ static int pxamci_probe(struct platform_device *pdev)
 	if (host->pdata && host->pdata->init)
 		host->pdata->init(&pdev->dev, pxamci_detect_irq, mmc);
 
+	/* card re-init on resume is slow and only needs this host */
+	device_set_async_suspend(&pdev->dev, 1);
+
+	host->rt.suspend = pxamci_runtime_suspend;
+	host->rt.resume = pxamci_runtime_resume;
+	host->rt.idle_ms = 100;
+	dpm_runtime_init(&pdev->dev, &host->rt);
+
 	mmc_add_host(mmc);
 
 	return 0;
@@ -525,6 +588,8 @@ static int pxamci_probe(struct platform_device *pdev)
 			iounmap(host->base);
 		if (host->sg_cpu)
 			dma_free_coherent(&pdev->dev, PAGE_SIZE, host->sg_cpu, host->sg_dma);
+		if (host->clk)
+			clk_put(host->clk);
 	}
 	if (mmc)
 		mmc_free_host(mmc);
@@ -545,6 +610,7 @@ static int pxamci_remove(struct platform_device *pdev)
 			host->pdata->exit(&pdev->dev, mmc);
 
 		mmc_remove_host(mmc);
+		dpm_runtime_exit(&pdev->dev);
 
 		pxamci_stop_clock(host);
 		writel(TXFIFO_WR_REQ|RXFIFO_RD_REQ|CLK_IS_OFF|STOP_CMD|
@@ -561,6 +627,10 @@ static int pxamci_remove(struct platform_device *pdev)
 
 		release_resource(host->res);
 
+		if (host->clk_on)
+			clk_disable(host->clk);
+		clk_put(host->clk);
+
 		mmc_free_host(mmc);
 	}
 	return 0;
@@ -613,7 +683,7 @@ static void __exit pxamci_exit(void)
 	platform_driver_unregister(&pxamci_driver);
 }
 
-module_init(pxamci_init);
+device_initcall_async(pxamci_init);
 module_exit(pxamci_exit);
 
 MODULE_DESCRIPTION("PXA Multimedia Card Interface Driver");
@@ -82,6 +82,8 @@ static int cfi_intelext_point (struct mtd_info *mtd, loff_t from, size_t len,
 		     size_t *retlen, u_char **mtdbuf);
 static void cfi_intelext_unpoint (struct mtd_info *mtd, u_char *addr, loff_t from,
 			size_t len);
+static int cfi_intelext_point_pfn (struct mtd_info *mtd, loff_t from,
+			unsigned long *pfn);
 
 static int get_chip(struct map_info *map, struct flchip *chip, unsigned long adr, int mode);
 static void put_chip(struct map_info *map, struct flchip *chip, unsigned long adr);
@@ -207,6 +209,7 @@ static void fixup_use_point(struct mtd_info *mtd, void *param)
 	if (!mtd->point && map_is_linear(map)) {
 		mtd->point   = cfi_intelext_point;
 		mtd->unpoint = cfi_intelext_unpoint;
+		mtd->point_pfn = cfi_intelext_point_pfn;
 	}
 }
 
@@ -1211,6 +1214,22 @@ static int cfi_intelext_point (struct mtd_info *mtd, loff_t from, size_t len, si
 	return 0;
 }
 
+static int cfi_intelext_point_pfn (struct mtd_info *mtd, loff_t from, unsigned long *pfn)
+{
+	struct map_info *map = mtd->priv;
+	unsigned long phys;
+
+	if (!map_is_linear(map) || from >= mtd->size)
+		return -EINVAL;
+
+	phys = map->phys + from;
+	if (phys & ~PAGE_MASK)
+		return -EINVAL;
+
+	*pfn = phys >> PAGE_SHIFT;
+	return 0;
+}
+
 static void cfi_intelext_unpoint (struct mtd_info *mtd, u_char *addr, loff_t from, size_t len)
 {
 	struct map_info *map = mtd->priv;
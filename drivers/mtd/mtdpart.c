@@ -86,6 +86,15 @@ static void part_unpoint (struct mtd_info *mtd, u_char *addr, loff_t from, size_
 	part->master->unpoint (part->master, addr, from + part->offset, len);
 }
 
+static int part_point_pfn (struct mtd_info *mtd, loff_t from, unsigned long *pfn)
+{
+	struct mtd_part *part = PART(mtd);
+
+	if (from >= mtd->size)
+		return -EINVAL;
+	return part->master->point_pfn (part->master, from + part->offset, pfn);
+}
+
 static int part_read_oob(struct mtd_info *mtd, loff_t from,
 			 struct mtd_oob_ops *ops)
 {
@@ -356,6 +365,8 @@ int add_mtd_partitions(struct mtd_info *master,
 		if(master->point && master->unpoint){
 			slave->mtd.point = part_point;
 			slave->mtd.unpoint = part_unpoint;
+			if (master->point_pfn)
+				slave->mtd.point_pfn = part_point_pfn;
 		}
 
 		if (master->read_oob)
@@ -165,7 +165,7 @@ static int __init h1910_init(void)
 	return 0;
 }
 
-module_init(h1910_init);
+device_initcall_async(h1910_init);
 
 /*
  * Clean up routine
@@ -185,7 +185,7 @@ static int __init palmtx_init(void)
 	return 0;
 }
 
-module_init(palmtx_init);
+device_initcall_async(palmtx_init);
 
 /*
  * Clean up routine
@@ -436,7 +436,7 @@ static void __exit tmio_nand_exit(void)
 	return driver_unregister (&tmio_nand_device);
 }
 
-module_init(tmio_nand_init);
+device_initcall_async(tmio_nand_init);
 module_exit(tmio_nand_exit);
 
 MODULE_LICENSE("GPL");
@@ -0,0 +1,503 @@
+/*
+ * UBI: attaching MTD devices, the /dev/ubi<N> control device and
+ * /proc/ubi.
+ *
+ * MTD devices are attached at load time with the mtd= parameter, by
+ * number or name, e.g. ubi.mtd=3 or ubi.mtd=rootfs on the kernel command
+ * line.  Each UBI device gets a misc device taking the ioctls of
+ * <mtd/ubi-user.h>, and each of its volumes an MTD device.
+ *
+ * This code is GPL
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/reboot.h>
+#include <linux/notifier.h>
+#include <linux/err.h>
+#include <asm/uaccess.h>
+#include <asm/div64.h>
+
+#include "ubi.h"
+
+struct ubi_device *ubi_devices[UBI_MAX_DEVICES];
+
+static char *mtd_dev[UBI_MAX_DEVICES];
+static int mtd_dev_count;
+module_param_array_named(mtd, mtd_dev, charp, &mtd_dev_count, 0400);
+MODULE_PARM_DESC(mtd, "MTD devices to attach, by number or name: "
+		 "mtd=<dev>[,<dev>...]");
+
+static struct ubi_device *ubi_by_minor(int minor)
+{
+	int i;
+
+	for (i = 0; i < UBI_MAX_DEVICES; i++)
+		if (ubi_devices[i] && ubi_devices[i]->cdev.minor == minor)
+			return ubi_devices[i];
+	return NULL;
+}
+
+static int ubi_cdev_open(struct inode *inode, struct file *file)
+{
+	struct ubi_device *ubi = ubi_by_minor(iminor(inode));
+
+	if (!ubi)
+		return -ENODEV;
+	file->private_data = ubi;
+	return 0;
+}
+
+static int ubi_cdev_release(struct inode *inode, struct file *file)
+{
+	struct ubi_device *ubi = file->private_data;
+	int i;
+
+	mutex_lock(&ubi->vol_mutex);
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i] && ubi->volumes[i]->upd_file == file)
+			ubi_abort_update(ubi->volumes[i]);
+	mutex_unlock(&ubi->vol_mutex);
+	return 0;
+}
+
+/* Update data for the volume UBI_IOCVOLUP was issued for on this file */
+static ssize_t ubi_cdev_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct ubi_device *ubi = file->private_data;
+	int i, err = -EINVAL;
+
+	mutex_lock(&ubi->vol_mutex);
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i] && ubi->volumes[i]->upd_file == file) {
+			err = ubi_more_update_data(ubi->volumes[i], buf,
+						   count);
+			break;
+		}
+	mutex_unlock(&ubi->vol_mutex);
+	return err;
+}
+
+static int mkvol(struct ubi_device *ubi, void __user *argp)
+{
+	struct ubi_mkvol_req req;
+	struct ubi_volume *vol;
+	int err;
+
+	if (copy_from_user(&req, argp, sizeof(req)))
+		return -EFAULT;
+	req.name[UBI_MAX_VOLUME_NAME] = '\0';
+
+	mutex_lock(&ubi->vol_mutex);
+	mutex_lock(&ubi->mutex);
+	err = ubi_create_volume(ubi, &req);
+	mutex_unlock(&ubi->mutex);
+	if (err)
+		goto out;
+
+	vol = ubi->volumes[req.vol_id];
+	err = ubi_gluebi_add(vol);
+	if (err) {
+		mutex_lock(&ubi->mutex);
+		ubi_remove_volume(ubi, req.vol_id);
+		mutex_unlock(&ubi->mutex);
+		goto out;
+	}
+
+	if (copy_to_user(argp, &req, sizeof(req)))
+		err = -EFAULT;
+out:
+	mutex_unlock(&ubi->vol_mutex);
+	return err;
+}
+
+static int rmvol(struct ubi_device *ubi, int vol_id)
+{
+	struct ubi_volume *vol;
+	int err;
+
+	if (vol_id < 0 || vol_id >= ubi->vtbl_slots)
+		return -EINVAL;
+
+	mutex_lock(&ubi->vol_mutex);
+	vol = ubi->volumes[vol_id];
+	err = -ENODEV;
+	if (!vol)
+		goto out;
+	err = -EBUSY;
+	if (vol->updating)
+		goto out;
+
+	err = ubi_gluebi_del(vol);
+	if (err)
+		goto out;
+
+	mutex_lock(&ubi->mutex);
+	err = ubi_remove_volume(ubi, vol_id);
+	mutex_unlock(&ubi->mutex);
+	if (err)
+		ubi_gluebi_add(vol);
+out:
+	mutex_unlock(&ubi->vol_mutex);
+	return err;
+}
+
+static int volup(struct ubi_device *ubi, struct file *file,
+		 void __user *argp)
+{
+	struct ubi_volup_req req;
+	int err;
+
+	if (copy_from_user(&req, argp, sizeof(req)))
+		return -EFAULT;
+	if (req.vol_id < 0 || req.vol_id >= ubi->vtbl_slots)
+		return -EINVAL;
+
+	mutex_lock(&ubi->vol_mutex);
+	if (ubi->volumes[req.vol_id])
+		err = ubi_start_update(ubi->volumes[req.vol_id], file,
+				       req.bytes);
+	else
+		err = -ENODEV;
+	mutex_unlock(&ubi->vol_mutex);
+	return err;
+}
+
+static int ubi_cdev_ioctl(struct inode *inode, struct file *file,
+			  unsigned int cmd, unsigned long arg)
+{
+	struct ubi_device *ubi = file->private_data;
+	void __user *argp = (void __user *)arg;
+	int32_t vol_id;
+
+	if (!capable(CAP_SYS_RESOURCE))
+		return -EPERM;
+
+	switch (cmd) {
+	case UBI_IOCMKVOL:
+		return mkvol(ubi, argp);
+
+	case UBI_IOCRMVOL:
+		if (get_user(vol_id, (int32_t __user *)argp))
+			return -EFAULT;
+		return rmvol(ubi, vol_id);
+
+	case UBI_IOCVOLUP:
+		return volup(ubi, file, argp);
+	}
+	return -ENOTTY;
+}
+
+static const struct file_operations ubi_cdev_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ubi_cdev_open,
+	.release	= ubi_cdev_release,
+	.write		= ubi_cdev_write,
+	.ioctl		= ubi_cdev_ioctl,
+};
+
+#ifdef CONFIG_PROC_FS
+
+static void ubi_show(struct seq_file *m, struct ubi_device *ubi)
+{
+	long long ec_sum = 0;
+	int i, ec_count = 0, ec_min = INT_MAX, ec_max = 0;
+
+	for (i = 0; i < ubi->peb_count; i++) {
+		struct ubi_peb *peb = &ubi->pebs[i];
+
+		if (peb->state == UBI_PEB_BAD)
+			continue;
+		ec_sum += peb->ec;
+		ec_count++;
+		ec_min = min(ec_min, peb->ec);
+		ec_max = max(ec_max, peb->ec);
+	}
+	if (ec_count)
+		do_div(ec_sum, ec_count);
+	else
+		ec_min = 0;
+
+	seq_printf(m, "ubi%d: mtd%d \"%s\", attached by %s%s\n",
+		   ubi->ubi_num, ubi->mtd->index, ubi->mtd->name,
+		   ubi->fm_attached ? "fast attach map" : "scanning",
+		   ubi->ro_mode ? ", read-only" : "");
+	seq_printf(m, "  PEBs: %d x %d KiB, LEB size %d, min. I/O %d\n",
+		   ubi->peb_count, ubi->peb_size >> 10, ubi->leb_size,
+		   ubi->min_io_size);
+	seq_printf(m, "  good %d, bad %d, reserved for bad PEBs %d, "
+		   "available %d\n", ubi->good_peb_count, ubi->bad_peb_count,
+		   ubi->beb_rsvd_pebs, ubi->avail_pebs);
+	seq_printf(m, "  free %d, to erase %d, to scrub %d\n",
+		   ubi->free_count, ubi->erase_count, ubi->scrub_count);
+	seq_printf(m, "  erase counters: min %d, max %d, mean %lld, "
+		   "threshold %d\n", ec_min, ec_max, ec_sum, UBI_WL_THRESHOLD);
+	seq_printf(m, "  erasures %lu, WL moves %lu, scrubs %lu, "
+		   "corrected reads %lu\n", ubi->stat_erases,
+		   ubi->stat_wl_moves, ubi->stat_scrubs, ubi->stat_bitflips);
+
+	for (i = 0; i < ubi->vtbl_slots; i++) {
+		struct ubi_volume *vol = ubi->volumes[i];
+		int lnum, mapped = 0;
+
+		if (!vol)
+			continue;
+		for (lnum = 0; lnum < vol->reserved_pebs; lnum++)
+			if (vol->eba_tbl[lnum] != UBI_LEB_UNMAPPED)
+				mapped++;
+		seq_printf(m, "  volume %d: \"%s\", %d LEBs, %d mapped%s%s\n",
+			   vol->vol_id, vol->name, vol->reserved_pebs, mapped,
+			   vol->upd_marker ? ", update marker set" : "",
+			   vol->updating ? ", updating" : "");
+	}
+}
+
+static int ubi_proc_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	for (i = 0; i < UBI_MAX_DEVICES; i++) {
+		struct ubi_device *ubi = ubi_devices[i];
+
+		if (!ubi)
+			continue;
+		mutex_lock(&ubi->mutex);
+		ubi_show(m, ubi);
+		mutex_unlock(&ubi->mutex);
+	}
+	return 0;
+}
+
+static int ubi_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ubi_proc_show, NULL);
+}
+
+static const struct file_operations ubi_proc_fops = {
+	.open		= ubi_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#endif /* CONFIG_PROC_FS */
+
+#ifdef CONFIG_MTD_UBI_FASTMAP
+
+/*
+ * Write the fast attach maps on reboot.  Userspace has unmounted or
+ * remounted read-only by now; the devices stay read-only afterwards.
+ */
+static int ubi_reboot_notifier(struct notifier_block *nb, unsigned long val,
+			       void *v)
+{
+	int i;
+
+	for (i = 0; i < UBI_MAX_DEVICES; i++) {
+		struct ubi_device *ubi = ubi_devices[i];
+
+		if (!ubi)
+			continue;
+		mutex_lock(&ubi->mutex);
+		if (!ubi->ro_mode) {
+			ubi_fm_write(ubi);
+			ubi->ro_mode = 1;
+		}
+		mutex_unlock(&ubi->mutex);
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block ubi_reboot_nb = {
+	.notifier_call	= ubi_reboot_notifier,
+};
+
+#endif /* CONFIG_MTD_UBI_FASTMAP */
+
+static struct mtd_info *open_mtd(const char *name)
+{
+	char *endp;
+	int num;
+
+	num = simple_strtoul(name, &endp, 0);
+	if (*name && !*endp)
+		return get_mtd_device(NULL, num);
+	return get_mtd_device_nm(name);
+}
+
+static void free_ubi(struct ubi_device *ubi)
+{
+	int i;
+
+	for (i = 0; i <= UBI_MAX_VOLUMES; i++)
+		if (ubi->volumes[i])
+			ubi_free_volume(ubi->volumes[i]);
+	vfree(ubi->vtbl);
+	vfree(ubi->pebs);
+	vfree(ubi->peb_buf);
+	kfree(ubi->hdr_buf);
+	kfree(ubi);
+}
+
+static int attach_mtd(struct mtd_info *mtd, int ubi_num)
+{
+	struct ubi_device *ubi;
+	int i, err, hdr_size;
+
+	if (mtd->type == MTD_UBIVOLUME) {
+		ubi_err("refusing to attach UBI volume \"%s\"", mtd->name);
+		return -EINVAL;
+	}
+	if (!(mtd->flags & MTD_WRITEABLE)) {
+		ubi_err("MTD device \"%s\" is read-only", mtd->name);
+		return -EROFS;
+	}
+
+	hdr_size = ALIGN(UBI_EC_HDR_SIZE, mtd->writesize);
+	if (mtd->erasesize <= 4 * hdr_size) {
+		ubi_err("eraseblocks of \"%s\" are too small", mtd->name);
+		return -EINVAL;
+	}
+
+	ubi = kzalloc(sizeof(struct ubi_device), GFP_KERNEL);
+	if (!ubi)
+		return -ENOMEM;
+
+	ubi->ubi_num = ubi_num;
+	ubi->mtd = mtd;
+	ubi->peb_size = mtd->erasesize;
+	ubi->peb_count = mtd->size / mtd->erasesize;
+	ubi->min_io_size = mtd->writesize;
+	ubi->vid_hdr_offset = hdr_size;
+	ubi->data_offset = 2 * hdr_size;
+	ubi->leb_size = ubi->peb_size - ubi->data_offset;
+	mutex_init(&ubi->mutex);
+	mutex_init(&ubi->vol_mutex);
+	spin_lock_init(&ubi->vol_lock);
+
+	err = -ENOMEM;
+	ubi->pebs = vmalloc(ubi->peb_count * sizeof(struct ubi_peb));
+	ubi->peb_buf = vmalloc(ubi->peb_size);
+	ubi->hdr_buf = kmalloc(hdr_size, GFP_KERNEL);
+	if (!ubi->pebs || !ubi->peb_buf || !ubi->hdr_buf)
+		goto out_free;
+
+	mutex_lock(&ubi->mutex);
+	err = ubi_attach(ubi);
+	mutex_unlock(&ubi->mutex);
+	if (err)
+		goto out_free;
+
+	sprintf(ubi->cdev_name, UBI_NAME_STR "%d", ubi_num);
+	ubi->cdev.minor = MISC_DYNAMIC_MINOR;
+	ubi->cdev.name = ubi->cdev_name;
+	ubi->cdev.fops = &ubi_cdev_fops;
+	ubi_devices[ubi_num] = ubi;
+	err = misc_register(&ubi->cdev);
+	if (err) {
+		ubi_devices[ubi_num] = NULL;
+		goto out_free;
+	}
+
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i])
+			ubi_gluebi_add(ubi->volumes[i]);
+
+	ubi_wl_start(ubi);
+
+	ubi_msg("attached mtd%d \"%s\" to ubi%d", mtd->index, mtd->name,
+		ubi_num);
+	ubi_msg("%d PEBs of %d KiB, LEB size %d, %d bad, %d available",
+		ubi->peb_count, ubi->peb_size >> 10, ubi->leb_size,
+		ubi->bad_peb_count, ubi->avail_pebs);
+	return 0;
+
+out_free:
+	free_ubi(ubi);
+	return err;
+}
+
+static void detach_ubi(struct ubi_device *ubi)
+{
+	int i;
+
+	ubi_wl_stop(ubi);
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i])
+			ubi_gluebi_del(ubi->volumes[i]);
+	misc_deregister(&ubi->cdev);
+	ubi_devices[ubi->ubi_num] = NULL;
+
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	mutex_lock(&ubi->mutex);
+	if (!ubi->ro_mode)
+		ubi_fm_write(ubi);
+	mutex_unlock(&ubi->mutex);
+#endif
+
+	put_mtd_device(ubi->mtd);
+	free_ubi(ubi);
+}
+
+static int __init ubi_init(void)
+{
+	int i, n = 0;
+
+	for (i = 0; i < mtd_dev_count; i++) {
+		struct mtd_info *mtd = open_mtd(mtd_dev[i]);
+
+		if (IS_ERR(mtd)) {
+			ubi_err("cannot open MTD device \"%s\"", mtd_dev[i]);
+			continue;
+		}
+		if (attach_mtd(mtd, n)) {
+			put_mtd_device(mtd);
+			continue;
+		}
+		n++;
+	}
+
+#ifdef CONFIG_PROC_FS
+	{
+		struct proc_dir_entry *entry;
+
+		entry = create_proc_entry("ubi", 0, NULL);
+		if (entry)
+			entry->proc_fops = &ubi_proc_fops;
+	}
+#endif
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	register_reboot_notifier(&ubi_reboot_nb);
+#endif
+	return 0;
+}
+
+static void __exit ubi_exit(void)
+{
+	int i;
+
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	unregister_reboot_notifier(&ubi_reboot_nb);
+#endif
+#ifdef CONFIG_PROC_FS
+	remove_proc_entry("ubi", NULL);
+#endif
+	for (i = 0; i < UBI_MAX_DEVICES; i++)
+		if (ubi_devices[i])
+			detach_ubi(ubi_devices[i]);
+}
+
+module_init(ubi_init);
+module_exit(ubi_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("UBI - wear leveling volume management for raw flash");
@@ -0,0 +1,264 @@
+/*
+ * UBI: eraseblock association, mapping LEBs of volumes to PEBs.
+ *
+ * A LEB is mapped on its first write by writing a VID header to a free
+ * PEB.  Unmapping only schedules the PEB for erasure.  When a LEB is
+ * copied to another PEB, for wear leveling, scrubbing, an atomic change
+ * or recovery from a write error, the copy gets the copy flag, a CRC of
+ * the data and a higher sequence number, so that attaching after a power
+ * cut can tell which of two PEBs claiming the same LEB is complete.
+ *
+ * Everything here is called with ubi->mutex held.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/crc32.h>
+
+#include "ubi.h"
+
+/* Attempts at writing a LEB before giving up */
+#define UBI_IO_RETRIES	3
+
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi)
+{
+	return ubi->global_sqnum++;
+}
+
+struct ubi_volume *ubi_eba_volume(struct ubi_device *ubi, int vol_id)
+{
+	int i;
+
+	for (i = 0; i <= UBI_MAX_VOLUMES; i++)
+		if (ubi->volumes[i] && ubi->volumes[i]->vol_id == vol_id)
+			return ubi->volumes[i];
+	return NULL;
+}
+
+static void init_vid_hdr(struct ubi_volume *vol, int lnum,
+			 struct ubi_vid_hdr *vid_hdr)
+{
+	memset(vid_hdr, 0, UBI_VID_HDR_SIZE);
+	vid_hdr->vol_id = cpu_to_be32(vol->vol_id);
+	vid_hdr->lnum = cpu_to_be32(lnum);
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(vol->ubi));
+}
+
+static void map_leb(struct ubi_volume *vol, int lnum, int pnum)
+{
+	struct ubi_peb *peb = &vol->ubi->pebs[pnum];
+
+	vol->eba_tbl[lnum] = pnum;
+	peb->vol_idx = vol->idx;
+	peb->lnum = lnum;
+}
+
+/* Reading an unmapped LEB gives 0xFF, like reading erased flash */
+int ubi_eba_read_leb(struct ubi_volume *vol, int lnum, void *buf,
+		     int offset, int len)
+{
+	struct ubi_device *ubi = vol->ubi;
+	int pnum = vol->eba_tbl[lnum];
+	int err;
+
+	if (pnum == UBI_LEB_UNMAPPED) {
+		memset(buf, 0xFF, len);
+		return 0;
+	}
+
+	err = ubi_io_read(ubi, buf, pnum, ubi->data_offset + offset, len);
+	if (err == UBI_IO_BITFLIPS) {
+		ubi_wl_scrub_peb(ubi, pnum);
+		err = 0;
+	}
+	return err;
+}
+
+/*
+ * Write a LEB to a new PEB, with the copy flag and a data CRC if it is
+ * replacing one already mapped.  data is in ubi->peb_buf or the caller's
+ * buffer; len is the length to write, data_size what the CRC covers.
+ */
+static int write_new_peb(struct ubi_volume *vol, int lnum, const void *buf,
+			 int len, int data_size, int copy)
+{
+	struct ubi_device *ubi = vol->ubi;
+	struct ubi_vid_hdr vid_hdr;
+	int pnum, err, tries = 0;
+
+retry:
+	pnum = ubi_wl_get_peb(ubi, 0);
+	if (pnum < 0)
+		return pnum;
+
+	init_vid_hdr(vol, lnum, &vid_hdr);
+	if (copy) {
+		vid_hdr.copy_flag = 1;
+		vid_hdr.data_size = cpu_to_be32(data_size);
+		vid_hdr.data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, buf,
+						     data_size));
+	}
+
+	err = ubi_io_write_vid_hdr(ubi, pnum, &vid_hdr);
+	if (!err && len)
+		err = ubi_io_write(ubi, buf, pnum, ubi->data_offset, len);
+	if (err) {
+		ubi_wl_put_peb(ubi, pnum);
+		if (err == -EROFS || ++tries == UBI_IO_RETRIES)
+			return err;
+		ubi_warn("write to PEB %d failed, trying another one", pnum);
+		goto retry;
+	}
+	return pnum;
+}
+
+/*
+ * Writing to an already mapped PEB failed.  Move the data written so far
+ * plus the new data to another PEB; the old one is erased, which marks it
+ * bad if it is really broken.
+ */
+static int recover_peb(struct ubi_volume *vol, int lnum, const void *buf,
+		       int offset, int len)
+{
+	struct ubi_device *ubi = vol->ubi;
+	int old = vol->eba_tbl[lnum];
+	int pnum, err;
+
+	if (offset) {
+		err = ubi_io_read(ubi, ubi->peb_buf, old, ubi->data_offset,
+				  offset);
+		if (err < 0)
+			return err;
+	}
+	memcpy(ubi->peb_buf + offset, buf, len);
+
+	pnum = write_new_peb(vol, lnum, ubi->peb_buf, offset + len,
+			     offset + len, 1);
+	if (pnum < 0)
+		return pnum;
+
+	ubi_msg("data of LEB %d:%d moved from PEB %d to PEB %d after a "
+		"write error", vol->vol_id, lnum, old, pnum);
+	map_leb(vol, lnum, pnum);
+	ubi_wl_put_peb(ubi, old);
+	return 0;
+}
+
+int ubi_eba_write_leb(struct ubi_volume *vol, int lnum, const void *buf,
+		      int offset, int len)
+{
+	struct ubi_device *ubi = vol->ubi;
+	int pnum = vol->eba_tbl[lnum];
+	int err;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	if (pnum != UBI_LEB_UNMAPPED) {
+		err = ubi_io_write(ubi, buf, pnum, ubi->data_offset + offset,
+				   len);
+		if (err && err != -EROFS)
+			err = recover_peb(vol, lnum, buf, offset, len);
+		return err;
+	}
+
+	if (offset) {
+		/* Keep the data at its offset within the new PEB */
+		memset(ubi->peb_buf, 0xFF, offset);
+		memcpy(ubi->peb_buf + offset, buf, len);
+		buf = ubi->peb_buf;
+		len += offset;
+	}
+
+	pnum = write_new_peb(vol, lnum, buf, len, 0, 0);
+	if (pnum < 0)
+		return pnum;
+	map_leb(vol, lnum, pnum);
+	return 0;
+}
+
+/*
+ * Replace the contents of a LEB so that after a power cut either the old
+ * or the new contents are found, never a mix.
+ */
+int ubi_eba_atomic_leb_change(struct ubi_volume *vol, int lnum,
+			      const void *buf, int len)
+{
+	struct ubi_device *ubi = vol->ubi;
+	int old = vol->eba_tbl[lnum];
+	int aligned = ALIGN(len, ubi->min_io_size);
+	int pnum;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	memcpy(ubi->peb_buf, buf, len);
+	memset(ubi->peb_buf + len, 0xFF, aligned - len);
+
+	pnum = write_new_peb(vol, lnum, ubi->peb_buf, aligned, len, 1);
+	if (pnum < 0)
+		return pnum;
+
+	map_leb(vol, lnum, pnum);
+	if (old != UBI_LEB_UNMAPPED)
+		ubi_wl_put_peb(ubi, old);
+	return 0;
+}
+
+int ubi_eba_unmap_leb(struct ubi_volume *vol, int lnum)
+{
+	int pnum = vol->eba_tbl[lnum];
+
+	if (pnum == UBI_LEB_UNMAPPED)
+		return 0;
+	if (vol->ubi->ro_mode)
+		return -EROFS;
+
+	vol->eba_tbl[lnum] = UBI_LEB_UNMAPPED;
+	ubi_wl_put_peb(vol->ubi, pnum);
+	return 0;
+}
+
+/*
+ * Copy the LEB held by PEB from to the free PEB to and update the map.
+ * Only the data up to the last non-0xFF minimal I/O unit is copied, so
+ * whoever owns the LEB can go on appending to it in the new PEB.
+ */
+int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to)
+{
+	struct ubi_peb *peb = &ubi->pebs[from];
+	struct ubi_volume *vol = ubi->volumes[peb->vol_idx];
+	struct ubi_vid_hdr vid_hdr;
+	int lnum = peb->lnum;
+	int err, data_size;
+
+	if (!vol || vol->eba_tbl[lnum] != from) {
+		ubi_err("PEB %d is not mapped", from);
+		return -EINVAL;
+	}
+
+	err = ubi_io_read(ubi, ubi->peb_buf, from, ubi->data_offset,
+			  ubi->leb_size);
+	if (err < 0)
+		return err;
+
+	data_size = ubi_calc_data_len(ubi, ubi->peb_buf, ubi->leb_size);
+
+	init_vid_hdr(vol, lnum, &vid_hdr);
+	vid_hdr.copy_flag = 1;
+	vid_hdr.data_size = cpu_to_be32(data_size);
+	vid_hdr.data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, ubi->peb_buf,
+					     data_size));
+
+	err = ubi_io_write_vid_hdr(ubi, to, &vid_hdr);
+	if (!err && data_size)
+		err = ubi_io_write(ubi, ubi->peb_buf, to, ubi->data_offset,
+				   data_size);
+	if (err)
+		return err;
+
+	map_leb(vol, lnum, to);
+	return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * UBI: gluebi, presenting each volume as an MTD device.
+ *
+ * The MTD device has the LEB size as eraseblock size and never reports
+ * bad blocks, so JFFS2 and the MTD block and char drivers work on top of
+ * a volume unchanged.  Erasing unmaps the LEBs and waits for their PEBs
+ * to be erased, so the erased state survives a power cut as it does on
+ * raw flash.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mtd/mtd.h>
+
+#include "ubi.h"
+
+static int gluebi_get_device(struct mtd_info *mtd)
+{
+	struct ubi_volume *vol = mtd->priv;
+	struct ubi_device *ubi = vol->ubi;
+	int err = 0;
+
+	spin_lock(&ubi->vol_lock);
+	if (vol->updating || vol->upd_marker)
+		err = -EBUSY;
+	else
+		vol->readers++;
+	spin_unlock(&ubi->vol_lock);
+	return err;
+}
+
+static void gluebi_put_device(struct mtd_info *mtd)
+{
+	struct ubi_volume *vol = mtd->priv;
+	struct ubi_device *ubi = vol->ubi;
+
+	spin_lock(&ubi->vol_lock);
+	vol->readers--;
+	spin_unlock(&ubi->vol_lock);
+}
+
+static int gluebi_read(struct mtd_info *mtd, loff_t from, size_t len,
+		       size_t *retlen, unsigned char *buf)
+{
+	struct ubi_volume *vol = mtd->priv;
+	struct ubi_device *ubi = vol->ubi;
+	int lnum, offset, err = 0;
+
+	*retlen = 0;
+	if (from < 0 || from + len > mtd->size)
+		return -EINVAL;
+
+	lnum = (u32)from / mtd->erasesize;
+	offset = (u32)from % mtd->erasesize;
+
+	mutex_lock(&ubi->mutex);
+	while (len) {
+		size_t n = min_t(size_t, len, mtd->erasesize - offset);
+
+		err = ubi_eba_read_leb(vol, lnum, buf, offset, n);
+		if (err)
+			break;
+		*retlen += n;
+		buf += n;
+		len -= n;
+		lnum++;
+		offset = 0;
+	}
+	mutex_unlock(&ubi->mutex);
+	return err;
+}
+
+static int gluebi_write(struct mtd_info *mtd, loff_t to, size_t len,
+			size_t *retlen, const unsigned char *buf)
+{
+	struct ubi_volume *vol = mtd->priv;
+	struct ubi_device *ubi = vol->ubi;
+	int lnum, offset, err = 0;
+
+	*retlen = 0;
+	if (to < 0 || to + len > mtd->size)
+		return -EINVAL;
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	lnum = (u32)to / mtd->erasesize;
+	offset = (u32)to % mtd->erasesize;
+	if (offset % mtd->writesize || len % mtd->writesize)
+		return -EINVAL;
+
+	mutex_lock(&ubi->mutex);
+	while (len) {
+		size_t n = min_t(size_t, len, mtd->erasesize - offset);
+
+		err = ubi_eba_write_leb(vol, lnum, buf, offset, n);
+		if (err)
+			break;
+		*retlen += n;
+		buf += n;
+		len -= n;
+		lnum++;
+		offset = 0;
+	}
+	mutex_unlock(&ubi->mutex);
+	return err;
+}
+
+static int gluebi_erase(struct mtd_info *mtd, struct erase_info *instr)
+{
+	struct ubi_volume *vol = mtd->priv;
+	struct ubi_device *ubi = vol->ubi;
+	int lnum, count, err = 0;
+
+	if (instr->addr + instr->len > mtd->size ||
+	    instr->addr % mtd->erasesize || instr->len % mtd->erasesize)
+		return -EINVAL;
+
+	lnum = instr->addr / mtd->erasesize;
+	count = instr->len / mtd->erasesize;
+
+	mutex_lock(&ubi->mutex);
+	while (count-- && !err)
+		err = ubi_eba_unmap_leb(vol, lnum++);
+	if (!err)
+		err = ubi_wl_flush(ubi);
+	mutex_unlock(&ubi->mutex);
+
+	if (err) {
+		instr->state = MTD_ERASE_FAILED;
+		instr->fail_addr = (lnum - 1) * mtd->erasesize;
+		return err;
+	}
+	instr->state = MTD_ERASE_DONE;
+	mtd_erase_callback(instr);
+	return 0;
+}
+
+/* Register the MTD device for vol; called without ubi->mutex */
+int ubi_gluebi_add(struct ubi_volume *vol)
+{
+	struct ubi_device *ubi = vol->ubi;
+	struct mtd_info *mtd = &vol->gluebi;
+
+	memset(mtd, 0, sizeof(struct mtd_info));
+	mtd->name = vol->name;
+	mtd->type = MTD_UBIVOLUME;
+	mtd->flags = MTD_WRITEABLE;
+	mtd->writesize = ubi->min_io_size;
+	mtd->erasesize = ubi->leb_size;
+	mtd->size = vol->reserved_pebs * ubi->leb_size;
+	mtd->owner = THIS_MODULE;
+	mtd->read = gluebi_read;
+	mtd->write = gluebi_write;
+	mtd->erase = gluebi_erase;
+	mtd->get_device = gluebi_get_device;
+	mtd->put_device = gluebi_put_device;
+	mtd->priv = vol;
+
+	if (add_mtd_device(mtd)) {
+		ubi_err("cannot add MTD device for volume %d", vol->vol_id);
+		return -ENFILE;
+	}
+	vol->gluebi_registered = 1;
+	return 0;
+}
+
+/* Returns -EBUSY if the MTD device is in use */
+int ubi_gluebi_del(struct ubi_volume *vol)
+{
+	int err;
+
+	if (!vol->gluebi_registered)
+		return 0;
+	err = del_mtd_device(&vol->gluebi);
+	if (err)
+		return err;
+	vol->gluebi_registered = 0;
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * UBI: flash I/O and the EC/VID header readers and writers.
+ *
+ * Everything here is called with ubi->mutex held.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/wait.h>
+#include <linux/crc32.h>
+#include <linux/string.h>
+#include <linux/err.h>
+
+#include "ubi.h"
+
+static inline loff_t peb_addr(struct ubi_device *ubi, int pnum, int offset)
+{
+	return (loff_t)pnum * ubi->peb_size + offset;
+}
+
+/*
+ * Read from a PEB.  Returns 0, UBI_IO_BITFLIPS if the data had to be
+ * corrected, -EBADMSG if it could not be, or another -errno.
+ */
+int ubi_io_read(struct ubi_device *ubi, void *buf, int pnum, int offset,
+		int len)
+{
+	size_t read = 0;
+	int err;
+
+	err = ubi->mtd->read(ubi->mtd, peb_addr(ubi, pnum, offset), len,
+			     &read, buf);
+	if (err == -EUCLEAN) {
+		ubi->stat_bitflips++;
+		return UBI_IO_BITFLIPS;
+	}
+	if (err == -EBADMSG)
+		return err;
+	if (err || read != len) {
+		ubi_err("error %d reading %d bytes from PEB %d:%d, read %zd",
+			err, len, pnum, offset, read);
+		return err ? err : -EIO;
+	}
+	return 0;
+}
+
+int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum,
+		 int offset, int len)
+{
+	size_t written = 0;
+	int err;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	err = ubi->mtd->write(ubi->mtd, peb_addr(ubi, pnum, offset), len,
+			      &written, buf);
+	if (err || written != len) {
+		ubi_err("error %d writing %d bytes to PEB %d:%d, written %zd",
+			err, len, pnum, offset, written);
+		return -EIO;
+	}
+	return 0;
+}
+
+static void erase_callback(struct erase_info *ei)
+{
+	wake_up((wait_queue_head_t *)ei->priv);
+}
+
+int ubi_io_erase(struct ubi_device *ubi, int pnum)
+{
+	struct erase_info ei;
+	wait_queue_head_t wq;
+	int err;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	init_waitqueue_head(&wq);
+	memset(&ei, 0, sizeof(struct erase_info));
+	ei.mtd = ubi->mtd;
+	ei.addr = peb_addr(ubi, pnum, 0);
+	ei.len = ubi->peb_size;
+	ei.callback = erase_callback;
+	ei.priv = (unsigned long)&wq;
+
+	err = ubi->mtd->erase(ubi->mtd, &ei);
+	if (err) {
+		ubi_err("cannot erase PEB %d, error %d", pnum, err);
+		return -EIO;
+	}
+	wait_event(wq, ei.state == MTD_ERASE_DONE ||
+		       ei.state == MTD_ERASE_FAILED);
+	if (ei.state == MTD_ERASE_FAILED) {
+		ubi_err("erasure of PEB %d failed", pnum);
+		return -EIO;
+	}
+	ubi->stat_erases++;
+	return 0;
+}
+
+int ubi_io_is_bad(struct ubi_device *ubi, int pnum)
+{
+	int ret;
+
+	if (!ubi->mtd->block_isbad)
+		return 0;
+
+	ret = ubi->mtd->block_isbad(ubi->mtd, peb_addr(ubi, pnum, 0));
+	if (ret < 0)
+		ubi_err("error %d checking PEB %d", ret, pnum);
+	return ret != 0;
+}
+
+int ubi_io_mark_bad(struct ubi_device *ubi, int pnum)
+{
+	if (!ubi->mtd->block_markbad)
+		return 0;
+	return ubi->mtd->block_markbad(ubi->mtd, peb_addr(ubi, pnum, 0));
+}
+
+static int all_ff(const void *buf, int len)
+{
+	const u8 *p = buf;
+	int i;
+
+	for (i = 0; i < len; i++)
+		if (p[i] != 0xFF)
+			return 0;
+	return 1;
+}
+
+/*
+ * Read the EC header of a PEB.  Returns 0 (or UBI_IO_BITFLIPS) with *ec
+ * set, UBI_IO_PEB_EMPTY, UBI_IO_BAD_HDR, or -errno.  A header written by
+ * an incompatible UBI gives -EINVAL so that attaching stops rather than
+ * wiping it.
+ */
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum, long long *ec)
+{
+	struct ubi_ec_hdr *hdr = ubi->hdr_buf;
+	int err, read_err;
+
+	read_err = ubi_io_read(ubi, hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	if (read_err < 0 && read_err != -EBADMSG)
+		return read_err;
+
+	if (all_ff(hdr, UBI_EC_HDR_SIZE))
+		return UBI_IO_PEB_EMPTY;
+
+	if (be32_to_cpu(hdr->magic) != UBI_EC_HDR_MAGIC ||
+	    crc32(UBI_CRC32_INIT, hdr, UBI_EC_HDR_CRC_SIZE) !=
+	    be32_to_cpu(hdr->hdr_crc))
+		return UBI_IO_BAD_HDR;
+
+	if (hdr->version != UBI_VERSION) {
+		ubi_err("PEB %d has UBI version %d, this is version %d",
+			pnum, hdr->version, UBI_VERSION);
+		return -EINVAL;
+	}
+	if (be32_to_cpu(hdr->vid_hdr_offset) != ubi->vid_hdr_offset ||
+	    be32_to_cpu(hdr->data_offset) != ubi->data_offset) {
+		ubi_err("PEB %d: headers at %d/%d, expected %d/%d", pnum,
+			be32_to_cpu(hdr->vid_hdr_offset),
+			be32_to_cpu(hdr->data_offset),
+			ubi->vid_hdr_offset, ubi->data_offset);
+		return -EINVAL;
+	}
+
+	*ec = be64_to_cpu(hdr->ec);
+	err = read_err == UBI_IO_BITFLIPS ? UBI_IO_BITFLIPS : 0;
+	return err;
+}
+
+/* Write the EC header of a freshly erased PEB */
+int ubi_io_write_ec_hdr(struct ubi_device *ubi, int pnum, long long ec)
+{
+	struct ubi_ec_hdr *hdr = ubi->hdr_buf;
+
+	memset(hdr, 0xFF, ubi->vid_hdr_offset);
+	memset(hdr, 0, UBI_EC_HDR_SIZE);
+	hdr->magic = cpu_to_be32(UBI_EC_HDR_MAGIC);
+	hdr->version = UBI_VERSION;
+	hdr->ec = cpu_to_be64(ec);
+	hdr->vid_hdr_offset = cpu_to_be32(ubi->vid_hdr_offset);
+	hdr->data_offset = cpu_to_be32(ubi->data_offset);
+	hdr->hdr_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, hdr,
+					 UBI_EC_HDR_CRC_SIZE));
+
+	return ubi_io_write(ubi, hdr, pnum, 0, ubi->vid_hdr_offset);
+}
+
+/* Like ubi_io_read_ec_hdr(), for the VID header */
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_hdr *vid_hdr)
+{
+	int read_err;
+
+	read_err = ubi_io_read(ubi, vid_hdr, pnum, ubi->vid_hdr_offset,
+			       UBI_VID_HDR_SIZE);
+	if (read_err < 0 && read_err != -EBADMSG)
+		return read_err;
+
+	if (all_ff(vid_hdr, UBI_VID_HDR_SIZE))
+		return UBI_IO_PEB_EMPTY;
+
+	if (be32_to_cpu(vid_hdr->magic) != UBI_VID_HDR_MAGIC ||
+	    crc32(UBI_CRC32_INIT, vid_hdr, UBI_VID_HDR_CRC_SIZE) !=
+	    be32_to_cpu(vid_hdr->hdr_crc))
+		return UBI_IO_BAD_HDR;
+
+	if (vid_hdr->version != UBI_VERSION ||
+	    vid_hdr->vol_type != UBI_VID_DYNAMIC)
+		return UBI_IO_BAD_HDR;
+
+	return read_err == UBI_IO_BITFLIPS ? UBI_IO_BITFLIPS : 0;
+}
+
+/* Fill in magic, version and CRC of vid_hdr and write it to PEB pnum */
+int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr)
+{
+	void *buf = ubi->hdr_buf;
+
+	vid_hdr->magic = cpu_to_be32(UBI_VID_HDR_MAGIC);
+	vid_hdr->version = UBI_VERSION;
+	vid_hdr->vol_type = UBI_VID_DYNAMIC;
+	vid_hdr->hdr_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, vid_hdr,
+					     UBI_VID_HDR_CRC_SIZE));
+
+	memset(buf, 0xFF, ubi->vid_hdr_offset);
+	memcpy(buf, vid_hdr, UBI_VID_HDR_SIZE);
+	return ubi_io_write(ubi, buf, pnum, ubi->vid_hdr_offset,
+			    ubi->vid_hdr_offset);
+}
+
+/*
+ * Length of the data in buf once trailing 0xFF bytes are dropped,
+ * rounded up to the minimal I/O unit.  Copying only that much leaves
+ * the rest of the new PEB erased and writable.
+ */
+int ubi_calc_data_len(struct ubi_device *ubi, const void *buf, int length)
+{
+	const u8 *p = buf;
+	int i;
+
+	for (i = length - 1; i >= 0; i--)
+		if (p[i] != 0xFF)
+			break;
+
+	return ALIGN(i + 1, ubi->min_io_size);
+}
@@ -0,0 +1,601 @@
+/*
+ * UBI: attaching an MTD device, by scanning it or from a fast attach map.
+ *
+ * A full scan reads the EC and VID headers of every PEB.  When two PEBs
+ * claim the same LEB, because a copy was interrupted or the old PEB was
+ * not erased yet, the one with the higher sequence number wins, unless
+ * it is a copy whose data CRC does not match.
+ *
+ * Scanning a large NAND device takes seconds, so on a clean detach the
+ * state is also written to a fast attach map (FM) in one or more free
+ * PEBs near the start of the device.  Attaching looks for it there
+ * first.  The map PEBs are erased before anything else is written, so a
+ * map that exists always describes the flash as it is.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include <linux/crc32.h>
+#include <asm/div64.h>
+
+#include "ubi.h"
+
+/* What attaching found out about a PEB besides struct ubi_peb */
+struct scan_peb {
+	unsigned long long sqnum;
+	int vol_id;
+	int lnum;
+	int data_size;
+	u32 data_crc;
+	unsigned char copy_flag;
+	unsigned char bitflips;
+	unsigned char fm;		/* holds (part of) a fast attach map */
+};
+
+static void scan_reset(struct ubi_device *ubi, struct scan_peb *si)
+{
+	int pnum;
+
+	memset(si, 0, ubi->peb_count * sizeof(struct scan_peb));
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		ubi->pebs[pnum].ec = 0;
+		ubi->pebs[pnum].state = UBI_PEB_ERASE;
+		ubi->pebs[pnum].scrub = 0;
+		ubi->pebs[pnum].vol_idx = -1;
+		ubi->pebs[pnum].lnum = UBI_LEB_UNMAPPED;
+	}
+	ubi->free_count = 0;
+	ubi->erase_count = 0;
+	ubi->scrub_count = 0;
+	ubi->bad_peb_count = 0;
+	ubi->global_sqnum = 0;
+
+	/*
+	 * Until the reserves are worked out, a PEB going bad while attaching
+	 * just lowers the good PEB count they are computed from.
+	 */
+	ubi->beb_rsvd_pebs = ubi->peb_count;
+}
+
+static void set_state(struct ubi_device *ubi, int pnum, int state)
+{
+	struct ubi_peb *peb = &ubi->pebs[pnum];
+
+	peb->state = state;
+	if (state == UBI_PEB_FREE)
+		ubi->free_count++;
+	else if (state == UBI_PEB_ERASE)
+		ubi->erase_count++;
+	else if (state == UBI_PEB_BAD)
+		ubi->bad_peb_count++;
+}
+
+static void scan_erase(struct ubi_device *ubi, int pnum)
+{
+	ubi->pebs[pnum].vol_idx = -1;
+	ubi->pebs[pnum].lnum = UBI_LEB_UNMAPPED;
+	set_state(ubi, pnum, UBI_PEB_ERASE);
+}
+
+static int data_crc_ok(struct ubi_device *ubi, struct scan_peb *s, int pnum)
+{
+	int err;
+
+	if (s->data_size > ubi->leb_size)
+		return 0;
+	err = ubi_io_read(ubi, ubi->peb_buf, pnum, ubi->data_offset,
+			  s->data_size);
+	if (err < 0)
+		return 0;
+	return crc32(UBI_CRC32_INIT, ubi->peb_buf, s->data_size) ==
+	       s->data_crc;
+}
+
+/* Which of two PEBs claiming the same LEB is the right one */
+static int compare_lebs(struct ubi_device *ubi, struct scan_peb *si,
+			int a, int b)
+{
+	int newer = si[a].sqnum > si[b].sqnum ? a : b;
+	int older = newer == a ? b : a;
+
+	if (si[newer].copy_flag && !data_crc_ok(ubi, &si[newer], newer)) {
+		ubi_warn("copy of LEB %d:%d in PEB %d is incomplete, using "
+			 "PEB %d", si[newer].vol_id, si[newer].lnum, newer,
+			 older);
+		return older;
+	}
+	return newer;
+}
+
+static void add_leb(struct ubi_device *ubi, struct scan_peb *si,
+		    struct ubi_volume *vol, int pnum)
+{
+	int lnum = si[pnum].lnum;
+	int old, winner;
+
+	if (lnum < 0 || lnum >= vol->reserved_pebs) {
+		scan_erase(ubi, pnum);
+		return;
+	}
+
+	old = vol->eba_tbl[lnum];
+	winner = pnum;
+	if (old != UBI_LEB_UNMAPPED) {
+		winner = compare_lebs(ubi, si, old, pnum);
+		scan_erase(ubi, winner == pnum ? old : pnum);
+	}
+
+	vol->eba_tbl[lnum] = winner;
+	ubi->pebs[winner].vol_idx = vol->idx;
+	ubi->pebs[winner].lnum = lnum;
+}
+
+static int scan_all(struct ubi_device *ubi, struct scan_peb *si, int *empty)
+{
+	struct ubi_vid_hdr vid_hdr;
+	long long ec, ec_sum = 0;
+	unsigned long long sqnum, max_sqnum = 0;
+	int pnum, err, vol_id, ec_count = 0, garbage = 0;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		struct ubi_peb *peb = &ubi->pebs[pnum];
+		struct scan_peb *s = &si[pnum];
+
+		if (ubi_io_is_bad(ubi, pnum)) {
+			set_state(ubi, pnum, UBI_PEB_BAD);
+			continue;
+		}
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, &ec);
+		if (err < 0)
+			return err;
+		if (err == UBI_IO_PEB_EMPTY || err == UBI_IO_BAD_HDR) {
+			/* Erase counter lost, use the mean below */
+			if (err == UBI_IO_BAD_HDR)
+				garbage++;
+			peb->ec = -1;
+			set_state(ubi, pnum, UBI_PEB_ERASE);
+			continue;
+		}
+		if (err == UBI_IO_BITFLIPS)
+			s->bitflips = 1;
+		peb->ec = ec;
+		ec_sum += ec;
+		ec_count++;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, &vid_hdr);
+		if (err < 0)
+			return err;
+		if (err == UBI_IO_PEB_EMPTY) {
+			set_state(ubi, pnum, UBI_PEB_FREE);
+			continue;
+		}
+		if (err == UBI_IO_BAD_HDR) {
+			/* Power cut while writing the VID header */
+			set_state(ubi, pnum, UBI_PEB_ERASE);
+			continue;
+		}
+		if (err == UBI_IO_BITFLIPS)
+			s->bitflips = 1;
+
+		vol_id = be32_to_cpu(vid_hdr.vol_id);
+		sqnum = be64_to_cpu(vid_hdr.sqnum);
+		if (sqnum > max_sqnum)
+			max_sqnum = sqnum;
+
+		if (vol_id == UBI_FM_VOLUME_ID) {
+			s->fm = 1;
+			set_state(ubi, pnum, UBI_PEB_ERASE);
+			continue;
+		}
+		if (vol_id != UBI_LAYOUT_VOLUME_ID &&
+		    (vol_id < 0 || vol_id >= UBI_MAX_VOLUMES)) {
+			ubi_warn("PEB %d belongs to unknown volume %d, erasing",
+				 pnum, vol_id);
+			set_state(ubi, pnum, UBI_PEB_ERASE);
+			continue;
+		}
+
+		peb->state = UBI_PEB_USED;
+		s->vol_id = vol_id;
+		s->lnum = be32_to_cpu(vid_hdr.lnum);
+		s->sqnum = sqnum;
+		s->copy_flag = vid_hdr.copy_flag;
+		s->data_size = be32_to_cpu(vid_hdr.data_size);
+		s->data_crc = be32_to_cpu(vid_hdr.data_crc);
+	}
+
+	*empty = 0;
+	if (!ec_count) {
+		if (garbage) {
+			ubi_err("MTD device \"%s\" does not contain UBI data",
+				ubi->mtd->name);
+			return -EINVAL;
+		}
+		ubi_msg("empty MTD device \"%s\", formatting it",
+			ubi->mtd->name);
+		*empty = 1;
+	} else
+		do_div(ec_sum, ec_count);
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (ubi->pebs[pnum].state != UBI_PEB_BAD &&
+		    ubi->pebs[pnum].ec < 0)
+			ubi->pebs[pnum].ec = ec_sum;
+
+	ubi->global_sqnum = max_sqnum + 1;
+	return 0;
+}
+
+#ifdef CONFIG_MTD_UBI_FASTMAP
+
+static int fm_size(struct ubi_device *ubi)
+{
+	return sizeof(struct ubi_fm_hdr) +
+	       ubi->peb_count * sizeof(struct ubi_fm_peb);
+}
+
+/*
+ * Load the state from a fast attach map.  Returns 0 on success, 1 if
+ * there is no usable map, or -errno on I/O errors.
+ */
+static int fm_attach(struct ubi_device *ubi, struct scan_peb *si)
+{
+	struct ubi_vid_hdr vid_hdr;
+	struct ubi_fm_hdr *hdr;
+	struct ubi_fm_peb *e;
+	unsigned long long sqnum, best = 0;
+	int fm_pnum[UBI_FM_MAX_START];
+	int pnum, lnum, err, ret = 1, found = 0;
+	int size = fm_size(ubi), nlebs = DIV_ROUND_UP(size, ubi->leb_size);
+	int max_pnum = min(UBI_FM_MAX_START, ubi->peb_count);
+	long long ec;
+	void *buf;
+
+	if (nlebs > UBI_FM_MAX_START)
+		return 1;
+
+	for (pnum = 0; pnum < max_pnum; pnum++) {
+		if (ubi_io_is_bad(ubi, pnum))
+			continue;
+		err = ubi_io_read_ec_hdr(ubi, pnum, &ec);
+		if (err < 0)
+			return err;
+		if (err == UBI_IO_PEB_EMPTY || err == UBI_IO_BAD_HDR)
+			continue;
+		err = ubi_io_read_vid_hdr(ubi, pnum, &vid_hdr);
+		if (err < 0)
+			return err;
+		if (err == UBI_IO_PEB_EMPTY || err == UBI_IO_BAD_HDR ||
+		    be32_to_cpu(vid_hdr.vol_id) != UBI_FM_VOLUME_ID)
+			continue;
+
+		si[pnum].fm = 1;
+		sqnum = be64_to_cpu(vid_hdr.sqnum);
+		lnum = be32_to_cpu(vid_hdr.lnum);
+		if (lnum < 0 || lnum >= nlebs)
+			continue;
+		if (!found || sqnum > best) {
+			best = sqnum;
+			found = 1;
+			memset(fm_pnum, 0xFF, sizeof(fm_pnum));
+		}
+		if (sqnum == best) {
+			fm_pnum[lnum] = pnum;
+			si[pnum].data_size = be32_to_cpu(vid_hdr.data_size);
+			si[pnum].data_crc = be32_to_cpu(vid_hdr.data_crc);
+		}
+	}
+	if (!found)
+		return 1;
+
+	buf = vmalloc(nlebs * ubi->leb_size);
+	if (!buf)
+		return -ENOMEM;
+
+	for (lnum = 0; lnum < nlebs; lnum++) {
+		int len = min(ubi->leb_size, size - lnum * ubi->leb_size);
+		void *p = buf + lnum * ubi->leb_size;
+
+		pnum = fm_pnum[lnum];
+		if (pnum < 0 || si[pnum].data_size != len) {
+			ubi_warn("fast attach map is incomplete");
+			goto out;
+		}
+		err = ubi_io_read(ubi, p, pnum, ubi->data_offset, len);
+		if (err < 0 ||
+		    crc32(UBI_CRC32_INIT, p, len) != si[pnum].data_crc) {
+			ubi_warn("fast attach map in PEB %d is corrupted",
+				 pnum);
+			goto out;
+		}
+	}
+
+	hdr = buf;
+	e = buf + sizeof(struct ubi_fm_hdr);
+	if (be32_to_cpu(hdr->magic) != UBI_FM_MAGIC ||
+	    crc32(UBI_CRC32_INIT, hdr, sizeof(struct ubi_fm_hdr) - 4) !=
+	    be32_to_cpu(hdr->hdr_crc) ||
+	    be32_to_cpu(hdr->peb_count) != ubi->peb_count ||
+	    crc32(UBI_CRC32_INIT, e, ubi->peb_count * sizeof(*e)) !=
+	    be32_to_cpu(hdr->data_crc)) {
+		ubi_warn("bad fast attach map header");
+		goto out;
+	}
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++, e++) {
+		ubi->pebs[pnum].ec = be32_to_cpu(e->ec);
+		switch (e->state) {
+		case UBI_FM_PEB_FREE:
+			set_state(ubi, pnum, UBI_PEB_FREE);
+			break;
+		case UBI_FM_PEB_ERASE:
+			set_state(ubi, pnum, UBI_PEB_ERASE);
+			break;
+		case UBI_FM_PEB_BAD:
+			set_state(ubi, pnum, UBI_PEB_BAD);
+			break;
+		case UBI_FM_PEB_USED:
+			ubi->pebs[pnum].state = UBI_PEB_USED;
+			si[pnum].vol_id = be32_to_cpu(e->vol_id);
+			si[pnum].lnum = be32_to_cpu(e->lnum);
+			break;
+		default:
+			ubi_warn("bad state %d of PEB %d in fast attach map",
+				 e->state, pnum);
+			goto out;
+		}
+	}
+
+	ubi->global_sqnum = be64_to_cpu(hdr->sqnum);
+	ubi_msg("attached from fast attach map in PEB %d", fm_pnum[0]);
+	ret = 0;
+out:
+	vfree(buf);
+	return ret;
+}
+
+/*
+ * Write the fast attach map.  Called on clean detach and on reboot;
+ * afterwards nothing may be written, so the caller detaches or switches
+ * the device to read-only mode.
+ */
+int ubi_fm_write(struct ubi_device *ubi)
+{
+	struct ubi_vid_hdr vid_hdr;
+	struct ubi_fm_hdr *hdr;
+	struct ubi_fm_peb *e;
+	unsigned long long sqnum;
+	int fm_pnum[UBI_FM_MAX_START];
+	int size = fm_size(ubi), nlebs = DIV_ROUND_UP(size, ubi->leb_size);
+	int max_pnum = min(UBI_FM_MAX_START, ubi->peb_count);
+	int i, n, pnum, err;
+	void *buf;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	err = ubi_wl_flush(ubi);
+	if (err)
+		return err;
+
+	for (pnum = n = 0; pnum < max_pnum && n < nlebs; pnum++)
+		if (ubi->pebs[pnum].state == UBI_PEB_FREE)
+			fm_pnum[n++] = pnum;
+	if (n < nlebs) {
+		ubi_warn("no room for a fast attach map, next attach will "
+			 "scan");
+		return -ENOSPC;
+	}
+
+	buf = vmalloc(nlebs * ubi->leb_size);
+	if (!buf)
+		return -ENOMEM;
+	memset(buf, 0xFF, nlebs * ubi->leb_size);
+
+	hdr = buf;
+	e = buf + sizeof(struct ubi_fm_hdr);
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		struct ubi_peb *peb = &ubi->pebs[pnum];
+
+		memset(&e[pnum], 0, sizeof(*e));
+		e[pnum].ec = cpu_to_be32(peb->ec);
+		switch (peb->state) {
+		case UBI_PEB_FREE:
+			e[pnum].state = UBI_FM_PEB_FREE;
+			break;
+		case UBI_PEB_USED:
+			e[pnum].state = UBI_FM_PEB_USED;
+			e[pnum].vol_id =
+				cpu_to_be32(ubi->volumes[peb->vol_idx]->vol_id);
+			e[pnum].lnum = cpu_to_be32(peb->lnum);
+			break;
+		case UBI_PEB_BAD:
+			e[pnum].state = UBI_FM_PEB_BAD;
+			break;
+		default:
+			e[pnum].state = UBI_FM_PEB_ERASE;
+			break;
+		}
+	}
+	/* The map's own PEBs are erased when it is read back */
+	for (i = 0; i < nlebs; i++)
+		e[fm_pnum[i]].state = UBI_FM_PEB_ERASE;
+
+	sqnum = ubi_next_sqnum(ubi);
+	hdr->magic = cpu_to_be32(UBI_FM_MAGIC);
+	hdr->peb_count = cpu_to_be32(ubi->peb_count);
+	hdr->sqnum = cpu_to_be64(ubi->global_sqnum);
+	hdr->data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, e,
+					  ubi->peb_count * sizeof(*e)));
+	hdr->hdr_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, hdr,
+					 sizeof(struct ubi_fm_hdr) - 4));
+
+	for (i = 0; i < nlebs; i++) {
+		int len = min(ubi->leb_size, size - i * ubi->leb_size);
+		void *p = buf + i * ubi->leb_size;
+
+		pnum = fm_pnum[i];
+		memset(&vid_hdr, 0, UBI_VID_HDR_SIZE);
+		vid_hdr.vol_id = cpu_to_be32(UBI_FM_VOLUME_ID);
+		vid_hdr.lnum = cpu_to_be32(i);
+		vid_hdr.sqnum = cpu_to_be64(sqnum);
+		vid_hdr.copy_flag = 1;
+		vid_hdr.data_size = cpu_to_be32(len);
+		vid_hdr.data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, p, len));
+
+		ubi->pebs[pnum].state = UBI_PEB_USED;
+		ubi->free_count--;
+		err = ubi_io_write_vid_hdr(ubi, pnum, &vid_hdr);
+		if (!err)
+			err = ubi_io_write(ubi, p, pnum, ubi->data_offset,
+					   ALIGN(len, ubi->min_io_size));
+		if (err)
+			goto out;
+	}
+
+	ubi_msg("fast attach map written to PEB %d", fm_pnum[0]);
+out:
+	vfree(buf);
+	return err;
+}
+
+#else
+
+static inline int fm_attach(struct ubi_device *ubi, struct scan_peb *si)
+{
+	return 1;
+}
+
+#endif /* CONFIG_MTD_UBI_FASTMAP */
+
+/* Work out the PEBs left for new volumes */
+static int calc_reserves(struct ubi_device *ubi)
+{
+	int i, reserved = UBI_LAYOUT_VOLUME_EBS + UBI_WL_RESERVED_PEBS;
+
+	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
+	ubi->beb_rsvd_pebs = 0;
+	if (ubi->mtd->block_isbad) {
+		ubi->beb_rsvd_pebs = ubi->good_peb_count *
+				     CONFIG_MTD_UBI_BEB_RESERVE / 100;
+		if (!ubi->beb_rsvd_pebs)
+			ubi->beb_rsvd_pebs = 1;
+	}
+
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i])
+			reserved += ubi->volumes[i]->reserved_pebs;
+
+	ubi->avail_pebs = ubi->good_peb_count - reserved - ubi->beb_rsvd_pebs;
+	if (ubi->avail_pebs < 0) {
+		ubi->beb_rsvd_pebs += ubi->avail_pebs;
+		ubi->avail_pebs = 0;
+		if (ubi->beb_rsvd_pebs < 0) {
+			ubi_err("%d good PEBs, %d needed",
+				ubi->good_peb_count, reserved);
+			return -ENOSPC;
+		}
+		ubi_warn("only %d PEBs reserved for bad PEB handling",
+			 ubi->beb_rsvd_pebs);
+	}
+	return 0;
+}
+
+static int build_volumes(struct ubi_device *ubi, struct scan_peb *si,
+			 int empty)
+{
+	struct ubi_volume *vol, *layout;
+	int pnum, err;
+
+	layout = ubi_alloc_volume(ubi, UBI_LAYOUT_VOLUME_ID,
+				  UBI_LAYOUT_VOLUME_EBS);
+	if (!layout)
+		return -ENOMEM;
+	layout->idx = UBI_LAYOUT_VOL_IDX;
+	strcpy(layout->name, "layout volume");
+	ubi->volumes[UBI_LAYOUT_VOL_IDX] = layout;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (ubi->pebs[pnum].state == UBI_PEB_USED &&
+		    si[pnum].vol_id == UBI_LAYOUT_VOLUME_ID)
+			add_leb(ubi, si, layout, pnum);
+
+	if (!empty && layout->eba_tbl[0] == UBI_LEB_UNMAPPED &&
+	    layout->eba_tbl[1] == UBI_LEB_UNMAPPED) {
+		ubi_err("volume table not found");
+		return -EINVAL;
+	}
+
+	err = ubi_vtbl_init(ubi, empty);
+	if (err)
+		return err;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		struct ubi_peb *peb = &ubi->pebs[pnum];
+
+		if (peb->state != UBI_PEB_USED || peb->vol_idx != -1)
+			continue;
+
+		vol = NULL;
+		if (si[pnum].vol_id >= 0 && si[pnum].vol_id < ubi->vtbl_slots)
+			vol = ubi->volumes[si[pnum].vol_id];
+		if (!vol) {
+			scan_erase(ubi, pnum);
+			continue;
+		}
+		add_leb(ubi, si, vol, pnum);
+	}
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (si[pnum].bitflips)
+			ubi_wl_scrub_peb(ubi, pnum);
+	return 0;
+}
+
+/*
+ * Attach ubi->mtd: fill in ubi->pebs, read the volume table and create
+ * the volumes.  The geometry and buffers are set up by the caller.
+ */
+int ubi_attach(struct ubi_device *ubi)
+{
+	struct scan_peb *si;
+	int pnum, err, empty = 0;
+
+	si = vmalloc(ubi->peb_count * sizeof(struct scan_peb));
+	if (!si)
+		return -ENOMEM;
+
+	scan_reset(ubi, si);
+	err = fm_attach(ubi, si);
+	if (err < 0)
+		goto out;
+	if (err) {
+		scan_reset(ubi, si);
+		err = scan_all(ubi, si, &empty);
+		if (err)
+			goto out;
+	} else
+		ubi->fm_attached = 1;
+
+	/* Get rid of any map before the first write */
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (si[pnum].fm && ubi->pebs[pnum].state == UBI_PEB_ERASE) {
+			err = ubi_wl_erase_peb(ubi, pnum);
+			if (err == -EROFS)
+				goto out;
+		}
+
+	err = build_volumes(ubi, si, empty);
+	if (err)
+		goto out;
+
+	err = calc_reserves(ubi);
+	ubi->wl_check = 1;
+out:
+	vfree(si);
+	return err;
+}
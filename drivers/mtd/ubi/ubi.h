@@ -0,0 +1,274 @@
+/*
+ * UBI: wear leveling volume management on top of raw MTD flash.
+ *
+ * UBI maps the logical eraseblocks (LEBs) of its volumes onto any
+ * physical eraseblock (PEB) of the underlying MTD device.  That lets it
+ * spread erasures over the whole device, move data off blocks which
+ * have been erased much less often than others, and copy data away from
+ * blocks that needed ECC correction on read before the bit flips become
+ * uncorrectable.
+ *
+ * All state of a UBI device is protected by ubi->mutex, including the
+ * flash I/O done on its behalf: NAND chips serve one operation at a time
+ * anyway, and this keeps moving a LEB atomic with respect to writers.
+ * The per volume reader counts are under ubi->vol_lock since they are
+ * changed from MTD's get_device() callback with mtd_table_mutex held.
+ * ubi->mutex is never held across add_mtd_device() or del_mtd_device():
+ * their notifiers may read the volume being added.
+ *
+ * This code is GPL
+ */
+
+#ifndef __UBI_UBI_H__
+#define __UBI_UBI_H__
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/mtd/mtd.h>
+#include <mtd/ubi-header.h>
+#include <mtd/ubi-user.h>
+
+#define UBI_NAME_STR		"ubi"
+#define UBI_MAX_DEVICES		4
+
+#define ubi_msg(fmt, ...) \
+	printk(KERN_NOTICE "UBI: " fmt "\n", ##__VA_ARGS__)
+#define ubi_warn(fmt, ...) \
+	printk(KERN_WARNING "UBI warning: %s: " fmt "\n", __FUNCTION__, \
+	       ##__VA_ARGS__)
+#define ubi_err(fmt, ...) \
+	printk(KERN_ERR "UBI error: %s: " fmt "\n", __FUNCTION__, \
+	       ##__VA_ARGS__)
+
+/* A free PEB is kept back for wear leveling and atomic LEB changes */
+#define UBI_WL_RESERVED_PEBS	1
+
+/* EC difference between free and used PEBs that triggers a move */
+#define UBI_WL_THRESHOLD	CONFIG_MTD_UBI_WL_THRESHOLD
+
+/* Marker for unmapped LEBs in the EBA tables */
+#define UBI_LEB_UNMAPPED	-1
+
+/* Return codes of the header readers besides 0 and -errno */
+enum {
+	UBI_IO_PEB_EMPTY = 1,	/* header area is all 0xFF */
+	UBI_IO_BAD_HDR,		/* magic or CRC mismatch */
+	UBI_IO_BITFLIPS,	/* read fine after ECC correction */
+};
+
+/* PEB states */
+enum {
+	UBI_PEB_FREE,		/* erased, with a valid EC header */
+	UBI_PEB_USED,		/* holds a LEB */
+	UBI_PEB_ERASE,		/* waiting to be erased */
+	UBI_PEB_BAD,
+};
+
+/**
+ * struct ubi_peb - per physical eraseblock state
+ * @ec:		erase counter
+ * @state:	UBI_PEB_*
+ * @scrub:	data needed ECC correction, move it elsewhere
+ * @vol_idx:	volume owning the PEB if used
+ * @lnum:	LEB it holds if used
+ */
+struct ubi_peb {
+	int ec;
+	unsigned char state;
+	unsigned char scrub;
+	short vol_idx;
+	int lnum;
+};
+
+/* Index of the layout volume in ubi->volumes[] */
+#define UBI_LAYOUT_VOL_IDX	UBI_MAX_VOLUMES
+
+struct ubi_device;
+
+/**
+ * struct ubi_volume - a UBI volume
+ * @ubi:		device it lives on
+ * @vol_id:		volume ID
+ * @idx:		index in ubi->volumes[], recorded in struct ubi_peb
+ * @reserved_pebs:	LEBs of the volume
+ * @upd_marker:		contents are incomplete, see UBI_IOCVOLUP
+ * @updating:		an update is in progress through @upd_file
+ * @readers:		gluebi users, see struct ubi_device
+ * @name:		volume name
+ * @eba_tbl:		LEB to PEB map
+ * @gluebi:		the MTD device presenting the volume
+ * @upd_file:		file doing the update
+ * @upd_bytes:		size of the new image
+ * @upd_received:	bytes of it received so far
+ * @upd_buf:		one LEB worth of update data
+ */
+struct ubi_volume {
+	struct ubi_device *ubi;
+	int vol_id;
+	int idx;
+	int reserved_pebs;
+	int upd_marker;
+	int updating;
+	int readers;
+	char name[UBI_VOL_NAME_MAX + 1];
+	int *eba_tbl;
+	struct mtd_info gluebi;
+	int gluebi_registered;
+
+	struct file *upd_file;
+	long long upd_bytes;
+	long long upd_received;
+	void *upd_buf;
+};
+
+/**
+ * struct ubi_device - a UBI device
+ * @ubi_num:		number of the device, ubi<N>
+ * @mtd:		underlying MTD device
+ * @peb_count:		PEBs of the MTD device
+ * @peb_size:		their size
+ * @min_io_size:	minimal I/O unit
+ * @vid_hdr_offset:	offset of the VID header in a PEB
+ * @data_offset:	offset of the LEB data in a PEB
+ * @leb_size:		usable bytes of a LEB
+ * @good_peb_count:	PEBs not bad
+ * @bad_peb_count:	bad PEBs
+ * @beb_rsvd_pebs:	PEBs held back to replace blocks going bad
+ * @avail_pebs:		PEBs not reserved for anything, for new volumes
+ * @free_count:		PEBs in UBI_PEB_FREE state
+ * @erase_count:	PEBs in UBI_PEB_ERASE state
+ * @scrub_count:	used PEBs flagged for scrubbing
+ * @wl_check:		erase counters changed, reconsider wear leveling
+ * @ro_mode:		device switched to read-only
+ * @global_sqnum:	next sequence number for VID headers
+ * @pebs:		per PEB state
+ * @volumes:		volumes by vtbl slot, plus the layout volume
+ * @vtbl_slots:		number of volume table slots
+ * @vtbl:		in-memory copy of the volume table
+ * @mutex:		protects everything else, see above
+ * @vol_mutex:		serializes creating, removing and updating volumes,
+ *			taken before @mutex
+ * @vol_lock:		protects the reader counts of the volumes
+ * @peb_buf:		one PEB worth of buffer for moves and recovery
+ * @hdr_buf:		buffer for header I/O, one min. I/O unit
+ * @bgt:		background thread doing erasures and moves
+ * @fm_attached:	attached from a fast attach map
+ * @stat_*:		counters shown in /proc/ubi
+ */
+struct ubi_device {
+	int ubi_num;
+	struct mtd_info *mtd;
+	int peb_count;
+	int peb_size;
+	int min_io_size;
+	int vid_hdr_offset;
+	int data_offset;
+	int leb_size;
+
+	int good_peb_count;
+	int bad_peb_count;
+	int beb_rsvd_pebs;
+	int avail_pebs;
+	int free_count;
+	int erase_count;
+	int scrub_count;
+	int wl_check;
+	int ro_mode;
+	unsigned long long global_sqnum;
+
+	struct ubi_peb *pebs;
+	struct ubi_volume *volumes[UBI_MAX_VOLUMES + 1];
+	int vtbl_slots;
+	struct ubi_vtbl_record *vtbl;
+
+	struct mutex mutex;
+	struct mutex vol_mutex;
+	spinlock_t vol_lock;
+
+	void *peb_buf;
+	void *hdr_buf;
+
+	struct task_struct *bgt;
+	char bgt_name[16];
+
+	struct miscdevice cdev;
+	char cdev_name[8];
+
+	int fm_attached;
+	unsigned long stat_erases;
+	unsigned long stat_wl_moves;
+	unsigned long stat_scrubs;
+	unsigned long stat_bitflips;
+};
+
+extern struct ubi_device *ubi_devices[UBI_MAX_DEVICES];
+
+/* io.c */
+int ubi_io_read(struct ubi_device *ubi, void *buf, int pnum, int offset,
+		int len);
+int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum,
+		 int offset, int len);
+int ubi_io_erase(struct ubi_device *ubi, int pnum);
+int ubi_io_is_bad(struct ubi_device *ubi, int pnum);
+int ubi_io_mark_bad(struct ubi_device *ubi, int pnum);
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum, long long *ec);
+int ubi_io_write_ec_hdr(struct ubi_device *ubi, int pnum, long long ec);
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_hdr *vid_hdr);
+int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr);
+int ubi_calc_data_len(struct ubi_device *ubi, const void *buf, int length);
+
+/* wl.c */
+int ubi_wl_get_peb(struct ubi_device *ubi, int for_wl);
+void ubi_wl_put_peb(struct ubi_device *ubi, int pnum);
+void ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
+int ubi_wl_erase_peb(struct ubi_device *ubi, int pnum);
+int ubi_wl_flush(struct ubi_device *ubi);
+void ubi_wl_mark_bad(struct ubi_device *ubi, int pnum);
+int ubi_wl_start(struct ubi_device *ubi);
+void ubi_wl_stop(struct ubi_device *ubi);
+void ubi_wl_wake(struct ubi_device *ubi);
+
+/* eba.c */
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi);
+int ubi_eba_read_leb(struct ubi_volume *vol, int lnum, void *buf,
+		     int offset, int len);
+int ubi_eba_write_leb(struct ubi_volume *vol, int lnum, const void *buf,
+		      int offset, int len);
+int ubi_eba_atomic_leb_change(struct ubi_volume *vol, int lnum,
+			      const void *buf, int len);
+int ubi_eba_unmap_leb(struct ubi_volume *vol, int lnum);
+int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to);
+struct ubi_volume *ubi_eba_volume(struct ubi_device *ubi, int vol_id);
+
+/* vtbl.c */
+int ubi_vtbl_init(struct ubi_device *ubi, int empty);
+int ubi_vtbl_change_record(struct ubi_device *ubi, int idx);
+int ubi_create_volume(struct ubi_device *ubi, struct ubi_mkvol_req *req);
+int ubi_remove_volume(struct ubi_device *ubi, int vol_id);
+struct ubi_volume *ubi_alloc_volume(struct ubi_device *ubi, int vol_id,
+				    int reserved_pebs);
+void ubi_free_volume(struct ubi_volume *vol);
+
+/* scan.c */
+int ubi_attach(struct ubi_device *ubi);
+int ubi_fm_write(struct ubi_device *ubi);
+
+/* upd.c */
+int ubi_start_update(struct ubi_volume *vol, struct file *file,
+		     long long bytes);
+int ubi_more_update_data(struct ubi_volume *vol, const char __user *buf,
+			 size_t count);
+void ubi_abort_update(struct ubi_volume *vol);
+
+/* gluebi.c */
+int ubi_gluebi_add(struct ubi_volume *vol);
+int ubi_gluebi_del(struct ubi_volume *vol);
+
+#endif /* __UBI_UBI_H__ */
@@ -0,0 +1,163 @@
+/*
+ * UBI: volume update.
+ *
+ * The update marker is set in the volume table before the old contents
+ * are dropped and cleared only after the last byte of the new image has
+ * been written.  A volume found with the marker set is refused by its MTD
+ * device, so nobody ever mounts half an image.
+ *
+ * The data arrives through write() on /dev/ubi<N> and is collected one
+ * LEB at a time, so each LEB is written once, trailing 0xFF bytes
+ * trimmed, and whatever uses the volume can append to it later.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/vmalloc.h>
+#include <asm/uaccess.h>
+#include <asm/div64.h>
+
+#include "ubi.h"
+
+static int set_upd_marker(struct ubi_volume *vol, int marker)
+{
+	struct ubi_device *ubi = vol->ubi;
+	struct ubi_vtbl_record *r = &ubi->vtbl[vol->idx];
+	int err;
+
+	r->upd_marker = marker;
+	err = ubi_vtbl_change_record(ubi, vol->idx);
+	if (err) {
+		r->upd_marker = vol->upd_marker;
+		return err;
+	}
+	vol->upd_marker = marker;
+	return 0;
+}
+
+static void finish_update(struct ubi_volume *vol)
+{
+	struct ubi_device *ubi = vol->ubi;
+
+	spin_lock(&ubi->vol_lock);
+	vol->updating = 0;
+	spin_unlock(&ubi->vol_lock);
+	vol->upd_file = NULL;
+	if (vol->upd_buf) {
+		vfree(vol->upd_buf);
+		vol->upd_buf = NULL;
+	}
+}
+
+/*
+ * Start replacing the contents of vol with bytes bytes written through
+ * file.  Called with ubi->vol_mutex held.
+ */
+int ubi_start_update(struct ubi_volume *vol, struct file *file,
+		     long long bytes)
+{
+	struct ubi_device *ubi = vol->ubi;
+	int i, err;
+
+	if (bytes < 0 || bytes > (long long)vol->reserved_pebs * ubi->leb_size)
+		return -EINVAL;
+
+	spin_lock(&ubi->vol_lock);
+	if (vol->readers || vol->updating) {
+		spin_unlock(&ubi->vol_lock);
+		return -EBUSY;
+	}
+	vol->updating = 1;
+	spin_unlock(&ubi->vol_lock);
+
+	if (bytes) {
+		vol->upd_buf = vmalloc(ubi->leb_size);
+		if (!vol->upd_buf) {
+			finish_update(vol);
+			return -ENOMEM;
+		}
+		memset(vol->upd_buf, 0xFF, ubi->leb_size);
+	}
+
+	mutex_lock(&ubi->mutex);
+	err = set_upd_marker(vol, 1);
+	for (i = 0; !err && i < vol->reserved_pebs; i++)
+		err = ubi_eba_unmap_leb(vol, i);
+	if (!err && !bytes)
+		err = set_upd_marker(vol, 0);
+	mutex_unlock(&ubi->mutex);
+
+	if (err || !bytes) {
+		finish_update(vol);
+		return err;
+	}
+
+	vol->upd_file = file;
+	vol->upd_bytes = bytes;
+	vol->upd_received = 0;
+	return 0;
+}
+
+/*
+ * Take the next count bytes of the image.  Returns the number of bytes
+ * consumed or -errno.  Called with ubi->vol_mutex held.
+ */
+int ubi_more_update_data(struct ubi_volume *vol, const char __user *buf,
+			 size_t count)
+{
+	struct ubi_device *ubi = vol->ubi;
+	size_t done = 0;
+	int err;
+
+	if (count > vol->upd_bytes - vol->upd_received)
+		count = vol->upd_bytes - vol->upd_received;
+
+	while (done < count) {
+		unsigned long long pos = vol->upd_received;
+		int offset = do_div(pos, ubi->leb_size);
+		int lnum = pos;
+		int len = min_t(size_t, count - done, ubi->leb_size - offset);
+
+		if (copy_from_user(vol->upd_buf + offset, buf + done, len))
+			return done ? done : -EFAULT;
+		done += len;
+		vol->upd_received += len;
+
+		if (offset + len < ubi->leb_size &&
+		    vol->upd_received < vol->upd_bytes)
+			continue;
+
+		len = ubi_calc_data_len(ubi, vol->upd_buf, offset + len);
+		err = 0;
+		if (len) {
+			mutex_lock(&ubi->mutex);
+			err = ubi_eba_write_leb(vol, lnum, vol->upd_buf, 0, len);
+			mutex_unlock(&ubi->mutex);
+		}
+		if (err)
+			return err;
+		memset(vol->upd_buf, 0xFF, ubi->leb_size);
+	}
+
+	if (vol->upd_received == vol->upd_bytes) {
+		mutex_lock(&ubi->mutex);
+		err = set_upd_marker(vol, 0);
+		mutex_unlock(&ubi->mutex);
+		finish_update(vol);
+		if (err)
+			return err;
+		ubi_msg("volume %d (\"%s\") updated, %lld bytes", vol->vol_id,
+			vol->name, vol->upd_bytes);
+	}
+	return done;
+}
+
+/* The updating file was closed early; the marker stays set */
+void ubi_abort_update(struct ubi_volume *vol)
+{
+	ubi_warn("update of volume %d (\"%s\") aborted after %lld of %lld "
+		 "bytes", vol->vol_id, vol->name, vol->upd_received,
+		 vol->upd_bytes);
+	finish_update(vol);
+}
@@ -0,0 +1,311 @@
+/*
+ * UBI: the volume table.
+ *
+ * The table is kept in both LEBs of the layout volume and changed with
+ * atomic LEB changes, first LEB 0 and then LEB 1, so at any time at
+ * least one of them is intact.  A volume's ID is its slot in the table.
+ *
+ * Everything here is called with ubi->mutex held.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include <linux/crc32.h>
+#include <asm/div64.h>
+
+#include "ubi.h"
+
+static int vtbl_size(struct ubi_device *ubi)
+{
+	return ubi->vtbl_slots * UBI_VTBL_RECORD_SIZE;
+}
+
+static void set_record_crc(struct ubi_vtbl_record *r)
+{
+	r->crc = cpu_to_be32(crc32(UBI_CRC32_INIT, r,
+				   UBI_VTBL_RECORD_CRC_SIZE));
+}
+
+/* Returns the number of the first bad record, or -1 if all are fine */
+static int check_vtbl(struct ubi_device *ubi, struct ubi_vtbl_record *vtbl)
+{
+	int i;
+
+	for (i = 0; i < ubi->vtbl_slots; i++) {
+		struct ubi_vtbl_record *r = &vtbl[i];
+		int name_len = be16_to_cpu(r->name_len);
+
+		if (crc32(UBI_CRC32_INIT, r, UBI_VTBL_RECORD_CRC_SIZE) !=
+		    be32_to_cpu(r->crc))
+			return i;
+		if (!r->reserved_pebs)
+			continue;
+		if (name_len > UBI_VOL_NAME_MAX || r->name[name_len] ||
+		    r->vol_type != UBI_VID_DYNAMIC)
+			return i;
+	}
+	return -1;
+}
+
+static int write_vtbl_leb(struct ubi_device *ubi, int lnum)
+{
+	return ubi_eba_atomic_leb_change(ubi->volumes[UBI_LAYOUT_VOL_IDX],
+					 lnum, ubi->vtbl, vtbl_size(ubi));
+}
+
+/* Write slot idx of the in-memory table to flash */
+int ubi_vtbl_change_record(struct ubi_device *ubi, int idx)
+{
+	int i, err;
+
+	set_record_crc(&ubi->vtbl[idx]);
+	for (i = 0; i < UBI_LAYOUT_VOLUME_EBS; i++) {
+		err = write_vtbl_leb(ubi, i);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+struct ubi_volume *ubi_alloc_volume(struct ubi_device *ubi, int vol_id,
+				    int reserved_pebs)
+{
+	struct ubi_volume *vol;
+	int i;
+
+	vol = kzalloc(sizeof(struct ubi_volume), GFP_KERNEL);
+	if (!vol)
+		return NULL;
+
+	vol->eba_tbl = kmalloc(reserved_pebs * sizeof(int), GFP_KERNEL);
+	if (!vol->eba_tbl) {
+		kfree(vol);
+		return NULL;
+	}
+	for (i = 0; i < reserved_pebs; i++)
+		vol->eba_tbl[i] = UBI_LEB_UNMAPPED;
+
+	vol->ubi = ubi;
+	vol->vol_id = vol_id;
+	vol->reserved_pebs = reserved_pebs;
+	return vol;
+}
+
+void ubi_free_volume(struct ubi_volume *vol)
+{
+	if (vol->upd_buf)
+		vfree(vol->upd_buf);
+	kfree(vol->eba_tbl);
+	kfree(vol);
+}
+
+static int create_volumes(struct ubi_device *ubi)
+{
+	int i;
+
+	for (i = 0; i < ubi->vtbl_slots; i++) {
+		struct ubi_vtbl_record *r = &ubi->vtbl[i];
+		struct ubi_volume *vol;
+		int reserved = be32_to_cpu(r->reserved_pebs);
+
+		if (!reserved)
+			continue;
+
+		vol = ubi_alloc_volume(ubi, i, reserved);
+		if (!vol)
+			return -ENOMEM;
+		vol->idx = i;
+		vol->upd_marker = r->upd_marker;
+		memcpy(vol->name, r->name, be16_to_cpu(r->name_len) + 1);
+		ubi->volumes[i] = vol;
+
+		if (vol->upd_marker)
+			ubi_warn("volume %d (\"%s\") was interrupted while "
+				 "being updated, update it again", i,
+				 vol->name);
+	}
+	return 0;
+}
+
+/*
+ * Read the volume table from the layout volume, which the caller has
+ * already mapped, and create the volumes it lists.  If empty is set the
+ * flash was blank and an empty table is written instead.
+ */
+int ubi_vtbl_init(struct ubi_device *ubi, int empty)
+{
+	struct ubi_vtbl_record *copy;
+	int i, size, err, bad0, bad1;
+
+	ubi->vtbl_slots = ubi->leb_size / UBI_VTBL_RECORD_SIZE;
+	if (ubi->vtbl_slots > UBI_MAX_VOLUMES)
+		ubi->vtbl_slots = UBI_MAX_VOLUMES;
+	size = vtbl_size(ubi);
+
+	ubi->vtbl = vmalloc(size);
+	if (!ubi->vtbl)
+		return -ENOMEM;
+
+	if (empty) {
+		memset(ubi->vtbl, 0, size);
+		for (i = 0; i < ubi->vtbl_slots; i++)
+			set_record_crc(&ubi->vtbl[i]);
+		for (i = 0; i < UBI_LAYOUT_VOLUME_EBS; i++) {
+			err = write_vtbl_leb(ubi, i);
+			if (err)
+				return err;
+		}
+		return 0;
+	}
+
+	copy = vmalloc(size);
+	if (!copy)
+		return -ENOMEM;
+
+	err = ubi_eba_read_leb(ubi->volumes[UBI_LAYOUT_VOL_IDX], 0,
+			       ubi->vtbl, 0, size);
+	if (err && err != -EBADMSG)
+		goto out;
+	bad0 = err ? 0 : check_vtbl(ubi, ubi->vtbl);
+
+	err = ubi_eba_read_leb(ubi->volumes[UBI_LAYOUT_VOL_IDX], 1,
+			       copy, 0, size);
+	if (err && err != -EBADMSG)
+		goto out;
+	bad1 = err ? 0 : check_vtbl(ubi, copy);
+
+	err = 0;
+	if (bad0 >= 0 && bad1 >= 0) {
+		ubi_err("both copies of the volume table are corrupted");
+		err = -EINVAL;
+		goto out;
+	}
+
+	if (bad0 >= 0) {
+		ubi_warn("volume table copy 0 is corrupted, using copy 1");
+		memcpy(ubi->vtbl, copy, size);
+		err = write_vtbl_leb(ubi, 0);
+	} else if (bad1 >= 0 || memcmp(ubi->vtbl, copy, size)) {
+		/* Also the case after a power cut between the two writes */
+		ubi_warn("volume table copy 1 is stale, rewriting it");
+		err = write_vtbl_leb(ubi, 1);
+	}
+	if (err)
+		goto out;
+
+	err = create_volumes(ubi);
+out:
+	vfree(copy);
+	return err;
+}
+
+int ubi_create_volume(struct ubi_device *ubi, struct ubi_mkvol_req *req)
+{
+	struct ubi_vtbl_record *r;
+	struct ubi_volume *vol;
+	long long bytes = req->bytes;
+	int i, idx, reserved, err;
+
+	if (req->name_len <= 0 || req->name_len > UBI_VOL_NAME_MAX ||
+	    req->name[req->name_len] || strlen(req->name) != req->name_len ||
+	    bytes <= 0)
+		return -EINVAL;
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	for (i = 0; i < ubi->vtbl_slots; i++)
+		if (ubi->volumes[i] && !strcmp(ubi->volumes[i]->name, req->name))
+			return -EEXIST;
+
+	if (req->vol_id == UBI_VOL_NUM_AUTO) {
+		for (idx = 0; idx < ubi->vtbl_slots; idx++)
+			if (!ubi->volumes[idx])
+				break;
+		if (idx == ubi->vtbl_slots)
+			return -ENFILE;
+	} else {
+		idx = req->vol_id;
+		if (idx < 0 || idx >= ubi->vtbl_slots)
+			return -EINVAL;
+		if (ubi->volumes[idx])
+			return -EEXIST;
+	}
+
+	bytes += ubi->leb_size - 1;
+	do_div(bytes, ubi->leb_size);
+	if (bytes > ubi->avail_pebs) {
+		ubi_err("%lld PEBs needed, only %d available", bytes,
+			ubi->avail_pebs);
+		return -ENOSPC;
+	}
+	reserved = bytes;
+
+	vol = ubi_alloc_volume(ubi, idx, reserved);
+	if (!vol)
+		return -ENOMEM;
+	vol->idx = idx;
+	memcpy(vol->name, req->name, req->name_len + 1);
+
+	r = &ubi->vtbl[idx];
+	memset(r, 0, UBI_VTBL_RECORD_SIZE);
+	r->reserved_pebs = cpu_to_be32(reserved);
+	r->vol_type = UBI_VID_DYNAMIC;
+	r->name_len = cpu_to_be16(req->name_len);
+	memcpy(r->name, req->name, req->name_len + 1);
+
+	err = ubi_vtbl_change_record(ubi, idx);
+	if (err) {
+		memset(r, 0, UBI_VTBL_RECORD_SIZE);
+		set_record_crc(r);
+		ubi_free_volume(vol);
+		return err;
+	}
+
+	ubi->volumes[idx] = vol;
+	ubi->avail_pebs -= reserved;
+	req->vol_id = idx;
+	ubi_msg("created volume %d (\"%s\"), %d LEBs", idx, vol->name,
+		reserved);
+	return 0;
+}
+
+/*
+ * Remove a volume.  The caller has already taken down its MTD device,
+ * so the only possible user left is an update in progress.
+ */
+int ubi_remove_volume(struct ubi_device *ubi, int vol_id)
+{
+	struct ubi_volume *vol;
+	struct ubi_vtbl_record *r, old;
+	int i, err;
+
+	if (vol_id < 0 || vol_id >= ubi->vtbl_slots || !ubi->volumes[vol_id])
+		return -ENODEV;
+	vol = ubi->volumes[vol_id];
+	if (vol->updating)
+		return -EBUSY;
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	r = &ubi->vtbl[vol_id];
+	old = *r;
+	memset(r, 0, UBI_VTBL_RECORD_SIZE);
+	err = ubi_vtbl_change_record(ubi, vol_id);
+	if (err) {
+		*r = old;
+		return err;
+	}
+
+	for (i = 0; i < vol->reserved_pebs; i++)
+		ubi_eba_unmap_leb(vol, i);
+
+	ubi->volumes[vol_id] = NULL;
+	ubi->avail_pebs += vol->reserved_pebs;
+	ubi_msg("removed volume %d (\"%s\")", vol_id, vol->name);
+	ubi_free_volume(vol);
+	return 0;
+}
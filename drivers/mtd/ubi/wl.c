@@ -0,0 +1,325 @@
+/*
+ * UBI: wear leveling, PEB erasure and scrubbing.
+ *
+ * Free PEBs are handed out lowest erase counter first.  PEBs that are no
+ * longer needed are erased by a background thread, which then scrubs
+ * PEBs whose data needed ECC correction and finally moves the LEB in the
+ * least worn used PEB to the most worn free PEB whenever their erase
+ * counters differ by UBI_WL_THRESHOLD or more, so blocks holding static
+ * data take their share of erasures too.
+ *
+ * The PEB state is a flat array searched linearly; with the few thousand
+ * eraseblocks of the NAND parts this runs on, a search costs far less
+ * than the erasure it precedes.
+ *
+ * This code is GPL
+ */
+
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/sched.h>
+
+#include "ubi.h"
+
+static int find_peb(struct ubi_device *ubi, int state)
+{
+	int pnum;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (ubi->pebs[pnum].state == state)
+			return pnum;
+	return -1;
+}
+
+/*
+ * Mark a PEB bad after an erase or write failure and take a replacement
+ * out of the bad block reserve.  With the reserve used up, the device
+ * goes read-only: there is no longer a spare PEB for atomic changes.
+ */
+void ubi_wl_mark_bad(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_peb *peb = &ubi->pebs[pnum];
+
+	if (peb->state == UBI_PEB_ERASE)
+		ubi->erase_count--;
+	else if (peb->state == UBI_PEB_FREE)
+		ubi->free_count--;
+	peb->state = UBI_PEB_BAD;
+	peb->scrub = 0;
+
+	ubi_io_mark_bad(ubi, pnum);
+	ubi->good_peb_count--;
+	ubi->bad_peb_count++;
+
+	if (ubi->beb_rsvd_pebs > 0)
+		ubi->beb_rsvd_pebs--;
+	else if (ubi->avail_pebs > 0)
+		ubi->avail_pebs--;
+	else {
+		ubi_err("no PEBs left to replace bad PEB %d, switching to "
+			"read-only mode", pnum);
+		ubi->ro_mode = 1;
+		return;
+	}
+	ubi_msg("marked PEB %d bad, %d reserved PEBs left", pnum,
+		ubi->beb_rsvd_pebs);
+}
+
+/* Erase a PEB in UBI_PEB_ERASE state and make it free */
+int ubi_wl_erase_peb(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_peb *peb = &ubi->pebs[pnum];
+	int err;
+
+	err = ubi_io_erase(ubi, pnum);
+	if (!err)
+		err = ubi_io_write_ec_hdr(ubi, pnum, peb->ec + 1);
+	if (err) {
+		if (err != -EROFS)
+			ubi_wl_mark_bad(ubi, pnum);
+		return err;
+	}
+
+	peb->ec++;
+	peb->state = UBI_PEB_FREE;
+	ubi->erase_count--;
+	ubi->free_count++;
+	ubi->wl_check = 1;
+	return 0;
+}
+
+/* Erase everything pending, used before writing a fast attach map */
+int ubi_wl_flush(struct ubi_device *ubi)
+{
+	int pnum, err;
+
+	while ((pnum = find_peb(ubi, UBI_PEB_ERASE)) >= 0) {
+		err = ubi_wl_erase_peb(ubi, pnum);
+		if (err == -EROFS || ubi->ro_mode)
+			return -EROFS;
+	}
+	return 0;
+}
+
+/*
+ * Take a free PEB, erasing one synchronously if the background thread
+ * has not caught up.  Ordinary writes get the least worn PEB; wear
+ * leveling asks for the most worn one to park long-lived data on.  The
+ * PEB is returned in UBI_PEB_USED state; the caller fills in the LEB it
+ * maps, or hands it back with ubi_wl_put_peb() on failure.
+ */
+int ubi_wl_get_peb(struct ubi_device *ubi, int for_wl)
+{
+	int pnum, best = -1;
+
+	while (ubi->free_count == 0) {
+		pnum = find_peb(ubi, UBI_PEB_ERASE);
+		if (pnum < 0) {
+			ubi_err("no free PEBs");
+			return -ENOSPC;
+		}
+		if (ubi_wl_erase_peb(ubi, pnum) == -EROFS || ubi->ro_mode)
+			return -EROFS;
+	}
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		struct ubi_peb *peb = &ubi->pebs[pnum];
+
+		if (peb->state != UBI_PEB_FREE)
+			continue;
+		if (best < 0 ||
+		    (for_wl ? peb->ec > ubi->pebs[best].ec :
+			      peb->ec < ubi->pebs[best].ec))
+			best = pnum;
+	}
+
+	ubi->pebs[best].state = UBI_PEB_USED;
+	ubi->pebs[best].scrub = 0;
+	ubi->pebs[best].vol_idx = -1;
+	ubi->pebs[best].lnum = UBI_LEB_UNMAPPED;
+	ubi->free_count--;
+	return best;
+}
+
+/* Give back a PEB that no longer holds a LEB for erasure */
+void ubi_wl_put_peb(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_peb *peb = &ubi->pebs[pnum];
+
+	if (peb->scrub)
+		ubi->scrub_count--;
+	peb->state = UBI_PEB_ERASE;
+	peb->scrub = 0;
+	peb->vol_idx = -1;
+	peb->lnum = UBI_LEB_UNMAPPED;
+	ubi->erase_count++;
+	ubi_wl_wake(ubi);
+}
+
+/* The LEB in pnum was read with corrected bit flips, move it */
+void ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_peb *peb = &ubi->pebs[pnum];
+
+	if (peb->state != UBI_PEB_USED || peb->scrub)
+		return;
+	peb->scrub = 1;
+	ubi->scrub_count++;
+	ubi_wl_wake(ubi);
+}
+
+static int move_peb(struct ubi_device *ubi, int from, int for_wl)
+{
+	int to, err;
+
+	to = ubi_wl_get_peb(ubi, for_wl);
+	if (to < 0)
+		return to;
+
+	err = ubi_eba_copy_leb(ubi, from, to);
+	if (err) {
+		ubi_wl_put_peb(ubi, to);
+		return err;
+	}
+	ubi_wl_put_peb(ubi, from);
+	return 0;
+}
+
+static int do_scrub(struct ubi_device *ubi)
+{
+	int pnum, err;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (ubi->pebs[pnum].state == UBI_PEB_USED &&
+		    ubi->pebs[pnum].scrub)
+			break;
+	if (pnum == ubi->peb_count) {
+		ubi->scrub_count = 0;
+		return 0;
+	}
+
+	err = move_peb(ubi, pnum, 0);
+	if (err) {
+		/* Leave it alone rather than retrying forever */
+		ubi_warn("cannot scrub PEB %d, error %d", pnum, err);
+		ubi->pebs[pnum].scrub = 0;
+		ubi->scrub_count--;
+		return err;
+	}
+	ubi->stat_scrubs++;
+	return 0;
+}
+
+static int do_wear_level(struct ubi_device *ubi)
+{
+	int pnum, min_used = -1, max_free = -1, err;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		struct ubi_peb *peb = &ubi->pebs[pnum];
+
+		if (peb->state == UBI_PEB_USED) {
+			if (min_used < 0 || peb->ec < ubi->pebs[min_used].ec)
+				min_used = pnum;
+		} else if (peb->state == UBI_PEB_FREE) {
+			if (max_free < 0 || peb->ec > ubi->pebs[max_free].ec)
+				max_free = pnum;
+		}
+	}
+
+	if (min_used < 0 || max_free < 0 ||
+	    ubi->pebs[max_free].ec - ubi->pebs[min_used].ec <
+	    UBI_WL_THRESHOLD) {
+		ubi->wl_check = 0;
+		return 0;
+	}
+
+	err = move_peb(ubi, min_used, 1);
+	if (err) {
+		ubi_warn("cannot move PEB %d, error %d", min_used, err);
+		ubi->wl_check = 0;
+		return err;
+	}
+	ubi->stat_wl_moves++;
+	return 0;
+}
+
+static int work_pending(struct ubi_device *ubi)
+{
+	if (ubi->ro_mode)
+		return 0;
+	return ubi->erase_count || ubi->scrub_count || ubi->wl_check;
+}
+
+/* Do one unit of background work, under ubi->mutex */
+static void do_work(struct ubi_device *ubi)
+{
+	int pnum;
+
+	if (ubi->erase_count) {
+		pnum = find_peb(ubi, UBI_PEB_ERASE);
+		if (pnum >= 0)
+			ubi_wl_erase_peb(ubi, pnum);
+		else
+			ubi->erase_count = 0;
+	} else if (ubi->scrub_count)
+		do_scrub(ubi);
+	else if (ubi->wl_check)
+		do_wear_level(ubi);
+}
+
+static int ubi_thread(void *u)
+{
+	struct ubi_device *ubi = u;
+
+	ubi_msg("background thread \"%s\" started", ubi->bgt_name);
+
+	while (!kthread_should_stop()) {
+		try_to_freeze();
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!work_pending(ubi)) {
+			if (!kthread_should_stop())
+				schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		mutex_lock(&ubi->mutex);
+		if (work_pending(ubi))
+			do_work(ubi);
+		mutex_unlock(&ubi->mutex);
+		cond_resched();
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+void ubi_wl_wake(struct ubi_device *ubi)
+{
+	if (ubi->bgt)
+		wake_up_process(ubi->bgt);
+}
+
+int ubi_wl_start(struct ubi_device *ubi)
+{
+	struct task_struct *t;
+
+	sprintf(ubi->bgt_name, "ubi_bgt%dd", ubi->ubi_num);
+	t = kthread_run(ubi_thread, ubi, ubi->bgt_name);
+	if (IS_ERR(t)) {
+		ubi_err("cannot start background thread, error %ld",
+			PTR_ERR(t));
+		return PTR_ERR(t);
+	}
+	ubi->bgt = t;
+	return 0;
+}
+
+void ubi_wl_stop(struct ubi_device *ubi)
+{
+	if (ubi->bgt) {
+		kthread_stop(ubi->bgt);
+		ubi->bgt = NULL;
+	}
+}
@@ -139,7 +139,8 @@ static void adc_battery_work_func(struct work_struct *work)
 	adc_battery_query(drvdata);
 	power_supply_changed(&drvdata->batt_cdev);
 
-	queue_delayed_work(drvdata->wq, &drvdata->work, (5000 * HZ) / 1000);
+	queue_delayed_work(drvdata->wq, &drvdata->work,
+			   round_jiffies_relative((5000 * HZ) / 1000));
 }
 
 static int adc_battery_probe(struct platform_device *pdev)
@@ -231,7 +232,7 @@ static int adc_battery_probe(struct platform_device *pdev)
 	adc_battery_query(drvdata);
 
 	// Still schedule next sampling soon
-	INIT_DELAYED_WORK(&drvdata->work, adc_battery_work_func);
+	INIT_DELAYED_WORK_DEFERRABLE(&drvdata->work, adc_battery_work_func);
 	drvdata->wq = create_workqueue(pdev->dev.bus_id);
 	if (!drvdata->wq)
 		return -ESRCH;
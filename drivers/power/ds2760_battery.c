@@ -271,7 +271,8 @@ static void ds2760_battery_work(struct work_struct *work)
 	dev_dbg(di->dev, "%s\n", __FUNCTION__);
 
 	ds2760_battery_update_status(di);
-	queue_delayed_work(di->monitor_wqueue, &di->monitor_work, interval);
+	queue_delayed_work(di->monitor_wqueue, &di->monitor_work,
+			   round_jiffies_relative(interval));
 
 	return;
 }
@@ -380,7 +381,7 @@ static int ds2760_battery_probe(struct platform_device *pdev)
 		goto batt_failed;
 	}
 
-	INIT_DELAYED_WORK(&di->monitor_work, ds2760_battery_work);
+	INIT_DELAYED_WORK_DEFERRABLE(&di->monitor_work, ds2760_battery_work);
 	di->monitor_wqueue = create_singlethread_workqueue(pdev->dev.bus_id);
 	if (!di->monitor_wqueue) {
 		retval = -ESRCH;
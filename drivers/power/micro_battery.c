@@ -95,7 +95,7 @@ void h3600_battery_read_status(unsigned long data) {
 	else 
 		h3600_micro_tx_msg(0x06,0,NULL);
 
-	batt_timer.expires += BATT_PERIOD;
+	batt_timer.expires = round_jiffies(jiffies + BATT_PERIOD);
 	batt_timer.data = data;
 
 	add_timer(&batt_timer);
@@ -184,8 +184,8 @@ static int micro_batt_probe (struct platform_device *pdev)
 	}
 
 	{ /*--- timer ---*/
-		init_timer(&batt_timer);
-		batt_timer.expires = jiffies + BATT_PERIOD;
+		init_timer_deferrable(&batt_timer);
+		batt_timer.expires = round_jiffies(jiffies + BATT_PERIOD);
 		batt_timer.data = 0;
 		batt_timer.function = h3600_battery_read_status;
 
@@ -38,6 +38,7 @@
 #include <linux/device.h>
 #include <linux/moduleparam.h>
 #include <linux/ctype.h>
+#include <linux/hrtimer.h>
 
 #include <asm/byteorder.h>
 #include <asm/io.h>
@@ -54,6 +55,7 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/lro.h>
 
 #include "gadget_chips.h"
 
@@ -143,8 +145,24 @@ struct eth_dev {
 #define	WORK_RX_MEMORY		0
 	int			rndis_config;
 	u8			host_mac [ETH_ALEN];
+
+#ifdef	CONFIG_USB_ETH_RNDIS
+	/* RNDIS packet messages waiting to go out as one transfer */
+	struct sk_buff		*tx_agg;
+	struct hrtimer		tx_agg_timer;
+#endif
+	/* transfers vs. frames, for "ethtool -S" */
+	unsigned long		stat_tx_xfers, stat_tx_agg;
+	unsigned long		stat_rx_xfers, stat_rx_agg;
+	struct net_lro_mgr	lro;
 };
 
+#ifdef	CONFIG_USB_ETH_RNDIS
+static void tx_agg_drop (struct eth_dev *dev);
+#else
+#define tx_agg_drop(d)		do{}while(0)
+#endif
+
 /* This version autoconfigures as much as possible at run-time.
  *
  * It also ASSUMES a self-powered device, without remote wakeup,
@@ -225,6 +243,28 @@ static char *host_addr;
 module_param(host_addr, charp, S_IRUGO);
 MODULE_PARM_DESC(host_addr, "Host Ethernet Address");
 
+#ifdef	CONFIG_USB_ETH_RNDIS
+/* RNDIS lets both sides pack several packet messages into one transfer;
+ * the host says how big our IN transfers may get, and we say how many
+ * messages and bytes its OUT transfers may carry.
+ */
+static unsigned agg_frames = 10;
+module_param(agg_frames, uint, S_IRUGO);
+MODULE_PARM_DESC(agg_frames, "RNDIS packets per transfer, 1 to disable");
+
+static unsigned agg_size = 4096;
+module_param(agg_size, uint, S_IRUGO);
+MODULE_PARM_DESC(agg_size, "RNDIS bytes per aggregated transfer");
+
+static unsigned agg_timeout = 500;
+module_param(agg_timeout, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(agg_timeout, "usecs a partial RNDIS transfer waits for more");
+#endif
+
+static unsigned lro_segs = 8;
+module_param(lro_segs, uint, S_IRUGO);
+MODULE_PARM_DESC(lro_segs, "TCP segments merged per skb on receive, 0 = off");
+
 
 /*-------------------------------------------------------------------------*/
 
@@ -1128,6 +1168,7 @@ static void eth_reset_config (struct eth_dev *dev)
 	netif_stop_queue (dev->net);
 	netif_carrier_off (dev->net);
 	rndis_uninit(dev->rndis_config);
+	tx_agg_drop (dev);
 
 	/* disable endpoints, forcing (synchronous) completion of
 	 * pending i/o.  then free the requests.
@@ -1681,9 +1722,44 @@ static u32 eth_get_link(struct net_device *net)
 	return dev->gadget->speed != USB_SPEED_UNKNOWN;
 }
 
+static const char eth_stat_strings [][ETH_GSTRING_LEN] = {
+	"tx_transfers",
+	"tx_aggregated",
+	"rx_transfers",
+	"rx_aggregated",
+	LRO_STAT_STRINGS
+};
+
+static int eth_get_stats_count(struct net_device *net)
+{
+	return ARRAY_SIZE(eth_stat_strings);
+}
+
+static void eth_get_strings(struct net_device *net, u32 stringset, u8 *data)
+{
+	if (stringset == ETH_SS_STATS)
+		memcpy(data, eth_stat_strings, sizeof eth_stat_strings);
+}
+
+/* frames per transfer shows what aggregation buys on the wire */
+static void eth_get_ethtool_stats(struct net_device *net,
+		struct ethtool_stats *stats, u64 *data)
+{
+	struct eth_dev	*dev = netdev_priv(net);
+
+	data[0] = dev->stat_tx_xfers;
+	data[1] = dev->stat_tx_agg;
+	data[2] = dev->stat_rx_xfers;
+	data[3] = dev->stat_rx_agg;
+	lro_get_stats (&dev->lro, data + 4);
+}
+
 static struct ethtool_ops ops = {
 	.get_drvinfo = eth_get_drvinfo,
-	.get_link = eth_get_link
+	.get_link = eth_get_link,
+	.get_strings = eth_get_strings,
+	.get_stats_count = eth_get_stats_count,
+	.get_ethtool_stats = eth_get_ethtool_stats,
 };
 
 static void defer_kevent (struct eth_dev *dev, int flag)
@@ -1718,8 +1794,14 @@ rx_submit (struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size = (sizeof (struct ethhdr) + dev->net->mtu + RX_EXTRA);
 	size += dev->out_ep->maxpacket - 1;
-	if (rndis_active(dev))
+	if (rndis_active(dev)) {
 		size += sizeof (struct rndis_packet_msg_type);
+#ifdef	CONFIG_USB_ETH_RNDIS
+		/* what rndis_init_response() told the host we take */
+		if (agg_frames > 1 && size < agg_size + dev->out_ep->maxpacket)
+			size = agg_size + dev->out_ep->maxpacket;
+#endif
+	}
 	size -= size % dev->out_ep->maxpacket;
 
 	if ((skb = alloc_skb (size + NET_IP_ALIGN, gfp_flags)) == 0) {
@@ -1752,6 +1834,29 @@ enomem:
 	return retval;
 }
 
+static int eth_rx_frame (struct eth_dev *dev, struct sk_buff *skb)
+{
+	if (ETH_HLEN > skb->len || skb->len > ETH_FRAME_LEN) {
+		dev->stats.rx_errors++;
+		dev->stats.rx_length_errors++;
+		DEBUG (dev, "rx length %d\n", skb->len);
+		dev_kfree_skb_any (skb);
+		return -EINVAL;
+	}
+
+	skb->dev = dev->net;
+	skb->protocol = eth_type_trans (skb, dev->net);
+	dev->stats.rx_packets++;
+	dev->stats.rx_bytes += skb->len;
+
+	/* no buffer copies needed, unless hardware can't
+	 * use skb buffers.
+	 */
+	if (lro_segs > 1)
+		return lro_receive_skb (&dev->lro, skb);
+	return netif_rx (skb);
+}
+
 static void rx_complete (struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
@@ -1763,27 +1868,40 @@ static void rx_complete (struct usb_ep *ep, struct usb_request *req)
 	/* normal completion */
 	case 0:
 		skb_put (skb, req->actual);
-		/* we know MaxPacketsPerTransfer == 1 here */
-		if (rndis_active(dev))
-			status = rndis_rm_hdr (skb);
-		if (status < 0
-				|| ETH_HLEN > skb->len
-				|| skb->len > ETH_FRAME_LEN) {
+		dev->stat_rx_xfers++;
+		if (rndis_active(dev)) {
+			struct sk_buff	*frame;
+			unsigned	frames = 0;
+
+			/* up to MaxPacketsPerTransfer messages */
+			while ((frame = rndis_split_packet (skb)) != NULL) {
+				if (IS_ERR (frame)) {
+					status = PTR_ERR (frame);
+					break;
+				}
+				eth_rx_frame (dev, frame);
+				frames++;
+			}
+			if (frames)
+				dev->stat_rx_agg += frames + 1;
+			if (status == 0)
+				status = rndis_rm_hdr (skb);
+			if (status == 0 && frames) {
+				eth_rx_frame (dev, skb);
+				skb = NULL;
+				/* the host's batch ends with its transfer */
+				lro_flush_all (&dev->lro);
+				break;
+			}
+		}
+		if (status < 0) {
 			dev->stats.rx_errors++;
 			dev->stats.rx_length_errors++;
 			DEBUG (dev, "rx length %d\n", skb->len);
 			break;
 		}
 
-		skb->dev = dev->net;
-		skb->protocol = eth_type_trans (skb, dev->net);
-		dev->stats.rx_packets++;
-		dev->stats.rx_bytes += skb->len;
-
-		/* no buffer copies needed, unless hardware can't
-		 * use skb buffers.
-		 */
-		status = netif_rx (skb);
+		status = eth_rx_frame (dev, skb);
 		skb = NULL;
 		break;
 
@@ -1920,10 +2038,12 @@ static void eth_work (struct work_struct *work)
 		DEBUG (dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
-static void tx_complete (struct usb_ep *ep, struct usb_request *req)
+static void tx_agg_flush (struct eth_dev *dev);
+
+static void tx_done (struct eth_dev *dev, struct usb_request *req,
+		unsigned frames, unsigned bytes)
 {
 	struct sk_buff	*skb = req->context;
-	struct eth_dev	*dev = ep->driver_data;
 
 	switch (req->status) {
 	default:
@@ -1934,9 +2054,9 @@ static void tx_complete (struct usb_ep *ep, struct usb_request *req)
 	case -ESHUTDOWN:		// disconnect etc
 		break;
 	case 0:
-		dev->stats.tx_bytes += skb->len;
+		dev->stats.tx_bytes += bytes;
 	}
-	dev->stats.tx_packets++;
+	dev->stats.tx_packets += frames;
 
 	spin_lock(&dev->req_lock);
 	list_add (&req->list, &dev->tx_reqs);
@@ -1944,10 +2064,240 @@ static void tx_complete (struct usb_ep *ep, struct usb_request *req)
 	dev_kfree_skb_any (skb);
 
 	atomic_dec (&dev->tx_qlen);
+	if (req->status == 0)
+		tx_agg_flush (dev);
 	if (netif_carrier_ok (dev->net))
 		netif_wake_queue (dev->net);
 }
 
+static void tx_complete (struct usb_ep *ep, struct usb_request *req)
+{
+	struct sk_buff	*skb = req->context;
+
+	tx_done (ep->driver_data, req, 1, skb->len);
+}
+
+#ifdef	CONFIG_USB_ETH_RNDIS
+
+/* Per aggregate bookkeeping, kept in the skb control buffer */
+struct tx_agg_cb {
+	unsigned	frames;
+	unsigned	bytes;		/* Ethernet bytes, for the stats */
+	__le32		*last_len;	/* MessageLength of the last message */
+};
+#define TX_AGG_CB(skb)	((struct tx_agg_cb *) (skb)->cb)
+
+static void tx_agg_complete (struct usb_ep *ep, struct usb_request *req)
+{
+	struct tx_agg_cb *cb = TX_AGG_CB ((struct sk_buff *) req->context);
+
+	tx_done (ep->driver_data, req, cb->frames, cb->bytes);
+}
+
+/* Bytes one IN transfer may carry, or 0 for a frame per transfer; the
+ * host said what it takes in REMOTE_NDIS_INITIALIZE_MSG.
+ */
+static unsigned tx_agg_limit (struct eth_dev *dev)
+{
+	unsigned	limit;
+
+	if (!rndis_active (dev) || agg_frames < 2)
+		return 0;
+	limit = min (agg_size, rndis_host_max_xfer (dev->rndis_config));
+	if (limit < sizeof (struct rndis_packet_msg_type)
+			+ ETH_HLEN + dev->net->mtu + 8)
+		return 0;
+	return limit;
+}
+
+/* Detach the pending aggregate along with a free request; req_lock held */
+static struct usb_request *tx_agg_take (struct eth_dev *dev)
+{
+	struct usb_request	*req;
+
+	if (!dev->tx_agg || list_empty (&dev->tx_reqs))
+		return NULL;
+
+	req = container_of (dev->tx_reqs.next, struct usb_request, list);
+	list_del (&req->list);
+	req->context = dev->tx_agg;
+	dev->tx_agg = NULL;
+	return req;
+}
+
+static void tx_agg_submit (struct eth_dev *dev, struct usb_request *req)
+{
+	struct sk_buff		*agg = req->context;
+	struct tx_agg_cb	*cb = TX_AGG_CB (agg);
+	unsigned long		flags;
+	int			retval;
+
+	hrtimer_try_to_cancel (&dev->tx_agg_timer);
+
+	/* as in eth_start_xmit(), but the pad must stay inside a message */
+	req->zero = 1;
+	if (!dev->zlp && (agg->len % dev->in_ep->maxpacket) == 0) {
+		memset (skb_put (agg, 4), 0, 4);
+		*cb->last_len = cpu_to_le32 (le32_to_cpu (*cb->last_len) + 4);
+	}
+
+	req->buf = agg->data;
+	req->length = agg->len;
+	req->complete = tx_agg_complete;
+	req->no_interrupt = 0;
+
+	retval = usb_ep_queue (dev->in_ep, req, GFP_ATOMIC);
+	if (retval) {
+		DEBUG (dev, "tx queue err %d\n", retval);
+		dev->stats.tx_dropped += cb->frames;
+		dev_kfree_skb_any (agg);
+		spin_lock_irqsave(&dev->req_lock, flags);
+		list_add (&req->list, &dev->tx_reqs);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return;
+	}
+
+	dev->net->trans_start = jiffies;
+	atomic_inc (&dev->tx_qlen);
+	dev->stat_tx_xfers++;
+	if (cb->frames > 1)
+		dev->stat_tx_agg += cb->frames;
+}
+
+static void tx_agg_flush (struct eth_dev *dev)
+{
+	struct usb_request	*req;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = tx_agg_take (dev);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (req)
+		tx_agg_submit (dev, req);
+}
+
+static enum hrtimer_restart tx_agg_timeout (struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of (timer, struct eth_dev,
+						tx_agg_timer);
+
+	/* with every request busy, the next completion sends it */
+	tx_agg_flush (dev);
+	return HRTIMER_NORESTART;
+}
+
+static void tx_agg_drop (struct eth_dev *dev)
+{
+	struct sk_buff	*agg;
+	unsigned long	flags;
+
+	hrtimer_cancel (&dev->tx_agg_timer);
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	agg = dev->tx_agg;
+	dev->tx_agg = NULL;
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (agg) {
+		dev->stats.tx_dropped += TX_AGG_CB (agg)->frames;
+		dev_kfree_skb_any (agg);
+	}
+}
+
+/*
+ * Append skb to the pending aggregate as an RNDIS packet message.  It is
+ * sent at once if nothing else is in flight, so an idle link adds no
+ * latency; otherwise when it fills up, when a transfer completes, or when
+ * agg_timeout runs out.
+ */
+static int tx_agg_xmit (struct eth_dev *dev, struct sk_buff *skb,
+		unsigned limit)
+{
+	struct rndis_packet_msg_type	*hdr;
+	struct tx_agg_cb		*cb;
+	struct sk_buff			*agg;
+	struct usb_request		*req = NULL;
+	unsigned			need, pad, room;
+	unsigned long			flags;
+
+	need = ALIGN (sizeof *hdr + skb->len, 4);
+	pad = dev->zlp ? 0 : 4;
+	room = limit - pad;
+
+	/* the pending aggregate was sized for the limit in force when it
+	 * was started, and the host may have sent a new INITIALIZE since
+	 */
+	spin_lock_irqsave(&dev->req_lock, flags);
+	agg = dev->tx_agg;
+	if (agg && (agg->len + need > room
+			|| need + pad > skb_tailroom (agg)
+			|| TX_AGG_CB (agg)->frames >= agg_frames)) {
+		req = tx_agg_take (dev);
+		if (!req) {
+			/* requeued by the core; tx_done() wakes us */
+			netif_stop_queue (dev->net);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			return NETDEV_TX_BUSY;
+		}
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		tx_agg_submit (dev, req);
+		req = NULL;
+		spin_lock_irqsave(&dev->req_lock, flags);
+		agg = dev->tx_agg;
+	}
+
+	if (!agg) {
+		agg = alloc_skb (limit, GFP_ATOMIC);
+		if (!agg) {
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev->stats.tx_dropped++;
+			dev_kfree_skb_any (skb);
+			return 0;
+		}
+		memset (TX_AGG_CB (agg), 0, sizeof (struct tx_agg_cb));
+		dev->tx_agg = agg;
+	}
+	cb = TX_AGG_CB (agg);
+
+	hdr = (void *) skb_put (agg, need);
+	memset (hdr, 0, sizeof *hdr);
+	hdr->MessageType = __constant_cpu_to_le32 (REMOTE_NDIS_PACKET_MSG);
+	hdr->MessageLength = cpu_to_le32 (need);
+	hdr->DataOffset = __constant_cpu_to_le32 (36);
+	hdr->DataLength = cpu_to_le32 (skb->len);
+	memcpy (hdr + 1, skb->data, skb->len);
+	memset ((u8 *) (hdr + 1) + skb->len, 0,
+			need - sizeof *hdr - skb->len);
+
+	cb->last_len = &hdr->MessageLength;
+	cb->frames++;
+	cb->bytes += skb->len;
+
+	if (atomic_read (&dev->tx_qlen) == 0
+			|| cb->frames >= agg_frames
+			|| room - agg->len < sizeof *hdr + ETH_ZLEN)
+		req = tx_agg_take (dev);
+	else if (!hrtimer_active (&dev->tx_agg_timer))
+		hrtimer_start (&dev->tx_agg_timer,
+				ktime_set (agg_timeout / USEC_PER_SEC,
+					(agg_timeout % USEC_PER_SEC)
+						* NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	dev_kfree_skb_any (skb);
+	if (req)
+		tx_agg_submit (dev, req);
+	return 0;
+}
+
+#else
+
+static inline void tx_agg_flush (struct eth_dev *dev) { }
+
+#endif	/* RNDIS */
+
 static inline int eth_is_promisc (struct eth_dev *dev)
 {
 	/* no filters for the CDC subset; always promisc */
@@ -1986,7 +2336,24 @@ static int eth_start_xmit (struct sk_buff *skb, struct net_device *net)
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+#ifdef	CONFIG_USB_ETH_RNDIS
+	{
+		unsigned	limit = tx_agg_limit (dev);
+
+		if (limit)
+			return tx_agg_xmit (dev, skb, limit);
+	}
+#endif
+
 	spin_lock_irqsave(&dev->req_lock, flags);
+	/* tx_agg_take() may have used the last request without stopping
+	 * the queue, if the host shrank its transfer size mid-stream
+	 */
+	if (list_empty (&dev->tx_reqs)) {
+		netif_stop_queue (net);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return NETDEV_TX_BUSY;
+	}
 	req = container_of (dev->tx_reqs.next, struct usb_request, list);
 	list_del (&req->list);
 	if (list_empty (&dev->tx_reqs))
@@ -2039,6 +2406,7 @@ static int eth_start_xmit (struct sk_buff *skb, struct net_device *net)
 	case 0:
 		net->trans_start = jiffies;
 		atomic_inc (&dev->tx_qlen);
+		dev->stat_tx_xfers++;
 	}
 
 	if (retval) {
@@ -2163,6 +2531,8 @@ static int eth_stop (struct net_device *net)
 
 	VDEBUG (dev, "%s\n", __FUNCTION__);
 	netif_stop_queue (net);
+	tx_agg_drop (dev);
+	lro_flush_all (&dev->lro);
 
 	DEBUG (dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->stats.rx_packets, dev->stats.tx_packets,
@@ -2241,6 +2611,7 @@ eth_unbind (struct usb_gadget *gadget)
 	}
 
 	unregister_netdev (dev->net);
+	lro_release (&dev->lro);
 	free_netdev(dev->net);
 
 	/* assuming we used keventd, it must quiesce too */
@@ -2524,6 +2895,10 @@ autoconf_fail:
 	spin_lock_init (&dev->lock);
 	spin_lock_init (&dev->req_lock);
 	INIT_WORK (&dev->work, eth_work);
+#ifdef	CONFIG_USB_ETH_RNDIS
+	hrtimer_init (&dev->tx_agg_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_agg_timer.function = tx_agg_timeout;
+#endif
 	INIT_LIST_HEAD (&dev->tx_reqs);
 	INIT_LIST_HEAD (&dev->rx_reqs);
 
@@ -2604,6 +2979,15 @@ autoconf_fail:
 	netif_stop_queue (dev->net);
 	netif_carrier_off (dev->net);
 
+	/* frames arrive one per transfer unless RNDIS batches them, so
+	 * a flow also gets flushed by a timer after a jiffy
+	 */
+	if (lro_segs > 1) {
+		status = lro_init (&dev->lro, dev->net, 4, lro_segs, 1);
+		if (status < 0)
+			goto fail;
+	}
+
 	SET_NETDEV_DEV (dev->net, &gadget->dev);
 	status = register_netdev (dev->net);
 	if (status < 0)
@@ -2651,6 +3035,9 @@ fail0:
 					    NDIS_MEDIUM_802_3,
 					    0))
 			goto fail0;
+		if (agg_frames > 1)
+			rndis_set_max_pkt_xfer (dev->rndis_config,
+						agg_frames, agg_size);
 		INFO (dev, "RNDIS ready\n");
 	}
 
@@ -2713,7 +3100,7 @@ static int __init init (void)
 {
 	return usb_gadget_register_driver (&eth_driver);
 }
-module_init (init);
+device_initcall_async (init);
 
 static void __exit cleanup (void)
 {
@@ -31,6 +31,7 @@
 #include <linux/list.h>
 #include <linux/proc_fs.h>
 #include <linux/netdevice.h>
+#include <linux/err.h>
 
 #include <asm/io.h>
 #include <asm/byteorder.h>
@@ -810,8 +811,13 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 {
 	rndis_init_cmplt_type	*resp;
 	rndis_resp_t            *r;
+	rndis_params		*params = rndis_per_dev_params + configNr;
+	u32			max_size;
 
-	if (!rndis_per_dev_params [configNr].dev) return -ENOTSUPP;
+	if (!params->dev) return -ENOTSUPP;
+
+	/* the most the host takes in one of our IN transfers */
+	params->host_max_xfer = le32_to_cpu (buf->MaxTransferSize);
 
 	r = rndis_add_response (configNr, sizeof (rndis_init_cmplt_type));
 	if (!r)
@@ -827,12 +833,17 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = __constant_cpu_to_le32 (RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = __constant_cpu_to_le32 (RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = __constant_cpu_to_le32 (RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = __constant_cpu_to_le32 (1);
-	resp->MaxTransferSize = cpu_to_le32 (
-		  rndis_per_dev_params [configNr].dev->mtu
+	max_size = params->dev->mtu
 		+ sizeof (struct ethhdr)
 		+ sizeof (struct rndis_packet_msg_type)
-		+ 22);
+		+ 22;
+	if (params->max_pkt_per_xfer > 1) {
+		resp->MaxPacketsPerTransfer =
+				cpu_to_le32 (params->max_pkt_per_xfer);
+		max_size = max (max_size, params->max_xfer_size);
+	} else
+		resp->MaxPacketsPerTransfer = __constant_cpu_to_le32 (1);
+	resp->MaxTransferSize = cpu_to_le32 (max_size);
 	resp->PacketAlignmentFactor = __constant_cpu_to_le32 (0);
 	resp->AFListOffset = __constant_cpu_to_le32 (0);
 	resp->AFListSize = __constant_cpu_to_le32 (0);
@@ -1034,6 +1045,7 @@ void rndis_uninit (int configNr)
 		return;
 	rndis_per_dev_params [configNr].used = 0;
 	rndis_per_dev_params [configNr].state = RNDIS_UNINITIALIZED;
+	rndis_per_dev_params [configNr].host_max_xfer = 0;
 
 	/* drain the response queue */
 	while ((buf = rndis_get_next_response(configNr, &length)))
@@ -1211,6 +1223,23 @@ int rndis_set_param_medium (u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+/* Let the host pack up to max_pkt messages, max_size bytes, per transfer */
+void rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt, u32 max_size)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return;
+	rndis_per_dev_params [configNr].max_pkt_per_xfer = max_pkt;
+	rndis_per_dev_params [configNr].max_xfer_size = max_size;
+}
+
+/* Zero until the host has sent REMOTE_NDIS_INITIALIZE_MSG */
+u32 rndis_host_max_xfer (u8 configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return 0;
+	return rndis_per_dev_params [configNr].host_max_xfer;
+}
+
 void rndis_add_hdr (struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type	*header;
@@ -1299,6 +1328,44 @@ int rndis_rm_hdr(struct sk_buff *skb)
 	return 0;
 }
 
+/*
+ * A transfer from the host may carry several packet messages.  Copies the
+ * first one's frame into a new skb and pulls the message off skb; returns
+ * NULL when skb holds just one message, for rndis_rm_hdr() to finish.
+ */
+struct sk_buff *rndis_split_packet (struct sk_buff *skb)
+{
+	__le32		*tmp = (void *) skb->data;
+	struct sk_buff	*frame;
+	u32		msg_len, data_offset, data_len;
+
+	if (skb->len < sizeof (struct rndis_packet_msg_type)
+			|| __constant_cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp))
+		return NULL;
+
+	/* anything shorter than a header past this message is padding */
+	msg_len = le32_to_cpu(get_unaligned(tmp + 1));
+	if (msg_len >= skb->len || skb->len - msg_len
+			< sizeof (struct rndis_packet_msg_type))
+		return NULL;
+
+	data_offset = le32_to_cpu(get_unaligned(tmp + 2))
+			+ 8 /* offset of DataOffset */;
+	data_len = le32_to_cpu(get_unaligned(tmp + 3));
+	if (data_offset > msg_len || data_len > msg_len - data_offset)
+		return ERR_PTR(-EOVERFLOW);
+
+	frame = alloc_skb (data_len + NET_IP_ALIGN, GFP_ATOMIC);
+	if (!frame)
+		return ERR_PTR(-ENOMEM);
+	skb_reserve (frame, NET_IP_ALIGN);
+	memcpy (skb_put (frame, data_len), skb->data + data_offset, data_len);
+
+	skb_pull (skb, msg_len);
+	return frame;
+}
+
 #ifdef	CONFIG_USB_GADGET_DEBUG_FILES
 
 static int rndis_proc_read (char *page, char **start, off_t off, int count, int *eof,
@@ -1316,7 +1383,9 @@ static int rndis_proc_read (char *page, char **start, off_t off, int count, int
 			 "speed     : %d\n"
 			 "cable     : %s\n"
 			 "vendor ID : 0x%08X\n"
-			 "vendor    : %s\n",
+			 "vendor    : %s\n"
+			 "rx xfer   : %u packets, %u bytes\n"
+			 "tx xfer   : %u bytes\n",
 			 param->confignr, (param->used) ? "y" : "n",
 			 ({ char *s = "?";
 			 switch (param->state) {
@@ -1330,7 +1399,9 @@ static int rndis_proc_read (char *page, char **start, off_t off, int count, int
 			 param->medium,
 			 (param->media_state) ? 0 : param->speed*100,
 			 (param->media_state) ? "disconnected" : "connected",
-			 param->vendorID, param->vendorDescr);
+			 param->vendorID, param->vendorDescr,
+			 param->max_pkt_per_xfer ? : 1, param->max_xfer_size,
+			 param->host_max_xfer);
 
 	len = out - page;
 	len -= off;
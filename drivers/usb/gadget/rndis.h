@@ -241,6 +241,11 @@ typedef struct rndis_params
 	const char		*vendorDescr;
 	int			(*ack) (struct net_device *);
 	struct list_head	resp_queue;
+
+	/* multi-packet transfers: what we accept, and what the host does */
+	u32			max_pkt_per_xfer;
+	u32			max_xfer_size;
+	u32			host_max_xfer;
 } rndis_params;
 
 /* RNDIS Message parser and other useless functions */
@@ -253,8 +258,11 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+void rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt, u32 max_size);
+u32  rndis_host_max_xfer (u8 configNr);
 void rndis_add_hdr (struct sk_buff *skb);
 int rndis_rm_hdr (struct sk_buff *skb);
+struct sk_buff *rndis_split_packet (struct sk_buff *skb);
 u8   *rndis_get_next_response (int configNr, u32 *length);
 void rndis_free_response (int configNr, u8 *buf);
 
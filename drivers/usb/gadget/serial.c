@@ -561,7 +561,7 @@ MODULE_PARM_DESC(write_buf_size, "Write buffer size, default=8192");
 module_param(use_acm, uint, S_IRUGO);
 MODULE_PARM_DESC(use_acm, "Use CDC ACM, 0=no, 1=yes, default=no");
 
-module_init(gs_module_init);
+device_initcall_async(gs_module_init);
 module_exit(gs_module_exit);
 
 /*
@@ -1411,7 +1411,8 @@ int __init pxafb_probe(struct platform_device *dev)
 	}
 
 #ifdef CONFIG_PM
-	// TODO
+	/* the LCD power sequence sleeps, let the rest of the system go on */
+	device_set_async_suspend(&dev->dev, 1);
 #endif
 
 #ifdef CONFIG_CPU_FREQ
@@ -1479,7 +1480,7 @@ int __devinit pxafb_init(void)
 	return platform_driver_register(&pxafb_driver);
 }
 
-module_init(pxafb_init);
+device_initcall_async(pxafb_init);
 
 MODULE_DESCRIPTION("loadable framebuffer driver for PXA");
 MODULE_LICENSE("GPL");
@@ -18,6 +18,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/spinlock.h>
 #include <linux/ds1wm.h>
 
 #include <asm/io.h>
@@ -94,9 +95,17 @@ struct ds1wm_data {
 	struct clk	*clk;
 	int		slave_present;
 	void		*reset_complete;
-	void		*read_complete;
-	void		*write_complete;
-	u8		read_byte; /* last byte received */
+
+	/* Byte stream run from the interrupt handler, see ds1wm_xfer() */
+	spinlock_t	lock;
+	const u8	*tx_buf;
+	int		tx_len;
+	u8		*rx_buf;
+	u8		fill;	/* sent once tx_buf runs out */
+	int		xfer_len;
+	int		tx_pos;
+	int		rx_pos;
+	void		*xfer_complete;
 };
 
 static inline void ds1wm_write_register(struct ds1wm_data *ds1wm_data, u32 reg,
@@ -111,25 +120,75 @@ static inline u8 ds1wm_read_register(struct ds1wm_data *ds1wm_data, u32 reg)
 }
 
 
+static inline u8 ds1wm_inten(struct ds1wm_data *ds1wm_data, u8 bits)
+{
+	return bits | (ds1wm_data->active_high ? DS1WM_INTEN_IAS : 0);
+}
+
+/*
+ * Moves the current transfer along: collects a received byte and keeps
+ * the transmit buffer loaded, so bytes go out back to back while at most
+ * two of them (buffer and shift register) are in flight.  Called with
+ * ds1wm_data->lock held; returns 0 once there is nothing left to do for
+ * this interrupt status.
+ */
+static int ds1wm_pump(struct ds1wm_data *ds1wm_data, u8 intr)
+{
+	int progress = 0;
+
+	if (intr & DS1WM_INT_RBF) {
+		u8 byte = ds1wm_read_register(ds1wm_data, DS1WM_DATA);
+
+		progress = 1;
+		if (ds1wm_data->rx_pos < ds1wm_data->tx_pos) {
+			int i = ds1wm_data->rx_pos++ - ds1wm_data->tx_len;
+
+			if (i >= 0 && ds1wm_data->rx_buf)
+				ds1wm_data->rx_buf[i] = byte;
+			if (ds1wm_data->rx_pos == ds1wm_data->xfer_len &&
+			    ds1wm_data->xfer_complete)
+				complete(ds1wm_data->xfer_complete);
+		}
+	}
+
+	if ((intr & DS1WM_INT_TBE) &&
+	    ds1wm_data->tx_pos < ds1wm_data->xfer_len &&
+	    ds1wm_data->tx_pos - ds1wm_data->rx_pos < 2) {
+		int i = ds1wm_data->tx_pos++;
+
+		ds1wm_write_register(ds1wm_data, DS1WM_DATA,
+			i < ds1wm_data->tx_len ? ds1wm_data->tx_buf[i] :
+						 ds1wm_data->fill);
+		progress = 1;
+
+		/* TBE stays set from here on; only RBF may interrupt now */
+		if (ds1wm_data->tx_pos == ds1wm_data->xfer_len)
+			ds1wm_write_register(ds1wm_data, DS1WM_INT_EN,
+				ds1wm_inten(ds1wm_data,
+					    DS1WM_INTEN_ERBF | DS1WM_INTEN_EPD));
+	}
+
+	return progress;
+}
+
 static irqreturn_t ds1wm_isr(int isr, void *data)
 {
 	struct ds1wm_data *ds1wm_data = data;
-	u8 intr = ds1wm_read_register(ds1wm_data, DS1WM_INT);
+	u8 intr;
 
-	ds1wm_data->slave_present = (intr & DS1WM_INT_PDR) ? 0 : 1;
+	spin_lock(&ds1wm_data->lock);
 
-	if ((intr & DS1WM_INT_PD) && ds1wm_data->reset_complete)
-		complete(ds1wm_data->reset_complete);
+	/* The line is edge triggered, so leave only once nothing is pending */
+	do {
+		intr = ds1wm_read_register(ds1wm_data, DS1WM_INT);
 
-	if ((intr & DS1WM_INT_TSRE) && ds1wm_data->write_complete)
-		complete(ds1wm_data->write_complete);
+		ds1wm_data->slave_present = (intr & DS1WM_INT_PDR) ? 0 : 1;
 
-	if (intr & DS1WM_INT_RBF) {
-		ds1wm_data->read_byte = ds1wm_read_register(ds1wm_data,
-							    DS1WM_DATA);
-		if (ds1wm_data->read_complete)
-			complete(ds1wm_data->read_complete);
-	}
+		if ((intr & DS1WM_INT_PD) && ds1wm_data->reset_complete)
+			complete(ds1wm_data->reset_complete);
+	} while (ds1wm_pump(ds1wm_data, intr));
+
+	spin_unlock(&ds1wm_data->lock);
 
 	return IRQ_HANDLED;
 }
@@ -163,8 +222,7 @@ static int ds1wm_reset(struct ds1wm_data *ds1wm_data)
 	udelay(500);
 
 	ds1wm_write_register(ds1wm_data, DS1WM_INT_EN,
-		DS1WM_INTEN_ERBF | DS1WM_INTEN_ETMT | DS1WM_INTEN_EPD |
-		(ds1wm_data->active_high ? DS1WM_INTEN_IAS : 0));
+		ds1wm_inten(ds1wm_data, DS1WM_INTEN_ERBF | DS1WM_INTEN_EPD));
 
 	if (!ds1wm_data->slave_present) {
                 dev_dbg(&ds1wm_data->pdev->dev, "reset: no devices found\n");
@@ -174,29 +232,73 @@ static int ds1wm_reset(struct ds1wm_data *ds1wm_data)
         return 0;
 }
 
-static int ds1wm_write(struct ds1wm_data *ds1wm_data, u8 data)
+/*
+ * Sends tx_len bytes from tx, then rx_len copies of fill, storing what
+ * comes back during the latter in rx.  The interrupt handler streams the
+ * whole lot; the caller sleeps once, not once per byte.
+ * Returns the number of bytes stored in rx.
+ */
+static int ds1wm_xfer(struct ds1wm_data *ds1wm_data, const u8 *tx, int tx_len,
+		      u8 *rx, int rx_len, u8 fill)
 {
-	DECLARE_COMPLETION_ONSTACK(write_done);
-	ds1wm_data->write_complete = &write_done;
+	DECLARE_COMPLETION_ONSTACK(xfer_done);
+	unsigned long flags;
+	int done;
+
+	if (tx_len + rx_len <= 0)
+		return 0;
+
+	spin_lock_irqsave(&ds1wm_data->lock, flags);
+	ds1wm_data->tx_buf = tx;
+	ds1wm_data->tx_len = tx_len;
+	ds1wm_data->rx_buf = rx;
+	ds1wm_data->fill = fill;
+	ds1wm_data->xfer_len = tx_len + rx_len;
+	ds1wm_data->tx_pos = 0;
+	ds1wm_data->rx_pos = 0;
+	ds1wm_data->xfer_complete = &xfer_done;
+
+	/* Enabling ETBE need not raise an edge, so prime the buffer here */
+	ds1wm_write_register(ds1wm_data, DS1WM_INT_EN,
+		ds1wm_inten(ds1wm_data, DS1WM_INTEN_ETBE | DS1WM_INTEN_ERBF |
+					DS1WM_INTEN_EPD));
+	while (ds1wm_pump(ds1wm_data,
+			  ds1wm_read_register(ds1wm_data, DS1WM_INT)))
+		;
+	spin_unlock_irqrestore(&ds1wm_data->lock, flags);
+
+	wait_for_completion_timeout(&xfer_done, DS1WM_TIMEOUT);
+
+	spin_lock_irqsave(&ds1wm_data->lock, flags);
+	done = ds1wm_data->rx_pos;
+	if (done < ds1wm_data->xfer_len)
+		dev_dbg(&ds1wm_data->pdev->dev, "transfer timed out after "
+			"%d of %d bytes\n", done, ds1wm_data->xfer_len);
+	ds1wm_data->xfer_len = 0;
+	ds1wm_data->tx_pos = 0;
+	ds1wm_data->rx_pos = 0;
+	ds1wm_data->xfer_complete = NULL;
+	ds1wm_write_register(ds1wm_data, DS1WM_INT_EN,
+		ds1wm_inten(ds1wm_data, DS1WM_INTEN_ERBF | DS1WM_INTEN_EPD));
+	spin_unlock_irqrestore(&ds1wm_data->lock, flags);
 
-	ds1wm_write_register(ds1wm_data, DS1WM_DATA, data);
+	return done > tx_len ? done - tx_len : 0;
+}
 
-	wait_for_completion_timeout(&write_done, DS1WM_TIMEOUT);
-	ds1wm_data->write_complete = NULL;
+static int ds1wm_write(struct ds1wm_data *ds1wm_data, u8 data)
+{
+	ds1wm_xfer(ds1wm_data, &data, 1, NULL, 0, 0);
 
 	return 0;
 }
 
 static int ds1wm_read(struct ds1wm_data *ds1wm_data, unsigned char write_data)
 {
-	DECLARE_COMPLETION_ONSTACK(read_done);
-	ds1wm_data->read_complete = &read_done;
+	u8 byte = 0xff;
 
-	ds1wm_write(ds1wm_data, write_data);
-	wait_for_completion_timeout(&read_done, DS1WM_TIMEOUT);
-	ds1wm_data->read_complete = NULL;
+	ds1wm_xfer(ds1wm_data, NULL, 0, &byte, 1, write_data);
 
-	return ds1wm_data->read_byte;
+	return byte;
 }
 
 static int ds1wm_find_divisor(int gclk)
@@ -264,13 +366,36 @@ static void ds1wm_write_byte(void *data, u8 byte)
 	ds1wm_write(ds1wm_data, byte);
 }
 
-static u8 ds1wm_reset_bus(void *data)
+static u8 ds1wm_read_block(void *data, u8 *buf, int len)
 {
 	struct ds1wm_data *ds1wm_data = data;
 
-	ds1wm_reset(ds1wm_data);
+	return ds1wm_xfer(ds1wm_data, NULL, 0, buf, len, 0xff);
+}
 
-	return 0;
+static void ds1wm_write_block(void *data, const u8 *buf, int len)
+{
+	struct ds1wm_data *ds1wm_data = data;
+
+	ds1wm_xfer(ds1wm_data, buf, len, NULL, 0, 0);
+}
+
+static int ds1wm_reset_select_read(void *data, const u8 *wbuf, int wlen,
+				   u8 *rbuf, int rlen)
+{
+	struct ds1wm_data *ds1wm_data = data;
+
+	if (ds1wm_reset(ds1wm_data))
+		return -1;
+
+	return ds1wm_xfer(ds1wm_data, wbuf, wlen, rbuf, rlen, 0xff);
+}
+
+static u8 ds1wm_reset_bus(void *data)
+{
+	struct ds1wm_data *ds1wm_data = data;
+
+	return ds1wm_reset(ds1wm_data);
 }
 
 static void ds1wm_search(void *data, u8 search_type,
@@ -279,6 +404,7 @@ static void ds1wm_search(void *data, u8 search_type,
 	struct ds1wm_data *ds1wm_data = data;
 	int i;
 	unsigned long long rom_id;
+	u8 resp[16];
 
 	/* XXX We need to iterate for multiple devices per the DS1WM docs.
 	 * See http://www.maxim-ic.com/appnotes.cfm/appnote_number/120. */
@@ -288,21 +414,26 @@ static void ds1wm_search(void *data, u8 search_type,
 	ds1wm_write(ds1wm_data, search_type);
 	ds1wm_write_register(ds1wm_data, DS1WM_CMD, DS1WM_CMD_SRA);
 
-	for (rom_id = 0, i = 0; i < 16; i++) {
+	/* All 16 accelerator bytes go out as a single transfer */
+	if (ds1wm_xfer(ds1wm_data, NULL, 0, resp, 16, 0x00) != 16) {
+		ds1wm_write_register(ds1wm_data, DS1WM_CMD, ~DS1WM_CMD_SRA);
+		ds1wm_reset(ds1wm_data);
+		return;
+	}
 
-		unsigned char resp, r, d;
+	for (rom_id = 0, i = 0; i < 16; i++) {
 
-		resp = ds1wm_read(ds1wm_data, 0x00);
+		unsigned char r, d;
 
-		r = ((resp & 0x02) >> 1) |
-		    ((resp & 0x08) >> 2) |
-		    ((resp & 0x20) >> 3) |
-		    ((resp & 0x80) >> 4);
+		r = ((resp[i] & 0x02) >> 1) |
+		    ((resp[i] & 0x08) >> 2) |
+		    ((resp[i] & 0x20) >> 3) |
+		    ((resp[i] & 0x80) >> 4);
 
-		d = ((resp & 0x01) >> 0) |
-		    ((resp & 0x04) >> 1) |
-		    ((resp & 0x10) >> 2) |
-		    ((resp & 0x40) >> 3);
+		d = ((resp[i] & 0x01) >> 0) |
+		    ((resp[i] & 0x04) >> 1) |
+		    ((resp[i] & 0x10) >> 2) |
+		    ((resp[i] & 0x40) >> 3);
 
 		rom_id |= (unsigned long long) r << (i * 4);
 
@@ -320,6 +451,9 @@ static void ds1wm_search(void *data, u8 search_type,
 static struct w1_bus_master ds1wm_master = {
 	.read_byte  = ds1wm_read_byte,
 	.write_byte = ds1wm_write_byte,
+	.read_block = ds1wm_read_block,
+	.write_block = ds1wm_write_block,
+	.reset_select_read = ds1wm_reset_select_read,
 	.reset_bus  = ds1wm_reset_bus,
 	.search	    = ds1wm_search,
 };
@@ -354,6 +488,7 @@ static int ds1wm_probe(struct platform_device *pdev)
 	ds1wm_data->bus_shift = plat->bus_shift;
 	ds1wm_data->pdev = pdev;
 	ds1wm_data->pdata = plat;
+	spin_lock_init(&ds1wm_data->lock);
 
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
 	if (!res) {
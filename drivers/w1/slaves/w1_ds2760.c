@@ -39,17 +39,17 @@ static int w1_ds2760_io(struct device *dev, char *buf, int addr, size_t count,
 	if (addr + count > DS2760_DATA_SIZE)
 		count = DS2760_DATA_SIZE - addr;
 
-	if (!w1_reset_select_slave(sl)) {
-		if (!io) {
-			w1_write_8(sl->master, W1_DS2760_READ_DATA);
-			w1_write_8(sl->master, addr);
-			count = w1_read_block(sl->master, buf, count);
-		} else {
-			w1_write_8(sl->master, W1_DS2760_WRITE_DATA);
-			w1_write_8(sl->master, addr);
-			w1_write_block(sl->master, buf, count);
-			/* XXX w1_write_block returns void, not n_written */
-		}
+	if (!io) {
+		u8 cmd[2] = { W1_DS2760_READ_DATA, addr };
+		int ret = w1_reset_select_read(sl, cmd, 2, buf, count);
+
+		if (ret >= 0)
+			count = ret;
+	} else if (!w1_reset_select_slave(sl)) {
+		w1_write_8(sl->master, W1_DS2760_WRITE_DATA);
+		w1_write_8(sl->master, addr);
+		w1_write_block(sl->master, buf, count);
+		/* XXX w1_write_block returns void, not n_written */
 	}
 
 out:
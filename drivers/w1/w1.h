@@ -136,6 +136,13 @@ struct w1_bus_master
 	 */
 	u8		(*triplet)(void *, u8);
 
+	/**
+	 * Resets the bus, writes the select and command bytes and reads the
+	 * reply as one transfer, for masters that can stream it.
+	 * @return the number of bytes read, -1 if no device answered the reset
+	 */
+	int		(*reset_select_read)(void *, const u8 *, int, u8 *, int);
+
 	/**
 	 * long write-0 with a read for the presence pulse detection
 	 * @return -1=Error, 0=Device present, 1=No device present
@@ -161,6 +168,7 @@ struct w1_master
 	int			initialized;
 	u32			id;
 	int			search_count;
+	unsigned long		search_valid;	/* jiffies the slave list is trusted until */
 
 	atomic_t		refcnt;
 
@@ -194,6 +202,8 @@ u8 w1_calc_crc8(u8 *, int);
 void w1_write_block(struct w1_master *, const u8 *, int);
 u8 w1_read_block(struct w1_master *, u8 *, int);
 int w1_reset_select_slave(struct w1_slave *sl);
+int w1_reset_select_read(struct w1_slave *sl, const u8 *cmd, int cmdlen,
+			 u8 *buf, int len);
 
 static inline struct w1_slave* dev_to_w1_slave(struct device *dev)
 {
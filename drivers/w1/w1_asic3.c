@@ -64,3 +64,10 @@
  */
 
 /* note, windows driver seems to read owm clkdiv register at unusual points in the code */
+
+/*
+ * The OWM is an embedded DS1WM, so the machine code registers it as a
+ * "ds1wm" platform device and masters/ds1wm.c drives it.  That driver
+ * streams whole blocks from the OWM interrupt (TBE to feed, RBF to
+ * collect) instead of the byte-at-a-time polling above.
+ */
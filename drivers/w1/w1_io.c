@@ -292,8 +292,11 @@ void w1_search_devices(struct w1_master *dev, u8 search_type, w1_slave_found_cal
  */
 int w1_reset_select_slave(struct w1_slave *sl)
 {
-	if (w1_reset_bus(sl->master))
+	if (w1_reset_bus(sl->master)) {
+		/* somebody left the bus, do not trust the last search */
+		sl->master->search_valid = jiffies;
 		return -1;
+	}
 
 	if (sl->master->slave_count == 1)
 		w1_write_8(sl->master, W1_SKIP_ROM);
@@ -305,3 +308,51 @@ int w1_reset_select_slave(struct w1_slave *sl)
 	return 0;
 }
 EXPORT_SYMBOL_GPL(w1_reset_select_slave);
+
+#define W1_SELECT_CMD_MAX	8
+
+/**
+ * Resets the bus, selects the slave, writes a command and reads the reply.
+ * Masters with reset_select_read run all of it as one transfer instead of
+ * a call per byte.
+ * The w1 master lock must be held.
+ *
+ * @param sl	 the slave to select
+ * @param cmd	 the command bytes to send after the select
+ * @param cmdlen the number of command bytes
+ * @param buf	 the buffer to fill
+ * @param len	 the number of bytes to read
+ * @return	 the number of bytes read, -1 if no device answered the reset
+ */
+int w1_reset_select_read(struct w1_slave *sl, const u8 *cmd, int cmdlen,
+			 u8 *buf, int len)
+{
+	struct w1_master *dev = sl->master;
+	u8 wbuf[9 + W1_SELECT_CMD_MAX];
+	int wlen, ret;
+
+	if (!dev->bus_master->reset_select_read || cmdlen > W1_SELECT_CMD_MAX) {
+		if (w1_reset_select_slave(sl))
+			return -1;
+		w1_write_block(dev, cmd, cmdlen);
+		return w1_read_block(dev, buf, len);
+	}
+
+	if (dev->slave_count == 1) {
+		wbuf[0] = W1_SKIP_ROM;
+		wlen = 1;
+	} else {
+		wbuf[0] = W1_MATCH_ROM;
+		memcpy(&wbuf[1], (u8 *)&sl->reg_num, 8);
+		wlen = 9;
+	}
+	memcpy(&wbuf[wlen], cmd, cmdlen);
+	wlen += cmdlen;
+
+	ret = dev->bus_master->reset_select_read(dev->bus_master->data,
+						 wbuf, wlen, buf, len);
+	if (ret < 0)
+		dev->search_valid = jiffies;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(w1_reset_select_read);
@@ -23,6 +23,9 @@
 #include <linux/buffer_head.h>
 #include <linux/vfs.h>
 #include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/major.h>
+#include <linux/mtd/mtd.h>
 #include <asm/semaphore.h>
 
 #include <asm/uaccess.h>
@@ -31,6 +34,9 @@ static const struct super_operations cramfs_ops;
 static const struct inode_operations cramfs_dir_inode_operations;
 static const struct file_operations cramfs_directory_operations;
 static const struct address_space_operations cramfs_aops;
+#ifdef CONFIG_CRAMFS_XIP
+static const struct file_operations cramfs_xip_fops;
+#endif
 
 static DEFINE_MUTEX(read_mutex);
 
@@ -40,6 +46,11 @@ static DEFINE_MUTEX(read_mutex);
 #define CRAMINO(x)	(((x)->offset && (x)->size)?(x)->offset<<2:1)
 #define OFFSET(x)	((x)->i_ino)
 
+/* Uncompressed, page aligned file data; see README */
+#define CRAMFS_XIP_FILE(inode) \
+	((CRAMFS_SB((inode)->i_sb)->flags & CRAMFS_FLAG_XIP_FILES) && \
+	 S_ISREG((inode)->i_mode) && ((inode)->i_mode & S_ISVTX))
+
 
 static int cramfs_iget5_test(struct inode *inode, void *opaque)
 {
@@ -83,6 +94,10 @@ static int cramfs_iget5_set(struct inode *inode, void *opaque)
 	   without -noleaf option. */
 	if (S_ISREG(inode->i_mode)) {
 		inode->i_fop = &generic_ro_fops;
+#ifdef CONFIG_CRAMFS_XIP
+		if (CRAMFS_XIP_FILE(inode))
+			inode->i_fop = &cramfs_xip_fops;
+#endif
 		inode->i_data.a_ops = &cramfs_aops;
 	} else if (S_ISDIR(inode->i_mode)) {
 		inode->i_op = &cramfs_dir_inode_operations;
@@ -219,8 +234,102 @@ static void *cramfs_read(struct super_block *sb, unsigned int offset, unsigned i
 	return read_buffers[buffer] + offset;
 }
 
+#ifdef CONFIG_CRAMFS_XIP
+/*
+ * Execute-in-place: uncompressed files of an image on a linearly mapped
+ * NOR flash MTD device are mmap()ed straight from the flash, so running
+ * programs share the flash pages instead of each having its text copied
+ * into RAM.  The mapping is only made after point() has put the flash in
+ * read array mode; if that fails, e.g. because the flash cannot leave an
+ * erase or program operation, the file is mapped through the page cache
+ * like any other.
+ *
+ * Once mapped the pages are read by the CPU directly, so the flash must
+ * not be programmed or erased behind their back: keep writable
+ * partitions on another chip, or use an XIP aware MTD driver
+ * (CONFIG_MTD_XIP), which keeps the chip readable between operations.
+ */
+static int cramfs_xip_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct mtd_info *mtd = CRAMFS_SB(inode->i_sb)->mtd;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long pfn;
+	size_t retlen;
+	u_char *virt;
+	int ret;
+
+	if (!mtd || (OFFSET(inode) & ~PAGE_MASK) ||
+	    offset + len > PAGE_ALIGN(inode->i_size) ||
+	    (vma->vm_flags & (VM_SHARED | VM_MAYWRITE)) == (VM_SHARED | VM_MAYWRITE))
+		return generic_file_readonly_mmap(file, vma);
+
+	ret = mtd->point(mtd, OFFSET(inode) + offset, len, &retlen, &virt);
+	if (ret)
+		return generic_file_readonly_mmap(file, vma);
+	if (retlen != len ||
+	    mtd->point_pfn(mtd, OFFSET(inode) + offset, &pfn)) {
+		mtd->unpoint(mtd, virt, OFFSET(inode) + offset, retlen);
+		return generic_file_readonly_mmap(file, vma);
+	}
+
+	/*
+	 * Writes to private mappings are copied on write as usual.  A
+	 * failed remap_pfn_range() has already changed vm_pgoff and
+	 * vm_flags, so there is no falling back to the page cache; the
+	 * caller unmaps whatever was installed.
+	 */
+	ret = remap_pfn_range(vma, vma->vm_start, pfn, len, vma->vm_page_prot);
+	mtd->unpoint(mtd, virt, OFFSET(inode) + offset, retlen);
+	if (ret)
+		return ret;
+
+	file_accessed(file);
+	return 0;
+}
+
+static const struct file_operations cramfs_xip_fops = {
+	.llseek		= generic_file_llseek,
+	.read		= do_sync_read,
+	.aio_read	= generic_file_aio_read,
+	.mmap		= cramfs_xip_mmap,
+	.sendfile	= generic_file_sendfile,
+};
+
+/* Find the MTD device behind an mtdblock device, if it can be mapped */
+static void cramfs_xip_attach(struct super_block *sb)
+{
+	struct cramfs_sb_info *sbi = CRAMFS_SB(sb);
+	struct mtd_info *mtd;
+
+	if (!(sbi->flags & CRAMFS_FLAG_XIP_FILES) ||
+	    MAJOR(sb->s_dev) != MTD_BLOCK_MAJOR)
+		return;
+
+	mtd = get_mtd_device(NULL, MINOR(sb->s_dev));
+	if (IS_ERR(mtd))
+		return;
+	if (!mtd->point || !mtd->unpoint || !mtd->point_pfn) {
+		put_mtd_device(mtd);
+		return;
+	}
+	sbi->mtd = mtd;
+	printk(KERN_INFO "cramfs: execute-in-place from mtd%d (%s)\n",
+	       mtd->index, mtd->name);
+}
+#else
+static inline void cramfs_xip_attach(struct super_block *sb) { }
+#endif
+
 static void cramfs_put_super(struct super_block *sb)
 {
+#ifdef CONFIG_CRAMFS_XIP
+	struct cramfs_sb_info *sbi = CRAMFS_SB(sb);
+
+	if (sbi->mtd)
+		put_mtd_device(sbi->mtd);
+#endif
 	kfree(sb->s_fs_info);
 	sb->s_fs_info = NULL;
 }
@@ -311,6 +420,7 @@ static int cramfs_fill_super(struct super_block *sb, void *data, int silent)
 		iput(root);
 		goto out;
 	}
+	cramfs_xip_attach(sb);
 	return 0;
 out:
 	kfree(sbi);
@@ -467,7 +577,17 @@ static int cramfs_readpage(struct file *file, struct page * page)
 
 	maxblock = (inode->i_size + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 	bytes_filled = 0;
-	if (page->index < maxblock) {
+	if (page->index < maxblock && CRAMFS_XIP_FILE(inode)) {
+		/* Stored as is */
+		u32 offset = page->index << PAGE_CACHE_SHIFT;
+
+		bytes_filled = min_t(u32, inode->i_size - offset, PAGE_CACHE_SIZE);
+		pgdata = kmap(page);
+		mutex_lock(&read_mutex);
+		memcpy(pgdata, cramfs_read(inode->i_sb, OFFSET(inode) + offset,
+					   bytes_filled), bytes_filled);
+		mutex_unlock(&read_mutex);
+	} else if (page->index < maxblock) {
 		struct super_block *sb = inode->i_sb;
 		u32 blkptr_offset = OFFSET(inode) + page->index*4;
 		u32 start_offset, compr_len;
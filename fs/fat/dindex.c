@@ -0,0 +1,325 @@
+/*
+ *  linux/fs/fat/dindex.c
+ *
+ *  In-memory hashed name index for large vfat directories.
+ *
+ *  fat_search_long() has to walk and decode every entry of a directory to
+ *  find one name.  For directories above FAT_DINDEX_MIN_SLOTS entries the
+ *  first lookup instead builds a small open-addressed table mapping the
+ *  hash of each (case folded) name to the slot offset of its entry, and
+ *  later lookups only decode the entries whose hash matches.
+ *
+ *  The table stores no names: a hit is always verified against the
+ *  directory itself, so a hash collision or a stale slot can only cost an
+ *  extra entry decode.  fat_add_entries() and fat_remove_entries() keep it
+ *  complete.  Every user holds the directory's i_mutex; the shrinker only
+ *  trylocks it, so indexes of busy directories are skipped rather than
+ *  waited for.  Total index memory is capped at 1/64 of RAM.
+ */
+
+#include <linux/fs.h>
+#include <linux/msdos_fs.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+
+#define FAT_DINDEX_EMPTY	0
+#define FAT_DINDEX_DELETED	(~0U)
+
+struct fat_dindex_ent {
+	u32 hash;
+	u32 slot;	/* slot number + 1, or EMPTY/DELETED */
+};
+
+struct fat_dindex {
+	struct list_head lru;
+	struct inode *dir;
+	unsigned int mask;	/* table size - 1 */
+	unsigned int used;	/* live entries */
+	unsigned int filled;	/* live + deleted entries */
+	struct fat_dindex_ent *ents;
+};
+
+static LIST_HEAD(fat_dindex_lru);
+static DEFINE_SPINLOCK(fat_dindex_lock);
+static unsigned long fat_dindex_pages;	/* table pages in use */
+static unsigned long fat_dindex_max_pages;
+static struct shrinker *fat_dindex_shrinker;
+
+static inline unsigned long fat_dindex_size(unsigned int nr)
+{
+	return nr * sizeof(struct fat_dindex_ent);
+}
+
+static inline unsigned long fat_dindex_nr_pages(unsigned int nr)
+{
+	return PAGE_ALIGN(fat_dindex_size(nr)) >> PAGE_SHIFT;
+}
+
+static struct fat_dindex_ent *fat_dindex_alloc_table(unsigned int nr)
+{
+	struct fat_dindex_ent *ents;
+	unsigned long size = fat_dindex_size(nr);
+
+	if (size <= PAGE_SIZE)
+		ents = kmalloc(size, GFP_KERNEL);
+	else
+		ents = vmalloc(size);
+	if (ents)
+		memset(ents, 0, size);
+	return ents;
+}
+
+static void fat_dindex_free_table(struct fat_dindex_ent *ents, unsigned int nr)
+{
+	if (fat_dindex_size(nr) <= PAGE_SIZE)
+		kfree(ents);
+	else
+		vfree(ents);
+}
+
+/*
+ * Detach an index from its directory.  Must hold fat_dindex_lock; the
+ * caller frees the table after dropping it.
+ */
+static void __fat_dindex_detach(struct fat_dindex *idx)
+{
+	list_del(&idx->lru);
+	MSDOS_I(idx->dir)->i_dindex = NULL;
+	fat_dindex_pages -= fat_dindex_nr_pages(idx->mask + 1);
+}
+
+static void fat_dindex_free(struct fat_dindex *idx)
+{
+	fat_dindex_free_table(idx->ents, idx->mask + 1);
+	kfree(idx);
+}
+
+/*
+ * Free up to nr_pages of indexes from the cold end of the LRU.  Returns
+ * the number of pages freed.
+ */
+static unsigned long fat_dindex_prune(unsigned long nr_pages)
+{
+	struct fat_dindex *idx, *n;
+	LIST_HEAD(free_list);
+	unsigned long freed = 0;
+
+	spin_lock(&fat_dindex_lock);
+	list_for_each_entry_safe_reverse(idx, n, &fat_dindex_lru, lru) {
+		struct inode *dir = idx->dir;
+
+		if (freed >= nr_pages)
+			break;
+		if (!mutex_trylock(&dir->i_mutex))
+			continue;
+		freed += fat_dindex_nr_pages(idx->mask + 1);
+		__fat_dindex_detach(idx);
+		mutex_unlock(&dir->i_mutex);
+		list_add(&idx->lru, &free_list);
+	}
+	spin_unlock(&fat_dindex_lock);
+
+	list_for_each_entry_safe(idx, n, &free_list, lru)
+		fat_dindex_free(idx);
+
+	return freed;
+}
+
+static int fat_dindex_shrink(int nr_to_scan, gfp_t gfp_mask)
+{
+	if (nr_to_scan)
+		fat_dindex_prune(nr_to_scan);
+	return (fat_dindex_pages / 100) * sysctl_vfs_cache_pressure;
+}
+
+/*
+ * Attach an empty index sized for nr_names names to dir.  Called with
+ * dir->i_mutex held, dir must not have an index yet.
+ */
+int fat_dindex_create(struct inode *dir, unsigned int nr_names)
+{
+	struct fat_dindex *idx;
+	unsigned int nr;
+	unsigned long pages;
+
+	/* keep the load factor below 2/3 */
+	nr = roundup_pow_of_two(max(nr_names + nr_names / 2, 64U));
+	pages = fat_dindex_nr_pages(nr);
+	if (pages > fat_dindex_max_pages)
+		return -ENOSPC;
+	if (fat_dindex_pages + pages > fat_dindex_max_pages)
+		fat_dindex_prune(fat_dindex_pages + pages - fat_dindex_max_pages);
+
+	idx = kmalloc(sizeof(*idx), GFP_KERNEL);
+	if (!idx)
+		return -ENOMEM;
+	idx->ents = fat_dindex_alloc_table(nr);
+	if (!idx->ents) {
+		kfree(idx);
+		return -ENOMEM;
+	}
+	idx->dir = dir;
+	idx->mask = nr - 1;
+	idx->used = idx->filled = 0;
+
+	spin_lock(&fat_dindex_lock);
+	if (fat_dindex_pages + pages > fat_dindex_max_pages) {
+		spin_unlock(&fat_dindex_lock);
+		fat_dindex_free(idx);
+		return -ENOSPC;
+	}
+	fat_dindex_pages += pages;
+	list_add(&idx->lru, &fat_dindex_lru);
+	MSDOS_I(dir)->i_dindex = idx;
+	spin_unlock(&fat_dindex_lock);
+
+	return 0;
+}
+
+void fat_dindex_drop(struct inode *dir)
+{
+	struct fat_dindex *idx;
+
+	spin_lock(&fat_dindex_lock);
+	idx = MSDOS_I(dir)->i_dindex;
+	if (idx)
+		__fat_dindex_detach(idx);
+	spin_unlock(&fat_dindex_lock);
+
+	if (idx)
+		fat_dindex_free(idx);
+}
+
+static void __fat_dindex_insert(struct fat_dindex *idx, u32 hash, u32 slot)
+{
+	unsigned int i = hash & idx->mask;
+
+	while (idx->ents[i].slot != FAT_DINDEX_EMPTY &&
+	       idx->ents[i].slot != FAT_DINDEX_DELETED)
+		i = (i + 1) & idx->mask;
+	if (idx->ents[i].slot == FAT_DINDEX_EMPTY)
+		idx->filled++;
+	idx->ents[i].hash = hash;
+	idx->ents[i].slot = slot;
+	idx->used++;
+}
+
+/* Rehash into a table of nr entries, dropping the deleted markers. */
+static int fat_dindex_resize(struct fat_dindex *idx, unsigned int nr)
+{
+	struct fat_dindex_ent *old = idx->ents;
+	unsigned int i, old_nr = idx->mask + 1;
+	unsigned long old_pages, pages;
+
+	old_pages = fat_dindex_nr_pages(old_nr);
+	pages = fat_dindex_nr_pages(nr);
+	if (pages > old_pages &&
+	    fat_dindex_pages + pages - old_pages > fat_dindex_max_pages)
+		return -ENOSPC;
+
+	idx->ents = fat_dindex_alloc_table(nr);
+	if (!idx->ents) {
+		idx->ents = old;
+		return -ENOMEM;
+	}
+	idx->mask = nr - 1;
+	idx->used = idx->filled = 0;
+	for (i = 0; i < old_nr; i++) {
+		if (old[i].slot != FAT_DINDEX_EMPTY &&
+		    old[i].slot != FAT_DINDEX_DELETED)
+			__fat_dindex_insert(idx, old[i].hash, old[i].slot);
+	}
+	fat_dindex_free_table(old, old_nr);
+
+	spin_lock(&fat_dindex_lock);
+	fat_dindex_pages += pages;
+	fat_dindex_pages -= old_pages;
+	spin_unlock(&fat_dindex_lock);
+
+	return 0;
+}
+
+/*
+ * Record that the entry starting at slot_off has a name hashing to hash.
+ * On failure the caller must drop the index, it is no longer complete.
+ */
+int fat_dindex_insert(struct inode *dir, u32 hash, loff_t slot_off)
+{
+	struct fat_dindex *idx = MSDOS_I(dir)->i_dindex;
+	unsigned int nr = idx->mask + 1;
+
+	if ((idx->filled + 1) * 4 > nr * 3) {
+		/* grow only if mostly live entries, else just rehash */
+		if ((idx->used + 1) * 2 > nr)
+			nr <<= 1;
+		if (fat_dindex_resize(idx, nr))
+			return -ENOMEM;
+	}
+	__fat_dindex_insert(idx, hash, (slot_off >> MSDOS_DIR_BITS) + 1);
+	return 0;
+}
+
+void fat_dindex_delete(struct inode *dir, u32 hash, loff_t slot_off)
+{
+	struct fat_dindex *idx = MSDOS_I(dir)->i_dindex;
+	u32 slot = (slot_off >> MSDOS_DIR_BITS) + 1;
+	unsigned int i = hash & idx->mask;
+
+	while (idx->ents[i].slot != FAT_DINDEX_EMPTY) {
+		if (idx->ents[i].hash == hash && idx->ents[i].slot == slot) {
+			idx->ents[i].slot = FAT_DINDEX_DELETED;
+			idx->used--;
+			return;
+		}
+		i = (i + 1) & idx->mask;
+	}
+}
+
+/*
+ * Iterate the slot offsets of entries with a name hashing to hash.  Start
+ * with *pos = 0; returns 0 once there are no more candidates.
+ */
+int fat_dindex_lookup(struct inode *dir, u32 hash, unsigned int *pos,
+		      loff_t *slot_off)
+{
+	struct fat_dindex *idx = MSDOS_I(dir)->i_dindex;
+
+	if (*pos == 0) {
+		spin_lock(&fat_dindex_lock);
+		list_move(&idx->lru, &fat_dindex_lru);
+		spin_unlock(&fat_dindex_lock);
+	}
+	while (*pos <= idx->mask) {
+		struct fat_dindex_ent *ent;
+
+		ent = &idx->ents[(hash + *pos) & idx->mask];
+		(*pos)++;
+		if (ent->slot == FAT_DINDEX_EMPTY)
+			break;
+		if (ent->slot != FAT_DINDEX_DELETED && ent->hash == hash) {
+			*slot_off = (loff_t)(ent->slot - 1) << MSDOS_DIR_BITS;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int __init fat_dindex_init(void)
+{
+	fat_dindex_max_pages = max(num_physpages >> 6, 1UL);
+	fat_dindex_shrinker = set_shrinker(DEFAULT_SEEKS, fat_dindex_shrink);
+	if (!fat_dindex_shrinker)
+		return -ENOMEM;
+	return 0;
+}
+
+void fat_dindex_exit(void)
+{
+	if (fat_dindex_shrinker)
+		remove_shrinker(fat_dindex_shrinker);
+}
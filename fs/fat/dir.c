@@ -297,12 +297,28 @@ parse_long:
 	return 0;
 }
 
+enum { FAT_WALK_NEXT, FAT_WALK_FOUND, FAT_WALK_STOP, };
+
 /*
- * Return values: negative -> error, 0 -> not found, positive -> found,
- * value is the total amount of slots, including the shortname entry.
+ * Called by fat_walk_names() for the short name and then, if there is one,
+ * the long name of each directory entry.  slot_off is the offset of the
+ * first slot of the entry.  Returns one of the FAT_WALK_* codes.
  */
-int fat_search_long(struct inode *inode, const unsigned char *name,
-		    int name_len, struct fat_slot_info *sinfo)
+typedef int (*fat_name_actor)(struct inode *dir, void *priv,
+			      const unsigned char *name, int len,
+			      loff_t slot_off);
+
+/*
+ * Walk the directory entries from cpos on, handing their names to actor in
+ * the form fat_search_long() compares them.
+ *
+ * Return values: 0 -> actor returned FAT_WALK_FOUND and sinfo describes the
+ * entry, -ENOENT -> end of directory or FAT_WALK_STOP, other negative value
+ * -> error.
+ */
+static int fat_walk_names(struct inode *inode, loff_t cpos,
+			  fat_name_actor actor, void *priv,
+			  struct fat_slot_info *sinfo)
 {
 	struct super_block *sb = inode->i_sb;
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
@@ -316,10 +332,9 @@ int fat_search_long(struct inode *inode, const unsigned char *name,
 	unsigned char work[8], bufname[260];	/* 256 + 4 */
 	int uni_xlate = sbi->options.unicode_xlate;
 	int utf8 = sbi->options.utf8;
-	int anycase = (sbi->options.name_check != 's');
 	unsigned short opt_shortname = sbi->options.shortname;
-	loff_t cpos = 0;
-	int chl, i, j, last_u, err;
+	loff_t slot_off;
+	int chl, i, j, last_u, err, ret;
 
 	err = -ENOENT;
 	while(1) {
@@ -381,26 +396,26 @@ parse_record:
 		if (!last_u)
 			continue;
 
+		slot_off = cpos - (nr_slots + 1) * sizeof(*de);
 		bufuname[last_u] = 0x0000;
 		xlate_len = utf8
 			?utf8_wcstombs(bufname, bufuname, sizeof(bufname))
 			:uni16_to_x8(bufname, bufuname, uni_xlate, nls_io);
-		if (xlate_len == name_len)
-			if ((!anycase && !memcmp(name, bufname, xlate_len)) ||
-			    (anycase && !nls_strnicmp(nls_io, name, bufname,
-								xlate_len)))
-				goto Found;
+		ret = actor(inode, priv, bufname, xlate_len, slot_off);
+		if (ret == FAT_WALK_FOUND)
+			goto Found;
+		else if (ret == FAT_WALK_STOP)
+			goto Stop;
 
 		if (nr_slots) {
 			xlate_len = utf8
 				?utf8_wcstombs(bufname, unicode, sizeof(bufname))
 				:uni16_to_x8(bufname, unicode, uni_xlate, nls_io);
-			if (xlate_len != name_len)
-				continue;
-			if ((!anycase && !memcmp(name, bufname, xlate_len)) ||
-			    (anycase && !nls_strnicmp(nls_io, name, bufname,
-								xlate_len)))
+			ret = actor(inode, priv, bufname, xlate_len, slot_off);
+			if (ret == FAT_WALK_FOUND)
 				goto Found;
+			else if (ret == FAT_WALK_STOP)
+				goto Stop;
 		}
 	}
 
@@ -412,6 +427,9 @@ Found:
 	sinfo->bh = bh;
 	sinfo->i_pos = fat_make_i_pos(sb, sinfo->bh, sinfo->de);
 	err = 0;
+	goto EODir;
+Stop:
+	brelse(bh);
 EODir:
 	if (unicode)
 		free_page((unsigned long)unicode);
@@ -419,6 +437,151 @@ EODir:
 	return err;
 }
 
+/*
+ * Hash a name the way fat_search_long() compares it: case folded through
+ * the io charset unless "check=s", as vfat_hashi() does for the dcache.
+ */
+static u32 fat_name_hash(struct inode *dir, const unsigned char *name, int len)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(dir->i_sb);
+	unsigned long hash = init_name_hash();
+
+	if (sbi->options.name_check != 's') {
+		while (len--)
+			hash = partial_name_hash(nls_tolower(sbi->nls_io, *name++),
+						 hash);
+	} else {
+		while (len--)
+			hash = partial_name_hash(*name++, hash);
+	}
+	return end_name_hash(hash);
+}
+
+struct fat_name_match {
+	const unsigned char *name;
+	int len;
+	loff_t slot_off;	/* entry to check, or -1 for any */
+};
+
+static int fat_match_actor(struct inode *dir, void *priv,
+			   const unsigned char *name, int len, loff_t slot_off)
+{
+	struct fat_name_match *match = priv;
+	struct msdos_sb_info *sbi = MSDOS_SB(dir->i_sb);
+
+	if (match->slot_off >= 0 && slot_off != match->slot_off)
+		return FAT_WALK_STOP;
+	if (len != match->len)
+		return FAT_WALK_NEXT;
+	if (sbi->options.name_check != 's') {
+		if (!nls_strnicmp(sbi->nls_io, match->name, name, len))
+			return FAT_WALK_FOUND;
+	} else if (!memcmp(match->name, name, len))
+		return FAT_WALK_FOUND;
+
+	return FAT_WALK_NEXT;
+}
+
+/*
+ * Directories with fewer slots than this are cheap enough to scan, and
+ * do not get a name index.
+ */
+#define FAT_DINDEX_MIN_SLOTS	256
+
+struct fat_dindex_update {
+	loff_t slot_off;	/* entry to (un)index, or -1 for all */
+	int remove;
+	int err;
+};
+
+static int fat_dindex_update_actor(struct inode *dir, void *priv,
+				   const unsigned char *name, int len,
+				   loff_t slot_off)
+{
+	struct fat_dindex_update *update = priv;
+	u32 hash;
+
+	if (update->slot_off >= 0 && slot_off != update->slot_off)
+		return FAT_WALK_STOP;
+	hash = fat_name_hash(dir, name, len);
+	if (update->remove)
+		fat_dindex_delete(dir, hash, slot_off);
+	else {
+		update->err = fat_dindex_insert(dir, hash, slot_off);
+		if (update->err)
+			return FAT_WALK_STOP;
+	}
+	return FAT_WALK_NEXT;
+}
+
+/*
+ * Add (or remove) the names of the entry at slot_off to the index of dir.
+ * If that fails the index no longer covers every name, so drop it.
+ */
+static void fat_dindex_update(struct inode *dir, loff_t slot_off, int remove)
+{
+	struct fat_dindex_update update = { slot_off, remove, 0 };
+	struct fat_slot_info sinfo;
+	int err;
+
+	if (!MSDOS_I(dir)->i_dindex)
+		return;
+	err = fat_walk_names(dir, slot_off, fat_dindex_update_actor, &update,
+			     &sinfo);
+	if (err != -ENOENT || update.err)
+		fat_dindex_drop(dir);
+}
+
+static int fat_dindex_build(struct inode *dir)
+{
+	struct fat_dindex_update update = { -1, 0, 0 };
+	struct fat_slot_info sinfo;
+	unsigned int nr_slots = dir->i_size >> MSDOS_DIR_BITS;
+	int err;
+
+	if (nr_slots < FAT_DINDEX_MIN_SLOTS)
+		return -ENOENT;
+	err = fat_dindex_create(dir, nr_slots);
+	if (err)
+		return err;
+	err = fat_walk_names(dir, 0, fat_dindex_update_actor, &update, &sinfo);
+	if (err != -ENOENT || update.err) {
+		fat_dindex_drop(dir);
+		return update.err ? update.err : err;
+	}
+	return 0;
+}
+
+/*
+ * Return values: negative -> error, 0 -> found (sinfo describes the
+ * entry, its slots including the shortname entry are sinfo->nr_slots).
+ *
+ * Large directories are searched through their name index: only the
+ * entries whose name hash matches are decoded and compared.
+ */
+int fat_search_long(struct inode *inode, const unsigned char *name,
+		    int name_len, struct fat_slot_info *sinfo)
+{
+	struct fat_name_match match = { name, name_len, -1 };
+	unsigned int pos = 0;
+	loff_t slot_off;
+	u32 hash;
+	int err;
+
+	if (!MSDOS_I(inode)->i_dindex && fat_dindex_build(inode))
+		return fat_walk_names(inode, 0, fat_match_actor, &match, sinfo);
+
+	hash = fat_name_hash(inode, name, name_len);
+	while (fat_dindex_lookup(inode, hash, &pos, &slot_off)) {
+		match.slot_off = slot_off;
+		err = fat_walk_names(inode, slot_off, fat_match_actor, &match,
+				     sinfo);
+		if (err != -ENOENT)
+			return err;
+	}
+	return -ENOENT;
+}
+
 EXPORT_SYMBOL_GPL(fat_search_long);
 
 struct fat_ioctl_filldir_callback {
@@ -948,6 +1111,8 @@ int fat_remove_entries(struct inode *dir, struct fat_slot_info *sinfo)
 	struct buffer_head *bh;
 	int err = 0, nr_slots;
 
+	fat_dindex_update(dir, sinfo->slot_off, 1);
+
 	/*
 	 * First stage: Remove the shortname. By this, the directory
 	 * entry is removed.
@@ -1304,6 +1469,7 @@ found:
 	sinfo->de = de;
 	sinfo->bh = bh;
 	sinfo->i_pos = fat_make_i_pos(sb, sinfo->bh, sinfo->de);
+	fat_dindex_update(dir, sinfo->slot_off, 0);
 
 	return 0;
 
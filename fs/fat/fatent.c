@@ -6,6 +6,9 @@
 #include <linux/module.h>
 #include <linux/fs.h>
 #include <linux/msdos_fs.h>
+#include <linux/vmalloc.h>
+#include <linux/bitmap.h>
+#include <linux/workqueue.h>
 
 struct fatent_operations {
 	void (*ent_blocknr)(struct super_block *, int, int *, sector_t *);
@@ -375,11 +378,68 @@ error:
 	return err;
 }
 
+/*
+ * Copying a FAT block to the backup FATs on every update costs a getblk
+ * and a block copy per FAT, for each cluster appended to a file.  Unless
+ * the update must be synchronous, only remember the FAT block here and
+ * copy each block once from fat_mirror_flush() (->write_super) or when
+ * the batch fills up.  Must hold fat_lock.
+ */
+static int __fat_mirror_flush(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct buffer_head *bh;
+	int i, err = 0;
+
+	for (i = 0; i < sbi->mirror_nr; i++) {
+		bh = sb_bread(sb, sbi->mirror_blocks[i]);
+		if (!bh) {
+			err = -EIO;
+			continue;
+		}
+		if (!err)
+			err = fat_mirror_bhs(sb, &bh, 1);
+		brelse(bh);
+	}
+	sbi->mirror_nr = 0;
+	return err;
+}
+
+static int __fat_mirror_bhs(struct super_block *sb, struct buffer_head **bhs,
+			    int nr_bhs, int sync)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	int i, n, err = 0;
+
+	if (sync || (sb->s_flags & MS_SYNCHRONOUS))
+		return fat_mirror_bhs(sb, bhs, nr_bhs);
+	if (sbi->fats < 2)
+		return 0;
+
+	for (n = 0; n < nr_bhs; n++) {
+		for (i = 0; i < sbi->mirror_nr; i++) {
+			if (sbi->mirror_blocks[i] == bhs[n]->b_blocknr)
+				break;
+		}
+		if (i < sbi->mirror_nr)
+			continue;
+		if (sbi->mirror_nr == FAT_MIRROR_BATCH) {
+			err = __fat_mirror_flush(sb);
+			if (err)
+				break;
+		}
+		sbi->mirror_blocks[sbi->mirror_nr++] = bhs[n]->b_blocknr;
+	}
+	sb->s_dirt = 1;
+	return err;
+}
+
 int fat_ent_write(struct inode *inode, struct fat_entry *fatent,
 		  int new, int wait)
 {
 	struct super_block *sb = inode->i_sb;
-	struct fatent_operations *ops = MSDOS_SB(sb)->fatent_ops;
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fatent_operations *ops = sbi->fatent_ops;
 	int err;
 
 	ops->ent_put(fatent, new);
@@ -388,7 +448,21 @@ int fat_ent_write(struct inode *inode, struct fat_entry *fatent,
 		if (err)
 			return err;
 	}
-	return fat_mirror_bhs(sb, fatent->bhs, fatent->nr_bhs);
+	lock_fat(sbi);
+	err = __fat_mirror_bhs(sb, fatent->bhs, fatent->nr_bhs, wait);
+	unlock_fat(sbi);
+	return err;
+}
+
+int fat_mirror_flush(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	int err;
+
+	lock_fat(sbi);
+	err = __fat_mirror_flush(sb);
+	unlock_fat(sbi);
+	return err;
 }
 
 static inline int fat_ent_next(struct msdos_sb_info *sbi,
@@ -431,6 +505,69 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+/*
+ * Free space bitmap.  After mount fat_free_map_scan() reads the whole FAT
+ * once from a workqueue and records one bit per cluster (set = free).
+ * From then on the allocator finds free clusters and extents in memory
+ * instead of reading FAT blocks forward from prev_free, and the count of
+ * free clusters is known without another scan.  The bits are kept in sync
+ * under fat_lock by allocation and freeing, also while the scan is still
+ * running: it reads each FAT block under the lock too, so a block that
+ * has not been scanned yet just gets read in its current state later.
+ */
+static struct workqueue_struct *fat_wq;
+
+/* a new cluster chain is started in a free extent at least this big */
+#define FAT_EXTENT_MIN		(256 * 1024)
+
+static inline void fat_free_map_set(struct msdos_sb_info *sbi, int entry,
+				    int free)
+{
+	if (!sbi->free_map)
+		return;
+	if (free)
+		__set_bit(entry, sbi->free_map);
+	else
+		__clear_bit(entry, sbi->free_map);
+}
+
+/*
+ * Choose where to start allocating.  A file being extended continues
+ * right after its last cluster if that one is free.  A new chain starts at
+ * the first free extent after prev_free of at least FAT_EXTENT_MIN, so the
+ * file has room to grow contiguously.  Failing both, take the next free
+ * cluster.  Must hold fat_lock, and the free map must be ready.
+ */
+static int fat_free_map_goal(struct msdos_sb_info *sbi, int goal)
+{
+	unsigned long *map = sbi->free_map;
+	int max_cluster = sbi->max_cluster;
+	int min_run, from, limit, start, end, pass;
+
+	if (goal >= FAT_START_ENT && goal < max_cluster && test_bit(goal, map))
+		return goal;
+
+	min_run = max(FAT_EXTENT_MIN >> sbi->cluster_bits, 1);
+	for (pass = 0; pass < 2; pass++) {
+		from = pass ? FAT_START_ENT : sbi->prev_free + 1;
+		limit = pass ? sbi->prev_free + 1 : max_cluster;
+		while (from < limit) {
+			start = find_next_bit(map, limit, from);
+			if (start >= limit)
+				break;
+			end = find_next_zero_bit(map, max_cluster, start);
+			if (end - start >= min_run)
+				return start;
+			from = end;
+		}
+	}
+
+	start = find_next_bit(map, max_cluster, sbi->prev_free + 1);
+	if (start >= max_cluster)
+		start = find_next_bit(map, max_cluster, FAT_START_ENT);
+	return start;
+}
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -438,10 +575,18 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	struct fatent_operations *ops = sbi->fatent_ops;
 	struct fat_entry fatent, prev_ent;
 	struct buffer_head *bhs[MAX_BUF_PER_PAGE];
-	int i, count, err, nr_bhs, idx_clus;
+	int i, count, err, nr_bhs, idx_clus, map_ready, goal = 0;
 
 	BUG_ON(nr_cluster > (MAX_BUF_PER_PAGE / 2));	/* fixed limit */
 
+	if (sbi->free_map_ready && MSDOS_I(inode)->i_start) {
+		int fclus, dclus;
+
+		/* append right after the current last cluster if possible */
+		if (fat_get_cluster(inode, FAT_ENT_EOF, &fclus, &dclus) >= 0)
+			goal = dclus + 1;
+	}
+
 	lock_fat(sbi);
 	if (sbi->free_clusters != -1 && sbi->free_clusters < nr_cluster) {
 		unlock_fat(sbi);
@@ -453,9 +598,24 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	fatent_init(&prev_ent);
 	fatent_init(&fatent);
 	fatent_set_entry(&fatent, sbi->prev_free + 1);
+	map_ready = sbi->free_map_ready;
+	if (map_ready)
+		fatent_set_entry(&fatent, fat_free_map_goal(sbi, goal));
 	while (count < sbi->max_cluster) {
 		if (fatent.entry >= sbi->max_cluster)
 			fatent.entry = FAT_START_ENT;
+		if (map_ready) {
+			/* skip the FAT blocks without free entries */
+			int next = find_next_bit(sbi->free_map, sbi->max_cluster,
+						 fatent.entry);
+			if (next >= sbi->max_cluster) {
+				count += sbi->max_cluster - fatent.entry;
+				fatent.entry = FAT_START_ENT;
+				continue;
+			}
+			count += next - fatent.entry;
+			fatent.entry = next;
+		}
 		fatent_set_entry(&fatent, fatent.entry);
 		err = fat_ent_read_block(sb, &fatent);
 		if (err)
@@ -472,6 +632,7 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 					ops->ent_put(&prev_ent, entry);
 
 				fat_collect_bhs(bhs, &nr_bhs, &fatent);
+				fat_free_map_set(sbi, entry, 0);
 
 				sbi->prev_free = entry;
 				if (sbi->free_clusters != -1)
@@ -488,7 +649,8 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 				 * so we can still use the prev_ent.
 				 */
 				prev_ent = fatent;
-			}
+			} else if (map_ready)
+				fat_free_map_set(sbi, fatent.entry, 0);
 			count++;
 			if (count == sbi->max_cluster)
 				break;
@@ -501,11 +663,12 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	err = -ENOSPC;
 
 out:
-	unlock_fat(sbi);
 	fatent_brelse(&fatent);
-	if (!err) {
-		if (inode_needs_sync(inode))
-			err = fat_sync_bhs(bhs, nr_bhs);
+	if (!err && !inode_needs_sync(inode))
+		err = __fat_mirror_bhs(sb, bhs, nr_bhs, 0);
+	unlock_fat(sbi);
+	if (!err && inode_needs_sync(inode)) {
+		err = fat_sync_bhs(bhs, nr_bhs);
 		if (!err)
 			err = fat_mirror_bhs(sb, bhs, nr_bhs);
 	}
@@ -543,6 +706,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		fat_free_map_set(sbi, fatent.entry, 1);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			sb->s_dirt = 1;
@@ -554,7 +718,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 				if (err)
 					goto error;
 			}
-			err = fat_mirror_bhs(sb, bhs, nr_bhs);
+			err = __fat_mirror_bhs(sb, bhs, nr_bhs, 0);
 			if (err)
 				goto error;
 			for (i = 0; i < nr_bhs; i++)
@@ -569,7 +733,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		if (err)
 			goto error;
 	}
-	err = fat_mirror_bhs(sb, bhs, nr_bhs);
+	err = __fat_mirror_bhs(sb, bhs, nr_bhs, 0);
 error:
 	fatent_brelse(&fatent);
 	for (i = 0; i < nr_bhs; i++)
@@ -590,6 +754,10 @@ int fat_count_free_clusters(struct super_block *sb)
 	struct fat_entry fatent;
 	int err = 0, free;
 
+	/* the background scan is counting them already */
+	if (sbi->free_map)
+		wait_for_completion(&sbi->free_map_done);
+
 	lock_fat(sbi);
 	if (sbi->free_clusters != -1)
 		goto out;
@@ -614,3 +782,87 @@ out:
 	unlock_fat(sbi);
 	return err;
 }
+
+static void fat_free_map_scan(struct work_struct *work)
+{
+	struct msdos_sb_info *sbi =
+		container_of(work, struct msdos_sb_info, free_map_work);
+	struct super_block *sb = sbi->free_map_sb;
+	struct fatent_operations *ops = sbi->fatent_ops;
+	struct fat_entry fatent;
+	int err = 0;
+
+	fatent_init(&fatent);
+	fatent_set_entry(&fatent, FAT_START_ENT);
+	while (fatent.entry < sbi->max_cluster && !sbi->free_map_abort) {
+		lock_fat(sbi);
+		err = fat_ent_read_block(sb, &fatent);
+		if (err) {
+			unlock_fat(sbi);
+			break;
+		}
+		do {
+			fat_free_map_set(sbi, fatent.entry,
+					 ops->ent_get(&fatent) == FAT_ENT_FREE);
+		} while (fat_ent_next(sbi, &fatent));
+		unlock_fat(sbi);
+		cond_resched();
+	}
+	fatent_brelse(&fatent);
+
+	if (!err && !sbi->free_map_abort) {
+		lock_fat(sbi);
+		sbi->free_clusters = bitmap_weight(sbi->free_map,
+						   sbi->max_cluster);
+		sbi->free_map_ready = 1;
+		sb->s_dirt = 1;
+		unlock_fat(sbi);
+	}
+	complete_all(&sbi->free_map_done);
+}
+
+/* Called at the end of a successful fill_super */
+void fat_free_map_start(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	unsigned long size = BITS_TO_LONGS(sbi->max_cluster) * sizeof(long);
+
+	sbi->free_map = vmalloc(size);
+	if (!sbi->free_map)
+		return;
+	memset(sbi->free_map, 0, size);
+	sbi->free_map_sb = sb;
+	init_completion(&sbi->free_map_done);
+	INIT_WORK(&sbi->free_map_work, fat_free_map_scan);
+	queue_work(fat_wq, &sbi->free_map_work);
+}
+
+/* Called from put_super: stop the scan and write out the batched mirrors */
+void fat_free_map_stop(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	if (sbi->free_map) {
+		sbi->free_map_abort = 1;
+		wait_for_completion(&sbi->free_map_done);
+		flush_workqueue(fat_wq);
+		vfree(sbi->free_map);
+		sbi->free_map = NULL;
+		sbi->free_map_ready = 0;
+	}
+	if (!(sb->s_flags & MS_RDONLY))
+		fat_mirror_flush(sb);
+}
+
+int __init fat_free_map_init(void)
+{
+	fat_wq = create_singlethread_workqueue("fat");
+	if (!fat_wq)
+		return -ENOMEM;
+	return 0;
+}
+
+void fat_free_map_exit(void)
+{
+	destroy_workqueue(fat_wq);
+}
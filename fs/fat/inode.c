@@ -439,6 +439,7 @@ static void fat_clear_inode(struct inode *inode)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
 
+	fat_dindex_drop(inode);
 	if (is_bad_inode(inode))
 		return;
 	lock_kernel();
@@ -453,14 +454,18 @@ static void fat_write_super(struct super_block *sb)
 {
 	sb->s_dirt = 0;
 
-	if (!(sb->s_flags & MS_RDONLY))
+	if (!(sb->s_flags & MS_RDONLY)) {
+		fat_mirror_flush(sb);
 		fat_clusters_flush(sb);
+	}
 }
 
 static void fat_put_super(struct super_block *sb)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
 
+	fat_free_map_stop(sb);
+
 	if (sbi->nls_disk) {
 		unload_nls(sbi->nls_disk);
 		sbi->nls_disk = NULL;
@@ -506,6 +511,7 @@ static void init_once(void * foo, struct kmem_cache * cachep, unsigned long flag
 		ei->cache_valid_id = FAT_CACHE_VALID + 1;
 		INIT_LIST_HEAD(&ei->cache_lru);
 		INIT_HLIST_NODE(&ei->i_fat_hash);
+		ei->i_dindex = NULL;
 		inode_init_once(&ei->vfs_inode);
 	}
 }
@@ -522,7 +528,7 @@ static int __init fat_init_inodecache(void)
 	return 0;
 }
 
-static void __exit fat_destroy_inodecache(void)
+static void fat_destroy_inodecache(void)
 {
 	kmem_cache_destroy(fat_inode_cachep);
 }
@@ -1408,6 +1414,8 @@ int fat_fill_super(struct super_block *sb, void *data, int silent,
 		goto out_fail;
 	}
 
+	fat_free_map_start(sb);
+
 	return 0;
 
 out_invalid:
@@ -1486,23 +1494,36 @@ static int __init init_fat_fs(void)
 {
 	int err;
 
-	err = fat_cache_init();
+	err = fat_free_map_init();
 	if (err)
 		return err;
 
+	err = fat_cache_init();
+	if (err)
+		goto failed_wq;
+
 	err = fat_init_inodecache();
 	if (err)
 		goto failed;
 
+	err = fat_dindex_init();
+	if (err)
+		goto failed_dindex;
 	return 0;
 
+failed_dindex:
+	fat_destroy_inodecache();
 failed:
 	fat_cache_destroy();
+failed_wq:
+	fat_free_map_exit();
 	return err;
 }
 
 static void __exit exit_fat_fs(void)
 {
+	fat_dindex_exit();
+	fat_free_map_exit();
 	fat_cache_destroy();
 	fat_destroy_inodecache();
 }
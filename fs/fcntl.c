@@ -11,6 +11,7 @@
 #include <linux/file.h>
 #include <linux/capability.h>
 #include <linux/dnotify.h>
+#include <linux/pipe_fs_i.h>
 #include <linux/smp_lock.h>
 #include <linux/slab.h>
 #include <linux/module.h>
@@ -376,6 +377,10 @@ static long do_fcntl(int fd, unsigned int cmd, unsigned long arg,
 	case F_NOTIFY:
 		err = fcntl_dirnotify(fd, filp, arg);
 		break;
+	case F_SETPIPE_SZ:
+	case F_GETPIPE_SZ:
+		err = pipe_fcntl(filp, cmd, arg);
+		break;
 	default:
 		break;
 	}
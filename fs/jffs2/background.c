@@ -72,6 +72,7 @@ void jffs2_stop_garbage_collect_thread(struct jffs2_sb_info *c)
 static int jffs2_garbage_collect_thread(void *_c)
 {
 	struct jffs2_sb_info *c = _c;
+	int erase, idle, ret;
 
 	daemonize("jffs2_gcd_mtd%d", c->mtd->index);
 	allow_signal(SIGKILL);
@@ -87,13 +88,17 @@ static int jffs2_garbage_collect_thread(void *_c)
 		allow_signal(SIGHUP);
 
 		if (!jffs2_thread_should_wake(c)) {
+			/* If there is idle-time work, come back for it once
+			   the writers have been quiet for long enough */
+			long timeout = jffs2_gc_idle_timeout(c);
+
 			set_current_state (TASK_INTERRUPTIBLE);
 			D1(printk(KERN_DEBUG "jffs2_garbage_collect_thread sleeping...\n"));
 			/* Yes, there's a race here; we checked jffs2_thread_should_wake()
 			   before setting current->state to TASK_INTERRUPTIBLE. But it doesn't
 			   matter - We don't care if we miss a wakeup, because the GC thread
 			   is only an optimisation anyway. */
-			schedule();
+			schedule_timeout(timeout);
 		}
 
 		if (try_to_freeze())
@@ -136,11 +141,34 @@ static int jffs2_garbage_collect_thread(void *_c)
 		/* We don't want SIGHUP to interrupt us. STOP and KILL are OK though. */
 		disallow_signal(SIGHUP);
 
+		/* Erase ahead rather than leave it to a writer */
+		spin_lock(&c->erase_completion_lock);
+		erase = !list_empty(&c->erase_pending_list) ||
+			!list_empty(&c->erase_complete_list);
+		if (erase)
+			c->gc_stat_erase_ahead++;
+		idle = !c->unchecked_size && !jffs2_gc_pressure(c);
+		spin_unlock(&c->erase_completion_lock);
+		if (erase) {
+			D1(printk(KERN_DEBUG "jffs2_garbage_collect_thread(): erasing\n"));
+			jffs2_erase_pending_blocks(c, 1);
+			continue;
+		}
+
 		D1(printk(KERN_DEBUG "jffs2_garbage_collect_thread(): pass\n"));
-		if (jffs2_garbage_collect_pass(c) == -ENOSPC) {
+		if (idle)
+			ret = jffs2_garbage_collect_idle_pass(c);
+		else
+			ret = jffs2_garbage_collect_pass(c);
+		if (ret == -ENOSPC) {
 			printk(KERN_NOTICE "No space for garbage collection. Aborting GC thread\n");
 			goto die;
 		}
+		if (!ret) {
+			spin_lock(&c->erase_completion_lock);
+			c->gc_stat_passes++;
+			spin_unlock(&c->erase_completion_lock);
+		}
 	}
  die:
 	spin_lock(&c->erase_completion_lock);
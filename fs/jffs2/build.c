@@ -16,8 +16,13 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/mtd/mtd.h>
+#include <linux/moduleparam.h>
 #include "nodelist.h"
 
+static unsigned int jffs2_gc_pool_blocks = 4;
+module_param_named(gc_pool_blocks, jffs2_gc_pool_blocks, uint, 0444);
+MODULE_PARM_DESC(gc_pool_blocks, "Free blocks the GC thread keeps erased ahead when idle, on top of the throttle level");
+
 static void jffs2_build_remove_unlinked_inode(struct jffs2_sb_info *,
 		struct jffs2_inode_cache *, struct jffs2_full_dirent **);
 
@@ -257,7 +262,7 @@ static void jffs2_build_remove_unlinked_inode(struct jffs2_sb_info *c,
 
 static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 {
-	uint32_t size;
+	uint32_t size, pool;
 
 	/* Deletion should almost _always_ be allowed. We're fairly
 	   buggered once we stop allowing people to delete stuff
@@ -287,6 +292,14 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 	   than actually making progress? */
 	c->resv_blocks_gcbad = 0;//c->resv_blocks_deletion + 2;
 
+	/* Below this, each write does a share of the GC itself, more the
+	   closer we get to resv_blocks_write */
+	c->resv_blocks_throttle = c->resv_blocks_gctrigger + 2;
+
+	/* How many free blocks the GC thread keeps ready when idle */
+	pool = c->resv_blocks_throttle + jffs2_gc_pool_blocks;
+	c->resv_blocks_gcpool = min_t(uint32_t, pool, 255);
+
 	/* If there's less than this amount of dirty space, don't bother
 	   trying to GC to make more space. It'll be a fruitless task */
 	c->nospc_dirty_size = c->sector_size + (c->flash_size / 100);
@@ -303,6 +316,10 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 		  c->resv_blocks_gcmerge, c->resv_blocks_gcmerge*c->sector_size/1024);
 	dbg_fsbuild("Blocks required to GC bad blocks:     %d (%d KiB)\n",
 		  c->resv_blocks_gcbad, c->resv_blocks_gcbad*c->sector_size/1024);
+	dbg_fsbuild("Blocks required to stop throttling:   %d (%d KiB)\n",
+		  c->resv_blocks_throttle, c->resv_blocks_throttle*c->sector_size/1024);
+	dbg_fsbuild("Blocks kept erased when idle:         %d (%d KiB)\n",
+		  c->resv_blocks_gcpool, c->resv_blocks_gcpool*c->sector_size/1024);
 	dbg_fsbuild("Amount of dirty space required to GC: %d bytes\n",
 		  c->nospc_dirty_size);
 }
@@ -312,6 +329,7 @@ int jffs2_do_mount_fs(struct jffs2_sb_info *c)
 	int ret;
 	int i;
 	int size;
+	uint32_t now = jffs2_gc_now();
 
 	c->free_size = c->flash_size;
 	c->nr_blocks = c->flash_size / c->sector_size;
@@ -330,6 +348,7 @@ int jffs2_do_mount_fs(struct jffs2_sb_info *c)
 		INIT_LIST_HEAD(&c->blocks[i].list);
 		c->blocks[i].offset = i * c->sector_size;
 		c->blocks[i].free_size = c->sector_size;
+		c->blocks[i].gc_stamp = now;
 	}
 
 	INIT_LIST_HEAD(&c->clean_list);
@@ -13,6 +13,12 @@
  *
  */
 
+#include <linux/sched.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <asm/uaccess.h>
+#include <asm/div64.h>
 #include "compr.h"
 
 static DEFINE_SPINLOCK(jffs2_compressor_list_lock);
@@ -26,6 +32,263 @@ static int jffs2_compression_mode = JFFS2_COMPR_MODE_PRIORITY;
 /* Statistics for blocks stored without compression */
 static uint32_t none_stat_compr_blocks=0,none_stat_decompr_blocks=0,none_stat_compr_size=0;
 
+/*
+ * Adaptive mode.  The first JFFS2_ADAPT_SAMPLES data nodes of an inode
+ * are given to every compressor, and the one with the lowest cost --
+ * compressed size plus its expected decompression time, converted to
+ * bytes by compr_us_weight -- is then used alone for that inode.  An
+ * inode none of whose samples shrank holds already compressed data and
+ * is written as is, with one probe every JFFS2_ADAPT_REPROBE nodes.  If
+ * the chosen compressor fails JFFS2_ADAPT_MISSES times in a row the
+ * inode is sampled again.
+ */
+#define JFFS2_ADAPT_SAMPLES	4
+#define JFFS2_ADAPT_MISSES	4
+#define JFFS2_ADAPT_REPROBE	64
+/* Trial decompressions until this much has been timed per compressor */
+#define JFFS2_ADAPT_TIMED	(64 * 1024)
+
+static int jffs2_compr_us_weight = 8;
+module_param_named(compr_us_weight, jffs2_compr_us_weight, int, 0644);
+MODULE_PARM_DESC(compr_us_weight, "Adaptive compression: flash bytes worth one microsecond of decompression");
+
+static uint32_t adapt_stat_samples, adapt_stat_skipped, adapt_stat_relearned;
+
+static int jffs2_timed_compress(struct jffs2_compressor *this,
+				unsigned char *data_in, unsigned char *cpage_out,
+				uint32_t *datalen, uint32_t *cdatalen,
+				unsigned long long *ns)
+{
+	unsigned long long start = sched_clock();
+	int ret;
+
+	ret = this->compress(data_in, cpage_out, datalen, cdatalen, NULL);
+	*ns = sched_clock() - start;
+	return ret;
+}
+
+/* Called with jffs2_compressor_list_lock held */
+static void jffs2_account_decompr(struct jffs2_compressor *this,
+				  uint32_t datalen, unsigned long long ns)
+{
+	this->est_decompr_ns += ns;
+	this->est_decompr_size += datalen;
+	/* Let the estimate follow recent behaviour and stay in 32 bits */
+	if (this->est_decompr_size > (1 << 30)) {
+		this->est_decompr_ns >>= 1;
+		this->est_decompr_size >>= 1;
+	}
+}
+
+/* Expected decompression time of datalen bytes, in flash bytes */
+static uint32_t jffs2_decompr_cost(struct jffs2_compressor *this,
+				   uint32_t datalen)
+{
+	uint64_t cost;
+
+	if (!this->est_decompr_size || jffs2_compr_us_weight <= 0)
+		return 0;
+	cost = this->est_decompr_ns * datalen;
+	do_div(cost, this->est_decompr_size);
+	cost *= jffs2_compr_us_weight;
+	do_div(cost, 1000);
+	return cost > 0xffffffff ? 0xffffffff : (uint32_t)cost;
+}
+
+/*
+ * Compress with the compressor for type compr only.  Returns compr,
+ * JFFS2_COMPR_NONE if the data did not shrink, or -ENOENT if that
+ * compressor is gone or disabled.
+ */
+static int jffs2_compress_one(uint8_t compr, unsigned char *data_in,
+			      unsigned char **output_buf,
+			      uint32_t *datalen, uint32_t *cdatalen)
+{
+	struct jffs2_compressor *this;
+	uint32_t orig_slen = *datalen, orig_dlen = *cdatalen;
+	unsigned long long ns;
+	unsigned char *buf;
+	int ret = -ENOENT, compr_ret;
+
+	buf = kmalloc(orig_dlen, GFP_KERNEL);
+	if (!buf) {
+		printk(KERN_WARNING "JFFS2: No memory for compressor allocation. Compression failed.\n");
+		return JFFS2_COMPR_NONE;
+	}
+	spin_lock(&jffs2_compressor_list_lock);
+	list_for_each_entry(this, &jffs2_compressor_list, list) {
+		if (this->compr != compr || !this->compress || this->disabled)
+			continue;
+
+		this->usecount++;
+		spin_unlock(&jffs2_compressor_list_lock);
+		compr_ret = jffs2_timed_compress(this, data_in, buf, datalen,
+						 cdatalen, &ns);
+		spin_lock(&jffs2_compressor_list_lock);
+		this->usecount--;
+		this->stat_compr_ns += ns;
+		if (compr_ret) {
+			this->stat_compr_failed++;
+			ret = JFFS2_COMPR_NONE;
+		} else {
+			this->stat_compr_blocks++;
+			this->stat_compr_orig_size += *datalen;
+			this->stat_compr_new_size  += *cdatalen;
+			ret = compr;
+		}
+		break;
+	}
+	spin_unlock(&jffs2_compressor_list_lock);
+
+	if (ret > 0) {
+		*output_buf = buf;
+	} else {
+		kfree(buf);
+		*datalen = orig_slen;
+		*cdatalen = orig_dlen;
+	}
+	return ret;
+}
+
+/*
+ * Try every compressor and keep the cheapest result.  Compressors whose
+ * decompression speed is still unknown get a trial decompression.
+ */
+static int jffs2_compress_sample(unsigned char *data_in,
+				 unsigned char **output_buf,
+				 uint32_t *datalen, uint32_t *cdatalen)
+{
+	struct jffs2_compressor *this;
+	uint32_t orig_slen = *datalen, orig_dlen = *cdatalen;
+	uint32_t slen, dlen, cost, best_cost = 0, best_slen = 0, best_dlen = 0;
+	unsigned char *buf, *best_buf = NULL, *check_buf = NULL, *tmp_buf;
+	unsigned long long ns, dns = 0;
+	int ret = JFFS2_COMPR_NONE, compr_ret, timed;
+
+	buf = kmalloc(orig_dlen, GFP_KERNEL);
+	if (!buf) {
+		printk(KERN_WARNING "JFFS2: No memory for compressor allocation. Compression failed.\n");
+		return JFFS2_COMPR_NONE;
+	}
+	spin_lock(&jffs2_compressor_list_lock);
+	list_for_each_entry(this, &jffs2_compressor_list, list) {
+		/* Skip decompress-only backwards-compatibility and disabled modules */
+		if ((!this->compress)||(this->disabled))
+			continue;
+
+		this->usecount++;
+		spin_unlock(&jffs2_compressor_list_lock);
+		slen = orig_slen;
+		dlen = orig_dlen;
+		compr_ret = jffs2_timed_compress(this, data_in, buf, &slen,
+						 &dlen, &ns);
+		timed = 0;
+		if (!compr_ret && this->est_decompr_size < JFFS2_ADAPT_TIMED) {
+			if (!check_buf)
+				check_buf = kmalloc(orig_slen, GFP_KERNEL);
+			if (check_buf) {
+				dns = sched_clock();
+				timed = !this->decompress(buf, check_buf, dlen,
+							  slen, NULL);
+				dns = sched_clock() - dns;
+			}
+		}
+		spin_lock(&jffs2_compressor_list_lock);
+		this->usecount--;
+		this->stat_compr_ns += ns;
+		if (compr_ret) {
+			this->stat_compr_failed++;
+			continue;
+		}
+		if (timed)
+			jffs2_account_decompr(this, slen, dns);
+
+		cost = dlen + jffs2_decompr_cost(this, slen);
+		if (ret != JFFS2_COMPR_NONE && cost >= best_cost)
+			continue;
+		ret = this->compr;
+		best_cost = cost;
+		best_slen = slen;
+		best_dlen = dlen;
+		/* Keep this output, reuse the previous best's buffer */
+		tmp_buf = best_buf;
+		best_buf = buf;
+		buf = tmp_buf;
+		if (!buf) {
+			spin_unlock(&jffs2_compressor_list_lock);
+			buf = kmalloc(orig_dlen, GFP_KERNEL);
+			spin_lock(&jffs2_compressor_list_lock);
+			if (!buf)
+				break;
+		}
+	}
+	if (ret != JFFS2_COMPR_NONE) {
+		list_for_each_entry(this, &jffs2_compressor_list, list) {
+			if (this->compr == ret) {
+				this->stat_compr_blocks++;
+				this->stat_compr_orig_size += best_slen;
+				this->stat_compr_new_size  += best_dlen;
+				break;
+			}
+		}
+	}
+	spin_unlock(&jffs2_compressor_list_lock);
+	kfree(buf);
+	kfree(check_buf);
+
+	if (ret != JFFS2_COMPR_NONE) {
+		*output_buf = best_buf;
+		*datalen = best_slen;
+		*cdatalen = best_dlen;
+	}
+	return ret;
+}
+
+/* Called with f->sem held, which serialises access to the f->compr_* */
+static int jffs2_compress_adaptive(struct jffs2_inode_info *f,
+				   unsigned char *data_in,
+				   unsigned char **output_buf,
+				   uint32_t *datalen, uint32_t *cdatalen)
+{
+	int ret;
+
+	if (f && f->compr_samples >= JFFS2_ADAPT_SAMPLES) {
+		if (f->compr_hint == JFFS2_COMPR_NONE) {
+			if (++f->compr_misses < JFFS2_ADAPT_REPROBE) {
+				adapt_stat_skipped++;
+				return JFFS2_COMPR_NONE;
+			}
+			/* Take one more sample; the data may have changed */
+			f->compr_misses = 0;
+			f->compr_samples--;
+		} else {
+			ret = jffs2_compress_one(f->compr_hint, data_in,
+						 output_buf, datalen, cdatalen);
+			if (ret > 0) {
+				f->compr_misses = 0;
+				return ret;
+			}
+			if (ret == JFFS2_COMPR_NONE &&
+			    ++f->compr_misses < JFFS2_ADAPT_MISSES)
+				return JFFS2_COMPR_NONE;
+			/* Start over with the node at hand */
+			f->compr_hint = JFFS2_COMPR_NONE;
+			f->compr_samples = 0;
+			f->compr_misses = 0;
+			adapt_stat_relearned++;
+		}
+	}
+
+	ret = jffs2_compress_sample(data_in, output_buf, datalen, cdatalen);
+	adapt_stat_samples++;
+	if (f) {
+		f->compr_samples++;
+		if (ret != JFFS2_COMPR_NONE)
+			f->compr_hint = ret;
+	}
+	return ret;
+}
+
 /* jffs2_compress:
  * @data: Pointer to uncompressed data
  * @cdata: Pointer to returned pointer to buffer for compressed data
@@ -50,6 +313,7 @@ uint16_t jffs2_compress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 {
 	int ret = JFFS2_COMPR_NONE;
         int compr_ret;
+        unsigned long long ns;
         struct jffs2_compressor *this, *best=NULL;
         unsigned char *output_buf = NULL, *tmp_buf;
         uint32_t orig_slen, orig_dlen;
@@ -76,10 +340,13 @@ uint16_t jffs2_compress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
                         spin_unlock(&jffs2_compressor_list_lock);
                         *datalen  = orig_slen;
                         *cdatalen = orig_dlen;
-                        compr_ret = this->compress(data_in, output_buf, datalen, cdatalen, NULL);
+                        compr_ret = jffs2_timed_compress(this, data_in, output_buf, datalen, cdatalen, &ns);
                         spin_lock(&jffs2_compressor_list_lock);
                         this->usecount--;
-                        if (!compr_ret) {
+                        this->stat_compr_ns += ns;
+                        if (compr_ret)
+                                this->stat_compr_failed++;
+                        else {
                                 ret = this->compr;
                                 this->stat_compr_blocks++;
                                 this->stat_compr_orig_size += *datalen;
@@ -123,10 +390,13 @@ uint16_t jffs2_compress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
                         spin_unlock(&jffs2_compressor_list_lock);
                         *datalen  = orig_slen;
                         *cdatalen = orig_dlen;
-                        compr_ret = this->compress(data_in, this->compr_buf, datalen, cdatalen, NULL);
+                        compr_ret = jffs2_timed_compress(this, data_in, this->compr_buf, datalen, cdatalen, &ns);
                         spin_lock(&jffs2_compressor_list_lock);
                         this->usecount--;
-                        if (!compr_ret) {
+                        this->stat_compr_ns += ns;
+                        if (compr_ret)
+                                this->stat_compr_failed++;
+                        else {
                                 if ((!best_dlen)||(best_dlen>*cdatalen)) {
                                         best_dlen = *cdatalen;
                                         best_slen = *datalen;
@@ -147,6 +417,9 @@ uint16_t jffs2_compress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
                 }
                 spin_unlock(&jffs2_compressor_list_lock);
                 break;
+        case JFFS2_COMPR_MODE_ADAPTIVE:
+                ret = jffs2_compress_adaptive(f, data_in, &output_buf, datalen, cdatalen);
+                break;
         default:
                 printk(KERN_ERR "JFFS2: unknow compression mode.\n");
         }
@@ -168,6 +441,7 @@ int jffs2_decompress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 		     unsigned char *data_out, uint32_t cdatalen, uint32_t datalen)
 {
         struct jffs2_compressor *this;
+        unsigned long long ns;
         int ret;
 
 	/* Older code had a bug where it would write non-zero 'usercompr'
@@ -190,13 +464,17 @@ int jffs2_decompress(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
                         if (comprtype == this->compr) {
                                 this->usecount++;
                                 spin_unlock(&jffs2_compressor_list_lock);
+                                ns = sched_clock();
                                 ret = this->decompress(cdata_in, data_out, cdatalen, datalen, NULL);
+                                ns = sched_clock() - ns;
                                 spin_lock(&jffs2_compressor_list_lock);
+                                this->stat_decompr_ns += ns;
                                 if (ret) {
                                         printk(KERN_WARNING "Decompressor \"%s\" returned %d\n", this->name, ret);
                                 }
                                 else {
                                         this->stat_decompr_blocks++;
+                                        jffs2_account_decompr(this, datalen, ns);
                                 }
                                 this->usecount--;
                                 spin_unlock(&jffs2_compressor_list_lock);
@@ -225,6 +503,11 @@ int jffs2_register_compressor(struct jffs2_compressor *comp)
         comp->stat_compr_new_size=0;
         comp->stat_compr_blocks=0;
         comp->stat_decompr_blocks=0;
+        comp->stat_compr_failed=0;
+        comp->stat_compr_ns=0;
+        comp->stat_decompr_ns=0;
+        comp->est_decompr_ns=0;
+        comp->est_decompr_size=0;
         D1(printk(KERN_DEBUG "Registering JFFS2 compressor \"%s\"\n", comp->name));
 
         spin_lock(&jffs2_compressor_list_lock);
@@ -302,6 +585,11 @@ char *jffs2_stats(void)
                            none_stat_compr_size, none_stat_decompr_blocks);
         spin_lock(&jffs2_compressor_list_lock);
         list_for_each_entry(this, &jffs2_compressor_list, list) {
+                unsigned long long compr_us = this->stat_compr_ns;
+                unsigned long long decompr_us = this->stat_decompr_ns;
+
+                do_div(compr_us, 1000);
+                do_div(decompr_us, 1000);
                 act_buf += sprintf(act_buf,"%10s ",this->name);
                 if ((this->disabled)||(!this->compress))
                         act_buf += sprintf(act_buf,"- ");
@@ -310,9 +598,12 @@ char *jffs2_stats(void)
                 act_buf += sprintf(act_buf,"compr: %d blocks (%d/%d)  decompr: %d blocks ", this->stat_compr_blocks,
                                    this->stat_compr_new_size, this->stat_compr_orig_size,
                                    this->stat_decompr_blocks);
-                act_buf += sprintf(act_buf,"\n");
+                act_buf += sprintf(act_buf,"\n%10s   time: compr %llu us (%d failed)  decompr %llu us\n", "",
+                                   compr_us, this->stat_compr_failed, decompr_us);
         }
         spin_unlock(&jffs2_compressor_list_lock);
+        act_buf += sprintf(act_buf,"adaptive: %d sampled, %d stored incompressible, %d relearned\n",
+                           adapt_stat_samples, adapt_stat_skipped, adapt_stat_relearned);
 
         return buf;
 }
@@ -326,6 +617,8 @@ char *jffs2_get_compression_mode_name(void)
                 return "priority";
         case JFFS2_COMPR_MODE_SIZE:
                 return "size";
+        case JFFS2_COMPR_MODE_ADAPTIVE:
+                return "adaptive";
         }
         return "unkown";
 }
@@ -344,6 +637,10 @@ int jffs2_set_compression_mode_name(const char *name)
                 jffs2_compression_mode = JFFS2_COMPR_MODE_SIZE;
                 return 0;
         }
+        if (!strcmp("adaptive",name)) {
+                jffs2_compression_mode = JFFS2_COMPR_MODE_ADAPTIVE;
+                return 0;
+        }
         return 1;
 }
 
@@ -373,6 +670,81 @@ int jffs2_disable_compressor_name(const char *name)
         return jffs2_compressor_Xable(name, 1);
 }
 
+static int jffs2_compr_stats_show(struct seq_file *m, void *v)
+{
+        char *buf = jffs2_stats();
+
+        if (!buf)
+                return -ENOMEM;
+        seq_puts(m, buf);
+        kfree(buf);
+        return 0;
+}
+
+static int jffs2_compr_stats_open(struct inode *inode, struct file *file)
+{
+        return single_open(file, jffs2_compr_stats_show, NULL);
+}
+
+static const struct file_operations jffs2_compr_stats_fops = {
+        .open           = jffs2_compr_stats_open,
+        .read           = seq_read,
+        .llseek         = seq_lseek,
+        .release        = single_release,
+};
+
+static int jffs2_compr_mode_read(char *page, char **start, off_t off,
+                                 int count, int *eof, void *data)
+{
+        *eof = 1;
+        return sprintf(page, "%s\n", jffs2_get_compression_mode_name());
+}
+
+static int jffs2_compr_mode_write(struct file *file, const char __user *buffer,
+                                  unsigned long count, void *data)
+{
+        char mode[16];
+
+        if (!count || count >= sizeof(mode))
+                return -EINVAL;
+        if (copy_from_user(mode, buffer, count))
+                return -EFAULT;
+        mode[count] = 0;
+        if (mode[count - 1] == '\n')
+                mode[count - 1] = 0;
+        if (jffs2_set_compression_mode_name(mode))
+                return -EINVAL;
+        return count;
+}
+
+struct proc_dir_entry *jffs2_proc_root;
+
+static void jffs2_compr_proc_init(void)
+{
+        struct proc_dir_entry *ent;
+
+        jffs2_proc_root = proc_mkdir("fs/jffs2", NULL);
+        if (!jffs2_proc_root)
+                return;
+        ent = create_proc_entry("compr_stats", S_IRUGO, jffs2_proc_root);
+        if (ent)
+                ent->proc_fops = &jffs2_compr_stats_fops;
+        ent = create_proc_entry("compr_mode", S_IRUGO | S_IWUSR, jffs2_proc_root);
+        if (ent) {
+                ent->read_proc = jffs2_compr_mode_read;
+                ent->write_proc = jffs2_compr_mode_write;
+        }
+}
+
+static void jffs2_compr_proc_exit(void)
+{
+        if (!jffs2_proc_root)
+                return;
+        remove_proc_entry("compr_mode", jffs2_proc_root);
+        remove_proc_entry("compr_stats", jffs2_proc_root);
+        remove_proc_entry("fs/jffs2", NULL);
+}
+
 int jffs2_set_compressor_priority(const char *name, int priority)
 {
         struct jffs2_compressor *this,*comp;
@@ -418,6 +790,9 @@ int __init jffs2_compressors_init(void)
 #ifdef CONFIG_JFFS2_ZLIB
         jffs2_zlib_init();
 #endif
+#ifdef CONFIG_JFFS2_LZF
+        jffs2_lzf_init();
+#endif
 #ifdef CONFIG_JFFS2_RTIME
         jffs2_rtime_init();
 #endif
@@ -433,15 +808,26 @@ int __init jffs2_compressors_init(void)
 #ifdef CONFIG_JFFS2_CMODE_SIZE
         jffs2_compression_mode = JFFS2_COMPR_MODE_SIZE;
         D1(printk(KERN_INFO "JFFS2: default compression mode: size\n");)
+#else
+#ifdef CONFIG_JFFS2_CMODE_ADAPTIVE
+        jffs2_compression_mode = JFFS2_COMPR_MODE_ADAPTIVE;
+        D1(printk(KERN_INFO "JFFS2: default compression mode: adaptive\n");)
 #else
         D1(printk(KERN_INFO "JFFS2: default compression mode: priority\n");)
 #endif
+#endif
+#endif
+#ifdef CONFIG_JFFS2_PROC
+        jffs2_compr_proc_init();
 #endif
         return 0;
 }
 
 int jffs2_compressors_exit(void)
 {
+#ifdef CONFIG_JFFS2_PROC
+        jffs2_compr_proc_exit();
+#endif
 /* Unregistering compressors */
 #ifdef CONFIG_JFFS2_RUBIN
         jffs2_dynrubin_exit();
@@ -450,6 +836,9 @@ int jffs2_compressors_exit(void)
 #ifdef CONFIG_JFFS2_RTIME
         jffs2_rtime_exit();
 #endif
+#ifdef CONFIG_JFFS2_LZF
+        jffs2_lzf_exit();
+#endif
 #ifdef CONFIG_JFFS2_ZLIB
         jffs2_zlib_exit();
 #endif
@@ -33,6 +33,7 @@
 #define JFFS2_LZO_PRIORITY       40
 #define JFFS2_RTIME_PRIORITY     50
 #define JFFS2_ZLIB_PRIORITY      60
+#define JFFS2_LZF_PRIORITY       70
 
 #define JFFS2_RUBINMIPS_DISABLED /* RUBINs will be used only */
 #define JFFS2_DYNRUBIN_DISABLED  /*        for decompression */
@@ -40,6 +41,7 @@
 #define JFFS2_COMPR_MODE_NONE       0
 #define JFFS2_COMPR_MODE_PRIORITY   1
 #define JFFS2_COMPR_MODE_SIZE       2
+#define JFFS2_COMPR_MODE_ADAPTIVE   3
 
 struct jffs2_compressor {
         struct list_head list;
@@ -58,6 +60,11 @@ struct jffs2_compressor {
         uint32_t stat_compr_new_size;
         uint32_t stat_compr_blocks;
         uint32_t stat_decompr_blocks;
+        uint32_t stat_compr_failed;  /* attempts which did not shrink the data */
+        uint64_t stat_compr_ns;      /* time spent, in ns of sched_clock() */
+        uint64_t stat_decompr_ns;
+        uint64_t est_decompr_ns;     /* decaying decompression speed */
+        uint32_t est_decompr_size;   /* estimate for the adaptive mode */
 };
 
 int jffs2_register_compressor(struct jffs2_compressor *comp);
@@ -103,5 +110,9 @@ void jffs2_rtime_exit(void);
 int jffs2_zlib_init(void);
 void jffs2_zlib_exit(void);
 #endif
+#ifdef CONFIG_JFFS2_LZF
+int jffs2_lzf_init(void);
+void jffs2_lzf_exit(void);
+#endif
 
 #endif /* __JFFS2_COMPR_H__ */
@@ -0,0 +1,96 @@
+/*
+ * JFFS2 -- Journalling Flash File System, Version 2.
+ *
+ * For licensing information, see the file 'LICENCE' in this directory.
+ *
+ * LZF compressor: a fraction of zlib's ratio, but decompression is a
+ * bounds checked byte copier several times faster than inflate, which
+ * is what matters for a mostly-read root file system.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/vmalloc.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/lzf.h>
+#include <linux/jffs2.h>
+#include "compr.h"
+
+static DEFINE_MUTEX(lzf_mutex);
+static void *lzf_wrkmem;
+
+static int jffs2_lzf_compress(unsigned char *data_in,
+			      unsigned char *cpage_out,
+			      uint32_t *sourcelen, uint32_t *dstlen,
+			      void *model)
+{
+	size_t out_len;
+
+	/* Only worth it if the result is smaller than the input */
+	if (*sourcelen < 2)
+		return -1;
+	out_len = min(*dstlen, *sourcelen - 1);
+
+	mutex_lock(&lzf_mutex);
+	out_len = lzf_compress(data_in, *sourcelen, cpage_out, out_len,
+			       lzf_wrkmem);
+	mutex_unlock(&lzf_mutex);
+
+	if (!out_len)
+		return -1;
+
+	*dstlen = out_len;
+	return 0;
+}
+
+static int jffs2_lzf_decompress(unsigned char *data_in,
+				unsigned char *cpage_out,
+				uint32_t srclen, uint32_t destlen,
+				void *model)
+{
+	int ret;
+
+	ret = lzf_decompress(data_in, srclen, cpage_out, destlen);
+	if (ret < 0)
+		return ret;
+	if (ret != destlen)
+		return -EIO;
+	return 0;
+}
+
+static struct jffs2_compressor jffs2_lzf_comp = {
+    .priority = JFFS2_LZF_PRIORITY,
+    .name = "lzf",
+    .compr = JFFS2_COMPR_LZF,
+    .compress = &jffs2_lzf_compress,
+    .decompress = &jffs2_lzf_decompress,
+#ifdef JFFS2_LZF_DISABLED
+    .disabled = 1,
+#else
+    .disabled = 0,
+#endif
+};
+
+int __init jffs2_lzf_init(void)
+{
+    int ret;
+
+    lzf_wrkmem = vmalloc(LZF_WRKMEM_SIZE);
+    if (!lzf_wrkmem)
+        return -ENOMEM;
+
+    ret = jffs2_register_compressor(&jffs2_lzf_comp);
+    if (ret)
+        vfree(lzf_wrkmem);
+
+    return ret;
+}
+
+void jffs2_lzf_exit(void)
+{
+    jffs2_unregister_compressor(&jffs2_lzf_comp);
+    vfree(lzf_wrkmem);
+}
@@ -475,6 +475,10 @@ int jffs2_do_fill_super(struct super_block *sb, void *data, int silent)
 		printk(KERN_ERR "jffs2: Cannot operate on DataFlash unless jffs2 DataFlash support is compiled in.\n");
 		return -EINVAL;
 	}
+	if (c->mtd->type == MTD_UBIVOLUME) {
+		printk(KERN_ERR "jffs2: Cannot operate on UBI volumes unless jffs2 write buffer support is compiled in.\n");
+		return -EINVAL;
+	}
 #endif
 
 	c->flash_size = c->mtd->size;
@@ -533,6 +537,7 @@ int jffs2_do_fill_super(struct super_block *sb, void *data, int silent)
 	sb->s_magic = JFFS2_SUPER_MAGIC;
 	if (!(sb->s_flags & MS_RDONLY))
 		jffs2_start_garbage_collect_thread(c);
+	jffs2_gc_proc_add(c);
 	return 0;
 
  out_root_i:
@@ -672,6 +677,13 @@ static int jffs2_flash_setup(struct jffs2_sb_info *c) {
 			return ret;
 	}
 
+	/* and UBI volumes */
+	if (jffs2_ubivol(c)) {
+		ret = jffs2_ubivol_setup(c);
+		if (ret)
+			return ret;
+	}
+
 	return ret;
 }
 
@@ -690,4 +702,9 @@ void jffs2_flash_cleanup(struct jffs2_sb_info *c) {
 	if (jffs2_nor_wbuf_flash(c)) {
 		jffs2_nor_wbuf_flash_cleanup(c);
 	}
+
+	/* and UBI volumes */
+	if (jffs2_ubivol(c)) {
+		jffs2_ubivol_cleanup(c);
+	}
 }
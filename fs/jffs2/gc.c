@@ -18,6 +18,10 @@
 #include <linux/crc32.h>
 #include <linux/compiler.h>
 #include <linux/stat.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <asm/div64.h>
 #include "nodelist.h"
 #include "compr.h"
 
@@ -39,47 +43,101 @@ static int jffs2_garbage_collect_dnode(struct jffs2_sb_info *c, struct jffs2_era
 static int jffs2_garbage_collect_live(struct jffs2_sb_info *c,  struct jffs2_eraseblock *jeb,
 			       struct jffs2_raw_node_ref *raw, struct jffs2_inode_info *f);
 
+/* Blocks looked at on each of the dirty lists when picking a victim */
+#define JFFS2_GC_SCAN_MAX	256
+
+/*
+ * Cost-benefit of collecting jeb, as in LFS: the space it gives back
+ * over the cost of reading and rewriting its valid data, times the
+ * age of that data.  Data which has survived long is unlikely to be
+ * obsoleted soon, so it is better moved now than a block whose dirt
+ * is still growing by itself.
+ */
+static uint64_t jffs2_gc_score(struct jffs2_sb_info *c,
+			       struct jffs2_eraseblock *jeb, uint32_t now)
+{
+	uint64_t score = jeb->dirty_size + jeb->wasted_size;
+
+	score *= (uint32_t)(now - jeb->gc_stamp) + 1;
+	score <<= 8;
+	do_div(score, c->sector_size + jeb->used_size);
+	return score;
+}
+
+/* Called with erase_completion_lock held.  Searches very_dirty_list,
+   and dirty_list as well unless very_dirty_only is set. */
+static struct jffs2_eraseblock *jffs2_find_best_dirty(struct jffs2_sb_info *c,
+						      int very_dirty_only)
+{
+	struct list_head *lists[2] = { &c->very_dirty_list, &c->dirty_list };
+	struct jffs2_eraseblock *jeb, *best = NULL;
+	uint64_t score, best_score = 0;
+	uint32_t now = jffs2_gc_now();
+	int i, n;
+
+	for (i = 0; i < (very_dirty_only ? 1 : 2); i++) {
+		n = 0;
+		list_for_each_entry(jeb, lists[i], list) {
+			if (++n > JFFS2_GC_SCAN_MAX)
+				break;
+			score = jffs2_gc_score(c, jeb, now);
+			if (!best || score > best_score) {
+				best = jeb;
+				best_score = score;
+			}
+		}
+	}
+	return best;
+}
+
 /* Called with erase_completion_lock held */
-static struct jffs2_eraseblock *jffs2_find_gc_block(struct jffs2_sb_info *c)
+static struct jffs2_eraseblock *jffs2_find_gc_block(struct jffs2_sb_info *c,
+						    int idle)
 {
 	struct jffs2_eraseblock *ret;
 	struct list_head *nextlist = NULL;
 	int n = jiffies % 128;
 
-	/* Pick an eraseblock to garbage collect next. This is where we'll
-	   put the clever wear-levelling algorithms. Eventually.  */
-	/* We possibly want to favour the dirtier blocks more when the
-	   number of free blocks is low. */
+	/* Blocks with nothing valid left cost nothing but the erase, so
+	   they always go first.  Otherwise the dirty block with the best
+	   cost-benefit is picked, except for an occasional clean block so
+	   static data gets moved off its eraseblock for wear levelling.
+	   An idle pass only takes what jffs2_gc_idle_work() allows it. */
 again:
-	if (!list_empty(&c->bad_used_list) && c->nr_free_blocks > c->resv_blocks_gcbad) {
+	if (idle) {
+		if (c->nr_free_blocks + c->nr_erasing_blocks >= c->resv_blocks_gcpool)
+			return NULL;
+		if (!list_empty(&c->erasable_list)) {
+			D1(printk(KERN_DEBUG "Picking block from erasable_list to GC next (idle)\n"));
+			nextlist = &c->erasable_list;
+		} else if (!list_empty(&c->very_dirty_list)) {
+			ret = jffs2_find_best_dirty(c, 1);
+			D1(printk(KERN_DEBUG "Picking block at 0x%08x to GC next (idle)\n",
+				  ret->offset));
+			goto found;
+		} else {
+			return NULL;
+		}
+	} else if (!list_empty(&c->bad_used_list) && c->nr_free_blocks > c->resv_blocks_gcbad) {
 		D1(printk(KERN_DEBUG "Picking block from bad_used_list to GC next\n"));
 		nextlist = &c->bad_used_list;
-	} else if (n < 50 && !list_empty(&c->erasable_list)) {
-		/* Note that most of them will have gone directly to be erased.
-		   So don't favour the erasable_list _too_ much. */
+	} else if (!list_empty(&c->erasable_list)) {
 		D1(printk(KERN_DEBUG "Picking block from erasable_list to GC next\n"));
 		nextlist = &c->erasable_list;
-	} else if (n < 110 && !list_empty(&c->very_dirty_list)) {
-		/* Most of the time, pick one off the very_dirty list */
-		D1(printk(KERN_DEBUG "Picking block from very_dirty_list to GC next\n"));
-		nextlist = &c->very_dirty_list;
-	} else if (n < 126 && !list_empty(&c->dirty_list)) {
-		D1(printk(KERN_DEBUG "Picking block from dirty_list to GC next\n"));
-		nextlist = &c->dirty_list;
+	} else if (n < 126 && (!list_empty(&c->very_dirty_list) ||
+			       !list_empty(&c->dirty_list))) {
+		ret = jffs2_find_best_dirty(c, 0);
+		D1(printk(KERN_DEBUG "Picking block at 0x%08x (used 0x%08x, dirty 0x%08x) to GC next\n",
+			  ret->offset, ret->used_size, ret->dirty_size));
+		goto found;
 	} else if (!list_empty(&c->clean_list)) {
 		D1(printk(KERN_DEBUG "Picking block from clean_list to GC next\n"));
 		nextlist = &c->clean_list;
-	} else if (!list_empty(&c->dirty_list)) {
-		D1(printk(KERN_DEBUG "Picking block from dirty_list to GC next (clean_list was empty)\n"));
-
-		nextlist = &c->dirty_list;
-	} else if (!list_empty(&c->very_dirty_list)) {
-		D1(printk(KERN_DEBUG "Picking block from very_dirty_list to GC next (clean_list and dirty_list were empty)\n"));
-		nextlist = &c->very_dirty_list;
-	} else if (!list_empty(&c->erasable_list)) {
-		D1(printk(KERN_DEBUG "Picking block from erasable_list to GC next (clean_list and {very_,}dirty_list were empty)\n"));
-
-		nextlist = &c->erasable_list;
+	} else if (!list_empty(&c->very_dirty_list) || !list_empty(&c->dirty_list)) {
+		ret = jffs2_find_best_dirty(c, 0);
+		D1(printk(KERN_DEBUG "Picking block at 0x%08x to GC next (clean_list was empty)\n",
+			  ret->offset));
+		goto found;
 	} else if (!list_empty(&c->erasable_pending_wbuf_list)) {
 		/* There are blocks are wating for the wbuf sync */
 		D1(printk(KERN_DEBUG "Synching wbuf in order to reuse erasable_pending_wbuf_list blocks\n"));
@@ -94,8 +152,10 @@ again:
 	}
 
 	ret = list_entry(nextlist->next, struct jffs2_eraseblock, list);
+ found:
 	list_del(&ret->list);
 	c->gcblock = ret;
+	c->gc_stat_blocks++;
 	ret->gc_node = ret->first_node;
 	if (!ret->gc_node) {
 		printk(KERN_WARNING "Eep. ret->gc_node for block at 0x%08x is NULL\n", ret->offset);
@@ -118,12 +178,13 @@ again:
  * Make a single attempt to progress GC. Move one node, and possibly
  * start erasing one eraseblock.
  */
-int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
+static int __jffs2_garbage_collect_pass(struct jffs2_sb_info *c, int idle)
 {
 	struct jffs2_inode_info *f;
 	struct jffs2_inode_cache *ic;
 	struct jffs2_eraseblock *jeb;
 	struct jffs2_raw_node_ref *raw;
+	uint32_t moved = 0;
 	int ret = 0, inum, nlink;
 	int xattr = 0;
 
@@ -218,7 +279,14 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 	jeb = c->gcblock;
 
 	if (!jeb)
-		jeb = jffs2_find_gc_block(c);
+		jeb = jffs2_find_gc_block(c, idle);
+
+	if (!jeb && idle) {
+		/* Nothing worth moving while nobody is writing */
+		spin_unlock(&c->erase_completion_lock);
+		up(&c->alloc_sem);
+		return -EAGAIN;
+	}
 
 	if (!jeb) {
 		D1 (printk(KERN_NOTICE "jffs2: Couldn't find erase block to garbage collect!\n"));
@@ -252,6 +320,7 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 		}
 	}
 	jeb->gc_node = raw;
+	moved = ref_totlen(c, jeb, raw);
 
 	D1(printk(KERN_DEBUG "Going to garbage collect node at 0x%08x\n", ref_offset(raw)));
 
@@ -264,6 +333,7 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 		} else {
 			/* Just mark it obsolete */
 			jffs2_mark_node_obsolete(c, raw);
+			moved = 0;
 		}
 		up(&c->alloc_sem);
 		goto eraseit_lock;
@@ -410,10 +480,13 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 
  release_sem:
 	up(&c->alloc_sem);
+	if (ret)
+		moved = 0;
 
  eraseit_lock:
 	/* If we've finished this block, start it erasing */
 	spin_lock(&c->erase_completion_lock);
+	c->gc_stat_moved += moved;
 
  eraseit:
 	if (c->gcblock && !c->gcblock->used_size) {
@@ -429,6 +502,18 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 	return ret;
 }
 
+int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
+{
+	return __jffs2_garbage_collect_pass(c, 0);
+}
+
+/* A pass made by the GC thread while there is no space pressure.
+   Returns -EAGAIN if there is no block it is allowed to collect. */
+int jffs2_garbage_collect_idle_pass(struct jffs2_sb_info *c)
+{
+	return __jffs2_garbage_collect_pass(c, 1);
+}
+
 static int jffs2_garbage_collect_live(struct jffs2_sb_info *c,  struct jffs2_eraseblock *jeb,
 				      struct jffs2_raw_node_ref *raw, struct jffs2_inode_info *f)
 {
@@ -1290,3 +1375,90 @@ static int jffs2_garbage_collect_dnode(struct jffs2_sb_info *c, struct jffs2_era
 	jffs2_gc_release_page(c, pg_ptr, &pg);
 	return ret;
 }
+
+#ifdef CONFIG_JFFS2_PROC
+
+/*
+ * The proc entry only holds the MTD number: remove_proc_entry() does not
+ * wait for a reader which already has the file open, so the reader looks
+ * the filesystem up here instead, and finds nothing once it is unmounted.
+ */
+static LIST_HEAD(jffs2_gc_proc_sbs);
+static DEFINE_MUTEX(jffs2_gc_proc_mutex);
+
+static int jffs2_gc_stats_show(struct seq_file *m, void *v)
+{
+	int mtdnr = (long)m->private;
+	struct jffs2_sb_info *c;
+
+	mutex_lock(&jffs2_gc_proc_mutex);
+	list_for_each_entry(c, &jffs2_gc_proc_sbs, gc_proc_list)
+		if (c->mtd->index == mtdnr)
+			goto found;
+	mutex_unlock(&jffs2_gc_proc_mutex);
+	return -ENODEV;
+
+ found:
+	spin_lock(&c->erase_completion_lock);
+	seq_printf(m, "passes:        %u thread, %u writers out of space, %u throttled\n",
+		   c->gc_stat_passes, c->gc_stat_fg_passes, c->gc_stat_throttled);
+	seq_printf(m, "blocks picked: %u\n", c->gc_stat_blocks);
+	seq_printf(m, "bytes moved:   %llu\n", (unsigned long long)c->gc_stat_moved);
+	seq_printf(m, "erase stalls:  %u\n", c->gc_stat_erase_stalls);
+	seq_printf(m, "erase ahead:   %u\n", c->gc_stat_erase_ahead);
+	seq_printf(m, "free blocks:   %u (+%u erasing), write %u, throttle %u, idle pool %u\n",
+		   c->nr_free_blocks, c->nr_erasing_blocks, c->resv_blocks_write,
+		   c->resv_blocks_throttle, c->resv_blocks_gcpool);
+	spin_unlock(&c->erase_completion_lock);
+	mutex_unlock(&jffs2_gc_proc_mutex);
+	return 0;
+}
+
+static int jffs2_gc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, jffs2_gc_stats_show, PDE(inode)->data);
+}
+
+static const struct file_operations jffs2_gc_stats_fops = {
+	.open		= jffs2_gc_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* /proc/fs/jffs2/gc_mtd<N> */
+void jffs2_gc_proc_add(struct jffs2_sb_info *c)
+{
+	struct proc_dir_entry *ent;
+	char name[16];
+
+	mutex_lock(&jffs2_gc_proc_mutex);
+	list_add(&c->gc_proc_list, &jffs2_gc_proc_sbs);
+	mutex_unlock(&jffs2_gc_proc_mutex);
+
+	if (!jffs2_proc_root)
+		return;
+	sprintf(name, "gc_mtd%d", c->mtd->index);
+	ent = create_proc_entry(name, S_IRUGO, jffs2_proc_root);
+	if (ent) {
+		ent->data = (void *)(long)c->mtd->index;
+		ent->proc_fops = &jffs2_gc_stats_fops;
+	}
+}
+
+/* Must be called before c is freed */
+void jffs2_gc_proc_del(struct jffs2_sb_info *c)
+{
+	char name[16];
+
+	if (jffs2_proc_root) {
+		sprintf(name, "gc_mtd%d", c->mtd->index);
+		remove_proc_entry(name, jffs2_proc_root);
+	}
+
+	mutex_lock(&jffs2_gc_proc_mutex);
+	list_del(&c->gc_proc_list);
+	mutex_unlock(&jffs2_gc_proc_mutex);
+}
+
+#endif /* CONFIG_JFFS2_PROC */
@@ -41,6 +41,11 @@ struct jffs2_inode_info {
 
 	uint16_t flags;
 	uint8_t usercompr;
+
+	/* Adaptive compression mode state, see compr.c */
+	uint8_t compr_hint;
+	uint8_t compr_samples;
+	uint8_t compr_misses;
 	struct inode vfs_inode;
 #ifdef CONFIG_JFFS2_FS_POSIX_ACL
 	struct posix_acl *i_acl_access;
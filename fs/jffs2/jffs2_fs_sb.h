@@ -60,6 +60,8 @@ struct jffs2_sb_info {
 	uint8_t resv_blocks_gctrigger;	/* ... wake up the GC thread */
 	uint8_t resv_blocks_gcbad;	/* ... pick a block from the bad_list to GC */
 	uint8_t resv_blocks_gcmerge;	/* ... merge pages when garbage collecting */
+	uint8_t resv_blocks_throttle;	/* ... let writers in without helping GC */
+	uint8_t resv_blocks_gcpool;	/* ... stop erasing ahead when idle */
 
 	uint32_t nospc_dirty_size;
 
@@ -110,6 +112,20 @@ struct jffs2_sb_info {
 
 	struct jffs2_summary *summary;		/* Summary information */
 
+	unsigned long gc_last_write;	/* jiffies of the last space reservation */
+
+	/* GC statistics, protected by erase_completion_lock */
+	uint32_t gc_stat_passes;	/* GC passes by the GC thread */
+	uint32_t gc_stat_fg_passes;	/* ... by writers out of free blocks */
+	uint32_t gc_stat_throttled;	/* ... by writers in the throttle zone */
+	uint32_t gc_stat_blocks;	/* Blocks picked for GC */
+	uint64_t gc_stat_moved;		/* Bytes of valid nodes copied */
+	uint32_t gc_stat_erase_stalls;	/* Writers waiting for an erase */
+	uint32_t gc_stat_erase_ahead;	/* Blocks erased by the GC thread */
+#ifdef CONFIG_JFFS2_PROC
+	struct list_head gc_proc_list;	/* On the list the gc_mtd<N> readers search */
+#endif
+
 #ifdef CONFIG_JFFS2_FS_XATTR
 #define XATTRINDEX_HASHSIZE	(57)
 	uint32_t highest_xid;
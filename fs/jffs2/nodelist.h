@@ -259,8 +259,13 @@ struct jffs2_eraseblock
 	struct jffs2_raw_node_ref *last_node;
 
 	struct jffs2_raw_node_ref *gc_node;	/* Next node to be garbage collected */
+
+	uint32_t gc_stamp;	/* jffs2_gc_now() when we started filling it */
 };
 
+/* Coarse clock for the age of eraseblocks; seconds, wraps harmlessly */
+#define jffs2_gc_now() ((uint32_t)(jiffies / HZ))
+
 static inline int jffs2_blocks_use_vmalloc(struct jffs2_sb_info *c)
 {
 	return ((c->flash_size / c->sector_size) * sizeof (struct jffs2_eraseblock)) > (128 * 1024);
@@ -273,6 +278,9 @@ static inline int jffs2_blocks_use_vmalloc(struct jffs2_sb_info *c)
 #define ALLOC_GC	2	/* Space requested for GC. Give it or die */
 #define ALLOC_NORETRY	3	/* For jffs2_write_dnode: On failure, return -EAGAIN instead of retrying */
 
+/* How long writes must have stopped before the GC thread works ahead */
+#define JFFS2_GC_IDLE_DELAY	HZ
+
 /* How much dirty space before it goes on the very_dirty_list */
 #define VERYDIRTY(c, size) ((size) >= ((c)->sector_size / 2))
 
@@ -345,6 +353,9 @@ extern uint32_t __jffs2_ref_totlen(struct jffs2_sb_info *c,
 
 /* nodemgmt.c */
 int jffs2_thread_should_wake(struct jffs2_sb_info *c);
+int jffs2_gc_pressure(struct jffs2_sb_info *c);
+int jffs2_gc_idle_work(struct jffs2_sb_info *c);
+long jffs2_gc_idle_timeout(struct jffs2_sb_info *c);
 int jffs2_reserve_space(struct jffs2_sb_info *c, uint32_t minsize,
 			uint32_t *len, int prio, uint32_t sumsize);
 int jffs2_reserve_space_gc(struct jffs2_sb_info *c, uint32_t minsize,
@@ -411,6 +422,16 @@ void jffs2_free_xattr_ref(struct jffs2_xattr_ref *);
 
 /* gc.c */
 int jffs2_garbage_collect_pass(struct jffs2_sb_info *c);
+int jffs2_garbage_collect_idle_pass(struct jffs2_sb_info *c);
+#ifdef CONFIG_JFFS2_PROC
+struct proc_dir_entry;
+extern struct proc_dir_entry *jffs2_proc_root;
+void jffs2_gc_proc_add(struct jffs2_sb_info *c);
+void jffs2_gc_proc_del(struct jffs2_sb_info *c);
+#else
+static inline void jffs2_gc_proc_add(struct jffs2_sb_info *c) { }
+static inline void jffs2_gc_proc_del(struct jffs2_sb_info *c) { }
+#endif
 
 /* read.c */
 int jffs2_read_dnode(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
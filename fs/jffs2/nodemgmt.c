@@ -41,6 +41,35 @@
 static int jffs2_do_reserve_space(struct jffs2_sb_info *c,  uint32_t minsize,
 				  uint32_t *len, uint32_t sumsize);
 
+/*
+ * Below resv_blocks_throttle free blocks, make each normal write do one
+ * GC pass for every block it is short, so writers slow down gradually
+ * rather than stall on a whole eraseblock worth of GC once they hit
+ * resv_blocks_write.
+ */
+static void jffs2_gc_throttle(struct jffs2_sb_info *c)
+{
+	uint32_t avail, dirty;
+	int passes = 0;
+
+	spin_lock(&c->erase_completion_lock);
+	c->gc_last_write = jiffies;
+	avail = c->nr_free_blocks + c->nr_erasing_blocks;
+	dirty = c->dirty_size + c->erasing_size - c->nr_erasing_blocks * c->sector_size;
+	if (avail >= c->resv_blocks_write && avail < c->resv_blocks_throttle &&
+	    dirty > c->nospc_dirty_size)
+		passes = c->resv_blocks_throttle - avail;
+	spin_unlock(&c->erase_completion_lock);
+
+	while (passes--) {
+		if (jffs2_garbage_collect_pass(c))
+			break;
+		spin_lock(&c->erase_completion_lock);
+		c->gc_stat_throttled++;
+		spin_unlock(&c->erase_completion_lock);
+	}
+}
+
 int jffs2_reserve_space(struct jffs2_sb_info *c, uint32_t minsize,
 			uint32_t *len, int prio, uint32_t sumsize)
 {
@@ -50,6 +79,10 @@ int jffs2_reserve_space(struct jffs2_sb_info *c, uint32_t minsize,
 	minsize = PAD(minsize);
 
 	D1(printk(KERN_DEBUG "jffs2_reserve_space(): Requested 0x%x bytes\n", minsize));
+	if (prio == ALLOC_NORMAL)
+		jffs2_gc_throttle(c);
+	else
+		c->gc_last_write = jiffies;
 	down(&c->alloc_sem);
 
 	D1(printk(KERN_DEBUG "jffs2_reserve_space(): alloc sem got\n"));
@@ -111,6 +144,8 @@ int jffs2_reserve_space(struct jffs2_sb_info *c, uint32_t minsize,
 				return -ENOSPC;
 			}
 
+			c->gc_stat_fg_passes++;
+
 			up(&c->alloc_sem);
 
 			D1(printk(KERN_DEBUG "Triggering GC pass. nr_free_blocks %d, nr_erasing_blocks %d, free_size 0x%08x, dirty_size 0x%08x, wasted_size 0x%08x, used_size 0x%08x, erasing_size 0x%08x, bad_size 0x%08x (total 0x%08x of 0x%08x)\n",
@@ -238,6 +273,7 @@ static int jffs2_find_nextblock(struct jffs2_sb_info *c)
 			return -ENOSPC;
 		}
 
+		c->gc_stat_erase_stalls++;
 		spin_unlock(&c->erase_completion_lock);
 		/* Don't wait for it; just erase one right now */
 		jffs2_erase_pending_blocks(c, 1);
@@ -252,6 +288,7 @@ static int jffs2_find_nextblock(struct jffs2_sb_info *c)
 	next = c->free_list.next;
 	list_del(next);
 	c->nextblock = list_entry(next, struct jffs2_eraseblock, list);
+	c->nextblock->gc_stamp = jffs2_gc_now();
 	c->nr_free_blocks--;
 
 	jffs2_sum_reset_collected(c->summary); /* reset collected summary */
@@ -710,17 +747,11 @@ void jffs2_mark_node_obsolete(struct jffs2_sb_info *c, struct jffs2_raw_node_ref
 	up(&c->erase_free_sem);
 }
 
-int jffs2_thread_should_wake(struct jffs2_sb_info *c)
+/* Short of free blocks, with enough dirty space for GC to get some back */
+int jffs2_gc_pressure(struct jffs2_sb_info *c)
 {
-	int ret = 0;
 	uint32_t dirty;
 
-	if (c->unchecked_size) {
-		D1(printk(KERN_DEBUG "jffs2_thread_should_wake(): unchecked_size %d, checked_ino #%d\n",
-			  c->unchecked_size, c->checked_ino));
-		return 1;
-	}
-
 	/* dirty_size contains blocks on erase_pending_list
 	 * those blocks are counted in c->nr_erasing_blocks.
 	 * If one block is actually erased, it is not longer counted as dirty_space
@@ -731,8 +762,24 @@ int jffs2_thread_should_wake(struct jffs2_sb_info *c)
 	 */
 	dirty = c->dirty_size + c->erasing_size - c->nr_erasing_blocks * c->sector_size;
 
-	if (c->nr_free_blocks + c->nr_erasing_blocks < c->resv_blocks_gctrigger &&
-			(dirty > c->nospc_dirty_size))
+	return c->nr_free_blocks + c->nr_erasing_blocks < c->resv_blocks_gctrigger &&
+		dirty > c->nospc_dirty_size;
+}
+
+int jffs2_thread_should_wake(struct jffs2_sb_info *c)
+{
+	int ret = 0;
+
+	if (c->unchecked_size) {
+		D1(printk(KERN_DEBUG "jffs2_thread_should_wake(): unchecked_size %d, checked_ino #%d\n",
+			  c->unchecked_size, c->checked_ino));
+		return 1;
+	}
+
+	if (jffs2_gc_pressure(c))
+		ret = 1;
+	else if (jffs2_gc_idle_work(c) &&
+		 time_after_eq(jiffies, c->gc_last_write + JFFS2_GC_IDLE_DELAY))
 		ret = 1;
 
 	D1(printk(KERN_DEBUG "jffs2_thread_should_wake(): nr_free_blocks %d, nr_erasing_blocks %d, dirty_size 0x%x: %s\n",
@@ -740,3 +787,40 @@ int jffs2_thread_should_wake(struct jffs2_sb_info *c)
 
 	return ret;
 }
+
+/*
+ * Work the GC thread may do while nobody is writing: erasing blocks
+ * which are waiting for it, and collecting blocks which are mostly
+ * dirty until resv_blocks_gcpool blocks are free.  Such passes go
+ * through jffs2_garbage_collect_idle_pass(), which only picks from
+ * very_dirty_list and erasable_list: clean and lightly dirty blocks
+ * are left alone, moving their data would cost more flash wear than
+ * the space it gives back is worth.
+ */
+int jffs2_gc_idle_work(struct jffs2_sb_info *c)
+{
+	if (!list_empty(&c->erase_pending_list) ||
+	    !list_empty(&c->erase_complete_list))
+		return 1;
+
+	if (c->nr_free_blocks + c->nr_erasing_blocks >= c->resv_blocks_gcpool)
+		return 0;
+
+	return !list_empty(&c->very_dirty_list) || !list_empty(&c->erasable_list);
+}
+
+/* How long the GC thread may sleep before it should look at idle work */
+long jffs2_gc_idle_timeout(struct jffs2_sb_info *c)
+{
+	long timeout;
+
+	spin_lock(&c->erase_completion_lock);
+	if (!jffs2_gc_idle_work(c)) {
+		spin_unlock(&c->erase_completion_lock);
+		return MAX_SCHEDULE_TIMEOUT;
+	}
+	timeout = (long)(c->gc_last_write + JFFS2_GC_IDLE_DELAY - jiffies);
+	spin_unlock(&c->erase_completion_lock);
+
+	return timeout > 0 ? timeout : 1;
+}
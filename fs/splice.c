@@ -41,6 +41,7 @@ struct splice_pipe_desc {
 	struct page **pages;		/* page map */
 	struct partial_page *partial;	/* pages[] may not be contig */
 	int nr_pages;			/* number of pages in map */
+	unsigned int nr_pages_max;	/* size of pages[] and partial[] */
 	unsigned int flags;		/* splice flags */
 	const struct pipe_buf_operations *ops;/* ops associated with output pipe */
 };
@@ -193,8 +194,8 @@ static ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 			break;
 		}
 
-		if (pipe->nrbufs < PIPE_BUFFERS) {
-			int newbuf = (pipe->curbuf + pipe->nrbufs) & (PIPE_BUFFERS - 1);
+		if (pipe->nrbufs < pipe->buffers) {
+			int newbuf = (pipe->curbuf + pipe->nrbufs) & (pipe->buffers - 1);
 			struct pipe_buffer *buf = pipe->bufs + newbuf;
 
 			buf->page = spd->pages[page_nr];
@@ -213,7 +214,7 @@ static ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 
 			if (!--spd->nr_pages)
 				break;
-			if (pipe->nrbufs < PIPE_BUFFERS)
+			if (pipe->nrbufs < pipe->buffers)
 				continue;
 
 			break;
@@ -260,6 +261,42 @@ static ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+/*
+ * The pages[] and partial[] maps handed to splice_to_pipe() live on the
+ * caller's stack for a default sized pipe, and are allocated to match a
+ * pipe grown with F_SETPIPE_SZ.
+ */
+static int splice_grow_spd(struct pipe_inode_info *pipe,
+			   struct splice_pipe_desc *spd)
+{
+	unsigned int buffers = pipe->buffers;
+
+	spd->nr_pages_max = PIPE_DEF_BUFFERS;
+	if (buffers <= PIPE_DEF_BUFFERS)
+		return 0;
+
+	spd->pages = kmalloc(buffers * sizeof(struct page *), GFP_KERNEL);
+	spd->partial = kmalloc(buffers * sizeof(struct partial_page),
+			       GFP_KERNEL);
+	if (spd->pages && spd->partial) {
+		spd->nr_pages_max = buffers;
+		return 0;
+	}
+
+	kfree(spd->pages);
+	kfree(spd->partial);
+	return -ENOMEM;
+}
+
+static void splice_shrink_spd(struct splice_pipe_desc *spd)
+{
+	if (spd->nr_pages_max <= PIPE_DEF_BUFFERS)
+		return;
+
+	kfree(spd->pages);
+	kfree(spd->partial);
+}
+
 static int
 __generic_file_splice_read(struct file *in, loff_t *ppos,
 			   struct pipe_inode_info *pipe, size_t len,
@@ -267,51 +304,48 @@ __generic_file_splice_read(struct file *in, loff_t *ppos,
 {
 	struct address_space *mapping = in->f_mapping;
 	unsigned int loff, nr_pages;
-	struct page *pages[PIPE_BUFFERS];
-	struct partial_page partial[PIPE_BUFFERS];
+	struct page *pages_def[PIPE_DEF_BUFFERS], **pages;
+	struct partial_page partial_def[PIPE_DEF_BUFFERS], *partial;
 	struct page *page;
 	pgoff_t index, end_index;
 	loff_t isize;
 	size_t total_len;
 	int error, page_nr;
 	struct splice_pipe_desc spd = {
-		.pages = pages,
-		.partial = partial,
+		.pages = pages_def,
+		.partial = partial_def,
 		.flags = flags,
 		.ops = &page_cache_pipe_buf_ops,
 	};
 
+	if (splice_grow_spd(pipe, &spd))
+		return -ENOMEM;
+	pages = spd.pages;
+	partial = spd.partial;
+
 	index = *ppos >> PAGE_CACHE_SHIFT;
 	loff = *ppos & ~PAGE_CACHE_MASK;
 	nr_pages = (len + loff + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 
-	if (nr_pages > PIPE_BUFFERS)
-		nr_pages = PIPE_BUFFERS;
-
-	/*
-	 * Initiate read-ahead on this page range. however, don't call into
-	 * read-ahead if this is a non-zero offset (we are likely doing small
-	 * chunk splice and the page is already there) for a single page.
-	 */
-	if (!loff || nr_pages > 1)
-		page_cache_readahead(mapping, &in->f_ra, in, index, nr_pages);
-
-	/*
-	 * Now fill in the holes:
-	 */
-	error = 0;
-	total_len = 0;
+	if (nr_pages > spd.nr_pages_max)
+		nr_pages = spd.nr_pages_max;
 
 	/*
 	 * Lookup the (hopefully) full range of pages we need.
 	 */
 	spd.nr_pages = find_get_pages_contig(mapping, index, nr_pages, pages);
+	index += spd.nr_pages;
 
 	/*
 	 * If find_get_pages_contig() returned fewer pages than we needed,
-	 * allocate the rest.
+	 * readahead/allocate the rest and fill in the holes.
 	 */
-	index += spd.nr_pages;
+	if (spd.nr_pages < nr_pages)
+		page_cache_sync_readahead(mapping, &in->f_ra, in,
+				index, nr_pages - spd.nr_pages);
+
+	error = 0;
+	total_len = 0;
 	while (spd.nr_pages < nr_pages) {
 		/*
 		 * Page could be there, find_get_pages_contig() breaks on
@@ -319,12 +353,6 @@ __generic_file_splice_read(struct file *in, loff_t *ppos,
 		 */
 		page = find_get_page(mapping, index);
 		if (!page) {
-			/*
-			 * Make sure the read-ahead engine is notified
-			 * about this failure.
-			 */
-			handle_ra_miss(mapping, &in->f_ra, index);
-
 			/*
 			 * page didn't exist, allocate one.
 			 */
@@ -370,6 +398,10 @@ __generic_file_splice_read(struct file *in, loff_t *ppos,
 		this_len = min_t(unsigned long, len, PAGE_CACHE_SIZE - loff);
 		page = pages[page_nr];
 
+		if (PageReadahead(page))
+			page_cache_async_readahead(mapping, &in->f_ra, in,
+					page, index, nr_pages - page_nr);
+
 		/*
 		 * If the page isn't uptodate, we may need to start io on it
 		 */
@@ -457,10 +489,12 @@ fill_it:
 	 */
 	while (page_nr < nr_pages)
 		page_cache_release(pages[page_nr++]);
+	in->f_ra.prev_index = index;
 
 	if (spd.nr_pages)
-		return splice_to_pipe(pipe, &spd);
+		error = splice_to_pipe(pipe, &spd);
 
+	splice_shrink_spd(&spd);
 	return error;
 }
 
@@ -532,6 +566,46 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+/*
+ * Try to move a gifted user page into mapping at index.  This is only
+ * safe once the page is an anonymous page that nobody maps any more,
+ * i.e. the pipe holds the last reference: the user gave it up with
+ * SPLICE_F_GIFT and then unmapped or remapped the range.  The page
+ * stays on the LRU it is already on.  Returns the page locked and with
+ * an extra reference for the caller, or NULL if the data has to be
+ * copied.
+ */
+static struct page *pipe_steal_gift(struct pipe_inode_info *pipe,
+				    struct pipe_buffer *buf,
+				    struct address_space *mapping,
+				    pgoff_t index)
+{
+	struct page *page = buf->page;
+
+	if (buf->ops->steal(pipe, buf))
+		return NULL;
+
+	/* steal() locked the page and saw page_count() == 1 */
+	if (!PageAnon(page) || !PageLRU(page) || !PageUptodate(page))
+		goto fail;
+
+	/*
+	 * The dirty bit is left over from the anonymous mapping; clear
+	 * it so commit_write() tags the page dirty in its new mapping.
+	 */
+	ClearPageDirty(page);
+	page->mapping = NULL;
+	if (add_to_page_cache(page, mapping, index, GFP_KERNEL))
+		goto fail;
+
+	page_cache_get(page);
+	return page;
+
+fail:
+	unlock_page(page);
+	return NULL;
+}
+
 /*
  * This is a little more tricky than the file -> pipe splicing. There are
  * basically three cases:
@@ -576,6 +650,17 @@ static int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	if (this_len + offset > PAGE_CACHE_SIZE)
 		this_len = PAGE_CACHE_SIZE - offset;
 
+	/*
+	 * A whole, aligned page gifted through vmsplice() can go straight
+	 * into the page cache if the only reference left to it is ours.
+	 */
+	if ((sd->flags & SPLICE_F_MOVE) && (buf->flags & PIPE_BUF_FLAG_GIFT) &&
+	    !offset && !buf->offset && this_len == PAGE_CACHE_SIZE) {
+		page = pipe_steal_gift(pipe, buf, mapping, index);
+		if (page)
+			goto prepare;
+	}
+
 find_page:
 	page = find_lock_page(mapping, index);
 	if (!page) {
@@ -593,6 +678,7 @@ find_page:
 			goto out;
 	}
 
+prepare:
 	ret = mapping->a_ops->prepare_write(file, page, offset, offset+this_len);
 	if (unlikely(ret)) {
 		loff_t isize = i_size_read(mapping->host);
@@ -703,7 +789,7 @@ ssize_t __splice_from_pipe(struct pipe_inode_info *pipe,
 			if (!buf->len) {
 				buf->ops = NULL;
 				ops->release(pipe, buf);
-				pipe->curbuf = (pipe->curbuf + 1) & (PIPE_BUFFERS - 1);
+				pipe->curbuf = (pipe->curbuf + 1) & (pipe->buffers - 1);
 				pipe->nrbufs--;
 				if (pipe->inode)
 					do_wakeup = 1;
@@ -996,9 +1082,9 @@ long do_splice_direct(struct file *in, loff_t *ppos, struct file *out,
 		size_t read_len, max_read_len;
 
 		/*
-		 * Do at most PIPE_BUFFERS pages worth of transfer:
+		 * Do at most one pipe worth of transfer:
 		 */
-		max_read_len = min(len, (size_t)(PIPE_BUFFERS*PAGE_SIZE));
+		max_read_len = min(len, (size_t)(pipe->buffers * PAGE_SIZE));
 
 		ret = do_splice_to(in, ppos, pipe, max_read_len, flags);
 		if (unlikely(ret < 0))
@@ -1040,7 +1126,7 @@ out_release:
 	 * If we did an incomplete transfer we must release
 	 * the pipe buffers in question:
 	 */
-	for (i = 0; i < PIPE_BUFFERS; i++) {
+	for (i = 0; i < pipe->buffers; i++) {
 		struct pipe_buffer *buf = pipe->bufs + i;
 
 		if (buf->ops) {
@@ -1134,12 +1220,12 @@ static long do_splice(struct file *in, loff_t __user *off_in,
  * Map an iov into an array of pages and offset/length tupples. With the
  * partial_page structure, we can map several non-contiguous ranges into
  * our ones pages[] map instead of splitting that operation into pieces.
- * Could easily be exported as a generic helper for other users, in which
- * case one would probably want to add a 'max_nr_pages' parameter as well.
+ * At most max_pages pages are mapped.
  */
 static int get_iovec_page_array(const struct iovec __user *iov,
 				unsigned int nr_vecs, struct page **pages,
-				struct partial_page *partial, int aligned)
+				struct partial_page *partial, int aligned,
+				unsigned int max_pages)
 {
 	int buffers = 0, error = 0;
 
@@ -1189,8 +1275,8 @@ static int get_iovec_page_array(const struct iovec __user *iov,
 			break;
 
 		npages = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
-		if (npages > PIPE_BUFFERS - buffers)
-			npages = PIPE_BUFFERS - buffers;
+		if (npages > max_pages - buffers)
+			npages = max_pages - buffers;
 
 		error = get_user_pages(current, current->mm,
 				       (unsigned long) base, npages, 0, 0,
@@ -1226,7 +1312,7 @@ static int get_iovec_page_array(const struct iovec __user *iov,
 		 * or if we mapped the max number of pages that we have
 		 * room for.
 		 */
-		if (error < npages || buffers == PIPE_BUFFERS)
+		if (error < npages || buffers == max_pages)
 			break;
 
 		nr_vecs--;
@@ -1265,14 +1351,15 @@ static long do_vmsplice(struct file *file, const struct iovec __user *iov,
 			unsigned long nr_segs, unsigned int flags)
 {
 	struct pipe_inode_info *pipe;
-	struct page *pages[PIPE_BUFFERS];
-	struct partial_page partial[PIPE_BUFFERS];
+	struct page *pages[PIPE_DEF_BUFFERS];
+	struct partial_page partial[PIPE_DEF_BUFFERS];
 	struct splice_pipe_desc spd = {
 		.pages = pages,
 		.partial = partial,
 		.flags = flags,
 		.ops = &user_page_pipe_buf_ops,
 	};
+	long ret;
 
 	pipe = pipe_info(file->f_path.dentry->d_inode);
 	if (!pipe)
@@ -1282,12 +1369,19 @@ static long do_vmsplice(struct file *file, const struct iovec __user *iov,
 	else if (unlikely(!nr_segs))
 		return 0;
 
-	spd.nr_pages = get_iovec_page_array(iov, nr_segs, pages, partial,
-					    flags & SPLICE_F_GIFT);
+	if (splice_grow_spd(pipe, &spd))
+		return -ENOMEM;
+
+	spd.nr_pages = get_iovec_page_array(iov, nr_segs, spd.pages,
+					    spd.partial, flags & SPLICE_F_GIFT,
+					    spd.nr_pages_max);
 	if (spd.nr_pages <= 0)
-		return spd.nr_pages;
+		ret = spd.nr_pages;
+	else
+		ret = splice_to_pipe(pipe, &spd);
 
-	return splice_to_pipe(pipe, &spd);
+	splice_shrink_spd(&spd);
+	return ret;
 }
 
 asmlinkage long sys_vmsplice(int fd, const struct iovec __user *iov,
@@ -1390,13 +1484,13 @@ static int link_opipe_prep(struct pipe_inode_info *pipe, unsigned int flags)
 	 * Check ->nrbufs without the inode lock first. This function
 	 * is speculative anyways, so missing one is ok.
 	 */
-	if (pipe->nrbufs < PIPE_BUFFERS)
+	if (pipe->nrbufs < pipe->buffers)
 		return 0;
 
 	ret = 0;
 	mutex_lock(&pipe->inode->i_mutex);
 
-	while (pipe->nrbufs >= PIPE_BUFFERS) {
+	while (pipe->nrbufs >= pipe->buffers) {
 		if (!pipe->readers) {
 			send_sig(SIGPIPE, current, 0);
 			ret = -EPIPE;
@@ -1448,11 +1542,11 @@ static int link_pipe(struct pipe_inode_info *ipipe,
 		 * If we have iterated all input buffers or ran out of
 		 * output room, break.
 		 */
-		if (i >= ipipe->nrbufs || opipe->nrbufs >= PIPE_BUFFERS)
+		if (i >= ipipe->nrbufs || opipe->nrbufs >= opipe->buffers)
 			break;
 
-		ibuf = ipipe->bufs + ((ipipe->curbuf + i) & (PIPE_BUFFERS - 1));
-		nbuf = (opipe->curbuf + opipe->nrbufs) & (PIPE_BUFFERS - 1);
+		ibuf = ipipe->bufs + ((ipipe->curbuf + i) & (ipipe->buffers - 1));
+		nbuf = (opipe->curbuf + opipe->nrbufs) & (opipe->buffers - 1);
 
 		/*
 		 * Get a reference to this pipe buffer,
@@ -617,7 +617,7 @@ static struct dentry *create_parents_named(struct inode *dir,
 	verify_locked(dentry);
 
 	/* There is no sense allocating any less than the minimum. */
-	kmalloc_size = malloc_sizes[0].cs_size;
+	kmalloc_size = UNIONFS_MIN_KMALLOC;
 	num_dentry = kmalloc_size / sizeof(struct dentry *);
 
 	if ((err = is_robranch_super(dir->i_sb, bindex))) {
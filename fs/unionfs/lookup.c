@@ -461,7 +461,7 @@ int new_dentry_private_data(struct dentry *dentry)
 	 * determine what our object sizes is, but those are not exported.
 	 */
 	if (oldsize) {
-		int minsize = malloc_sizes[0].cs_size;
+		int minsize = UNIONFS_MIN_KMALLOC;
 
 		if (!newsize || ((oldsize < newsize) && (newsize > minsize))) {
 			kfree(info->lower_paths);
@@ -63,6 +63,13 @@
 /* number of times we try to get a unique temporary file name */
 #define GET_TMPNAM_MAX_RETRY	5
 
+/* size of the smallest kmalloc object, nothing smaller is worth asking for */
+#ifdef CONFIG_SLUB
+#define UNIONFS_MIN_KMALLOC	KMALLOC_MIN_SIZE
+#else
+#define UNIONFS_MIN_KMALLOC	(malloc_sizes[0].cs_size)
+#endif
+
 /* Operations vectors defined in specific files. */
 extern struct file_operations unionfs_main_fops;
 extern struct file_operations unionfs_dir_fops;
@@ -28,8 +28,11 @@ struct exec
 #define M_ARM 103
 
 #ifdef __KERNEL__
+#include <asm/fcse.h>
+
+/* a process with an FCSE PID has to live in its 32MB slot */
 #define STACK_TOP	((current->personality == PER_LINUX_32BIT) ? \
-			 TASK_SIZE : TASK_SIZE_26)
+			 fcse_task_size(current->mm) : TASK_SIZE_26)
 #endif
 
 #ifndef LIBRARY_START_TEXT
@@ -7,4 +7,10 @@
 #define L1_CACHE_SHIFT		5
 #define L1_CACHE_BYTES		(1 << L1_CACHE_SHIFT)
 
+/*
+ * DMA is not cache coherent, so kmalloc buffers handed to drivers must
+ * not share a cache line with anything else.
+ */
+#define ARCH_KMALLOC_MINALIGN	L1_CACHE_BYTES
+
 #endif
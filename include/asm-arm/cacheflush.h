@@ -15,6 +15,7 @@
 
 #include <asm/glue.h>
 #include <asm/shmparam.h>
+#include <asm/fcse.h>
 
 #define CACHE_COLOUR(vaddr)	((vaddr & (SHMLBA - 1)) >> PAGE_SHIFT)
 
@@ -323,16 +324,19 @@ static inline void flush_cache_mm(struct mm_struct *mm)
 static inline void
 flush_cache_range(struct vm_area_struct *vma, unsigned long start, unsigned long end)
 {
-	if (cpu_isset(smp_processor_id(), vma->vm_mm->cpu_vm_mask))
-		__cpuc_flush_user_range(start & PAGE_MASK, PAGE_ALIGN(end),
-					vma->vm_flags);
+	if (cpu_isset(smp_processor_id(), vma->vm_mm->cpu_vm_mask)) {
+		unsigned long off = fcse_mva_offset(vma->vm_mm, start);
+		__cpuc_flush_user_range((start & PAGE_MASK) + off,
+					PAGE_ALIGN(end) + off, vma->vm_flags);
+	}
 }
 
 static inline void
 flush_cache_page(struct vm_area_struct *vma, unsigned long user_addr, unsigned long pfn)
 {
 	if (cpu_isset(smp_processor_id(), vma->vm_mm->cpu_vm_mask)) {
-		unsigned long addr = user_addr & PAGE_MASK;
+		unsigned long addr = fcse_va_to_mva(vma->vm_mm,
+						    user_addr & PAGE_MASK);
 		__cpuc_flush_user_range(addr, addr + PAGE_SIZE, vma->vm_flags);
 	}
 }
@@ -364,7 +368,9 @@ extern void flush_ptrace_access(struct vm_area_struct *vma, struct page *page,
  * This is used for the ARM private sys_cacheflush system call.
  */
 #define flush_cache_user_range(vma,start,end) \
-	__cpuc_coherent_user_range((start) & PAGE_MASK, PAGE_ALIGN(end))
+	__cpuc_coherent_user_range(					\
+		((start) & PAGE_MASK) + fcse_mva_offset((vma)->vm_mm, start), \
+		PAGE_ALIGN(end) + fcse_mva_offset((vma)->vm_mm, start))
 
 /*
  * Perform necessary cache operations to ensure that data previously
@@ -0,0 +1,67 @@
+/*
+ *  linux/include/asm-arm/fcse.h
+ *
+ * Fast Context Switch Extension.  The core adds the PID register to
+ * every address below 32MB before it reaches the caches and the MMU,
+ * so MVA = VA + (PID << 25).  A process that fits in 32MB is given a
+ * PID of its own, its cache lines are then tagged apart from those of
+ * every other process and need not be flushed on a context switch.
+ * PID 0 is kept for the processes that do not fit.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_FCSE_H
+#define __ASM_ARM_FCSE_H
+
+#include <asm/memory.h>
+
+#define FCSE_PID_SHIFT		25
+#define FCSE_PID_TASK_SIZE	(UL(1) << FCSE_PID_SHIFT)
+#define FCSE_NR_PIDS		(TASK_SIZE >> FCSE_PID_SHIFT)
+
+#ifdef CONFIG_ARM_FCSE
+
+#ifndef __ASSEMBLY__
+
+struct mm_struct;
+
+/*
+ * mm->context.pid is kept shifted, i.e. as written to the register,
+ * and is 0 for a process running without a slot.
+ */
+#define fcse_mva_offset(mm, va)	\
+	((unsigned long)(va) < FCSE_PID_TASK_SIZE ? (mm)->context.pid : 0UL)
+
+#define fcse_va_to_mva(mm, va)	\
+	((unsigned long)(va) + fcse_mva_offset(mm, va))
+
+/* The FAR reports the modified address; undo the relocation. */
+#define fcse_mva_to_va(mm, mva)	\
+	((((mva) ^ (mm)->context.pid) < FCSE_PID_TASK_SIZE) ? \
+	 (mva) & (FCSE_PID_TASK_SIZE - 1) : (mva))
+
+#define fcse_task_size(mm)	\
+	((mm) && (mm)->context.pid ? FCSE_PID_TASK_SIZE : TASK_SIZE)
+
+static inline void fcse_pid_set(unsigned long pid)
+{
+	asm volatile("mcr	p15, 0, %0, c13, c0, 0	@ set FCSE PID"
+		     : : "r" (pid) : "memory");
+}
+
+extern void fcse_relocate_mm_to_null_pid(struct mm_struct *mm);
+
+#endif
+
+#else
+
+#define fcse_mva_offset(mm, va)	0UL
+#define fcse_va_to_mva(mm, va)	((unsigned long)(va))
+#define fcse_mva_to_va(mm, mva)	(mva)
+#define fcse_task_size(mm)	TASK_SIZE
+
+#endif
+
+#endif
@@ -14,4 +14,10 @@
 #define MCL_CURRENT	1		/* lock all current mappings */
 #define MCL_FUTURE	2		/* lock all future mappings */
 
+#if defined(__KERNEL__) && defined(CONFIG_ARM_FCSE)
+extern int fcse_mmap_check(unsigned long addr, unsigned long len,
+			   unsigned long flags);
+#define arch_mmap_check	fcse_mmap_check
+#endif
+
 #endif /* __ARM_MMAN_H__ */
@@ -8,6 +8,11 @@ typedef struct {
 	unsigned int id;
 #endif
 	unsigned int kvm_seq;
+#ifdef CONFIG_ARM_FCSE
+	unsigned long pid;		/* FCSE PID, shifted; 0 if none */
+	unsigned int fallback:1;	/* runs without a PID */
+	unsigned int shared:1;		/* has had a MAP_SHARED mapping */
+#endif
 } mm_context_t;
 
 #if __LINUX_ARM_ARCH__ >= 6
@@ -16,6 +16,7 @@
 #include <linux/compiler.h>
 #include <asm/cacheflush.h>
 #include <asm/proc-fns.h>
+#include <asm/fcse.h>
 
 void __check_kvm_seq(struct mm_struct *mm);
 
@@ -62,11 +63,39 @@ static inline void check_context(struct mm_struct *mm)
 		__check_kvm_seq(mm);
 }
 
+#ifdef CONFIG_ARM_FCSE
+
+int fcse_init_new_context(struct task_struct *tsk, struct mm_struct *mm);
+void fcse_destroy_context(struct mm_struct *mm);
+extern void cpu_xscale_fcse_switch_mm(unsigned long pgd_phys);
+
+#define init_new_context(tsk,mm)	fcse_init_new_context(tsk,mm)
+#define destroy_context(mm)		fcse_destroy_context(mm)
+
+/*
+ * Two processes with their own PIDs have no cache lines in common.
+ * The exception is a MAP_SHARED page: prev's dirty lines for it must
+ * reach memory before another process reads it through its own MVA.
+ * A process with PID 0 sees the slots of everybody else.
+ */
+static inline int
+fcse_switch_keeps_caches(struct mm_struct *prev, struct mm_struct *next)
+{
+	return prev->context.pid && next->context.pid &&
+	       !prev->context.shared;
+}
+
+#else
+
 #define init_new_context(tsk,mm)	0
 
 #endif
 
+#endif
+
+#ifndef CONFIG_ARM_FCSE
 #define destroy_context(mm)		do { } while(0)
+#endif
 
 /*
  * This is called when "tsk" is about to enter lazy TLB mode.
@@ -98,6 +127,13 @@ switch_mm(struct mm_struct *prev, struct mm_struct *next,
 	if (prev != next) {
 		cpu_set(cpu, next->cpu_vm_mask);
 		check_context(next);
+#ifdef CONFIG_ARM_FCSE
+		fcse_pid_set(next->context.pid);
+		if (fcse_switch_keeps_caches(prev, next)) {
+			cpu_xscale_fcse_switch_mm(virt_to_phys(next->pgd));
+			return;
+		}
+#endif
 		cpu_switch_mm(next->pgd, next);
 		if (cache_is_vivt())
 			cpu_clear(cpu, prev->cpu_vm_mask);
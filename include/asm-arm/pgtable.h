@@ -20,6 +20,7 @@
 #else
 
 #include <asm/memory.h>
+#include <asm/fcse.h>
 #include <asm/arch/vmalloc.h>
 #include <asm/pgtable-hwdef.h>
 
@@ -347,7 +348,7 @@ static inline pte_t *pmd_page_vaddr(pmd_t pmd)
 /* to find an entry in a page-table-directory */
 #define pgd_index(addr)		((addr) >> PGDIR_SHIFT)
 
-#define pgd_offset(mm, addr)	((mm)->pgd+pgd_index(addr))
+#define pgd_offset(mm, addr)	((mm)->pgd+pgd_index(fcse_va_to_mva(mm, addr)))
 
 /* to find an entry in a kernel page-table-directory */
 #define pgd_offset_k(addr)	pgd_offset(&init_mm, addr)
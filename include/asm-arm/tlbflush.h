@@ -18,6 +18,7 @@
 #else /* CONFIG_MMU */
 
 #include <asm/glue.h>
+#include <asm/fcse.h>
 
 #define TLB_V3_PAGE	(1 << 0)
 #define TLB_V4_U_PAGE	(1 << 1)
@@ -310,7 +311,7 @@ local_flush_tlb_page(struct vm_area_struct *vma, unsigned long uaddr)
 	const int zero = 0;
 	const unsigned int __tlb_flag = __cpu_tlb_flags;
 
-	uaddr = (uaddr & PAGE_MASK) | ASID(vma->vm_mm);
+	uaddr = fcse_va_to_mva(vma->vm_mm, uaddr & PAGE_MASK) | ASID(vma->vm_mm);
 
 	if (tlb_flag(TLB_WB))
 		dsb();
@@ -422,7 +423,10 @@ static inline void clean_pmd_entry(pmd_t *pmd)
 /*
  * Convert calls to our calling convention.
  */
-#define local_flush_tlb_range(vma,start,end)	__cpu_flush_user_tlb_range(start,end,vma)
+#define local_flush_tlb_range(vma,start,end)				\
+	__cpu_flush_user_tlb_range(					\
+		(start) + fcse_mva_offset((vma)->vm_mm, start),		\
+		(end) + fcse_mva_offset((vma)->vm_mm, start), vma)
 #define local_flush_tlb_kernel_range(s,e)	__cpu_flush_kern_tlb_range(s,e)
 
 #ifndef CONFIG_SMP
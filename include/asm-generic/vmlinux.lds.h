@@ -225,7 +225,12 @@
   	*(.initcall5s.init)						\
 	*(.initcallrootfs.init)						\
   	*(.initcall6.init)						\
+	VMLINUX_SYMBOL(__async_initcall_start) = .;			\
+  	*(.initcall6a.init)						\
+	VMLINUX_SYMBOL(__async_initcall_end) = .;			\
   	*(.initcall6s.init)						\
   	*(.initcall7.init)						\
-  	*(.initcall7s.init)
+  	*(.initcall7s.init)						\
+	VMLINUX_SYMBOL(__deferred_initcall_start) = .;			\
+  	*(.initcalld.init)
 
@@ -0,0 +1,14 @@
+/*
+ *  include/linux/anon_inodes.h
+ *
+ *  Files with no inode of their own (see fs/anon_inodes.c).
+ */
+
+#ifndef _LINUX_ANON_INODES_H
+#define _LINUX_ANON_INODES_H
+
+int anon_inode_getfd(int *pfd, struct inode **pinode, struct file **pfile,
+		     const char *name, const struct file_operations *fops,
+		     void *priv);
+
+#endif /* _LINUX_ANON_INODES_H */
@@ -10,6 +10,9 @@ struct cramfs_sb_info {
 			unsigned long blocks;
 			unsigned long files;
 			unsigned long flags;
+#ifdef CONFIG_CRAMFS_XIP
+			struct mtd_info *mtd;	/* for mapping XIP files */
+#endif
 };
 
 static inline struct cramfs_sb_info *CRAMFS_SB(struct super_block *sb)
@@ -0,0 +1,32 @@
+/*
+ *	crc-itu-t.h - CRC ITU-T V.41 routine
+ *
+ * Implements the standard CRC ITU-T V.41:
+ *   Width 16
+ *   Poly  0x1021 (x^16 + x^12 + x^5 + 1)
+ *   Init  0
+ *
+ * This is the msbit-first CRC used by XMODEM/YMODEM.  Note that
+ * <linux/crc-ccitt.h> implements the bit-reversed variant.
+ *
+ * This source code is licensed under the GNU General Public License,
+ * Version 2. See the file COPYING for more details.
+ */
+
+#ifndef _LINUX_CRC_ITU_T_H
+#define _LINUX_CRC_ITU_T_H
+#ifdef __KERNEL__
+
+#include <linux/types.h>
+
+extern u16 const crc_itu_t_table[256];
+
+extern u16 crc_itu_t(u16 crc, const u8 *buffer, size_t len);
+
+static inline u16 crc_itu_t_byte(u16 crc, const u8 data)
+{
+	return (crc << 8) ^ crc_itu_t_table[((crc >> 8) ^ data) & 0xff];
+}
+
+#endif /* __KERNEL__ */
+#endif /* _LINUX_CRC_ITU_T_H */
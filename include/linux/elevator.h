@@ -13,6 +13,7 @@ typedef void (elevator_merge_req_fn) (request_queue_t *, struct request *, struc
 typedef void (elevator_merged_fn) (request_queue_t *, struct request *, int);
 
 typedef int (elevator_allow_merge_fn) (request_queue_t *, struct request *, struct bio *);
+typedef int (elevator_allow_rq_merge_fn) (request_queue_t *, struct request *, struct request *);
 
 typedef int (elevator_dispatch_fn) (request_queue_t *, int);
 
@@ -36,6 +37,7 @@ struct elevator_ops
 	elevator_merged_fn *elevator_merged_fn;
 	elevator_merge_req_fn *elevator_merge_req_fn;
 	elevator_allow_merge_fn *elevator_allow_merge_fn;
+	elevator_allow_rq_merge_fn *elevator_allow_rq_merge_fn;
 
 	elevator_dispatch_fn *elevator_dispatch_fn;
 	elevator_add_req_fn *elevator_add_req_fn;
@@ -100,6 +102,8 @@ extern void elv_add_request(request_queue_t *, struct request *, int, int);
 extern void __elv_add_request(request_queue_t *, struct request *, int, int);
 extern void elv_insert(request_queue_t *, struct request *, int);
 extern int elv_merge(request_queue_t *, struct request **, struct bio *);
+extern int elv_allow_rq_merge(request_queue_t *, struct request *,
+			      struct request *);
 extern void elv_merge_requests(request_queue_t *, struct request *,
 			       struct request *);
 extern void elv_merged_request(request_queue_t *, struct request *, int);
@@ -74,6 +74,9 @@ extern unsigned int reset_devices;
 /* used by init/main.c */
 extern void setup_arch(char **);
 
+/* Runs the deferred_initcall()s once, see init/main.c */
+extern void do_deferred_initcalls(void);
+
 #endif
   
 #ifndef MODULE
@@ -118,6 +121,22 @@ extern void setup_arch(char **);
 #define late_initcall(fn)		__define_initcall("7",fn,7)
 #define late_initcall_sync(fn)		__define_initcall("7s",fn,7s)
 
+/*
+ * An "async" device initcall may run in its own kernel thread, in
+ * parallel with the other async initcalls.  All of them are finished
+ * before the device_initcall_sync() level starts, so they may only
+ * depend on initcalls of level 6 and below, never on each other.
+ */
+#define device_initcall_async(fn)	__define_initcall("6a",fn,6a)
+
+/*
+ * A "deferred" initcall is not needed to reach the point where the
+ * system can boot.  Normally these run right after the late initcalls;
+ * with CONFIG_LAB they are postponed until the LAB command line is
+ * first used (see do_deferred_initcalls()).
+ */
+#define deferred_initcall(fn)		__define_initcall("d",fn,d)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn) \
@@ -200,7 +219,9 @@ void __init parse_early_param(void);
 #define subsys_initcall(fn)		module_init(fn)
 #define fs_initcall(fn)			module_init(fn)
 #define device_initcall(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
+#define deferred_initcall(fn)		module_init(fn)
 
 #define security_initcall(fn)		module_init(fn)
 
@@ -30,6 +30,25 @@ struct input_event {
 	__s32 value;
 };
 
+/*
+ * Event ring shared with the reader through mmap(), see EVIOCSRING.
+ * The kernel advances head one whole packet (up to EV_SYN) at a time;
+ * the reader consumes events[tail] and advances tail.  Both wrap at size.
+ */
+
+struct input_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 flags;
+	__u32 dropped;		/* packets lost to a full ring */
+	__u32 coalesced;	/* packets folded into their predecessor */
+	__u32 reserved[2];
+	struct input_event events[0];
+};
+
+#define INPUT_RING_COALESCE	0x01	/* merge EV_ABS moves when behind */
+
 /*
  * Protocol version.
  */
@@ -80,6 +99,7 @@ struct input_absinfo {
 #define EVIOCGEFFECTS		_IOR('E', 0x84, int)			/* Report number of effects playable at the same time */
 
 #define EVIOCGRAB		_IOW('E', 0x90, int)			/* Grab/Release device */
+#define EVIOCSRING		_IOW('E', 0x91, int)			/* Switch to an mmap'd event ring */
 
 /*
  * Event types
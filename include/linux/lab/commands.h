@@ -27,11 +27,11 @@ struct lab_command {
 void lab_cmdinit(void);
 void lab_addcommand(char *cmd, void(*func)(int,const char **), char *help);
 void lab_addsubcommand(char *cmd, char *cmd2, void(*func)(int,const char **), char *help);
-void lab_execcommand(int argc, char **argv);
+int lab_execcommand(int argc, char **argv);
 void lab_delcommand(char *cmd);
 
 
 /* Specific commands */
-void lab_armboot(char* source, char* sourcefile, char *cmdline);
+void lab_armboot(char* source, char* sourcefile, char *cmdline, char *initrdspec);
 
 #endif /* _COMMANDS_H_ */
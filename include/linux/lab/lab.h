@@ -31,7 +31,13 @@ extern void lab_readline (char *buff, size_t buffsize);
 
 /* Command line interpreter */
 extern void lab_main (int cmdline);
-extern void lab_exec_string (char *str);
+extern int lab_exec_string (char *str);
+extern int lab_script_depth (const char *str);
+
+/* Interpreter variables */
+extern const char *lab_getvar (const char *name);
+extern int lab_setvar (const char *name, const char *value);
+extern void lab_unsetvar (const char *name);
 
 /* Utility functions */
 extern int lab_dev_open (int devmode, int major, int minor, int fmode);
@@ -0,0 +1,80 @@
+#ifndef _LINUX_LATENCY_HIST_H
+#define _LINUX_LATENCY_HIST_H
+
+/*
+ * Wakeup and critical section latency histograms, see
+ * kernel/latency_hist.c.
+ */
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+/* <1us, [1,2)us, [2,4)us, ... [32,65)ms, >=65ms */
+#define LATENCY_HIST_BUCKETS	18
+
+struct latency_hist {
+	unsigned long count[LATENCY_HIST_BUCKETS];
+	unsigned long long total;	/* ns */
+	unsigned long long max;		/* ns */
+};
+
+enum latency_type {
+	LATENCY_WAKEUP,		/* wakeup until the task runs */
+	LATENCY_PREEMPTOFF,	/* preempt_count() held non-zero */
+	LATENCY_IRQSOFF,	/* hardirqs disabled */
+	NR_LATENCY_TYPES
+};
+
+struct task_struct;
+
+#ifdef CONFIG_LATENCY_HIST
+
+extern int latency_hist_enabled;
+
+extern void __latency_hist_wakeup(struct task_struct *p);
+extern void __latency_hist_switch(struct task_struct *prev,
+				  struct task_struct *next,
+				  unsigned long long now);
+extern void __latency_hist_section_start(int type, unsigned long ip);
+extern void __latency_hist_section_end(int type, unsigned long ip);
+extern int proc_pid_latency_hist(struct task_struct *task, char *buffer);
+
+/* Called with the runqueue of p locked, once p is on it */
+static inline void latency_hist_wakeup(struct task_struct *p)
+{
+	if (unlikely(latency_hist_enabled))
+		__latency_hist_wakeup(p);
+}
+
+/*
+ * Called from schedule() before switching to next.  A pending wakeup
+ * stamp is consumed even while disabled so that it can't go stale.
+ */
+#define latency_hist_switch(prev, next, now)			\
+	do {							\
+		if (unlikely((next)->lat_wakeup_stamp))		\
+			__latency_hist_switch(prev, next, now);	\
+	} while (0)
+
+static inline void latency_hist_section_start(int type, unsigned long ip)
+{
+	if (unlikely(latency_hist_enabled))
+		__latency_hist_section_start(type, ip);
+}
+
+static inline void latency_hist_section_end(int type, unsigned long ip)
+{
+	if (unlikely(latency_hist_enabled))
+		__latency_hist_section_end(type, ip);
+}
+
+#else
+
+static inline void latency_hist_wakeup(struct task_struct *p) { }
+#define latency_hist_switch(prev, next, now)	do { } while (0)
+static inline void latency_hist_section_start(int type, unsigned long ip) { }
+static inline void latency_hist_section_end(int type, unsigned long ip) { }
+
+#endif
+
+#endif /* _LINUX_LATENCY_HIST_H */
@@ -0,0 +1,96 @@
+#ifndef _LINUX_LRO_H
+#define _LINUX_LRO_H
+
+/*
+ * Large receive offload in software: in-order TCP/IPv4 segments of one
+ * flow are chained into a single skb before they reach the stack, so
+ * ip_rcv() and tcp_v4_rcv() run once per burst instead of per segment.
+ */
+
+#ifdef __KERNEL__
+
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+
+struct net_lro_stats {
+	unsigned long	aggregated;	/* segments merged into another */
+	unsigned long	flushed;	/* merged skbs handed to the stack */
+	unsigned long	no_desc;	/* flows passed through, table full */
+};
+
+struct net_lro_desc {
+	struct sk_buff	*parent;	/* first segment, owns the chain */
+	struct sk_buff	*last_skb;
+	__be32		saddr, daddr;
+	__be16		source, dest;
+	u32		next_seq;
+	__be32		ack_seq;
+	__be16		window;
+	__be32		tsval, tsecr;	/* when the segments carry them */
+	unsigned	tot_len;	/* IP length of the merged skb */
+	unsigned	segs;
+	unsigned	mss;
+	int		psh;
+	int		active;
+};
+
+struct net_lro_mgr {
+	struct net_device	*dev;
+	struct net_lro_desc	*lro_arr;
+	int			max_desc;
+	int			max_aggr;	/* segments per merged skb */
+	unsigned long		timeout;	/* jiffies; 0 = driver flushes */
+	int			napi;		/* deliver with netif_receive_skb */
+	spinlock_t		lock;
+	struct timer_list	timer;
+	struct net_lro_stats	stats;
+};
+
+/* for a driver's ethtool string table, in lro_get_stats() order */
+#define LRO_STATS_LEN		3
+#define LRO_STAT_STRINGS	"lro_aggregated", "lro_flushed", "lro_no_desc"
+
+#ifdef CONFIG_NET_LRO
+
+extern int lro_init(struct net_lro_mgr *mgr, struct net_device *dev,
+		    int max_desc, int max_aggr, unsigned long timeout);
+extern void lro_release(struct net_lro_mgr *mgr);
+extern int lro_receive_skb(struct net_lro_mgr *mgr, struct sk_buff *skb);
+extern void lro_flush_all(struct net_lro_mgr *mgr);
+extern void lro_get_stats(struct net_lro_mgr *mgr, u64 *data);
+
+#else
+
+static inline int lro_init(struct net_lro_mgr *mgr, struct net_device *dev,
+			   int max_desc, int max_aggr, unsigned long timeout)
+{
+	mgr->dev = dev;
+	return 0;
+}
+
+static inline void lro_release(struct net_lro_mgr *mgr)
+{
+}
+
+static inline int lro_receive_skb(struct net_lro_mgr *mgr,
+				  struct sk_buff *skb)
+{
+	return mgr->napi ? netif_receive_skb(skb) : netif_rx(skb);
+}
+
+static inline void lro_flush_all(struct net_lro_mgr *mgr)
+{
+}
+
+static inline void lro_get_stats(struct net_lro_mgr *mgr, u64 *data)
+{
+	memset(data, 0, LRO_STATS_LEN * sizeof(u64));
+}
+
+#endif /* CONFIG_NET_LRO */
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_LRO_H */
@@ -0,0 +1,33 @@
+#ifndef _LINUX_LZF_H
+#define _LINUX_LZF_H
+/*
+ * LZF: a very small, very fast LZ77 codec.
+ *
+ * The stream format is that of Marc Lehmann's liblzf, so data can be
+ * produced or checked with the userspace tools.  Compression trades
+ * ratio for speed (a single 4096 entry hash probe per position);
+ * decompression is a plain byte copier with bounds checks.
+ */
+
+#include <linux/types.h>
+
+#define LZF_HLOG		12
+#define LZF_WRKMEM_SIZE		((1 << LZF_HLOG) * sizeof(u32))
+
+/*
+ * Compress @in_len bytes into at most @out_len bytes.  @wrkmem must
+ * point to LZF_WRKMEM_SIZE bytes; it need not be initialised.  Returns
+ * the compressed length, or 0 if the result does not fit in @out_len.
+ */
+extern size_t lzf_compress(const void *in, size_t in_len,
+			   void *out, size_t out_len, void *wrkmem);
+
+/*
+ * Decompress into at most @out_len bytes.  Returns the decompressed
+ * length, -E2BIG if @out_len is too small or -EINVAL for a corrupt
+ * stream.
+ */
+extern int lzf_decompress(const void *in, size_t in_len,
+			  void *out, size_t out_len);
+
+#endif /* _LINUX_LZF_H */
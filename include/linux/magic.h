@@ -2,6 +2,7 @@
 #define __LINUX_MAGIC_H__
 
 #define ADFS_SUPER_MAGIC	0xadf5
+#define ANON_INODE_FS_MAGIC	0x09041934
 #define AFFS_SUPER_MAGIC	0xadff
 #define AFS_SUPER_MAGIC                0x5346414F
 #define AUTOFS_SUPER_MAGIC	0x0187
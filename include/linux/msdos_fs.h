@@ -185,6 +185,8 @@ struct fat_slot_info {
 #include <linux/nls.h>
 #include <linux/fs.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
 
 struct fat_mount_options {
 	uid_t fs_uid;
@@ -212,6 +214,8 @@ struct fat_mount_options {
 #define FAT_HASH_SIZE	(1UL << FAT_HASH_BITS)
 #define FAT_HASH_MASK	(FAT_HASH_SIZE-1)
 
+#define FAT_MIRROR_BATCH	8	/* FAT blocks pending copy to backup FATs */
+
 /*
  * MS-DOS file system in-core superblock data
  */
@@ -243,10 +247,22 @@ struct msdos_sb_info {
 
 	spinlock_t inode_hash_lock;
 	struct hlist_head inode_hashtable[FAT_HASH_SIZE];
+
+	unsigned long *free_map;     /* one bit per cluster, set = free */
+	int free_map_ready;          /* free_map covers the whole FAT */
+	int free_map_abort;
+	struct super_block *free_map_sb;
+	struct work_struct free_map_work;
+	struct completion free_map_done;
+
+	int mirror_nr;               /* FAT blocks not yet in backup FATs */
+	sector_t mirror_blocks[FAT_MIRROR_BATCH];
 };
 
 #define FAT_CACHE_VALID	0	/* special case for valid cache */
 
+struct fat_dindex;
+
 /*
  * MS-DOS file system inode data in memory
  */
@@ -263,6 +279,7 @@ struct msdos_inode_info {
 	int i_attrs;		/* unused attribute bits */
 	loff_t i_pos;		/* on-disk position of directory entry or 0 */
 	struct hlist_node i_fat_hash;	/* hash by i_location */
+	struct fat_dindex *i_dindex;	/* name index of a large directory */
 	struct inode vfs_inode;
 };
 
@@ -349,6 +366,14 @@ extern int fat_add_entries(struct inode *dir, void *slots, int nr_slots,
 			   struct fat_slot_info *sinfo);
 extern int fat_remove_entries(struct inode *dir, struct fat_slot_info *sinfo);
 
+/* fat/dindex.c */
+extern int fat_dindex_create(struct inode *dir, unsigned int nr_names);
+extern void fat_dindex_drop(struct inode *dir);
+extern int fat_dindex_insert(struct inode *dir, u32 hash, loff_t slot_off);
+extern void fat_dindex_delete(struct inode *dir, u32 hash, loff_t slot_off);
+extern int fat_dindex_lookup(struct inode *dir, u32 hash, unsigned int *pos,
+			     loff_t *slot_off);
+
 /* fat/fatent.c */
 struct fat_entry {
 	int entry;
@@ -394,6 +419,9 @@ extern int fat_alloc_clusters(struct inode *inode, int *cluster,
 			      int nr_cluster);
 extern int fat_free_clusters(struct inode *inode, int cluster);
 extern int fat_count_free_clusters(struct super_block *sb);
+extern int fat_mirror_flush(struct super_block *sb);
+extern void fat_free_map_start(struct super_block *sb);
+extern void fat_free_map_stop(struct super_block *sb);
 
 /* fat/file.c */
 extern int fat_generic_ioctl(struct inode *inode, struct file *filp,
@@ -427,6 +455,10 @@ extern int fat_sync_bhs(struct buffer_head **bhs, int nr_bhs);
 
 int fat_cache_init(void);
 void fat_cache_destroy(void);
+int fat_dindex_init(void);
+void fat_dindex_exit(void);
+int fat_free_map_init(void);
+void fat_free_map_exit(void);
 
 #endif /* __KERNEL__ */
 
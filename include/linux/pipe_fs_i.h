@@ -3,7 +3,7 @@
 
 #define PIPEFS_MAGIC 0x50495045
 
-#define PIPE_BUFFERS (16)
+#define PIPE_DEF_BUFFERS	16
 
 #define PIPE_BUF_FLAG_LRU	0x01	/* page is on the LRU */
 #define PIPE_BUF_FLAG_ATOMIC	0x02	/* was atomically mapped */
@@ -50,7 +50,8 @@ struct pipe_inode_info {
 	struct fasync_struct *fasync_readers;
 	struct fasync_struct *fasync_writers;
 	struct inode *inode;
-	struct pipe_buffer bufs[PIPE_BUFFERS];
+	unsigned int buffers;		/* size of bufs[], a power of two */
+	struct pipe_buffer *bufs;
 };
 
 /* Differs from PIPE_BUF in that PIPE_SIZE is the length of the actual
@@ -64,6 +65,14 @@ struct pipe_inode_info * alloc_pipe_info(struct inode * inode);
 void free_pipe_info(struct inode * inode);
 void __free_pipe_info(struct pipe_inode_info *);
 
+/* Pipe capacity limits for F_SETPIPE_SZ, fs.pipe-max-size */
+extern unsigned int pipe_max_size, pipe_min_size;
+struct ctl_table;
+int pipe_proc_fn(struct ctl_table *, int, struct file *, void __user *,
+		 size_t *, loff_t *);
+struct pipe_inode_info *get_pipe_info(struct file *file);
+long pipe_fcntl(struct file *, unsigned int, unsigned long);
+
 /* Generic pipe buffer ops functions */
 void *generic_pipe_buf_map(struct pipe_inode_info *, struct pipe_buffer *, int);
 void generic_pipe_buf_unmap(struct pipe_inode_info *, struct pipe_buffer *, void *);
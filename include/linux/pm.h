@@ -24,6 +24,9 @@
 #ifdef __KERNEL__
 
 #include <linux/list.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
 #include <asm/atomic.h>
 
 /*
@@ -235,15 +238,49 @@ typedef struct pm_message {
 #define PMSG_SUSPEND	((struct pm_message){ .event = PM_EVENT_SUSPEND, })
 #define PMSG_ON		((struct pm_message){ .event = PM_EVENT_ON, })
 
+/*
+ * Runtime power management: a driver keeps one of these in its private
+ * data and brackets every use of the hardware with dpm_runtime_get()
+ * and dpm_runtime_put().  idle_ms after the last put, ->suspend() is
+ * called to gate clocks and park pins; the next get calls ->resume()
+ * first.  Both callbacks run in process context.
+ */
+struct dev_pm_runtime {
+	int			(*suspend)(struct device *);
+	int			(*resume)(struct device *);
+	unsigned int		idle_ms;
+
+	/* private to drivers/base/power/runtime.c */
+	struct device		*dev;
+	spinlock_t		lock;
+	struct mutex		mutex;		/* serializes the callbacks */
+	struct delayed_work	work;
+	int			usage;
+	unsigned		suspended:1;
+	unsigned		suspending:1;	/* ->suspend() running */
+	unsigned long		last_busy;	/* jiffies at the last put */
+	unsigned long		stamp;		/* jiffies at the last change */
+	unsigned long		active_jiffies;
+	unsigned long		idle_jiffies;
+	unsigned long		suspend_count;
+};
+
 struct dev_pm_info {
 	pm_message_t		power_state;
 	unsigned		can_wakeup:1;
 #ifdef	CONFIG_PM
 	unsigned		should_wakeup:1;
+	unsigned		async_suspend:1;	/* may run in parallel */
+	unsigned		suspend_failed:1;
+	unsigned		async_started:1;	/* has a thread this pass */
 	pm_message_t		prev_state;
 	void			* saved_state;
 	struct device		* pm_parent;
 	struct list_head	entry;
+	struct completion	done;		/* this pass is over */
+	unsigned long		suspend_usecs;	/* last suspend_device() */
+	unsigned long		resume_usecs;	/* last resume_device() */
+	struct dev_pm_runtime	* runtime;
 #endif
 };
 
@@ -264,9 +301,22 @@ extern int device_prepare_suspend(pm_message_t state);
 #define device_may_wakeup(dev) \
 	(device_can_wakeup(dev) && (dev)->power.should_wakeup)
 
+/* Drivers whose suspend and resume only depend on their parent (and
+ * children) set this, and are then suspended and resumed in a thread
+ * of their own while the rest of the device list carries on.
+ */
+#define device_set_async_suspend(dev,val) \
+	((dev)->power.async_suspend = !!(val))
+
 extern int dpm_runtime_suspend(struct device *, pm_message_t);
 extern void dpm_runtime_resume(struct device *);
+
+extern void dpm_runtime_init(struct device *, struct dev_pm_runtime *);
+extern void dpm_runtime_exit(struct device *);
+extern int dpm_runtime_get(struct device *);
+extern void dpm_runtime_put(struct device *);
 extern void __suspend_report_result(const char *function, void *fn, int ret);
+extern ssize_t dpm_show_times(char *buf);
 
 #define suspend_report_result(fn, ret)					\
 	do {								\
@@ -282,6 +332,7 @@ static inline int device_suspend(pm_message_t state)
 
 #define device_set_wakeup_enable(dev,val)	do{}while(0)
 #define device_may_wakeup(dev)			(0)
+#define device_set_async_suspend(dev,val)	do{}while(0)
 
 static inline int dpm_runtime_suspend(struct device * dev, pm_message_t state)
 {
@@ -292,6 +343,25 @@ static inline void dpm_runtime_resume(struct device * dev)
 {
 }
 
+/* without CONFIG_PM the hardware simply stays on */
+static inline void dpm_runtime_init(struct device * dev,
+				    struct dev_pm_runtime * rt)
+{
+}
+
+static inline void dpm_runtime_exit(struct device * dev)
+{
+}
+
+static inline int dpm_runtime_get(struct device * dev)
+{
+	return 0;
+}
+
+static inline void dpm_runtime_put(struct device * dev)
+{
+}
+
 #define suspend_report_result(fn, ret) do { } while (0)
 
 #endif
@@ -21,6 +21,12 @@
 #define WQUEUES_STACK_ALLOC	(MAX_STACK_ALLOC - FRONTEND_STACK_ALLOC)
 #define N_INLINE_POLL_ENTRIES	(WQUEUES_STACK_ALLOC / sizeof(struct poll_table_entry))
 
+/*
+ * Passed as the wakeup key when a wait queue head is about to be freed;
+ * the callback must unhook its entry.  Never reported to user space.
+ */
+#define POLLFREE	0x4000
+
 struct poll_table_struct;
 
 /* 
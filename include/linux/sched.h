@@ -83,6 +83,7 @@ struct sched_param {
 #include <linux/timer.h>
 #include <linux/hrtimer.h>
 #include <linux/task_io_accounting.h>
+#include <linux/latency_hist.h>
 
 #include <asm/processor.h>
 
@@ -379,6 +380,7 @@ struct sighand_struct {
 	atomic_t		count;
 	struct k_sigaction	action[_NSIG];
 	spinlock_t		siglock;
+	wait_queue_head_t	signalfd_wqh;
 };
 
 struct pacct_struct {
@@ -832,6 +834,11 @@ struct task_struct {
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	struct sched_info sched_info;
 #endif
+#ifdef CONFIG_LATENCY_HIST
+	unsigned long long lat_wakeup_stamp;	/* sched_clock() at wakeup */
+	pid_t lat_waker;
+	struct latency_hist lat_wakeup;
+#endif
 
 	struct list_head tasks;
 	/*
@@ -96,6 +96,8 @@ static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
 
 #ifdef CONFIG_SLAB
 #include <linux/slab_def.h>
+#elif defined(CONFIG_SLUB)
+#include <linux/slub_def.h>
 #else
 /*
  * Fallback definitions for an allocator not wanting to provide
@@ -0,0 +1,125 @@
+#ifndef _LINUX_SLUB_DEF_H
+#define _LINUX_SLUB_DEF_H
+
+/*
+ * SLUB : An unqueued slab allocator for small memory systems.
+ *
+ * Objects are handed out straight from a freelist kept inside each slab
+ * page; there are no per cpu or shared object queues to fill and drain.
+ * See mm/slub.c.
+ */
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/threads.h>
+#include <linux/log2.h>
+#include <asm/atomic.h>
+#include <asm/page.h>
+#include <asm/cache.h>
+
+struct page;
+
+struct kmem_cache {
+	/* Fields used by the allocation and free paths */
+	unsigned long flags;
+	int size;		/* Object size including metadata */
+	int objsize;		/* Object size as requested */
+	int offset;		/* Free pointer offset, in words */
+	int order;		/* Page order of a slab */
+	int objects;		/* Objects per slab */
+	struct page *cpu_slab[NR_CPUS];	/* Slab each cpu allocates from */
+
+	/* Partial slabs, i.e. slabs with both used and free objects */
+	spinlock_t list_lock;
+	unsigned long nr_partial;
+	struct list_head partial;
+	atomic_long_t nr_slabs;
+
+	void (*ctor)(void *, struct kmem_cache *, unsigned long);
+	void (*dtor)(void *, struct kmem_cache *, unsigned long);
+	int inuse;		/* Offset of the metadata after the object */
+	int align;
+	int refcount;		/* Number of kmem_cache_create()s merged */
+	const char *name;	/* First name the cache was created under */
+	struct list_head list;	/* All caches, see slub_lock */
+};
+
+/*
+ * The smallest kmalloc object.  Architectures whose DMA is not cache
+ * coherent raise ARCH_KMALLOC_MINALIGN so that kmalloc buffers never
+ * share a cache line.
+ */
+#if defined(ARCH_KMALLOC_MINALIGN) && ARCH_KMALLOC_MINALIGN > 8
+#define KMALLOC_MIN_SIZE	ARCH_KMALLOC_MINALIGN
+#else
+#define KMALLOC_MIN_SIZE	8
+#endif
+
+#define KMALLOC_SHIFT_LOW	ilog2(KMALLOC_MIN_SIZE)
+#define KMALLOC_SHIFT_HIGH	17	/* 128k, as with SLAB */
+
+/*
+ * kmalloc caches by power of two index; 1 and 2 hold the 96 and 192
+ * byte caches.
+ */
+extern struct kmem_cache kmalloc_caches[KMALLOC_SHIFT_HIGH + 1];
+
+static inline int kmalloc_index(size_t size)
+{
+	if (size <= KMALLOC_MIN_SIZE)
+		return KMALLOC_SHIFT_LOW;
+
+	if (KMALLOC_MIN_SIZE <= 32 && size > 64 && size <= 96)
+		return 1;
+	if (KMALLOC_MIN_SIZE <= 64 && size > 128 && size <= 192)
+		return 2;
+	if (size <=          8) return 3;
+	if (size <=         16) return 4;
+	if (size <=         32) return 5;
+	if (size <=         64) return 6;
+	if (size <=        128) return 7;
+	if (size <=        256) return 8;
+	if (size <=        512) return 9;
+	if (size <=       1024) return 10;
+	if (size <=   2 * 1024) return 11;
+	if (size <=   4 * 1024) return 12;
+	if (size <=   8 * 1024) return 13;
+	if (size <=  16 * 1024) return 14;
+	if (size <=  32 * 1024) return 15;
+	if (size <=  64 * 1024) return 16;
+	if (size <= 128 * 1024) return 17;
+	return -1;
+}
+
+/*
+ * Find the kmalloc cache for a size known at compile time.  The DMA
+ * caches are left to __kmalloc().
+ */
+static inline struct kmem_cache *kmalloc_slab(size_t size)
+{
+	int index = kmalloc_index(size);
+
+	if (index < 0) {
+		extern void __you_cannot_kmalloc_that_much(void);
+		__you_cannot_kmalloc_that_much();
+	}
+	return &kmalloc_caches[index];
+}
+
+static inline void *kmalloc(size_t size, gfp_t flags)
+{
+	if (__builtin_constant_p(size) && !(flags & __GFP_DMA))
+		return kmem_cache_alloc(kmalloc_slab(size), flags);
+	return __kmalloc(size, flags);
+}
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	if (__builtin_constant_p(size) && !(flags & __GFP_DMA))
+		return kmem_cache_zalloc(kmalloc_slab(size), flags);
+	return __kzalloc(size, flags);
+}
+
+#endif /* _LINUX_SLUB_DEF_H */
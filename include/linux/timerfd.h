@@ -0,0 +1,14 @@
+/*
+ *  include/linux/timerfd.h
+ *
+ *  Timer expirations delivered through a file descriptor
+ *  (see fs/timerfd.c).
+ */
+
+#ifndef _LINUX_TIMERFD_H
+#define _LINUX_TIMERFD_H
+
+/* Flags for timerfd_settime() */
+#define TFD_TIMER_ABSTIME	(1 << 0)
+
+#endif /* _LINUX_TIMERFD_H */
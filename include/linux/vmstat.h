@@ -37,6 +37,7 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		FOR_ALL_ZONES(PGSCAN_DIRECT),
 		PGINODESTEAL, SLABS_SCANNED, KSWAPD_STEAL, KSWAPD_INODESTEAL,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		RA_SYNC, RA_ASYNC, RA_CONTEXT, RA_MMAP, RA_PAGES, RA_THRASH,
 		NR_VM_EVENT_ITEMS
 };
 
@@ -214,6 +215,8 @@ extern void __dec_zone_state(struct zone *, enum zone_stat_item);
 void refresh_cpu_vm_stats(int);
 void refresh_vm_stats(void);
 
+extern int sysctl_stat_interval;
+
 #else /* CONFIG_SMP */
 
 /*
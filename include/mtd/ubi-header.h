@@ -0,0 +1,156 @@
+/*
+ * On-flash format of the UBI wear leveling layer.
+ *
+ * Every physical eraseblock (PEB) starts with an erase counter header in
+ * its first minimal I/O unit.  A PEB that holds data has a volume
+ * identifier header in the next I/O unit; the data of the logical
+ * eraseblock (LEB) starts in the I/O unit after that.  All fields are
+ * big endian and every header carries a CRC32 of the bytes before it.
+ *
+ * This code is GPL
+ */
+
+#ifndef __UBI_HEADER_H__
+#define __UBI_HEADER_H__
+
+#include <asm/byteorder.h>
+
+#define UBI_VERSION		1
+
+#define UBI_EC_HDR_MAGIC	0x55424923	/* "UBI#" */
+#define UBI_VID_HDR_MAGIC	0x55424921	/* "UBI!" */
+#define UBI_FM_MAGIC		0x55424946	/* "UBIF" */
+
+#define UBI_CRC32_INIT		0xFFFFFFFFU
+
+/* Volume types */
+#define UBI_VID_DYNAMIC		1
+
+/* Internal volumes, their IDs are above any user volume ID */
+#define UBI_INTERNAL_VOL_START	0x7FFFEFFE
+#define UBI_FM_VOLUME_ID	0x7FFFEFFE	/* fast attach map */
+#define UBI_LAYOUT_VOLUME_ID	0x7FFFEFFF	/* volume table */
+#define UBI_LAYOUT_VOLUME_EBS	2		/* two copies of the table */
+
+#define UBI_MAX_VOLUMES		128
+#define UBI_VOL_NAME_MAX	127
+
+/**
+ * struct ubi_ec_hdr - erase counter header
+ * @magic:		%UBI_EC_HDR_MAGIC
+ * @version:		%UBI_VERSION
+ * @ec:			number of times this PEB has been erased
+ * @vid_hdr_offset:	where the volume identifier header starts
+ * @data_offset:	where the LEB data starts
+ * @hdr_crc:		CRC32 of the preceding bytes
+ */
+struct ubi_ec_hdr {
+	__be32	magic;
+	__u8	version;
+	__u8	padding1[3];
+	__be64	ec;
+	__be32	vid_hdr_offset;
+	__be32	data_offset;
+	__u8	padding2[36];
+	__be32	hdr_crc;
+} __attribute__ ((packed));
+
+/**
+ * struct ubi_vid_hdr - volume identifier header
+ * @magic:	%UBI_VID_HDR_MAGIC
+ * @version:	%UBI_VERSION
+ * @vol_type:	%UBI_VID_DYNAMIC
+ * @copy_flag:	set if the LEB was copied here from another PEB, in
+ *		which case @data_size and @data_crc describe the data
+ * @vol_id:	volume this LEB belongs to
+ * @lnum:	logical eraseblock number
+ * @data_size:	bytes of data covered by @data_crc
+ * @data_crc:	CRC32 of the data, valid if @copy_flag is set
+ * @sqnum:	global sequence number; the highest one wins when two
+ *		PEBs claim the same LEB after an interrupted copy
+ * @hdr_crc:	CRC32 of the preceding bytes
+ */
+struct ubi_vid_hdr {
+	__be32	magic;
+	__u8	version;
+	__u8	vol_type;
+	__u8	copy_flag;
+	__u8	padding1;
+	__be32	vol_id;
+	__be32	lnum;
+	__be32	data_size;
+	__be32	data_crc;
+	__be64	sqnum;
+	__u8	padding2[28];
+	__be32	hdr_crc;
+} __attribute__ ((packed));
+
+#define UBI_EC_HDR_SIZE		sizeof(struct ubi_ec_hdr)
+#define UBI_VID_HDR_SIZE	sizeof(struct ubi_vid_hdr)
+#define UBI_EC_HDR_CRC_SIZE	(UBI_EC_HDR_SIZE - sizeof(__be32))
+#define UBI_VID_HDR_CRC_SIZE	(UBI_VID_HDR_SIZE - sizeof(__be32))
+
+/**
+ * struct ubi_vtbl_record - volume table record
+ * @reserved_pebs:	PEBs reserved for the volume, 0 if the slot is free
+ * @vol_type:		%UBI_VID_DYNAMIC
+ * @upd_marker:		set while the volume is being updated; a volume
+ *			found with the marker set holds a partial image
+ * @name_len:		length of @name
+ * @name:		volume name, NUL terminated
+ * @crc:		CRC32 of the preceding bytes
+ *
+ * Both LEBs of the layout volume hold the full table.
+ */
+struct ubi_vtbl_record {
+	__be32	reserved_pebs;
+	__u8	vol_type;
+	__u8	upd_marker;
+	__be16	name_len;
+	__u8	name[UBI_VOL_NAME_MAX + 1];
+	__u8	padding[20];
+	__be32	crc;
+} __attribute__ ((packed));
+
+#define UBI_VTBL_RECORD_SIZE	sizeof(struct ubi_vtbl_record)
+#define UBI_VTBL_RECORD_CRC_SIZE (UBI_VTBL_RECORD_SIZE - sizeof(__be32))
+
+/*
+ * Fast attach map.  Written to a free PEB among the first
+ * %UBI_FM_MAX_START ones on clean detach and erased again on attach, so
+ * it only exists while nothing has been written since it was made.
+ */
+#define UBI_FM_MAX_START	64
+
+/* PEB states in the map */
+#define UBI_FM_PEB_FREE		0
+#define UBI_FM_PEB_USED		1
+#define UBI_FM_PEB_BAD		2
+#define UBI_FM_PEB_ERASE	3
+
+/**
+ * struct ubi_fm_hdr - fast attach map header, followed by @peb_count
+ *		       &struct ubi_fm_peb entries
+ * @magic:	%UBI_FM_MAGIC
+ * @peb_count:	number of PEBs of the device
+ * @sqnum:	highest sequence number in use
+ * @data_crc:	CRC32 of the entries
+ * @hdr_crc:	CRC32 of the preceding bytes
+ */
+struct ubi_fm_hdr {
+	__be32	magic;
+	__be32	peb_count;
+	__be64	sqnum;
+	__be32	data_crc;
+	__be32	hdr_crc;
+} __attribute__ ((packed));
+
+struct ubi_fm_peb {
+	__be32	ec;
+	__be32	vol_id;
+	__be32	lnum;
+	__u8	state;
+	__u8	padding[3];
+} __attribute__ ((packed));
+
+#endif /* __UBI_HEADER_H__ */
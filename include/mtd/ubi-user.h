@@ -0,0 +1,46 @@
+/*
+ * UBI user space interface: ioctls on /dev/ubi<N>.
+ *
+ * UBI_IOCMKVOL	create a volume; @vol_id of -1 picks a free ID, which is
+ *		returned in @vol_id
+ * UBI_IOCRMVOL	remove the volume with the given ID
+ * UBI_IOCVOLUP	start replacing the contents of a volume with @bytes
+ *		bytes, which are then passed with write() on the same file
+ *		descriptor.  The volume is marked as being updated until
+ *		the last byte is written; if the update is interrupted by
+ *		a crash or by closing the descriptor, the volume refuses
+ *		access until it is updated again, so a partial image is
+ *		never used.
+ *
+ * This code is GPL
+ */
+
+#ifndef __UBI_USER_H__
+#define __UBI_USER_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define UBI_VOL_NUM_AUTO	(-1)
+#define UBI_MAX_VOLUME_NAME	127
+
+struct ubi_mkvol_req {
+	int32_t vol_id;
+	int32_t name_len;
+	int64_t bytes;
+	char name[UBI_MAX_VOLUME_NAME + 1];
+};
+
+struct ubi_volup_req {
+	int32_t vol_id;
+	int32_t padding;
+	int64_t bytes;
+};
+
+#define UBI_IOC_MAGIC	'o'
+
+#define UBI_IOCMKVOL	_IOWR(UBI_IOC_MAGIC, 0, struct ubi_mkvol_req)
+#define UBI_IOCRMVOL	_IOW(UBI_IOC_MAGIC, 1, int32_t)
+#define UBI_IOCVOLUP	_IOW(UBI_IOC_MAGIC, 2, struct ubi_volup_req)
+
+#endif /* __UBI_USER_H__ */
@@ -54,6 +54,8 @@
 #include <linux/lockdep.h>
 #include <linux/pid_namespace.h>
 #include <linux/device.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -645,7 +647,20 @@ asmlinkage void __init start_kernel(void)
 	rest_init();
 }
 
-static int __initdata initcall_debug;
+/*
+ * LAB never frees the init sections and runs the deferred initcalls
+ * from its command line, long after do_basic_setup() has returned, so
+ * the initcall runner has to stay resident there.
+ */
+#ifdef CONFIG_LAB
+#define __initcall_runner
+#define __initcall_runnerdata
+#else
+#define __initcall_runner	__init
+#define __initcall_runnerdata	__initdata
+#endif
+
+static int __initcall_runnerdata initcall_debug;
 
 static int __init initcall_debug_setup(char *str)
 {
@@ -654,47 +669,145 @@ static int __init initcall_debug_setup(char *str)
 }
 __setup("initcall_debug", initcall_debug_setup);
 
+static int __initdata initcall_serial;
+
+static int __init initcall_serial_setup(char *str)
+{
+	initcall_serial = 1;
+	return 1;
+}
+__setup("initcall_serial", initcall_serial_setup);
+
 extern initcall_t __initcall_start[], __initcall_end[];
+extern initcall_t __async_initcall_start[], __async_initcall_end[];
+extern initcall_t __deferred_initcall_start[];
 
-static void __init do_initcalls(void)
+static void __initcall_runner do_one_initcall(initcall_t fn)
 {
-	initcall_t *call;
 	int count = preempt_count();
+	ktime_t t0 = ktime_set(0, 0);
+	char *msg = NULL;
+	char msgbuf[40];
+	int result;
+
+	if (initcall_debug) {
+		printk("Calling initcall 0x%p", fn);
+		print_fn_descriptor_symbol(": %s()", (unsigned long) fn);
+		printk("\n");
+		t0 = ktime_get();
+	}
 
-	for (call = __initcall_start; call < __initcall_end; call++) {
-		char *msg = NULL;
-		char msgbuf[40];
-		int result;
+	result = fn();
 
-		if (initcall_debug) {
-			printk("Calling initcall 0x%p", *call);
-			print_fn_descriptor_symbol(": %s()",
-					(unsigned long) *call);
-			printk("\n");
-		}
+	if (initcall_debug) {
+		ktime_t delta = ktime_sub(ktime_get(), t0);
 
-		result = (*call)();
+		printk("initcall 0x%p", fn);
+		print_fn_descriptor_symbol(": %s()", (unsigned long) fn);
+		printk(" returned %d after %Ld usecs\n", result,
+		       (unsigned long long) ktime_to_ns(delta) >> 10);
+	}
 
-		if (result && result != -ENODEV && initcall_debug) {
-			sprintf(msgbuf, "error code %d", result);
-			msg = msgbuf;
-		}
-		if (preempt_count() != count) {
-			msg = "preemption imbalance";
-			preempt_count() = count;
-		}
-		if (irqs_disabled()) {
-			msg = "disabled interrupts";
-			local_irq_enable();
-		}
-		if (msg) {
-			printk(KERN_WARNING "initcall at 0x%p", *call);
-			print_fn_descriptor_symbol(": %s()",
-					(unsigned long) *call);
-			printk(": returned with %s\n", msg);
+	if (result && result != -ENODEV && initcall_debug) {
+		sprintf(msgbuf, "error code %d", result);
+		msg = msgbuf;
+	}
+	if (preempt_count() != count) {
+		msg = "preemption imbalance";
+		preempt_count() = count;
+	}
+	if (irqs_disabled()) {
+		msg = "disabled interrupts";
+		local_irq_enable();
+	}
+	if (msg) {
+		printk(KERN_WARNING "initcall at 0x%p", fn);
+		print_fn_descriptor_symbol(": %s()", (unsigned long) fn);
+		printk(": returned with %s\n", msg);
+	}
+}
+
+static void __initcall_runner do_initcall_range(initcall_t *start, initcall_t *end)
+{
+	initcall_t *call;
+
+	for (call = start; call < end; call++)
+		do_one_initcall(*call);
+}
+
+static atomic_t async_initcalls_pending __initdata;
+static __initdata DECLARE_COMPLETION(async_initcalls_done);
+
+static int __init async_initcall_thread(void *data)
+{
+	initcall_t *call = data;
+
+	do_one_initcall(*call);
+	if (atomic_dec_and_test(&async_initcalls_pending))
+		complete(&async_initcalls_done);
+	return 0;
+}
+
+/*
+ * Start every device_initcall_async() in a kernel thread of its own and
+ * wait until all of them are finished.  Probes that sleep on hardware
+ * (card detection, panel power sequencing, flash scans) overlap instead
+ * of adding up.
+ */
+static void __init do_async_initcalls(void)
+{
+	initcall_t *call;
+	struct task_struct *tsk;
+
+	if (initcall_serial) {
+		do_initcall_range(__async_initcall_start, __async_initcall_end);
+		return;
+	}
+
+	/* the extra reference keeps the count from hitting zero early */
+	atomic_set(&async_initcalls_pending, 1);
+
+	for (call = __async_initcall_start; call < __async_initcall_end; call++) {
+		atomic_inc(&async_initcalls_pending);
+		tsk = kthread_run(async_initcall_thread, call, "initcall/%d",
+				  (int) (call - __async_initcall_start));
+		if (IS_ERR(tsk)) {
+			atomic_dec(&async_initcalls_pending);
+			do_one_initcall(*call);
 		}
 	}
 
+	if (!atomic_dec_and_test(&async_initcalls_pending))
+		wait_for_completion(&async_initcalls_done);
+}
+
+static int deferred_initcalls_done;
+
+/*
+ * Run the deferred_initcall()s.  Without LAB this happens at the end of
+ * do_initcalls(); LAB calls it when its command line is first used.
+ */
+void __initcall_runner do_deferred_initcalls(void)
+{
+	if (deferred_initcalls_done)
+		return;
+	deferred_initcalls_done = 1;
+
+	do_initcall_range(__deferred_initcall_start, __initcall_end);
+
+	flush_scheduled_work();
+}
+
+static void __init do_initcalls(void)
+{
+	do_initcall_range(__initcall_start, __async_initcall_start);
+	do_async_initcalls();
+	do_initcall_range(__async_initcall_end, __deferred_initcall_start);
+
+#if !defined(CONFIG_LAB)
+	do_deferred_initcalls();
+#endif
+
 	/* Make sure there is no pending stuff from the initcall sequence */
 	flush_scheduled_work();
 }
@@ -49,6 +49,7 @@
 #include <linux/delayacct.h>
 #include <linux/taskstats_kern.h>
 #include <linux/random.h>
+#include <linux/signalfd.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -822,8 +823,10 @@ static inline int copy_sighand(unsigned long clone_flags, struct task_struct * t
 
 void __cleanup_sighand(struct sighand_struct *sighand)
 {
-	if (atomic_dec_and_test(&sighand->count))
+	if (atomic_dec_and_test(&sighand->count)) {
+		signalfd_cleanup(sighand);
 		kmem_cache_free(sighand_cachep, sighand);
+	}
 }
 
 static inline int copy_signal(unsigned long clone_flags, struct task_struct * tsk)
@@ -1424,8 +1427,10 @@ static void sighand_ctor(void *data, struct kmem_cache *cachep, unsigned long fl
 	struct sighand_struct *sighand = data;
 
 	if ((flags & (SLAB_CTOR_VERIFY | SLAB_CTOR_CONSTRUCTOR)) ==
-					SLAB_CTOR_CONSTRUCTOR)
+					SLAB_CTOR_CONSTRUCTOR) {
 		spin_lock_init(&sighand->siglock);
+		init_waitqueue_head(&sighand->signalfd_wqh);
+	}
 }
 
 void __init proc_caches_init(void)
@@ -0,0 +1,479 @@
+/*
+ * kernel/latency_hist.c
+ *
+ * Wakeup and critical section latency histograms.
+ *
+ * Three latencies are sampled into log2 histograms of microseconds:
+ *
+ *  wakeup	from try_to_wake_up() putting a task on a runqueue until
+ *		schedule() switches to it.  Kept per CPU and per task, the
+ *		latter in /proc/<pid>/latency_hist.
+ *  preemptoff	preempt_count() non-zero, timed in add_preempt_count()
+ *		and sub_preempt_count() (CONFIG_DEBUG_PREEMPT).
+ *  irqsoff	hardirqs disabled, timed from the lockdep irq tracing
+ *		hooks (CONFIG_TRACE_IRQFLAGS).
+ *
+ * Sections opened by the idle task are not counted, the idle loop runs
+ * non-preemptible by design.  For each type the worst sample is kept
+ * along with the tasks involved and a call chain; samples longer than
+ * the system latency constraint from kernel/latency.c are counted
+ * separately.
+ *
+ * Everything is off until "1" is written to /proc/latency_hist; until
+ * then the hooks cost one predictable branch.  "0" stops sampling and
+ * "reset" clears all histograms.
+ */
+
+#include <linux/sched.h>
+#include <linux/init.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/kallsyms.h>
+#include <linux/stacktrace.h>
+#include <linux/latency.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/irqflags.h>
+#include <linux/bitops.h>
+#include <asm/uaccess.h>
+#include <asm/div64.h>
+
+#define LATENCY_TRACE_DEPTH	16
+
+int latency_hist_enabled __read_mostly;
+
+struct latency_cpu {
+	struct latency_hist hist[NR_LATENCY_TYPES];
+	unsigned long long start[NR_LATENCY_TYPES];	/* open sections */
+	unsigned long start_ip[NR_LATENCY_TYPES];
+};
+
+static DEFINE_PER_CPU(struct latency_cpu, latency_cpu);
+
+struct latency_worst {
+	unsigned long long latency;	/* ns */
+	int cpu;
+	pid_t pid;
+	int prio;
+	char comm[TASK_COMM_LEN];
+	pid_t waker;			/* wakeup only */
+	pid_t prev_pid;			/* wakeup only: who had the cpu */
+	char prev_comm[TASK_COMM_LEN];
+	unsigned long start_ip, end_ip;	/* sections only */
+	unsigned int nr_entries;
+	unsigned long entries[LATENCY_TRACE_DEPTH];
+};
+
+/*
+ * The worst samples are updated from inside the irq and preempt tracing
+ * hooks, so use a raw lock that does not recurse into them.
+ */
+static raw_spinlock_t latency_worst_lock =
+	(raw_spinlock_t)__RAW_SPIN_LOCK_UNLOCKED;
+static struct latency_worst latency_worst[NR_LATENCY_TYPES];
+
+static atomic_t latency_over[NR_LATENCY_TYPES];
+static unsigned long long latency_constraint_ns = ~0ULL;
+
+static const char *latency_names[NR_LATENCY_TYPES] = {
+	[LATENCY_WAKEUP]	= "wakeup",
+	[LATENCY_PREEMPTOFF]	= "preemptoff",
+	[LATENCY_IRQSOFF]	= "irqsoff",
+};
+
+static inline unsigned long latency_us(unsigned long long ns)
+{
+	do_div(ns, 1000);
+	return ns;
+}
+
+/* Lower bound of bucket i, in microseconds */
+static inline unsigned long latency_bucket_us(int i)
+{
+	return i ? 1UL << (i - 1) : 0;
+}
+
+static void latency_hist_add(struct latency_hist *h, unsigned long long ns)
+{
+	unsigned long us = latency_us(ns);
+	int i;
+
+	if (us >= latency_bucket_us(LATENCY_HIST_BUCKETS - 1))
+		i = LATENCY_HIST_BUCKETS - 1;
+	else
+		i = fls(us);
+
+	h->count[i]++;
+	h->total += ns;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+#ifdef CONFIG_STACKTRACE
+static void latency_save_trace(struct latency_worst *w)
+{
+	struct stack_trace trace;
+
+	trace.nr_entries = 0;
+	trace.max_entries = LATENCY_TRACE_DEPTH;
+	trace.entries = w->entries;
+	trace.skip = 3;		/* our own frames */
+	trace.all_contexts = 0;
+	save_stack_trace(&trace, NULL);
+	w->nr_entries = trace.nr_entries;
+}
+#else
+static inline void latency_save_trace(struct latency_worst *w)
+{
+	w->nr_entries = 0;
+}
+#endif
+
+static void latency_update_worst(int type, unsigned long long ns,
+				 struct task_struct *p,
+				 struct task_struct *prev,
+				 unsigned long start_ip, unsigned long end_ip)
+{
+	struct latency_worst *w = &latency_worst[type];
+	unsigned long flags;
+
+	raw_local_irq_save(flags);
+	__raw_spin_lock(&latency_worst_lock);
+	if (ns <= w->latency)
+		goto out;
+
+	w->latency = ns;
+	w->cpu = raw_smp_processor_id();
+	w->pid = p->pid;
+	w->prio = p->prio;
+	memcpy(w->comm, p->comm, TASK_COMM_LEN);
+	if (prev) {
+		w->waker = p->lat_waker;
+		w->prev_pid = prev->pid;
+		memcpy(w->prev_comm, prev->comm, TASK_COMM_LEN);
+	}
+	w->start_ip = start_ip;
+	w->end_ip = end_ip;
+
+	latency_save_trace(w);
+out:
+	__raw_spin_unlock(&latency_worst_lock);
+	raw_local_irq_restore(flags);
+}
+
+static inline void latency_sample(int type, struct latency_hist *h,
+				  unsigned long long ns)
+{
+	latency_hist_add(h, ns);
+	if (ns > latency_constraint_ns)
+		atomic_inc(&latency_over[type]);
+}
+
+void __latency_hist_wakeup(struct task_struct *p)
+{
+	p->lat_wakeup_stamp = sched_clock();
+	p->lat_waker = current->pid;
+}
+
+/* Called with the runqueue locked and interrupts off */
+void __latency_hist_switch(struct task_struct *prev, struct task_struct *next,
+			   unsigned long long now)
+{
+	unsigned long long stamp = next->lat_wakeup_stamp;
+	unsigned long long ns;
+	struct latency_cpu *lc;
+
+	next->lat_wakeup_stamp = 0;
+	if (!latency_hist_enabled)
+		return;
+
+	/* the stamp may come from another cpu's clock */
+	ns = (long long)(now - stamp) > 0 ? now - stamp : 0;
+
+	lc = &per_cpu(latency_cpu, raw_smp_processor_id());
+	latency_sample(LATENCY_WAKEUP, &lc->hist[LATENCY_WAKEUP], ns);
+	latency_hist_add(&next->lat_wakeup, ns);
+
+	if (ns > latency_worst[LATENCY_WAKEUP].latency)
+		latency_update_worst(LATENCY_WAKEUP, ns, next, prev, 0, 0);
+}
+
+/*
+ * The section hooks run with the section already open (start) or still
+ * open (end), so the cpu can't change under us.  They must not take
+ * anything that disables irqs or preemption the traced way.
+ */
+void __latency_hist_section_start(int type, unsigned long ip)
+{
+	struct latency_cpu *lc = &per_cpu(latency_cpu, raw_smp_processor_id());
+
+	if (lc->start[type] || !current->pid)
+		return;
+
+	lc->start[type] = sched_clock();
+	lc->start_ip[type] = ip;
+}
+
+void __latency_hist_section_end(int type, unsigned long ip)
+{
+	struct latency_cpu *lc = &per_cpu(latency_cpu, raw_smp_processor_id());
+	unsigned long long start = lc->start[type];
+	unsigned long long ns;
+
+	if (!start)
+		return;
+	lc->start[type] = 0;
+
+	ns = sched_clock() - start;
+	if ((long long)ns < 0)
+		return;
+
+	latency_sample(type, &lc->hist[type], ns);
+	if (ns > latency_worst[type].latency)
+		latency_update_worst(type, ns, current, NULL,
+				     lc->start_ip[type], ip);
+}
+
+int proc_pid_latency_hist(struct task_struct *task, char *buffer)
+{
+	struct latency_hist *h = &task->lat_wakeup;
+	unsigned long long avg = h->total;
+	unsigned long nr = 0;
+	int i, len = 0;
+
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		len += sprintf(buffer + len, "%lu %lu\n",
+			       latency_bucket_us(i), h->count[i]);
+		nr += h->count[i];
+	}
+	if (nr)
+		do_div(avg, nr);
+	len += sprintf(buffer + len, "max_us %lu\navg_us %lu\n",
+		       latency_us(h->max), latency_us(avg));
+	return len;
+}
+
+static void latency_seq_sym(struct seq_file *m, unsigned long addr)
+{
+	char namebuf[KSYM_NAME_LEN + 1];
+	unsigned long size, offset;
+	const char *name;
+	char *modname;
+
+	name = kallsyms_lookup(addr, &size, &offset, &modname, namebuf);
+	if (!name)
+		seq_printf(m, "0x%08lx", addr);
+	else if (modname)
+		seq_printf(m, "%s+%#lx/%#lx [%s]", name, offset, size, modname);
+	else
+		seq_printf(m, "%s+%#lx/%#lx", name, offset, size);
+}
+
+static void latency_show_worst(struct seq_file *m, int type)
+{
+	struct latency_worst w;
+	unsigned long flags;
+	unsigned int i;
+
+	raw_local_irq_save(flags);
+	__raw_spin_lock(&latency_worst_lock);
+	w = latency_worst[type];
+	__raw_spin_unlock(&latency_worst_lock);
+	raw_local_irq_restore(flags);
+
+	if (!w.latency)
+		return;
+
+	seq_printf(m, "\nworst %s: %lu us on cpu %d, pid %d (%s) prio %d\n",
+		   latency_names[type], latency_us(w.latency), w.cpu,
+		   w.pid, w.comm, w.prio);
+	if (type == LATENCY_WAKEUP) {
+		seq_printf(m, "  woken by pid %d, ran after pid %d (%s)\n",
+			   w.waker, w.prev_pid, w.prev_comm);
+	} else {
+		seq_printf(m, "  from ");
+		latency_seq_sym(m, w.start_ip);
+		seq_printf(m, "\n  to   ");
+		latency_seq_sym(m, w.end_ip);
+		seq_printf(m, "\n");
+	}
+	for (i = 0; i < w.nr_entries; i++) {
+		seq_printf(m, "  [<%08lx>] ", w.entries[i]);
+		latency_seq_sym(m, w.entries[i]);
+		seq_printf(m, "\n");
+	}
+}
+
+static int latency_hist_show(struct seq_file *m, void *v)
+{
+	struct latency_hist sum[NR_LATENCY_TYPES];
+	unsigned long nr[NR_LATENCY_TYPES];
+	int cpu, type, i;
+
+	memset(sum, 0, sizeof(sum));
+	memset(nr, 0, sizeof(nr));
+	for_each_online_cpu(cpu) {
+		struct latency_cpu *lc = &per_cpu(latency_cpu, cpu);
+
+		for (type = 0; type < NR_LATENCY_TYPES; type++) {
+			struct latency_hist *h = &lc->hist[type];
+
+			for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+				sum[type].count[i] += h->count[i];
+				nr[type] += h->count[i];
+			}
+			sum[type].total += h->total;
+			if (h->max > sum[type].max)
+				sum[type].max = h->max;
+		}
+	}
+
+	seq_printf(m, "enabled %d\n", latency_hist_enabled);
+	if (latency_constraint_ns != ~0ULL)
+		seq_printf(m, "constraint_us %lu\n",
+			   latency_us(latency_constraint_ns));
+	else
+		seq_printf(m, "constraint_us none\n");
+
+	seq_printf(m, "\n%-14s", "#from_us");
+	for (type = 0; type < NR_LATENCY_TYPES; type++)
+		seq_printf(m, " %12s", latency_names[type]);
+	seq_printf(m, "\n");
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		seq_printf(m, "%-14lu", latency_bucket_us(i));
+		for (type = 0; type < NR_LATENCY_TYPES; type++)
+			seq_printf(m, " %12lu", sum[type].count[i]);
+		seq_printf(m, "\n");
+	}
+
+	seq_printf(m, "%-14s", "max_us");
+	for (type = 0; type < NR_LATENCY_TYPES; type++)
+		seq_printf(m, " %12lu", latency_us(sum[type].max));
+	seq_printf(m, "\n%-14s", "avg_us");
+	for (type = 0; type < NR_LATENCY_TYPES; type++) {
+		unsigned long long avg = sum[type].total;
+
+		if (nr[type])
+			do_div(avg, nr[type]);
+		seq_printf(m, " %12lu", latency_us(avg));
+	}
+	seq_printf(m, "\n%-14s", "over_limit");
+	for (type = 0; type < NR_LATENCY_TYPES; type++)
+		seq_printf(m, " %12d", atomic_read(&latency_over[type]));
+	seq_printf(m, "\n");
+
+	for (type = 0; type < NR_LATENCY_TYPES; type++)
+		latency_show_worst(m, type);
+
+	return 0;
+}
+
+static void latency_hist_reset(void)
+{
+	struct task_struct *g, *p;
+	unsigned long flags;
+	int cpu, type;
+
+	for_each_possible_cpu(cpu) {
+		struct latency_cpu *lc = &per_cpu(latency_cpu, cpu);
+
+		memset(lc->hist, 0, sizeof(lc->hist));
+	}
+
+	raw_local_irq_save(flags);
+	__raw_spin_lock(&latency_worst_lock);
+	memset(latency_worst, 0, sizeof(latency_worst));
+	__raw_spin_unlock(&latency_worst_lock);
+	raw_local_irq_restore(flags);
+
+	for (type = 0; type < NR_LATENCY_TYPES; type++)
+		atomic_set(&latency_over[type], 0);
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, p) {
+		memset(&p->lat_wakeup, 0, sizeof(p->lat_wakeup));
+	} while_each_thread(g, p);
+	read_unlock(&tasklist_lock);
+}
+
+static void latency_hist_enable(int on)
+{
+	int cpu;
+
+	if (on && !latency_hist_enabled) {
+		/* drop sections left open when sampling was last stopped */
+		for_each_possible_cpu(cpu) {
+			struct latency_cpu *lc = &per_cpu(latency_cpu, cpu);
+
+			memset(lc->start, 0, sizeof(lc->start));
+		}
+		smp_wmb();
+	}
+	latency_hist_enabled = on;
+}
+
+static ssize_t latency_hist_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	char kbuf[8];
+	size_t len = min(count, sizeof(kbuf) - 1);
+
+	if (copy_from_user(kbuf, buf, len))
+		return -EFAULT;
+	kbuf[len] = '\0';
+
+	if (!strncmp(kbuf, "reset", 5))
+		latency_hist_reset();
+	else if (kbuf[0] == '1')
+		latency_hist_enable(1);
+	else if (kbuf[0] == '0')
+		latency_hist_enable(0);
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static int latency_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, latency_hist_show, NULL);
+}
+
+static const struct file_operations latency_hist_fops = {
+	.open		= latency_hist_open,
+	.read		= seq_read,
+	.write		= latency_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Track the strictest constraint announced through kernel/latency.c */
+static int latency_constraint_notify(struct notifier_block *nb,
+				     unsigned long val, void *data)
+{
+	int usecs = system_latency_constraint();
+
+	if (usecs >= INFINITE_LATENCY)
+		latency_constraint_ns = ~0ULL;
+	else
+		latency_constraint_ns = (unsigned long long)usecs * 1000;
+	return NOTIFY_OK;
+}
+
+static struct notifier_block latency_constraint_nb = {
+	.notifier_call	= latency_constraint_notify,
+};
+
+static int __init latency_hist_init(void)
+{
+	struct proc_dir_entry *entry;
+
+	latency_constraint_notify(NULL, 0, NULL);
+	register_latency_notifier(&latency_constraint_nb);
+
+	entry = create_proc_entry("latency_hist", S_IRUGO | S_IWUSR, NULL);
+	if (entry)
+		entry->proc_fops = &latency_hist_fops;
+	return 0;
+}
+__initcall(latency_hist_init);
@@ -1857,6 +1857,8 @@ void trace_hardirqs_on(void)
 	struct task_struct *curr = current;
 	unsigned long ip;
 
+	latency_hist_section_end(LATENCY_IRQSOFF, _RET_IP_);
+
 	if (unlikely(!debug_locks || current->lockdep_recursion))
 		return;
 
@@ -1904,6 +1906,8 @@ void trace_hardirqs_off(void)
 {
 	struct task_struct *curr = current;
 
+	latency_hist_section_start(LATENCY_IRQSOFF, _RET_IP_);
+
 	if (unlikely(!debug_locks || current->lockdep_recursion))
 		return;
 
@@ -293,6 +293,26 @@ static ssize_t state_store(struct subsystem * subsys, const char * buf, size_t n
 
 power_attr(state);
 
+/**
+ *	device_times - time taken by the last suspend and resume.
+ *
+ *	Totals first, then one line per slow device: bus id, 'a' if it
+ *	ran asynchronously, suspend and resume time in microseconds.
+ */
+
+static ssize_t device_times_show(struct subsystem * subsys, char * buf)
+{
+	return dpm_show_times(buf);
+}
+
+static struct subsys_attribute device_times_attr = {
+	.attr	= {
+		.name = "device_times",
+		.mode = 0444,
+	},
+	.show	= device_times_show,
+};
+
 #ifdef CONFIG_PM_TRACE
 int pm_trace_enabled;
 
@@ -317,12 +337,14 @@ power_attr(pm_trace);
 
 static struct attribute * g[] = {
 	&state_attr.attr,
+	&device_times_attr.attr,
 	&pm_trace_attr.attr,
 	NULL,
 };
 #else
 static struct attribute * g[] = {
 	&state_attr.attr,
+	&device_times_attr.attr,
 	NULL,
 };
 #endif /* CONFIG_PM_TRACE */
@@ -1543,6 +1543,7 @@ out_activate:
 
 
 	activate_task(p, rq, cpu == this_cpu);
+	latency_hist_wakeup(p);
 	/*
 	 * Sync wakeups (i.e. those types of wakeups where the waker
 	 * has indicated that it will leave the CPU in short order)
@@ -1610,6 +1611,10 @@ void fastcall sched_fork(struct task_struct *p, int clone_flags)
 	if (unlikely(sched_info_on()))
 		memset(&p->sched_info, 0, sizeof(p->sched_info));
 #endif
+#ifdef CONFIG_LATENCY_HIST
+	p->lat_wakeup_stamp = 0;
+	memset(&p->lat_wakeup, 0, sizeof(p->lat_wakeup));
+#endif
 #if defined(CONFIG_SMP) && defined(__ARCH_WANT_UNLOCKED_CTXSW)
 	p->oncpu = 0;
 #endif
@@ -3241,6 +3246,9 @@ void fastcall add_preempt_count(int val)
 	if (DEBUG_LOCKS_WARN_ON((preempt_count() < 0)))
 		return;
 	preempt_count() += val;
+	if (preempt_count() == val)
+		latency_hist_section_start(LATENCY_PREEMPTOFF,
+				(unsigned long)__builtin_return_address(0));
 	/*
 	 * Spinlock count overflowing soon?
 	 */
@@ -3263,6 +3271,9 @@ void fastcall sub_preempt_count(int val)
 			!(preempt_count() & PREEMPT_MASK)))
 		return;
 
+	if (preempt_count() == val)
+		latency_hist_section_end(LATENCY_PREEMPTOFF,
+				(unsigned long)__builtin_return_address(0));
 	preempt_count() -= val;
 }
 EXPORT_SYMBOL(sub_preempt_count);
@@ -3413,6 +3424,7 @@ switch_tasks:
 
 	sched_info_switch(prev, next);
 	if (likely(prev != next)) {
+		latency_hist_switch(prev, next, now);
 		next->timestamp = next->last_ran = now;
 		rq->nr_switches++;
 		rq->curr = next;
@@ -31,6 +31,12 @@
  * Display the information collected so far:
  * # cat /proc/timer_stats
  *
+ * Each line is one timer: its expiry count, the pid and comm of the task
+ * that armed it, the function that armed it and (in brackets) the expiry
+ * callback.  A 'D' after the count marks a deferrable timer, which never
+ * wakes an idle CPU on its own; every other line is a potential wakeup
+ * source.
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
  * published by the Free Software Foundation.
@@ -68,6 +74,7 @@ struct entry {
 	 * Number of timeout events:
 	 */
 	unsigned long		count;
+	unsigned int		timer_flag;
 
 	/*
 	 * We save the command-line string to preserve
@@ -154,7 +161,8 @@ static int match_entries(struct entry *entry1, struct entry *entry2)
 	return entry1->timer       == entry2->timer	  &&
 	       entry1->start_func  == entry2->start_func  &&
 	       entry1->expire_func == entry2->expire_func &&
-	       entry1->pid	   == entry2->pid;
+	       entry1->pid	   == entry2->pid	  &&
+	       entry1->timer_flag  == entry2->timer_flag;
 }
 
 /*
@@ -222,12 +230,14 @@ static struct entry *tstat_lookup(struct entry *entry, char *comm)
  * @startf:	pointer to the function which did the timer setup
  * @timerf:	pointer to the timer callback function of the timer
  * @comm:	name of the process which set up the timer
+ * @timer_flag:	TIMER_STATS_FLAG_xxx of the timer
  *
  * When the timer is already registered, then the event counter is
  * incremented. Otherwise the timer is registered in a free slot.
  */
 void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
-			      void *timerf, char * comm)
+			      void *timerf, char *comm,
+			      unsigned int timer_flag)
 {
 	/*
 	 * It doesnt matter which lock we take:
@@ -240,6 +250,7 @@ void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
 	input.start_func = startf;
 	input.expire_func = timerf;
 	input.pid = pid;
+	input.timer_flag = timer_flag;
 
 	spin_lock_irqsave(lock, flags);
 	if (!active)
@@ -274,7 +285,7 @@ static int tstats_show(struct seq_file *m, void *v)
 	struct timespec period;
 	struct entry *entry;
 	unsigned long ms;
-	long events = 0;
+	long events = 0, deferred = 0;
 	ktime_t time;
 	int i;
 
@@ -290,7 +301,7 @@ static int tstats_show(struct seq_file *m, void *v)
 	period = ktime_to_timespec(time);
 	ms = period.tv_nsec / 1000000;
 
-	seq_puts(m, "Timer Stats Version: v0.1\n");
+	seq_puts(m, "Timer Stats Version: v0.2\n");
 	seq_printf(m, "Sample period: %ld.%03ld s\n", period.tv_sec, ms);
 	if (atomic_read(&overflow_count))
 		seq_printf(m, "Overflow: %d entries\n",
@@ -298,8 +309,14 @@ static int tstats_show(struct seq_file *m, void *v)
 
 	for (i = 0; i < nr_entries; i++) {
 		entry = entries + i;
-		seq_printf(m, "%4lu, %5d %-16s ",
+		if (entry->timer_flag & TIMER_STATS_FLAG_DEFERRABLE) {
+			seq_printf(m, "%4luD, %5d %-16s ",
+				entry->count, entry->pid, entry->comm);
+			deferred += entry->count;
+		} else {
+			seq_printf(m, "%5lu, %5d %-16s ",
 				entry->count, entry->pid, entry->comm);
+		}
 
 		print_name_offset(m, (unsigned long)entry->start_func);
 		seq_puts(m, " (");
@@ -318,6 +335,8 @@ static int tstats_show(struct seq_file *m, void *v)
 			   events / period.tv_sec, events * 1000 / ms);
 	else
 		seq_printf(m, "%ld total events\n", events);
+	seq_printf(m, "%ld deferrable, %ld potential wakeups\n",
+		   deferred, events - deferred);
 
 	mutex_unlock(&show_mutex);
 
@@ -9,10 +9,13 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/lab/lab.h>
 #include <linux/lab/commands.h>
 
 struct lab_cmdlist* cmdlist = NULL;
+/* commands may be registered from parallel initcall threads */
+static DEFINE_MUTEX(cmdlist_mutex);
 void lab_command_help(int,const char**);
 
 void lab_cmdinit ()
@@ -30,6 +33,8 @@ void lab_cmdinit ()
 void lab_addcommand (char *cmd, void (*func)(int, const char **), char *help)
 {
 	struct lab_cmdlist *mylist;
+
+	mutex_lock(&cmdlist_mutex);
 	mylist = cmdlist;
 
 	if (mylist == NULL) {
@@ -40,6 +45,7 @@ void lab_addcommand (char *cmd, void (*func)(int, const char **), char *help)
 	while (mylist) {
 		if (!strcmp(cmd, mylist->command->cmdname)) {
 			if (mylist->command->func) {
+				mutex_unlock(&cmdlist_mutex);
 				printk (KERN_NOTICE "lab: tried to insert command %s, but it already exists!\n", cmd);
 				return;
 			} else
@@ -64,6 +70,7 @@ void lab_addcommand (char *cmd, void (*func)(int, const char **), char *help)
 justset:
 	mylist->command->func = func;
 	mylist->command->help = help;
+	mutex_unlock(&cmdlist_mutex);
 
 	printk(KERN_NOTICE "lab: loaded command %s\n", cmd);
 }
@@ -71,12 +78,16 @@ EXPORT_SYMBOL(lab_addcommand);
 
 void lab_delcommand (char* cmd)
 {
-	struct lab_cmdlist *mylist = cmdlist;
+	struct lab_cmdlist *mylist;
 	struct lab_cmdlist *lastsc = NULL;
 	struct lab_cmdlist *prevcmd = NULL;
 
-	if (mylist == NULL)
+	mutex_lock(&cmdlist_mutex);
+	mylist = cmdlist;
+	if (mylist == NULL) {
+		mutex_unlock(&cmdlist_mutex);
 		return;
+	}
 
 	while (mylist) {
 		if (mylist->command && mylist->command->cmdname)
@@ -88,6 +99,7 @@ void lab_delcommand (char* cmd)
 	}
 
 	if (!mylist) {
+		mutex_unlock(&cmdlist_mutex);
 		printk(KERN_NOTICE "lab: tried to delete command %s, but it doesn't exist!\n", cmd);
 		return;
 	}
@@ -113,10 +125,11 @@ void lab_delcommand (char* cmd)
 	if (prevcmd)
 		prevcmd->next = mylist->next;
 	kfree(mylist);
+	mutex_unlock(&cmdlist_mutex);
 }
 EXPORT_SYMBOL(lab_delcommand);
 
-void lab_addsubcommand(char* cmd, char* cmd2, void(*func)(int,const char**), char* help)
+static void __lab_addsubcommand(char* cmd, char* cmd2, void(*func)(int,const char**), char* help)
 {
 	struct lab_cmdlist* mylist;
 	mylist = cmdlist;
@@ -190,12 +203,23 @@ void lab_addsubcommand(char* cmd, char* cmd2, void(*func)(int,const char**), cha
 	mylist->command->subcmd = NULL;
 	printk(KERN_NOTICE "lab: loaded command [%s]%s\n", cmd, cmd2);
 }
+
+void lab_addsubcommand(char* cmd, char* cmd2, void(*func)(int,const char**), char* help)
+{
+	mutex_lock(&cmdlist_mutex);
+	__lab_addsubcommand(cmd, cmd2, func, help);
+	mutex_unlock(&cmdlist_mutex);
+}
 EXPORT_SYMBOL(lab_addsubcommand);
 
-void lab_execcommand(int argc, char** argv)
+/*
+ * Returns 0 if the command succeeded, i.e. it didn't bump globfail.
+ */
+int lab_execcommand(int argc, char** argv)
 {
 	void(*func)(int,const char**);
 	struct lab_cmdlist* mylist;
+	int failures = globfail;
 
 	mylist = cmdlist;
 
@@ -240,16 +264,19 @@ void lab_execcommand(int argc, char** argv)
 breakout:
 	if ((int)func == 0) {
 		lab_printf ("Couldn't find command %s.\r\n", argv [0]);
-		return;
+		globfail++;
+		return 1;
 	}
 
 	if ((int)func == 1) {
 		lab_printf ("Couldn't find subcommand %s %s.\r\n",
 			    argv [0], argv [1]);
-		return;
+		globfail++;
+		return 1;
 	}
 
 	func (argc, (const char**)argv);
+	return globfail != failures;
 }
 
 void lab_command_help (int argc, const char **argv)
@@ -53,69 +53,6 @@ static void print_banner (void)
 	lab_puts ("This program is provided with NO WARRANTY under the terms of the\r\nGNU General Public License.\r\n");
 }
 
-enum ParseState {
-	PS_WHITESPACE,
-	PS_TOKEN,
-	PS_STRING,
-	PS_ESCAPE
-};
-
-static void parseargs (char *argstr, int *argc_p, char **argv, char **resid)
-{
-	int argc = 0;
-	char c;
-	enum ParseState lastState = PS_WHITESPACE;
-	enum ParseState stackedState = PS_WHITESPACE;
-
-	/* tokenize the argstr */
-	while ((c = *argstr) != 0) {
-		enum ParseState newState;
-
-		if ((c == ';' || c == '\n') && lastState != PS_STRING && lastState != PS_ESCAPE)
-			break;
-
-		if (lastState == PS_ESCAPE) {
-			newState = stackedState;
-		} else if (lastState == PS_STRING) {
-			if (c == '"') {
-				newState = PS_WHITESPACE;
-				*argstr = 0;
-			} else {
-				newState = PS_STRING;
-			}
-		} else if ((c == ' ') || (c == '\t')) {
-			/* whitespace character */
-			*argstr = 0;
-			newState = PS_WHITESPACE;
-		} else if (c == '"') {
-			newState = PS_STRING;
-			*argstr = 0;
-			argv[argc++] = argstr + 1;
-		} else if (c == '\\') {
-			stackedState = lastState;
-			newState = PS_ESCAPE;
-		} else {
-			/* token */
-			if (lastState == PS_WHITESPACE) {
-				argv[argc++] = argstr;
-			}
-			newState = PS_TOKEN;
-		}
-
-		lastState = newState;
-		argstr++;
-	}
-
-	argv [argc] = NULL;
-	if (argc_p != NULL)
-		*argc_p = argc;
-
-	if (*argstr == ';' || *argstr == '\n')
-		*argstr++ = 0;
-
-	*resid = argstr;
-}
-
 #if 0
 // Commented out until we find a use for it -- zap
 
@@ -173,24 +110,6 @@ static void unparseargs(char *argstr, int argc, const char **argv)
 }
 #endif
 
-void lab_exec_string (char *buf)
-{
-	int argc;
-	char *argv[256];
-	char *resid;
-
-	while (*buf) {
-		memset (argv, 0, sizeof (argv));
-		parseargs (buf, &argc, argv, &resid);
-		if (argc > 0)
-			lab_execcommand (argc, (char**) argv);
-		else
-			lab_exec_string ("help");
-		buf = resid;
-	}
-}
-EXPORT_SYMBOL (lab_exec_string);
-
 static char *blockdevs[] = {
 	"/dev/mmcblk0p1", "ext2",  "root=/dev/mmcblk0p1 rootdelay=5",
 	"/dev/mmcblk0p2", "ext2",  "root=/dev/mmcblk0p2 rootdelay=5",
@@ -209,14 +128,87 @@ static char *blockdevs[] = {
 };
 	
 
+/*
+ * What autoboot found out about each blockdevs[] entry.  Media that
+ * failed to mount or had nothing to boot is not probed again when
+ * autoboot is rerun from the command line.
+ */
+enum { MEDIA_UNPROBED, MEDIA_NOBOOT };
+static unsigned char mediastate [ARRAY_SIZE (blockdevs) / 3];
+
+static void lab_autoboot (void)
+{
+	char **blockdev;
+	struct stat sstat;
+	int i;
+
+	sys_mkdir("/mnt", 0000);
+	sys_mount("/dev", "/dev", "devfs", 0, "");
+	lab_puts (">> Looking for filesystems...\r\n");
+
+	for (blockdev = blockdevs, i = 0; *blockdev; blockdev += 3, i++) {
+		if (mediastate [i] == MEDIA_NOBOOT)
+			continue;
+
+		/* no device node, no media: don't even try to mount it */
+		if (sys_newstat(blockdev[0], &sstat) < 0)
+			continue;
+
+		lab_printf("  >> Trying \"%s\"... ", blockdev[0]);
+		if (sys_mount(blockdev[0], "/mnt", blockdev[1],
+		    MS_RDONLY, "") < 0) {
+			lab_printf("failed\r\n");
+			mediastate [i] = MEDIA_NOBOOT;
+			continue;
+		}
+
+		lab_printf("ok");
+
+		/* let labrun scripts know what we've found */
+		lab_setvar("bootdev", blockdev[0]);
+		lab_setvar("bootfstype", blockdev[1]);
+		lab_setvar("bootargs", blockdev[2]);
+
+		if (sys_newstat("/mnt/boot/labrun", &sstat) >= 0) {
+			lab_printf(".\r\n");
+			lab_printf(">> Executing labrun... ");
+			lab_runfile("fs", "/mnt/boot/labrun");
+			lab_printf("done\r\n");
+			return;
+		}
+		lab_printf("; no labrun");
+
+		if (sys_newstat("/mnt/boot/zImage", &sstat) >= 0) {
+			lab_printf("; found zImage\r\n");
+			lab_printf(">> Booting kernel.\r\n");
+			lab_armboot("fs", "/mnt/boot/zImage", blockdev[2], NULL);
+			sys_oldumount("/mnt");
+			return;
+		}
+		lab_printf(", no zImage.\r\n");
+		sys_oldumount("/mnt");
+		mediastate [i] = MEDIA_NOBOOT;
+	}
+
+	lab_unsetvar("bootdev");
+	lab_unsetvar("bootfstype");
+	lab_unsetvar("bootargs");
+	lab_printf(">> No bootable filesystems found!\r\n");
+	globfail++;
+}
+
+static void lab_cmd_autoboot (int argc, const char **argv)
+{
+	lab_autoboot ();
+}
+
 void lab_main (int cmdline)
 {
-	char cmdbuff [512];
+	char cmdbuff [1024];
+	int len;
 
 	print_banner ();
 	if (!cmdline) {
-		char **blockdev;
-		unsigned char *contents;
 		int tleft;
 		
 		for (tleft = 3; tleft > 0; tleft--)
@@ -237,58 +229,27 @@ void lab_main (int cmdline)
 		}
 		lab_puts ("\r\n"
 		          ">> Booting now.\r\n");
-		sys_mkdir("/mnt", 0000);
-		sys_mount("/dev", "/dev", "devfs", 0, "");
-		lab_puts (">> Looking for filesystems...\r\n");
-		blockdev = blockdevs;
-		while (*blockdev) {
-
-			struct stat sstat;
-
-			lab_printf("  >> Trying \"%s\"... ", blockdev[0]);
-			if (sys_mount(blockdev[0], "/mnt", blockdev[1],
-			    MS_RDONLY, "") < 0) {
-
-			    lab_printf("failed\r\n");
-			    blockdev += 3;
-			    continue;
-			}
-
-			lab_printf("ok");
-
-			if (sys_newstat("/mnt/boot/labrun", &sstat) >= 0) {
-				lab_printf(".\r\n");
-				lab_printf(">> Executing labrun... ");
-				lab_runfile("fs", "/mnt/boot/labrun");
-				lab_printf("done\r\n");
-				break;
-			}
-			lab_printf("; no labrun");
-
-			if (sys_newstat("/mnt/boot/zImage", &sstat) >= 0) {
-				lab_printf("; found zImage\r\n");
-				lab_printf(">> Copying zImage... ");
-				lab_copy("fs", "/mnt/boot/zImage", "fs", "/zImage");
-				lab_printf("done\r\n>> Unmounting filesystem... ");
-				sys_oldumount("/mnt");
-				lab_printf("done\r\n>> Booting kernel.\r\n");
-				lab_armboot("fs", "/zImage", blockdev[2]);
-				break;
-			}
-			lab_printf(", no zImage.\r\n");
-			sys_oldumount("/mnt");
-			blockdev += 3;
-			continue;
-		}
-		if (!*blockdev)
-			lab_printf(">> No bootable filesystems found!\r\n");
+		lab_autoboot ();
 	}
 
 domenu:
+	do_deferred_initcalls ();
+	lab_addcommand ("autoboot", lab_cmd_autoboot,
+			"Looks for a bootable filesystem and boots from it");
 	while (1) {
 		lab_puts("boot> ");
 		lab_readline (cmdbuff, sizeof cmdbuff);
 
+		/* keep reading until all if/while/for blocks are closed */
+		while (cmdbuff [0] && lab_script_depth (cmdbuff) > 0) {
+			len = strlen (cmdbuff);
+			if (len + 2 >= sizeof cmdbuff)
+				break;
+			cmdbuff [len++] = '\n';
+			lab_puts("> ");
+			lab_readline (cmdbuff + len, sizeof cmdbuff - len);
+		}
+
 		if (cmdbuff [0])
 			lab_exec_string (cmdbuff);
 	}
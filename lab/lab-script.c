@@ -0,0 +1,709 @@
+/*
+ * Linux As Bootloader command interpreter
+ *
+ * Scripts are lists of commands separated by newlines or ';'.  Besides
+ * plain commands the interpreter understands:
+ *
+ *	$NAME, ${NAME}		the value of a variable (see set/show/unset)
+ *	$?			the exit status of the last command
+ *	! COMMAND		inverts the exit status of COMMAND
+ *	if COMMAND ... [else ...] endif
+ *	while COMMAND ... endwhile
+ *	for NAME in WORDS ... endfor
+ *	break			leaves the innermost loop
+ *	exit [STATUS]		stops the script
+ *
+ * A command has failed when it bumped globfail, so every existing LAB
+ * command can be used as a condition.
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file COPYING in the main directory of this archive for
+ * more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/ctype.h>
+#include <linux/fs.h>
+#include <linux/stat.h>
+#include <linux/syscalls.h>
+#include <linux/lab/lab.h>
+#include <linux/lab/commands.h>
+
+#define LAB_MAXARGS		256
+#define LAB_LINE_MAX		1024
+#define LAB_MAXDEPTH		16
+
+enum ParseState {
+	PS_WHITESPACE,
+	PS_TOKEN,
+	PS_STRING,
+	PS_ESCAPE
+};
+
+/*
+ * Split one statement into argv[], which has room for maxargs words and
+ * the NULL.  Returns -E2BIG if the statement has more words than that;
+ * *resid is still moved past it.
+ */
+static int parseargs (char *argstr, int *argc_p, char **argv, int maxargs,
+		      char **resid)
+{
+	int argc = 0, toomany = 0;
+	char c;
+	enum ParseState lastState = PS_WHITESPACE;
+	enum ParseState stackedState = PS_WHITESPACE;
+
+	/* tokenize the argstr */
+	while ((c = *argstr) != 0) {
+		enum ParseState newState;
+
+		if ((c == ';' || c == '\n') && lastState != PS_STRING && lastState != PS_ESCAPE)
+			break;
+
+		if (lastState == PS_ESCAPE) {
+			newState = stackedState;
+		} else if (lastState == PS_STRING) {
+			if (c == '"') {
+				newState = PS_WHITESPACE;
+				*argstr = 0;
+			} else {
+				newState = PS_STRING;
+			}
+		} else if ((c == ' ') || (c == '\t')) {
+			/* whitespace character */
+			*argstr = 0;
+			newState = PS_WHITESPACE;
+		} else if (c == '"') {
+			newState = PS_STRING;
+			*argstr = 0;
+			if (argc < maxargs)
+				argv[argc++] = argstr + 1;
+			else
+				toomany = 1;
+		} else if (c == '\\') {
+			stackedState = lastState;
+			newState = PS_ESCAPE;
+		} else {
+			/* token */
+			if (lastState == PS_WHITESPACE) {
+				if (argc < maxargs)
+					argv[argc++] = argstr;
+				else
+					toomany = 1;
+			}
+			newState = PS_TOKEN;
+		}
+
+		lastState = newState;
+		argstr++;
+	}
+
+	argv [argc] = NULL;
+	if (argc_p != NULL)
+		*argc_p = argc;
+
+	if (*argstr == ';' || *argstr == '\n')
+		*argstr++ = 0;
+
+	*resid = argstr;
+	return toomany ? -E2BIG : 0;
+}
+
+/*********************************************************** Variables ******/
+
+struct lab_var {
+	char *name;
+	char *value;
+	struct lab_var *next;
+};
+
+static struct lab_var *varlist;
+static int laststatus;
+
+static struct lab_var *lab_findvar (const char *name)
+{
+	struct lab_var *var;
+
+	for (var = varlist; var; var = var->next)
+		if (!strcmp (var->name, name))
+			return var;
+	return NULL;
+}
+
+const char *lab_getvar (const char *name)
+{
+	struct lab_var *var = lab_findvar (name);
+
+	return var ? var->value : NULL;
+}
+EXPORT_SYMBOL (lab_getvar);
+
+int lab_setvar (const char *name, const char *value)
+{
+	struct lab_var *var = lab_findvar (name);
+	char *newval;
+
+	newval = kmalloc (strlen (value) + 1, GFP_KERNEL);
+	if (!newval)
+		return -ENOMEM;
+	strcpy (newval, value);
+
+	if (!var) {
+		var = kmalloc (sizeof (struct lab_var) + strlen (name) + 1,
+			       GFP_KERNEL);
+		if (!var) {
+			kfree (newval);
+			return -ENOMEM;
+		}
+		var->name = (char *) (var + 1);
+		strcpy (var->name, name);
+		var->value = NULL;
+		var->next = varlist;
+		varlist = var;
+	}
+
+	kfree (var->value);
+	var->value = newval;
+	return 0;
+}
+EXPORT_SYMBOL (lab_setvar);
+
+void lab_unsetvar (const char *name)
+{
+	struct lab_var **pvar, *var;
+
+	for (pvar = &varlist; (var = *pvar) != NULL; pvar = &var->next)
+		if (!strcmp (var->name, name)) {
+			*pvar = var->next;
+			kfree (var->value);
+			kfree (var);
+			return;
+		}
+}
+EXPORT_SYMBOL (lab_unsetvar);
+
+static int isvarchar (char c)
+{
+	return isalnum (c) || c == '_';
+}
+
+static int isvarname (const char *name)
+{
+	if (!*name || isdigit (*name))
+		return 0;
+	while (*name)
+		if (!isvarchar (*name++))
+			return 0;
+	return 1;
+}
+
+/* Expand the variable references in src into dst, -1 if it doesn't fit */
+static int expand (const char *src, char *dst, int size)
+{
+	char name [64], status [12];
+	const char *val;
+	int len = 0, n, brace;
+
+	while (*src) {
+		if (src [0] == '\\' && src [1] == '$') {
+			val = "$";
+			src += 2;
+		} else if (src [0] != '$' || !src [1]) {
+			if (len + 1 >= size)
+				return -1;
+			dst [len++] = *src++;
+			continue;
+		} else if (src [1] == '?') {
+			sprintf (status, "%d", laststatus);
+			val = status;
+			src += 2;
+		} else {
+			src++;
+			brace = (*src == '{');
+			if (brace)
+				src++;
+			for (n = 0; isvarchar (*src) && n < sizeof (name) - 1; n++)
+				name [n] = *src++;
+			name [n] = 0;
+			if (brace && *src == '}')
+				src++;
+			val = n ? lab_getvar (name) : "$";
+		}
+
+		if (val) {
+			n = strlen (val);
+			if (len + n >= size)
+				return -1;
+			memcpy (dst + len, val, n);
+			len += n;
+		}
+	}
+
+	dst [len] = 0;
+	return len;
+}
+
+/*********************************************************** Scripts ********/
+
+struct lab_stmt {
+	int argc;
+	char **argv;
+};
+
+struct lab_script {
+	char *text;
+	struct lab_stmt *stmt;
+	int nstmt;
+	int brk;		/* leave the innermost loop */
+	int quit;		/* leave the script */
+};
+
+static const char *blocks [][2] = {
+	{ "if",    "endif" },
+	{ "while", "endwhile" },
+	{ "for",   "endfor" },
+};
+
+static int block_open (const char *kw)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE (blocks); i++)
+		if (!strcmp (kw, blocks [i][0]))
+			return i;
+	return -1;
+}
+
+static int block_close (const char *kw)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE (blocks); i++)
+		if (!strcmp (kw, blocks [i][1]))
+			return i;
+	return -1;
+}
+
+static void lab_script_free (struct lab_script *s)
+{
+	int i;
+
+	for (i = 0; i < s->nstmt; i++)
+		kfree (s->stmt [i].argv);
+	kfree (s->stmt);
+	vfree (s->text);
+}
+
+/* Split the text into statements; the argv[] point into s->text */
+static int lab_script_parse (struct lab_script *s, const char *buf)
+{
+	char *argv [LAB_MAXARGS + 1];
+	char *p, *resid;
+	int argc, max = 0;
+
+	memset (s, 0, sizeof (*s));
+	s->text = vmalloc (strlen (buf) + 1);
+	if (!s->text)
+		return -ENOMEM;
+	strcpy (s->text, buf);
+
+	for (p = s->text; *p; p = resid) {
+		struct lab_stmt *st;
+
+		if (parseargs (p, &argc, argv, LAB_MAXARGS, &resid))
+			return -E2BIG;
+		if (argc == 0)
+			continue;
+
+		if (s->nstmt == max) {
+			st = kmalloc ((max + 32) * sizeof (*st), GFP_KERNEL);
+			if (!st)
+				return -ENOMEM;
+			if (s->stmt) {
+				memcpy (st, s->stmt, max * sizeof (*st));
+				kfree (s->stmt);
+			}
+			s->stmt = st;
+			max += 32;
+		}
+
+		st = &s->stmt [s->nstmt];
+		st->argv = kmalloc ((argc + 1) * sizeof (char *), GFP_KERNEL);
+		if (!st->argv)
+			return -ENOMEM;
+		memcpy (st->argv, argv, (argc + 1) * sizeof (char *));
+		st->argc = argc;
+		s->nstmt++;
+	}
+
+	return 0;
+}
+
+/*
+ * Check that the blocks are properly nested.  Returns the number of
+ * blocks still open at the end, or -1 on a syntax error.
+ */
+static int lab_script_check (struct lab_script *s, int report)
+{
+	int stack [LAB_MAXDEPTH];
+	int depth = 0, pc, b;
+
+	for (pc = 0; pc < s->nstmt; pc++) {
+		const char *kw = s->stmt [pc].argv [0];
+
+		if ((b = block_open (kw)) >= 0) {
+			if (depth == LAB_MAXDEPTH) {
+				if (report)
+					lab_puts ("lab: blocks nested too deep\r\n");
+				return -1;
+			}
+			stack [depth++] = b;
+		} else if ((b = block_close (kw)) >= 0) {
+			if (!depth || stack [depth - 1] != b) {
+				if (report)
+					lab_printf ("lab: unexpected \"%s\"\r\n", kw);
+				return -1;
+			}
+			depth--;
+		} else if (!strcmp (kw, "else")) {
+			if (!depth || stack [depth - 1] != 0) {
+				if (report)
+					lab_puts ("lab: \"else\" without \"if\"\r\n");
+				return -1;
+			}
+		}
+	}
+
+	return depth;
+}
+
+/* Find the end of the block opened at pc and the "else" belonging to it */
+static int lab_script_match (struct lab_script *s, int pc, int *elsepc)
+{
+	int depth = 0;
+
+	*elsepc = -1;
+	for (pc++; pc < s->nstmt; pc++) {
+		const char *kw = s->stmt [pc].argv [0];
+
+		if (block_open (kw) >= 0)
+			depth++;
+		else if (block_close (kw) >= 0) {
+			if (!depth)
+				return pc;
+			depth--;
+		} else if (!depth && !strcmp (kw, "else"))
+			*elsepc = pc;
+	}
+
+	/* lab_script_check() makes sure we never get here */
+	return s->nstmt;
+}
+
+/* Ctrl-C on the console stops a running loop */
+static int lab_script_interrupted (void)
+{
+	return lab_char_ready () && lab_get_char () == 3;
+}
+
+/* Expand and run a single command, returning its exit status */
+static int lab_script_cmd (struct lab_script *s, int argc, char **argv)
+{
+	char *xargv [LAB_MAXARGS + 1];
+	char *buf, *p;
+	int i, len, invert = 0, status;
+
+	if (argc && !strcmp (argv [0], "!")) {
+		invert = 1;
+		argc--;
+		argv++;
+	}
+	if (!argc)
+		return laststatus = invert;
+
+	buf = kmalloc (LAB_LINE_MAX, GFP_KERNEL);
+	if (!buf) {
+		globfail++;
+		return laststatus = 1;
+	}
+
+	for (i = 0, p = buf; i < argc; i++) {
+		len = expand (argv [i], p, buf + LAB_LINE_MAX - p);
+		if (len < 0) {
+			lab_puts ("lab: command too long after expansion\r\n");
+			kfree (buf);
+			globfail++;
+			return laststatus = 1;
+		}
+		xargv [i] = p;
+		p += len + 1;
+	}
+	xargv [argc] = NULL;
+
+	if (!strcmp (xargv [0], "break")) {
+		s->brk = 1;
+		status = 0;
+	} else if (!strcmp (xargv [0], "exit")) {
+		s->quit = 1;
+		status = argc > 1 ? simple_strtol (xargv [1], NULL, 0) : laststatus;
+	} else
+		status = lab_execcommand (argc, xargv);
+
+	kfree (buf);
+
+	if (invert)
+		status = !status;
+	return laststatus = status;
+}
+
+static void lab_script_run (struct lab_script *s, int pc, int end);
+
+static void lab_script_for (struct lab_script *s, int pc, int end)
+{
+	struct lab_stmt *st = &s->stmt [pc];
+	char *buf, *word, *next;
+	int i;
+
+	if (st->argc < 3 || strcmp (st->argv [2], "in") ||
+	    !isvarname (st->argv [1])) {
+		lab_puts ("for: syntax: for NAME in WORDS... endfor\r\n");
+		globfail++;
+		laststatus = 1;
+		return;
+	}
+
+	buf = kmalloc (LAB_LINE_MAX, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (i = 3; i < st->argc && !s->brk && !s->quit; i++) {
+		if (expand (st->argv [i], buf, LAB_LINE_MAX) < 0)
+			break;
+
+		/* a variable may hold a whole list of words */
+		for (word = buf; *word && !s->brk && !s->quit; word = next) {
+			while (*word == ' ' || *word == '\t')
+				word++;
+			if (!*word)
+				break;
+			for (next = word; *next && *next != ' ' && *next != '\t'; next++)
+				;
+			if (*next)
+				*next++ = 0;
+
+			lab_setvar (st->argv [1], word);
+			lab_script_run (s, pc + 1, end);
+		}
+	}
+	s->brk = 0;
+
+	kfree (buf);
+}
+
+static void lab_script_run (struct lab_script *s, int pc, int end)
+{
+	while (pc < end && !s->brk && !s->quit) {
+		struct lab_stmt *st = &s->stmt [pc];
+		const char *kw = st->argv [0];
+		int close, elsepc;
+
+		if (!strcmp (kw, "if")) {
+			close = lab_script_match (s, pc, &elsepc);
+			if (!lab_script_cmd (s, st->argc - 1, st->argv + 1))
+				lab_script_run (s, pc + 1,
+						elsepc >= 0 ? elsepc : close);
+			else if (elsepc >= 0)
+				lab_script_run (s, elsepc + 1, close);
+			pc = close + 1;
+		} else if (!strcmp (kw, "while")) {
+			close = lab_script_match (s, pc, &elsepc);
+			while (!s->quit &&
+			       !lab_script_cmd (s, st->argc - 1, st->argv + 1)) {
+				lab_script_run (s, pc + 1, close);
+				if (s->brk || lab_script_interrupted ())
+					break;
+			}
+			s->brk = 0;
+			pc = close + 1;
+		} else if (!strcmp (kw, "for")) {
+			close = lab_script_match (s, pc, &elsepc);
+			lab_script_for (s, pc, close);
+			pc = close + 1;
+		} else {
+			lab_script_cmd (s, st->argc, st->argv);
+			pc++;
+		}
+	}
+}
+
+/*
+ * Run a script, returning the exit status of the last command.  The
+ * buffer is left untouched.
+ */
+int lab_exec_string (char *buf)
+{
+	struct lab_script s;
+	int err;
+
+	err = lab_script_parse (&s, buf);
+	if (err == -E2BIG)
+		lab_puts ("lab: too many arguments\r\n");
+	if (!err) {
+		err = lab_script_check (&s, 1);
+		if (err > 0)
+			lab_puts ("lab: unterminated block\r\n");
+	}
+
+	if (err) {
+		globfail++;
+		laststatus = 1;
+	} else
+		lab_script_run (&s, 0, s.nstmt);
+
+	lab_script_free (&s);
+	return laststatus;
+}
+EXPORT_SYMBOL (lab_exec_string);
+
+/*
+ * Returns the number of blocks left open by buf, so the command line can
+ * keep reading lines until an "if" or a loop is complete.
+ */
+int lab_script_depth (const char *buf)
+{
+	struct lab_script s;
+	int depth = 0;
+
+	if (!lab_script_parse (&s, buf))
+		depth = lab_script_check (&s, 0);
+	lab_script_free (&s);
+	return depth;
+}
+EXPORT_SYMBOL (lab_script_depth);
+
+/*********************************************************** Commands *******/
+
+static void lab_cmd_show (int argc, const char **argv);
+
+static void lab_cmd_set (int argc, const char **argv)
+{
+	char *value;
+	int i, len = 0;
+
+	if (argc < 2) {
+		lab_cmd_show (argc, argv);
+		return;
+	}
+
+	if (!isvarname (argv [1])) {
+		lab_printf ("set: invalid variable name \"%s\"\r\n", argv [1]);
+		globfail++;
+		return;
+	}
+
+	value = kmalloc (LAB_LINE_MAX, GFP_KERNEL);
+	if (!value) {
+		globfail++;
+		return;
+	}
+
+	/* the remaining arguments make up the value */
+	value [0] = 0;
+	for (i = 2; i < argc; i++) {
+		int n = strlen (argv [i]);
+
+		if (len + n + 2 > LAB_LINE_MAX) {
+			lab_puts ("set: value too long\r\n");
+			globfail++;
+			kfree (value);
+			return;
+		}
+		if (i > 2)
+			value [len++] = ' ';
+		memcpy (value + len, argv [i], n + 1);
+		len += n;
+	}
+
+	if (lab_setvar (argv [1], value))
+		globfail++;
+	kfree (value);
+}
+
+static void lab_cmd_unset (int argc, const char **argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+		lab_unsetvar (argv [i]);
+}
+
+static void lab_cmd_show (int argc, const char **argv)
+{
+	struct lab_var *var;
+	int i;
+
+	if (argc < 2) {
+		for (var = varlist; var; var = var->next)
+			lab_printf ("%s=%s\r\n", var->name, var->value);
+		return;
+	}
+
+	for (i = 1; i < argc; i++) {
+		var = lab_findvar (argv [i]);
+		if (!var) {
+			lab_printf ("show: %s is not set\r\n", argv [i]);
+			globfail++;
+			continue;
+		}
+		lab_printf ("%s=%s\r\n", var->name, var->value);
+	}
+}
+
+static void lab_cmd_echo (int argc, const char **argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+		lab_printf (i > 1 ? " %s" : "%s", argv [i]);
+	lab_puts ("\r\n");
+}
+
+static void lab_cmd_true (int argc, const char **argv)
+{
+}
+
+static void lab_cmd_false (int argc, const char **argv)
+{
+	globfail++;
+}
+
+static void lab_cmd_exists (int argc, const char **argv)
+{
+	struct stat sstat;
+
+	if (argc != 2) {
+		lab_puts ("exists: syntax: exists path\r\n");
+		globfail++;
+		return;
+	}
+
+	if (sys_newstat ((char *) argv [1], &sstat) < 0)
+		globfail++;
+}
+
+static int lab_script_init (void)
+{
+	lab_addcommand ("set", lab_cmd_set, "Sets a variable: set name [value...]");
+	lab_addcommand ("unset", lab_cmd_unset, "Removes variables");
+	lab_addcommand ("show", lab_cmd_show, "Shows variables");
+	lab_addcommand ("echo", lab_cmd_echo, "Prints its arguments");
+	lab_addcommand ("true", lab_cmd_true, "Does nothing, successfully");
+	lab_addcommand ("false", lab_cmd_false, "Does nothing, unsuccessfully");
+	lab_addcommand ("exists", lab_cmd_exists, "Succeeds if a file or device exists");
+	return 0;
+}
+device_initcall(lab_script_init);
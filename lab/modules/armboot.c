@@ -16,6 +16,11 @@
 #include <linux/mm.h>
 #include <linux/vmalloc.h>
 #include <linux/fs.h>
+#ifdef CONFIG_ARMBOOT_KEXEC
+#include <linux/kexec.h>
+#include <linux/reboot.h>
+#include <linux/syscalls.h>
+#endif
 
 #include <asm/types.h>
 #include <asm/setup.h>
@@ -53,39 +58,19 @@ struct physlist {		// 128bit == 16byte
 	int	last;		// is this the last block?
 };
 
+/* Where the new kernel and its initrd go, relative to MEMSTART */
+#define ZIMAGE_OFFSET	0x00008000
+#define INITRD_OFFSET	0x00800000	/* well above the decompressed kernel */
+
 extern void armboot_asm(int listaddr, int myaddr, int rambase, int machtype);
 void(*armboot_ptr)(int listaddr, int myaddr, int rambase, int machtype);
 
 extern char* relocdone;
 
-/* This shouldn't return. */
-int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline)
+/* Fill in the tagged list for the new kernel; returns the end of it. */
+static struct tag *armboot_tags(struct tag *t, unsigned char *cmdline,
+				int initrd_size)
 {
-	struct physlist* addrmap;
-	struct tag* t;
-	unsigned int* asmaddr;
-	int mappos;
-	unsigned int kernaddr;
-	
-	/* At this point, we will allocate 64k for a list of things that need to be mapped later. */
-	addrmap = (struct physlist*)kmalloc(64 * 1024, GFP_KERNEL);
-	if (!addrmap)
-		return -ENOMEM;
-	
-	/* We start at the first element of the map. */
-	mappos = 0;
-	
-	/* Now we need to allocate 64kbytes for our tagged list. */
-	t = (struct tag*)kmalloc(64*1024, GFP_KERNEL);
-	if (!t)
-		return -ENOMEM;
-	
-	/* Set up our tagged list reloc block. */
-	addrmap[mappos].physaddr = virt_to_phys(t);
-	addrmap[mappos].newphysaddr = TAGBASE;
-	addrmap[mappos].last = 0;
-	
-	/* Now set up the tagged list. */
 	t->hdr.tag = ATAG_CORE;
 	t->hdr.size = tag_size(tag_core);
 	t->u.core.flags = 0;
@@ -105,20 +90,87 @@ int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline)
 	t->u.mem.size = (num_physpages >> (20-PAGE_SHIFT)) * 1024*1024;
 	t->u.mem.start = MEMSTART;
 	t = tag_next(t);
+
+	if (initrd_size) {
+		t->hdr.tag = ATAG_INITRD2;
+		t->hdr.size = tag_size(tag_initrd);
+		t->u.initrd.start = MEMSTART + INITRD_OFFSET;
+		t->u.initrd.size = initrd_size;
+		t = tag_next(t);
+	}
 	
 	t->hdr.tag = ATAG_NONE;
 	t->hdr.size = 0;
 	t = tag_next(t);
-	
-	/* Now just fill in the size, and we can begin relocating the kernel. */
-	addrmap[mappos].size = virt_to_phys(t) - addrmap[mappos].physaddr;
-	mappos++;
-	
-	kernaddr = MEMSTART+0x8000;
-	
-	printk(KERN_EMERG "armboot: Placing new kernel into temporary RAM...\n");
-	
-	/* Begin relocating. We're going to have to trust that the kernel won't give us any addresses in the first few megs of RAM. */
+
+	return t;
+}
+
+#ifdef CONFIG_ARMBOOT_KEXEC
+
+/*
+ * Hand the images to kexec.  It copies them straight into the pages they
+ * will run from wherever those are free, so there is no intermediate
+ * copy and the relocation stub only has to move the pages that are still
+ * in use by this kernel.  Devices are shut down by kernel_kexec() through
+ * the reboot path before we jump.
+ */
+static int armboot_kexec(unsigned char *kerneladdr, int size,
+			 unsigned char *initrd, int initrd_size,
+			 unsigned char *cmdline)
+{
+	struct kexec_segment segs[3];
+	unsigned long tagpage;
+	int nsegs = 0;
+	long retval;
+
+	tagpage = get_zeroed_page(GFP_KERNEL);
+	if (!tagpage)
+		return -ENOMEM;
+
+	/* kexec wants whole pages, so the tags travel in RAM's first page */
+	armboot_tags((struct tag *)(tagpage + TAGBASE - MEMSTART), cmdline,
+		     initrd ? initrd_size : 0);
+	segs[nsegs].buf = (void __user *)tagpage;
+	segs[nsegs].bufsz = PAGE_SIZE;
+	segs[nsegs].mem = MEMSTART;
+	segs[nsegs].memsz = PAGE_SIZE;
+	nsegs++;
+
+	segs[nsegs].buf = (void __user *)kerneladdr;
+	segs[nsegs].bufsz = size;
+	segs[nsegs].mem = MEMSTART + ZIMAGE_OFFSET;
+	segs[nsegs].memsz = PAGE_ALIGN(size);
+	nsegs++;
+
+	if (initrd) {
+		segs[nsegs].buf = (void __user *)initrd;
+		segs[nsegs].bufsz = initrd_size;
+		segs[nsegs].mem = MEMSTART + INITRD_OFFSET;
+		segs[nsegs].memsz = PAGE_ALIGN(initrd_size);
+		nsegs++;
+	}
+
+	printk(KERN_EMERG "armboot: Loading new kernel into place...\n");
+	retval = sys_kexec_load(MEMSTART + ZIMAGE_OFFSET, nsegs,
+				(struct kexec_segment __user *)segs,
+				KEXEC_ARCH_DEFAULT);
+	free_page(tagpage);
+	if (retval)
+		return retval;
+
+	printk(KERN_EMERG "armboot: Booting new kernel...\n");
+	return sys_reboot(LINUX_REBOOT_MAGIC1, LINUX_REBOOT_MAGIC2,
+			  LINUX_REBOOT_CMD_KEXEC, NULL);
+}
+
+#else
+
+/* Queue an image for relocation to dest in 64k blocks. */
+static int armboot_add_blocks(struct physlist *addrmap, int *mappos,
+			      unsigned char *data, int size,
+			      unsigned int dest)
+{
 	while(size)
 	{
 		int relocsize;
@@ -134,18 +186,67 @@ int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline)
 			return -ENOMEM;
 		
 		/* Copy kernel into said block... */
-		memcpy(block, kerneladdr, relocsize);
+		memcpy(block, data, relocsize);
 		
 		/* Set up our allocation tables. */
-		addrmap[mappos].physaddr = virt_to_phys(block);
-		addrmap[mappos].newphysaddr = kernaddr;
-		addrmap[mappos].size = relocsize;
-		addrmap[mappos].last = 0;
+		addrmap[*mappos].physaddr = virt_to_phys(block);
+		addrmap[*mappos].newphysaddr = dest;
+		addrmap[*mappos].size = relocsize;
+		addrmap[*mappos].last = 0;
 		
-		mappos++;
-		kernaddr += relocsize;
-		kerneladdr += relocsize;
+		(*mappos)++;
+		dest += relocsize;
+		data += relocsize;
 	}
+
+	return 0;
+}
+
+static int armboot_relocate(unsigned char *kerneladdr, int size,
+			    unsigned char *initrd, int initrd_size,
+			    unsigned char *cmdline)
+{
+	struct physlist* addrmap;
+	struct tag* t;
+	unsigned int* asmaddr;
+	int mappos;
+	int retval;
+	
+	/* At this point, we will allocate 64k for a list of things that need to be mapped later. */
+	addrmap = (struct physlist*)kmalloc(64 * 1024, GFP_KERNEL);
+	if (!addrmap)
+		return -ENOMEM;
+	
+	/* We start at the first element of the map. */
+	mappos = 0;
+	
+	/* Now we need to allocate 64kbytes for our tagged list. */
+	t = (struct tag*)kmalloc(64*1024, GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	
+	/* Set up our tagged list reloc block. */
+	addrmap[mappos].physaddr = virt_to_phys(t);
+	addrmap[mappos].newphysaddr = TAGBASE;
+	addrmap[mappos].last = 0;
+	
+	/* Now set up the tagged list. */
+	t = armboot_tags(t, cmdline, initrd ? initrd_size : 0);
+	
+	/* Now just fill in the size, and we can begin relocating the kernel. */
+	addrmap[mappos].size = virt_to_phys(t) - addrmap[mappos].physaddr;
+	mappos++;
+	
+	printk(KERN_EMERG "armboot: Placing new kernel into temporary RAM...\n");
+	
+	/* Begin relocating. We're going to have to trust that the kernel won't give us any addresses in the first few megs of RAM. */
+	retval = armboot_add_blocks(addrmap, &mappos, kerneladdr, size,
+				    MEMSTART + ZIMAGE_OFFSET);
+	if (!retval && initrd)
+		retval = armboot_add_blocks(addrmap, &mappos, initrd,
+					    initrd_size, MEMSTART + INITRD_OFFSET);
+	if (retval)
+		return retval;
 	
 	addrmap[mappos-1].last = 1;
 	
@@ -157,11 +258,32 @@ int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline)
 	cpu_proc_fin ();
 
 	printk(KERN_EMERG "armboot: Booting new kernel...\n");
-	armboot_ptr(virt_to_phys(addrmap), ((int)&relocdone) - ((int)&armboot_asm) + virt_to_phys(asmaddr), MEMSTART+0x8000, machine_arch_type);
+	armboot_ptr(virt_to_phys(addrmap), ((int)&relocdone) - ((int)&armboot_asm) + virt_to_phys(asmaddr), MEMSTART+ZIMAGE_OFFSET, machine_arch_type);
 	
 	return 0;
 }
 
+#endif /* CONFIG_ARMBOOT_KEXEC */
+
+/* This shouldn't return. */
+int armboot_initrd(unsigned char* kerneladdr, int size,
+		   unsigned char* initrd, int initrd_size,
+		   unsigned char* cmdline)
+{
+#ifdef CONFIG_ARMBOOT_KEXEC
+	return armboot_kexec(kerneladdr, size, initrd, initrd_size, cmdline);
+#else
+	return armboot_relocate(kerneladdr, size, initrd, initrd_size, cmdline);
+#endif
+}
+
+EXPORT_SYMBOL(armboot_initrd);
+
+int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline)
+{
+	return armboot_initrd(kerneladdr, size, NULL, 0, cmdline);
+}
+
 EXPORT_SYMBOL(armboot);
 
 MODULE_AUTHOR("Joshua Wise");
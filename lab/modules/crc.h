@@ -30,28 +30,35 @@
 #define _CRC_H
 
 #include <linux/types.h>
+#include <linux/crc32.h>
+#include <linux/crc-itu-t.h>
 
-/* Constants used in generating the CRC tables: */
+struct mtd_info;
+struct lab_verify;
 
-#define CRC_TABLE_SIZE   (256)
-
-#define CRC16_POLYNOMIAL (0x1021)
-
-extern int crc16_init(void);
-extern unsigned short crc16_buf(unsigned char *buf, unsigned int length);
-extern unsigned short *crc16_table;
-
-extern const uint32_t crc32_table[256];
+/*
+ * The CRC engines themselves live in lib/ so LAB shares the slice-by-8
+ * code with the rest of the kernel: crc_itu_t() is the XMODEM/YMODEM
+ * CRC-16, crc32_le() the JFFS2 one.  Both take the previous value as
+ * seed, so a large image can be fed through in pieces.
+ */
 
 /* Return a 32-bit CRC of the contents of the buffer. */
-
 static inline uint32_t 
 crc32(uint32_t val, const void *ss, int len)
 {
-	const unsigned char *s = ss;
-        while (--len >= 0)
-                val = crc32_table[(val ^ *s++) & 0xff] ^ (val >> 8);
-        return val;
+	return crc32_le(val, ss, len);
 }
 
+/*
+ * Verify-after-write.  Blocks queued with lab_verify_queue() are read
+ * back and checked by a helper thread while the caller programs the
+ * next one; lab_verify_finish() waits for the queue to drain and
+ * returns the number of blocks that failed.
+ */
+extern struct lab_verify *lab_verify_start(struct mtd_info *mtd);
+extern void lab_verify_queue(struct lab_verify *v, loff_t ofs, size_t len,
+			     const unsigned char *src);
+extern int lab_verify_finish(struct lab_verify *v);
+
 #endif  /* !defined(_CRC_H) */
@@ -24,7 +24,9 @@
 
 extern struct lab_srclist* srclist;
 
-extern int armboot(unsigned char* kerneladdr, int size, unsigned char* cmdline);
+extern int armboot_initrd(unsigned char* kerneladdr, int size,
+			  unsigned char* initrd, int initrd_size,
+			  unsigned char* cmdline);
 void lab_cmd_armboot(int argc,const char** argv);
 
 int labarmboot_init(void)
@@ -38,11 +40,10 @@ void labarmboot_cleanup(void)
 	lab_delcommand("armboot");
 }
 
-void lab_armboot(char* source, char* sourcefile, char *cmdline)
+/* Fetch a whole file from a copy source */
+static unsigned char *lab_armboot_get(char *source, char *sourcefile, int *count)
 {
 	struct lab_srclist *mysrclist;
-	int count;
-	int retval;
 	unsigned char* data;
 	
 	mysrclist = srclist;
@@ -56,70 +57,106 @@ void lab_armboot(char* source, char* sourcefile, char *cmdline)
 	if (!mysrclist) {
 		lab_printf("Source [%s] does not exist.\r\n", source);
 		globfail++;
-		return;
-	}
-	
-	if (!strcmp(source,"fs") && !strncmp(sourcefile,"/fs",3)) {
-		lab_puts("It looks like you're booting something from /fs. I'll assume you meant to chroot into /fs first so that symlinks don't break.\r\n");
-		sys_chroot("/fs");
-		sourcefile += 3;
+		return NULL;
 	}
 	
 	if (!mysrclist->src->check(sourcefile)) {
 		lab_printf("Source [%s] rejected filename \"%s\".\r\n",
 			   source, sourcefile);
 		globfail++;
-		return;
+		return NULL;
 	}
 	
-	data = mysrclist->src->get(&count,sourcefile);
+	data = mysrclist->src->get(count,sourcefile);
 	if (!data) {
 		lab_puts("Error occured while getting file.\r\n");
 		globfail++;
-		return;
+		return NULL;
+	}
+
+	return data;
+}
+
+/* Split "device:file" in place; returns the file part or NULL */
+static char *lab_armboot_splitspec(char *spec)
+{
+	char *temp = spec;
+
+	while (*temp != ':' && *temp != '\0')
+		temp++;
+	if (*temp == '\0') {
+		lab_puts("Illegal filespec\r\n");
+		globfail++;
+		return NULL;
 	}
+	*temp = '\0';
+	return temp + 1;
+}
+
+void lab_armboot(char* source, char* sourcefile, char *cmdline, char *initrdspec)
+{
+	int count, initrd_size = 0;
+	int retval;
+	unsigned char *data, *initrd = NULL;
 	
+	if (!strcmp(source,"fs") && !strncmp(sourcefile,"/fs",3)) {
+		lab_puts("It looks like you're booting something from /fs. I'll assume you meant to chroot into /fs first so that symlinks don't break.\r\n");
+		sys_chroot("/fs");
+		sourcefile += 3;
+	}
+	
+	data = lab_armboot_get(source, sourcefile, &count);
+	if (!data)
+		return;
+
+	if (initrdspec) {
+		char *initrdfile = lab_armboot_splitspec(initrdspec);
+
+		if (initrdfile)
+			initrd = lab_armboot_get(initrdspec, initrdfile, &initrd_size);
+		if (!initrd) {
+			vfree(data);
+			return;
+		}
+	}
 	
 	printk("ARMBooting NOW: Cmdline %s\n", cmdline ? cmdline : "[none]");
-	retval = armboot(data, count, cmdline);
+	retval = armboot_initrd(data, count, initrd, initrd_size, cmdline);
 	printk(KERN_EMERG "ARMBoot failed to boot - system may be in an unstable state (return %d)\n", retval);
+	globfail++;
+	vfree(data);
+	if (initrd)
+		vfree(initrd);
 }
 EXPORT_SYMBOL(lab_armboot);
 
 void lab_cmd_armboot(int argc,const char** argv)
 {
-	char *temp;
 	char *source;
 	char *sourcefile;
 
-	if (argc < 2)
+	if (argc < 2 || argc > 4)
 	{
-		lab_puts("Usage: boot> armboot filespec [cmdline]\r\n"
+		lab_puts("Usage: boot> armboot filespec [cmdline [initrd-filespec]]\r\n"
 		         "filespec is device:[file]\r\n"
 		         "example: boot> armboot ymodem: \"console=ttyS1\"\r\n"
 		         "would receive data over ymodem, then boot it.\r\n");
+		globfail++;
 		return;
 	}
 	
-	temp = source = (char*)argv[1];
-	while (*temp != ':' && *temp != '\0')
-		temp++;
-	if (*temp == '\0')
-	{
-		lab_puts("Illegal filespec\r\n");
-		globfail++;
+	source = (char*)argv[1];
+	sourcefile = lab_armboot_splitspec(source);
+	if (!sourcefile)
 		return;
-	}
-	*temp = '\0';
-	temp++;
-	sourcefile = temp;
 
-	lab_armboot(source, sourcefile, argc == 3 ? argv[2] : NULL);
+	lab_armboot(source, sourcefile, argc >= 3 ? (char*)argv[2] : NULL,
+		    argc == 4 ? (char*)argv[3] : NULL);
 	
 }
 
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB armboot command module");
 MODULE_LICENSE("GPL");
-module_init(labarmboot_init);
+device_initcall_async(labarmboot_init);
 module_exit(labarmboot_cleanup);
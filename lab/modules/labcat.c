@@ -71,5 +71,5 @@ void lab_cmd_cat(int argc, const char** argv)
 MODULE_AUTHOR("Paul Sokolovsky");
 MODULE_DESCRIPTION("LAB cat Module");
 MODULE_LICENSE("GPL");
-module_init(labcat_init);
+deferred_initcall(labcat_init);
 module_exit(labcat_cleanup);
@@ -16,6 +16,7 @@
 #include <linux/unistd.h>
 #include <linux/ctype.h>
 #include <linux/vmalloc.h>
+#include <linux/mutex.h>
 #include <linux/lab/copy.h>
 #include <linux/lab/lab.h>
 #include <linux/lab/commands.h>
@@ -23,6 +24,8 @@
 struct lab_srclist* srclist;
 struct lab_destlist* destlist;
 struct lab_unlinklist* unlinklist;
+/* sources and destinations may register from parallel initcalls */
+static DEFINE_MUTEX(copylist_mutex);
 
 void lab_cmd_copy(int argc,const char** argv);
 void lab_cmd_unlink(int argc,const char** argv);
@@ -47,6 +50,7 @@ void lab_copy_addsrc(char* name, int(*check)(char* fn), unsigned char*(*get)(int
 {
 	struct lab_srclist *mylist;
 	
+	mutex_lock(&copylist_mutex);
 	mylist = srclist;
 	if (!mylist)
 	{
@@ -66,6 +70,7 @@ buildentry:
 	mylist->src->name = name;
 	mylist->src->check = check;
 	mylist->src->get = get;
+	mutex_unlock(&copylist_mutex);
 	
 	printk(KERN_NOTICE "lab: loaded copy source [%s]\n", name);
 }
@@ -75,6 +80,7 @@ void lab_copy_adddest(char* name, int(*check)(char* fn), int(*put)(int count,uns
 {
 	struct lab_destlist *mylist;
 	
+	mutex_lock(&copylist_mutex);
 	mylist = destlist;
 	if (!mylist)
 	{
@@ -94,6 +100,7 @@ buildentry:
 	mylist->dest->name = name;
 	mylist->dest->check = check;
 	mylist->dest->put = put;
+	mutex_unlock(&copylist_mutex);
 	
 	printk(KERN_NOTICE "lab: loaded copy destination [%s]\n", name);
 }
@@ -103,6 +110,7 @@ void lab_copy_addunlink(char* name, int(*check)(char* fn), int(*unlink)(char* fn
 {
 	struct lab_unlinklist *mylist;
 	
+	mutex_lock(&copylist_mutex);
 	mylist = unlinklist;
 	if (!mylist)
 	{
@@ -122,6 +130,7 @@ buildentry:
 	mylist->unlink->name = name;
 	mylist->unlink->check = check;
 	mylist->unlink->unlink = unlink;
+	mutex_unlock(&copylist_mutex);
 	
 	printk(KERN_NOTICE "lab: loaded unlink device [%s]\n", name);
 }
@@ -308,5 +317,5 @@ void lab_cmd_unlink(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy command module");
 MODULE_LICENSE("GPL");
-module_init(labcopy_init);
+device_initcall_async(labcopy_init);
 module_exit(labcopy_cleanup);
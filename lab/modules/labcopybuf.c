@@ -89,5 +89,5 @@ void labcopybuf_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy buf module");
 MODULE_LICENSE("GPL");
-module_init(labcopybuf_init);
+deferred_initcall(labcopybuf_init);
 module_exit(labcopybuf_cleanup);
@@ -51,5 +51,5 @@ void labcopydummy_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy dummy module");
 MODULE_LICENSE("GPL");
-module_init(labcopydummy_init);
+deferred_initcall(labcopydummy_init);
 module_exit(labcopydummy_cleanup);
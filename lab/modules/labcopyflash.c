@@ -18,18 +18,39 @@
 #include <linux/mtd/mtd.h>
 #include <linux/lab/lab.h>
 #include <linux/lab/copy.h>
+#include "crc.h"
 
-static int flashcheck(char* filename)
+/*
+ * Filenames are "N" or "verify:N", N being the MTD number.  Returns
+ * N, or -1 if the name is no good; verify is only accepted when the
+ * caller passes somewhere to put it.
+ */
+static int flashparse(char* filename, int* verify)
 {
-	struct mtd_info *mtd;
-	
+	if (!strncmp(filename, "verify:", 7)) {
+		if (!verify)
+			return -1;
+		*verify = 1;
+		filename += 7;
+	}
 	if (filename[1] != '\0')
-		return 0;
+		return -1;
 	if (filename[0] < '0')
-		return 0;
+		return -1;
 	if (filename[0] > '9')
+		return -1;
+	return filename[0]-'0';
+}
+
+static int flashcheck(char* filename)
+{
+	struct mtd_info *mtd;
+	int verify, num;
+	
+	num = flashparse(filename, &verify);
+	if (num < 0)
 		return 0;
-	mtd = get_mtd_device(NULL, filename[0]-'0');
+	mtd = get_mtd_device(NULL, num);
 	if (!mtd)
 		return 0;
 
@@ -55,14 +76,12 @@ static unsigned char* get(int* count, char* filename)
 {
 	struct mtd_info *mtd;
 	void* ptr;
+	int num;
 	
-	if (filename[1] != '\0')
+	num = flashparse(filename, NULL);
+	if (num < 0)
 		return 0;
-	if (filename[0] < '0')
-		return 0;
-	if (filename[0] > '9')
-		return 0;
-	mtd = get_mtd_device(NULL, filename[0]-'0');
+	mtd = get_mtd_device(NULL, num);
 	if (!mtd)
 		return 0;
 	if (mtd->type == MTD_ABSENT)
@@ -108,15 +127,14 @@ static int put(int count, unsigned char* data, char* filename)
 	struct erase_info erase;
 	DECLARE_WAITQUEUE(wait, current);
 	wait_queue_head_t wq;
-	int ret;
+	struct lab_verify* v = NULL;
+	int verify = 0;
+	int ret, num;
 	
-	if (filename[1] != '\0')
-		return 0;
-	if (filename[0] < '0')
+	num = flashparse(filename, &verify);
+	if (num < 0)
 		return 0;
-	if (filename[0] > '9')
-		return 0;
-	mtd = get_mtd_device(NULL, filename[0]-'0');
+	mtd = get_mtd_device(NULL, num);
 	if (!mtd)
 		return 0;
 	if (mtd->type == MTD_ABSENT)
@@ -189,6 +207,13 @@ unprodone:
 	}
 	lab_puts("\rErasing flash:\t\tdone                   \r\n");
 	
+	/* Block N is read back and checked while block N+1 is programmed. */
+	if (verify) {
+		v = lab_verify_start(mtd);
+		if (!v)
+			lab_puts("Couldn't start verify, writing without it.\r\n");
+	}
+	
 	addr = 0;
 	while (count)
 	{
@@ -201,16 +226,22 @@ unprodone:
 		
 		ret = MTD_WRITE(mtd, addr, wcount, &rlen, data);
 		if (!ret) {
+			lab_verify_queue(v, addr, rlen, data);
 			addr += rlen;
 			count -= rlen;
 			data += rlen;
 		} else {
 			lab_puts("error\r\n");
+			lab_verify_finish(v);
 			put_mtd_device(mtd);
 			return 0;
 		};
 	}
 	lab_puts("\rWriting flash:\t\tdone                   \r\n");	
+	if (lab_verify_finish(v)) {
+		put_mtd_device(mtd);
+		return 0;
+	}
 	put_mtd_device(mtd);
 
 	return 1;
@@ -231,5 +262,5 @@ void labcopyflash_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy flash module");
 MODULE_LICENSE("GPL");
-module_init(labcopyflash_init);
+deferred_initcall(labcopyflash_init);
 module_exit(labcopyflash_cleanup);
@@ -139,5 +139,5 @@ void labcopyfs_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy fs module");
 MODULE_LICENSE("GPL");
-module_init(labcopyfs_init);
+device_initcall_async(labcopyfs_init);
 module_exit(labcopyfs_cleanup);
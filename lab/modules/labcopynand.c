@@ -52,6 +52,7 @@ static struct nand_oobinfo none_oobinfo = {
  *  :autoplace:
  *  :oob:
  *  :start=0xfoobar:
+ *  :verify:
  * Mandatory to end with a flash number.
  * Example: copy ymodem: nand:jffs2:1
  */
@@ -91,6 +92,8 @@ static int putcheck(char* fname)
 			continue;
 		if (!strcmp(arg, "autoplace"))
 			continue;
+		if (!strcmp(arg, "verify"))
+			continue;
 		lab_printf("Unknown argument: %s\r\n", arg);
 		return 0;
 	}
@@ -103,7 +106,8 @@ static void erase_callback(struct erase_info *ei)
 	wake_up(wq);
 }
 
-static int put(int count, unsigned char* buf, char* fname)
+static int nand_put(int count, unsigned char* buf, char* fname,
+		    struct lab_verify** vp)
 {
 	struct jffs2_unknown_node cleanmarker;
 
@@ -126,6 +130,11 @@ static int put(int count, unsigned char* buf, char* fname)
 	int	wince = 0;
 	int	erase = 0;
 	int	autoplace = 0;
+	int	verify = 0;
+	
+	/* run of written pages not yet handed to the verifier */
+	int	vofs = 0, vlen = 0, plen;
+	unsigned char *vsrc = NULL, *psrc;
 	
 	int	retries = 0;
 	
@@ -173,6 +182,8 @@ static int put(int count, unsigned char* buf, char* fname)
 			erase = 1;
 		else if (!strcmp(arg, "autoplace"))
 			autoplace = 1;
+		else if (!strcmp(arg, "verify"))
+			verify = 1;
 		else if (!strcmp(arg, "wince"))
 		{
 			wince = 1;
@@ -194,6 +205,12 @@ static int put(int count, unsigned char* buf, char* fname)
 		return 0;
 	}
 
+	if (verify && (writeoob || noecc)) {
+		lab_puts("Can't verify raw or OOB writes.\r\n");
+		put_mtd_device(mtd);
+		return 0;
+	}
+	
 	rdat = count;
 
 	/* Make sure device page sizes are valid */
@@ -239,6 +256,12 @@ static int put(int count, unsigned char* buf, char* fname)
 	
 	blockstart = -1;
 	
+	if (verify) {
+		*vp = lab_verify_start(mtd);
+		if (!*vp)
+			lab_puts("Couldn't start verify, writing without it.\r\n");
+	}
+	
 	/* Get data from input and write to the device */
 	while(mtdoffset < mtd->size) {
 		int retlen;
@@ -310,7 +333,9 @@ static int put(int count, unsigned char* buf, char* fname)
 			mtd = NULL;
 			return 0;
 		}
-		memcpy(writebuf, buf, (rdat < mtd->oobblock) ? rdat : mtd->oobblock);
+		plen = (rdat < mtd->oobblock) ? rdat : mtd->oobblock;
+		psrc = buf;
+		memcpy(writebuf, buf, plen);
 		buf += mtd->oobblock;
 		rdat -= mtd->oobblock;
 		
@@ -355,6 +380,23 @@ writeretry:
 			return 0;
 		}
 		
+		/*
+		 * Hand each finished eraseblock to the verifier, so it is
+		 * read back while the next one is being programmed.
+		 */
+		if (*vp) {
+			if (vlen && (vofs + vlen != mtdoffset ||
+				     !(mtdoffset & (mtd->erasesize - 1)))) {
+				lab_verify_queue(*vp, vofs, vlen, vsrc);
+				vlen = 0;
+			}
+			if (!vlen) {
+				vofs = mtdoffset;
+				vsrc = psrc;
+			}
+			vlen += plen;
+		}
+		
 		if (writeoob) {
 			if (rdat < mtd->oobsize) {
 				lab_puts("Out of data for OOB. Oops.\r\n");
@@ -378,6 +420,8 @@ writeretry:
 		mtdoffset += mtd->oobblock;
 	}
 
+	lab_verify_queue(*vp, vofs, vlen, vsrc);
+	
 	lab_puts("\r\nAll done. Closing the MTD device.");
 	/* Close the output file and MTD device */
 	put_mtd_device(mtd);
@@ -393,6 +437,17 @@ writeretry:
 	return 1;
 }
 
+static int put(int count, unsigned char* buf, char* fname)
+{
+	struct lab_verify* v = NULL;
+	int ret;
+	
+	ret = nand_put(count, buf, fname, &v);
+	if (lab_verify_finish(v))
+		ret = 0;
+	return ret;
+}
+
 int  labcopynand_init(void)
 {
 	lab_copy_adddest("nand",putcheck,put);
@@ -407,5 +462,5 @@ void labcopynand_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy nand module");
 MODULE_LICENSE("GPL");
-module_init(labcopynand_init);
+deferred_initcall(labcopynand_init);
 module_exit(labcopynand_cleanup);
@@ -45,5 +45,5 @@ void labcopyxmodem_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy xmodem module");
 MODULE_LICENSE("GPL");
-module_init(labcopyxmodem_init);
+deferred_initcall(labcopyxmodem_init);
 module_exit(labcopyxmodem_cleanup);
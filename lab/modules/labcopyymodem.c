@@ -58,5 +58,5 @@ void labcopyymodem_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB copy ymodem module");
 MODULE_LICENSE("GPL");
-module_init(labcopyymodem_init);
+deferred_initcall(labcopyymodem_init);
 module_exit(labcopyymodem_cleanup);
@@ -29,6 +29,8 @@
  * History:
  * ^^^^^^^^
  * 13 March, 2001 - created by separating from jffs.c and ymodem.c. (jd)
+ * The tables now live in lib/crc32.c and lib/crc-itu-t.c; this module
+ * keeps the verify-after-write helper and the crcbench command.
  *
  */
 
@@ -36,116 +38,295 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <linux/types.h>
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/mtd/mtd.h>
+#include <asm/checksum.h>
+#include <asm/div64.h>
 #include <linux/lab/lab.h>
+#include <linux/lab/commands.h>
 #include "crc.h"
 
-unsigned short *crc16_table = NULL;
-EXPORT_SYMBOL(crc16_table);
+struct lab_verify_blk {
+	struct list_head list;
+	loff_t ofs;
+	size_t len;
+	const unsigned char *src;
+};
+
+struct lab_verify {
+	struct mtd_info *mtd;
+	unsigned char *buf;
+	struct mutex mutex;	/* serialises use of buf and the counts */
+	spinlock_t lock;
+	struct list_head pending;
+	wait_queue_head_t wait;
+	struct completion exited;
+	int closing;
+	int checked;
+	int bad;
+};
 
-/* Generate the table of constants used in executing the CRC32 algorithm: */
-int crc16_init(void)
+/* Read one block back and compare its CRC32 with that of the source. */
+static void lab_verify_block(struct lab_verify *v, loff_t ofs, size_t len,
+			     const unsigned char *src)
 {
-	int i, j;
-	unsigned short crc;
-	if(crc16_table == NULL)
-	{
-		/* This table is currently _not_ freed: */
-		if((crc16_table = (unsigned short *)kmalloc(64*1024, GFP_KERNEL)) == NULL)
-			return -1;
-		for(i = 0; i < CRC_TABLE_SIZE; ++i)
-		{
-			crc = i << 8;
-			for(j = 8; j > 0; --j)
-			{
-				if(crc & 0x8000)
-					crc = (crc << 1) ^ CRC16_POLYNOMIAL;
-				else
-					crc <<= 1;
-			}
-			crc16_table[i] = crc;
+	u32 want, got = ~0;
+	size_t n, retlen;
+	loff_t pos = ofs;
+	int ret;
+
+	want = crc32_le(~0, src, len);
+	while (len) {
+		n = (len > PAGE_SIZE) ? PAGE_SIZE : len;
+		ret = v->mtd->read(v->mtd, pos, n, &retlen, v->buf);
+		if ((ret && ret != -EUCLEAN) || retlen != n) {
+			lab_printf("\r\nVerify: read error at %08X (%d)\r\n",
+				   (unsigned int)pos, ret);
+			v->bad++;
+			v->checked++;
+			return;
+		}
+		got = crc32_le(got, v->buf, n);
+		pos += n;
+		len -= n;
+	}
+	if (got != want) {
+		lab_printf("\r\nVerify: mismatch in block at %08X "
+			   "(crc %08X, expected %08X)\r\n",
+			   (unsigned int)ofs, ~got, ~want);
+		v->bad++;
+	}
+	v->checked++;
+}
+
+static int lab_verify_thread(void *arg)
+{
+	struct lab_verify *v = arg;
+	struct lab_verify_blk *blk;
+
+	for (;;) {
+		wait_event(v->wait, !list_empty(&v->pending) || v->closing);
+
+		spin_lock(&v->lock);
+		if (list_empty(&v->pending)) {
+			spin_unlock(&v->lock);
+			break;
 		}
+		blk = list_entry(v->pending.next, struct lab_verify_blk, list);
+		list_del(&blk->list);
+		spin_unlock(&v->lock);
+
+		mutex_lock(&v->mutex);
+		lab_verify_block(v, blk->ofs, blk->len, blk->src);
+		mutex_unlock(&v->mutex);
+		kfree(blk);
 	}
+	complete(&v->exited);
 	return 0;
 }
-EXPORT_SYMBOL(crc16_init);
-module_init(crc16_init);
 
-/* Perform a CRC16 computation over `buf'. This method was derived from
- * an algorithm (C) 1986 by Gary S. Brown, and was checked against an
- * implementation (C) 2000 by Compaq Computer Corporation, authored by
- * George France.
- */
-unsigned short crc16_buf(unsigned char *buf, unsigned int length)
+struct lab_verify *lab_verify_start(struct mtd_info *mtd)
+{
+	struct lab_verify *v;
+	struct task_struct *task;
+
+	v = kzalloc(sizeof(*v), GFP_KERNEL);
+	if (!v)
+		return NULL;
+	v->buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!v->buf)
+		goto out_free;
+
+	/* Hold our own reference; the caller may drop its one first. */
+	v->mtd = get_mtd_device(mtd, -1);
+	if (IS_ERR(v->mtd))
+		goto out_buf;
+
+	mutex_init(&v->mutex);
+	spin_lock_init(&v->lock);
+	INIT_LIST_HEAD(&v->pending);
+	init_waitqueue_head(&v->wait);
+	init_completion(&v->exited);
+
+	task = kthread_run(lab_verify_thread, v, "labverify");
+	if (IS_ERR(task))
+		goto out_mtd;
+	return v;
+
+out_mtd:
+	put_mtd_device(v->mtd);
+out_buf:
+	kfree(v->buf);
+out_free:
+	kfree(v);
+	return NULL;
+}
+EXPORT_SYMBOL(lab_verify_start);
+
+void lab_verify_queue(struct lab_verify *v, loff_t ofs, size_t len,
+		      const unsigned char *src)
+{
+	struct lab_verify_blk *blk;
+
+	if (!v || !len)
+		return;
+
+	blk = kmalloc(sizeof(*blk), GFP_KERNEL);
+	if (!blk) {
+		/* No memory to defer it; check it right here instead. */
+		mutex_lock(&v->mutex);
+		lab_verify_block(v, ofs, len, src);
+		mutex_unlock(&v->mutex);
+		return;
+	}
+	blk->ofs = ofs;
+	blk->len = len;
+	blk->src = src;
+
+	spin_lock(&v->lock);
+	list_add_tail(&blk->list, &v->pending);
+	spin_unlock(&v->lock);
+	wake_up(&v->wait);
+}
+EXPORT_SYMBOL(lab_verify_queue);
+
+int lab_verify_finish(struct lab_verify *v)
+{
+	int bad;
+
+	if (!v)
+		return 0;
+
+	spin_lock(&v->lock);
+	v->closing = 1;
+	spin_unlock(&v->lock);
+	wake_up(&v->wait);
+	wait_for_completion(&v->exited);
+
+	bad = v->bad;
+	lab_printf("Verify: %d block(s) checked, %d bad\r\n", v->checked, bad);
+
+	put_mtd_device(v->mtd);
+	kfree(v->buf);
+	kfree(v);
+	return bad;
+}
+EXPORT_SYMBOL(lab_verify_finish);
+
+static u32 crcbench_crc32(const unsigned char *buf, size_t len)
+{
+	return crc32_le(~0, buf, len);
+}
+
+static u32 crcbench_crc16(const unsigned char *buf, size_t len)
 {
-	unsigned short crc = 0;
-	while(length-- > 0)
-		crc = crc16_table[(crc >> 8) & 0xff] ^ (crc << 8) ^ *buf++;
+	return crc_itu_t(0, buf, len);
+}
+
+static u32 crcbench_crc16_byte(const unsigned char *buf, size_t len)
+{
+	u16 crc = 0;
+
+	while (len--)
+		crc = crc_itu_t_byte(crc, *buf++);
 	return crc;
 }
-EXPORT_SYMBOL(crc16_buf);
 
-/*
- *  COPYRIGHT (C) 1986 Gary S. Brown.  You may use this program, or
- *  code or tables extracted from it, as desired without restriction.
- *
- *  First, the polynomial itself and its table of feedback terms.  The
- *  polynomial is
- *  X^32+X^26+X^23+X^22+X^16+X^12+X^11+X^10+X^8+X^7+X^5+X^4+X^2+X^1+X^0
- */
+static u32 crcbench_csum(const unsigned char *buf, size_t len)
+{
+	return (__force u32)csum_partial(buf, len, 0);
+}
 
-const uint32_t crc32_table[256] = {
-	0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L,
-	0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0x0edb8832L, 0x79dcb8a4L,
-	0xe0d5e91eL, 0x97d2d988L, 0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L,
-	0x90bf1d91L, 0x1db71064L, 0x6ab020f2L, 0xf3b97148L, 0x84be41deL,
-	0x1adad47dL, 0x6ddde4ebL, 0xf4d4b551L, 0x83d385c7L, 0x136c9856L,
-	0x646ba8c0L, 0xfd62f97aL, 0x8a65c9ecL, 0x14015c4fL, 0x63066cd9L,
-	0xfa0f3d63L, 0x8d080df5L, 0x3b6e20c8L, 0x4c69105eL, 0xd56041e4L,
-	0xa2677172L, 0x3c03e4d1L, 0x4b04d447L, 0xd20d85fdL, 0xa50ab56bL,
-	0x35b5a8faL, 0x42b2986cL, 0xdbbbc9d6L, 0xacbcf940L, 0x32d86ce3L,
-	0x45df5c75L, 0xdcd60dcfL, 0xabd13d59L, 0x26d930acL, 0x51de003aL,
-	0xc8d75180L, 0xbfd06116L, 0x21b4f4b5L, 0x56b3c423L, 0xcfba9599L,
-	0xb8bda50fL, 0x2802b89eL, 0x5f058808L, 0xc60cd9b2L, 0xb10be924L,
-	0x2f6f7c87L, 0x58684c11L, 0xc1611dabL, 0xb6662d3dL, 0x76dc4190L,
-	0x01db7106L, 0x98d220bcL, 0xefd5102aL, 0x71b18589L, 0x06b6b51fL,
-	0x9fbfe4a5L, 0xe8b8d433L, 0x7807c9a2L, 0x0f00f934L, 0x9609a88eL,
-	0xe10e9818L, 0x7f6a0dbbL, 0x086d3d2dL, 0x91646c97L, 0xe6635c01L,
-	0x6b6b51f4L, 0x1c6c6162L, 0x856530d8L, 0xf262004eL, 0x6c0695edL,
-	0x1b01a57bL, 0x8208f4c1L, 0xf50fc457L, 0x65b0d9c6L, 0x12b7e950L,
-	0x8bbeb8eaL, 0xfcb9887cL, 0x62dd1ddfL, 0x15da2d49L, 0x8cd37cf3L,
-	0xfbd44c65L, 0x4db26158L, 0x3ab551ceL, 0xa3bc0074L, 0xd4bb30e2L,
-	0x4adfa541L, 0x3dd895d7L, 0xa4d1c46dL, 0xd3d6f4fbL, 0x4369e96aL,
-	0x346ed9fcL, 0xad678846L, 0xda60b8d0L, 0x44042d73L, 0x33031de5L,
-	0xaa0a4c5fL, 0xdd0d7cc9L, 0x5005713cL, 0x270241aaL, 0xbe0b1010L,
-	0xc90c2086L, 0x5768b525L, 0x206f85b3L, 0xb966d409L, 0xce61e49fL,
-	0x5edef90eL, 0x29d9c998L, 0xb0d09822L, 0xc7d7a8b4L, 0x59b33d17L,
-	0x2eb40d81L, 0xb7bd5c3bL, 0xc0ba6cadL, 0xedb88320L, 0x9abfb3b6L,
-	0x03b6e20cL, 0x74b1d29aL, 0xead54739L, 0x9dd277afL, 0x04db2615L,
-	0x73dc1683L, 0xe3630b12L, 0x94643b84L, 0x0d6d6a3eL, 0x7a6a5aa8L,
-	0xe40ecf0bL, 0x9309ff9dL, 0x0a00ae27L, 0x7d079eb1L, 0xf00f9344L,
-	0x8708a3d2L, 0x1e01f268L, 0x6906c2feL, 0xf762575dL, 0x806567cbL,
-	0x196c3671L, 0x6e6b06e7L, 0xfed41b76L, 0x89d32be0L, 0x10da7a5aL,
-	0x67dd4accL, 0xf9b9df6fL, 0x8ebeeff9L, 0x17b7be43L, 0x60b08ed5L,
-	0xd6d6a3e8L, 0xa1d1937eL, 0x38d8c2c4L, 0x4fdff252L, 0xd1bb67f1L,
-	0xa6bc5767L, 0x3fb506ddL, 0x48b2364bL, 0xd80d2bdaL, 0xaf0a1b4cL,
-	0x36034af6L, 0x41047a60L, 0xdf60efc3L, 0xa867df55L, 0x316e8eefL,
-	0x4669be79L, 0xcb61b38cL, 0xbc66831aL, 0x256fd2a0L, 0x5268e236L,
-	0xcc0c7795L, 0xbb0b4703L, 0x220216b9L, 0x5505262fL, 0xc5ba3bbeL,
-	0xb2bd0b28L, 0x2bb45a92L, 0x5cb36a04L, 0xc2d7ffa7L, 0xb5d0cf31L,
-	0x2cd99e8bL, 0x5bdeae1dL, 0x9b64c2b0L, 0xec63f226L, 0x756aa39cL,
-	0x026d930aL, 0x9c0906a9L, 0xeb0e363fL, 0x72076785L, 0x05005713L,
-	0x95bf4a82L, 0xe2b87a14L, 0x7bb12baeL, 0x0cb61b38L, 0x92d28e9bL,
-	0xe5d5be0dL, 0x7cdcefb7L, 0x0bdbdf21L, 0x86d3d2d4L, 0xf1d4e242L,
-	0x68ddb3f8L, 0x1fda836eL, 0x81be16cdL, 0xf6b9265bL, 0x6fb077e1L,
-	0x18b74777L, 0x88085ae6L, 0xff0f6a70L, 0x66063bcaL, 0x11010b5cL,
-	0x8f659effL, 0xf862ae69L, 0x616bffd3L, 0x166ccf45L, 0xa00ae278L,
-	0xd70dd2eeL, 0x4e048354L, 0x3903b3c2L, 0xa7672661L, 0xd06016f7L,
-	0x4969474dL, 0x3e6e77dbL, 0xaed16a4aL, 0xd9d65adcL, 0x40df0b66L,
-	0x37d83bf0L, 0xa9bcae53L, 0xdebb9ec5L, 0x47b2cf7fL, 0x30b5ffe9L,
-	0xbdbdf21cL, 0xcabac28aL, 0x53b39330L, 0x24b4a3a6L, 0xbad03605L,
-	0xcdd70693L, 0x54de5729L, 0x23d967bfL, 0xb3667a2eL, 0xc4614ab8L,
-	0x5d681b02L, 0x2a6f2b94L, 0xb40bbe37L, 0xc30c8ea1L, 0x5a05df1bL,
-	0x2d02ef8dL
+static const struct {
+	const char *name;
+	u32 (*fn)(const unsigned char *buf, size_t len);
+} crcbench_algs[] = {
+	{ "crc32",	crcbench_crc32 },
+	{ "crc16",	crcbench_crc16 },
+	{ "crc16/byte",	crcbench_crc16_byte },
+	{ "csum",	crcbench_csum },
 };
-EXPORT_SYMBOL(crc32_table);
+
+static void lab_cmd_crcbench(int argc, const char** argv)
+{
+	unsigned char *buf;
+	size_t len = 1024 * 1024;
+	u64 bytes, ns, kbps;
+	unsigned long us;
+	ktime_t t0;
+	u32 res;
+	int i, j;
+
+	if (argc > 2) {
+		lab_puts("Usage: crcbench [size-in-KB]\r\n");
+		globfail++;
+		return;
+	}
+	if (argc == 2) {
+		len = simple_strtoul(argv[1], NULL, 0) * 1024;
+		if (!len) {
+			lab_puts("crcbench: bad size\r\n");
+			globfail++;
+			return;
+		}
+	}
+
+	buf = vmalloc(len);
+	if (!buf) {
+		lab_puts("crcbench: out of memory\r\n");
+		globfail++;
+		return;
+	}
+	for (i = 0; i < len; i++)
+		buf[i] = i * 131 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(crcbench_algs); i++) {
+		bytes = 0;
+		res = 0;
+		t0 = ktime_get();
+		/* Run for at least a quarter of a second. */
+		do {
+			for (j = 0; j < 4; j++)
+				res ^= crcbench_algs[i].fn(buf, len);
+			bytes += 4 * len;
+			ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+		} while (ns < NSEC_PER_SEC / 4);
+
+		do_div(ns, 1000);
+		us = ns;
+		kbps = bytes * 1000000;
+		do_div(kbps, us);
+		kbps >>= 10;
+		lab_printf("%-12s %5lu.%02lu MB/s  (%08x)\r\n",
+			   crcbench_algs[i].name,
+			   (unsigned long)(kbps >> 10),
+			   (unsigned long)((kbps & 1023) * 100 >> 10), res);
+	}
+
+	vfree(buf);
+}
+
+int labcrc_init(void)
+{
+	lab_addcommand("crcbench", lab_cmd_crcbench,
+		       "Reports CRC and checksum throughput");
+	return 0;
+}
+
+void labcrc_cleanup(void)
+{
+	lab_delcommand("crcbench");
+}
+
+MODULE_DESCRIPTION("LAB CRC module");
+MODULE_LICENSE("GPL");
+deferred_initcall(labcrc_init);
+module_exit(labcrc_cleanup);
@@ -34,5 +34,5 @@ void lab_cmd_debug(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB debug Module");
 MODULE_LICENSE("GPL");
-module_init(labdebug_init);
+deferred_initcall(labdebug_init);
 module_exit(labdebug_cleanup);
@@ -98,5 +98,5 @@ void lab_cmd_devmem2(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB devmem2 Module");
 MODULE_LICENSE("GPL");
-module_init(labdevmem_init);
+deferred_initcall(labdevmem_init);
 module_exit(labdevmem_cleanup);
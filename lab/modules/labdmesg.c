@@ -83,5 +83,5 @@ void lab_cmd_dmesg(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB dmesg Module");
 MODULE_LICENSE("GPL");
-module_init(labdmesg_init);
+deferred_initcall(labdmesg_init);
 module_exit(labdmesg_cleanup);
@@ -43,5 +43,5 @@ void lab_cmd_dummy2(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB Dummy Test Module");
 MODULE_LICENSE("GPL");
-module_init(labdummy_init);
+deferred_initcall(labdummy_init);
 module_exit(labdummy_cleanup);
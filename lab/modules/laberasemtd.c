@@ -69,7 +69,7 @@ void laberasemtd_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB erasemtd Module");
 MODULE_LICENSE("GPL");
-module_init(laberasemtd_init);
+deferred_initcall(laberasemtd_init);
 module_exit(laberasemtd_cleanup);
 
 static void erase_callback(struct erase_info *ei)
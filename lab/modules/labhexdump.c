@@ -71,5 +71,5 @@ void lab_cmd_hexdump(int argc, const char** argv)
 MODULE_AUTHOR("Paul Sokolovsky");
 MODULE_DESCRIPTION("LAB hexdump Module");
 MODULE_LICENSE("GPL");
-module_init(labhexdump_init);
+deferred_initcall(labhexdump_init);
 module_exit(labhexdump_cleanup);
@@ -110,5 +110,5 @@ void lab_cmd_insmod(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB insmod command module");
 MODULE_LICENSE("GPL");
-module_init(labinsmod_init);
+deferred_initcall(labinsmod_init);
 module_exit(labinsmod_cleanup);
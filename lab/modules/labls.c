@@ -43,11 +43,13 @@ void lab_cmd_ls(int argc, const char** argv)
 
 	if (argc != 2) {
 		lab_puts("ls: syntax: ls <dir>\r\n");
+		globfail++;
 		return;
 	}
 
 	if ((fd = sys_open(argv[1], O_RDONLY, 0)) < 0) {
 		lab_printf("lab: couldn't open the dir, errno=%d\r\n", fd);
+		globfail++;
 		return;
 	}
 
@@ -56,6 +58,7 @@ void lab_cmd_ls(int argc, const char** argv)
 	sz = sys_getdents(fd, (struct linux_dirent*)buf, 32768);
 	if (sz < 0) {
 		lab_printf("lab: couldn't read the dir, errno=%d\r\n", sz);
+		globfail++;
 		sys_close(fd);
 		vfree(buf);
 		return;
@@ -73,5 +76,5 @@ void lab_cmd_ls(int argc, const char** argv)
 MODULE_AUTHOR("Paul Sokolovsky");
 MODULE_DESCRIPTION("LAB ls Module");
 MODULE_LICENSE("GPL");
-module_init(labls_init);
+deferred_initcall(labls_init);
 module_exit(labls_cleanup);
@@ -23,7 +23,7 @@ static void lab_cmd_lsblk(int argc,const char** argv);
 
 int lablsblk_init(void)
 {
-	lab_addcommand("lsblk", lab_cmd_lsblk, "List block devices");
+	lab_addcommand("lsblk", lab_cmd_lsblk, "List block devices, or check that one exists");
 	return 0;
 }
 
@@ -37,35 +37,47 @@ static void lab_cmd_lsblk(int argc, const char** argv)
 	struct gendisk *sgp;
 	char buf[BDEVNAME_SIZE];
 	loff_t pos = 0;
+	int found = 0;
 
-	if (argc != 1) {
-		lab_puts("lsblk: syntax: lsblk\r\n");
+	if (argc > 2) {
+		lab_puts("lsblk: syntax: lsblk [name]\r\n");
+		globfail++;
 		return;
 	}
 
+	/* with a name, only that device is listed and it must exist */
 	for (sgp = partitions_op.start(NULL, &pos); sgp; sgp = partitions_op.next(NULL, sgp, &pos)) {
 	        int n;
-		lab_printf("%4d  %4d %10llu %s\r\n", sgp->major, sgp->first_minor, 
-			(unsigned long long)get_capacity(sgp) >> 1,
-			disk_name(sgp, 0, buf));
+		disk_name(sgp, 0, buf);
+		if (argc == 1 || !strcmp(argv[1], buf)) {
+			lab_printf("%4d  %4d %10llu %s\r\n", sgp->major, sgp->first_minor, 
+				(unsigned long long)get_capacity(sgp) >> 1, buf);
+			found++;
+		}
 		for (n = 0; n < sgp->minors - 1; n++) {
 			if (!sgp->part[n])
 				continue;
 			if (sgp->part[n]->nr_sects == 0)
 				continue;
+			disk_name(sgp, n + 1, buf);
+			if (argc == 2 && strcmp(argv[1], buf))
+				continue;
 			lab_printf("%4d  %4d %10llu %s\r\n",
 				sgp->major, n + 1 + sgp->first_minor,
 				(unsigned long long)sgp->part[n]->nr_sects >> 1 ,
-				disk_name(sgp, n + 1, buf));
+				buf);
+			found++;
 		}
 	}
 
 	partitions_op.stop(NULL, NULL);
 
+	if (argc == 2 && !found)
+		globfail++;
 }
 
 MODULE_AUTHOR("Paul Sokolovsky");
 MODULE_DESCRIPTION("LAB lsblk Module");
 MODULE_LICENSE("GPL");
-module_init(lablsblk_init);
+deferred_initcall(lablsblk_init);
 module_exit(lablsblk_cleanup);
@@ -41,5 +41,5 @@ void lab_cmd_mkdir(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB mkdir Module");
 MODULE_LICENSE("GPL");
-module_init(labmkdir_init);
+deferred_initcall(labmkdir_init);
 module_exit(labmkdir_cleanup);
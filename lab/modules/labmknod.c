@@ -68,5 +68,5 @@ void lab_cmd_mknod(int argc,const char** argv)
 MODULE_AUTHOR("Paul Sokolovsky");
 MODULE_DESCRIPTION("LAB mknod Module");
 MODULE_LICENSE("GPL");
-module_init(labmknod_init);
+deferred_initcall(labmknod_init);
 module_exit(labmknod_cleanup);
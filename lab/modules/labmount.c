@@ -76,5 +76,5 @@ void lab_cmd_umount(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB mount Module");
 MODULE_LICENSE("GPL");
-module_init(labmount_init);
+deferred_initcall(labmount_init);
 module_exit(labmount_cleanup);
@@ -108,5 +108,5 @@ void lab_partition_show(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB MTD Interface Module");
 MODULE_LICENSE("GPL");
-module_init(labmtd_init);
+deferred_initcall(labmtd_init);
 module_exit(labmtd_cleanup);
@@ -42,7 +42,7 @@ void labnandcheck_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB nanddump Module");
 MODULE_LICENSE("GPL");
-module_init(labnandcheck_init);
+deferred_initcall(labnandcheck_init);
 module_exit(labnandcheck_cleanup);
 
 
@@ -42,7 +42,7 @@ void labnanddump_cleanup(void)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB nanddump Module");
 MODULE_LICENSE("GPL");
-module_init(labnanddump_init);
+deferred_initcall(labnanddump_init);
 module_exit(labnanddump_cleanup);
 
 
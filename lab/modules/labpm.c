@@ -34,5 +34,5 @@ void lab_cmd_suspend(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB Dummy Test Module");
 MODULE_LICENSE("GPL");
-module_init(labsuspend_init);
+deferred_initcall(labsuspend_init);
 module_exit(labsuspend_cleanup);
@@ -51,5 +51,5 @@ void lab_cmd_rmmod(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB rmmod command module");
 MODULE_LICENSE("GPL");
-module_init(labrmmod_init);
+deferred_initcall(labrmmod_init);
 module_exit(labrmmod_cleanup);
@@ -53,21 +53,25 @@ void lab_runfile(char* source, char* sourcefile)
 	
 	if (!mysrclist) {
 		lab_printf("Source [%s] does not exist.\r\n", source);
+		globfail++;
 		return;
 	}
 	
 	if (!mysrclist->src->check(sourcefile)) {
 		lab_printf("Source [%s] rejected filename \"%s\".\r\n",
 			   source, sourcefile);
+		globfail++;
 		return;
 	}
 	
 	data = mysrclist->src->get(&count,sourcefile);
 	if (!data) {
 		lab_puts("Error occured while getting file.\r\n");
+		globfail++;
 		return;
 	}
 	
+	/* scripts may test and set variables, see lab-script.c */
 	data2 = vmalloc(count+1);
 	memcpy(data2, data, count);
 	data2[count] = '\0';
@@ -90,6 +94,7 @@ void lab_cmd_run(int argc,const char** argv)
 			 "filespec is device:[file]\r\n"
 			 "example: boot> run ymodem:\r\n"
 			 "would receive data over ymodem, then run it as a list of commands.\r\n");
+		globfail++;
 		return;
 	}
 	
@@ -98,6 +103,7 @@ void lab_cmd_run(int argc,const char** argv)
 		temp++;
 	if (*temp == '\0') {
 		lab_puts("Illegal filespec\r\n");
+		globfail++;
 		return;
 	}
 	*temp = '\0';
@@ -112,5 +118,5 @@ void lab_cmd_run(int argc,const char** argv)
 MODULE_AUTHOR("Joshua Wise");
 MODULE_DESCRIPTION("LAB script exec module");
 MODULE_LICENSE("GPL");
-module_init(labrun_init);
+device_initcall_async(labrun_init);
 module_exit(labrun_cleanup);
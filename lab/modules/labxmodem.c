@@ -24,7 +24,7 @@ int lab_xmodem_init(void)
 {
 	return 0;
 }
-module_init(lab_xmodem_init);
+deferred_initcall(lab_xmodem_init);
 
 static inline unsigned char getchar(void)
 {
@@ -87,19 +87,14 @@ eotagain:			lab_putc(EOT);
 			tbuf[2] = ~(block & 0xff);
 			memcpy(tbuf+3, buf, pktsize);
 			buf += pktsize;
+			for (i=pktsize; i<128; i++)
+				tbuf[i+3] = 0x1A; /* CTRL-Z */
 			crc = 0;
-			for (i=0; i<pktsize; i++)
-				if (usecrc)
-					crc = crc16_table[((crc >> 8) ^ tbuf[i+3]) & 0xFF] ^ (crc << 8);
-				else
+			if (usecrc)
+				crc = crc_itu_t(0, tbuf+3, 128);
+			else
+				for (i=0; i<128; i++)
 					crc = (crc + tbuf[i+3]) & 0xFF;
-			for (; i<128; i++) {
-				tbuf[i+3] = 0x1A; /* CTRL-Z */
-				if (usecrc)
-					crc = crc16_table[((crc >> 8) ^ 0x1A) & 0xFF] ^ (crc << 8);
-				else
-					crc = (crc + 0x1A) & 0xFF;
-			}
 			if (usecrc) {
 				tbuf[131] = (crc >> 8) & 0xFF;
 				tbuf[132] = crc & 0xFF;
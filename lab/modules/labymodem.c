@@ -95,7 +95,8 @@ havesize:
 			for (i=0; i<pktsize+2; i++)
 				dbytes[i] = getchar();
 			
-			if (crc16_buf(dbytes, pktsize+2))
+			/* data followed by its own CRC leaves a zero residue */
+			if (crc_itu_t(0, dbytes, pktsize+2))
 			{
 				/* CRC failed, try again */
 				lab_putc(NAK);
@@ -221,4 +222,4 @@ havesize:
 }
 EXPORT_SYMBOL(lab_ymodem_receive);
 
-module_init(lab_ymodem_init);
+deferred_initcall(lab_ymodem_init);
@@ -77,8 +77,12 @@ u32 __attribute_pure__ crc32_le(u32 crc, unsigned char const *p, size_t len)
 
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[ (crc ^ (x)) & 255 ] ^ (crc>>8)
+#  define DO_CRC8(ta, tb, tc, td) \
+	(ta[q & 255] ^ tb[(q >> 8) & 255] ^ tc[(q >> 16) & 255] ^ td[q >> 24])
 # else
 #  define DO_CRC(x) crc = tab[ ((crc >> 24) ^ (x)) & 255] ^ (crc<<8)
+#  define DO_CRC8(ta, tb, tc, td) \
+	(ta[q >> 24] ^ tb[(q >> 16) & 255] ^ tc[(q >> 8) & 255] ^ td[q & 255])
 # endif
 
 	crc = __cpu_to_le32(crc);
@@ -90,6 +94,28 @@ u32 __attribute_pure__ crc32_le(u32 crc, unsigned char const *p, size_t len)
 			b = (void *)p;
 		} while ((--len) && ((long)b)&3 );
 	}
+#ifdef CONFIG_CRC32_SLICEBY8
+	if(likely(len >= 8)){
+		/*
+		 * Slice-by-8: fold two words per iteration through eight
+		 * independent tables instead of eight dependent lookups.
+		 */
+		const u32 (*t)[256] = crc32table_le_sb8;
+		size_t save_len = len & 7;
+		u32 q;
+
+		len = len >> 3;
+		--b;
+		do {
+			q = crc ^ *++b;
+			crc = DO_CRC8(t[6], t[5], t[4], t[3]);
+			q = *++b;
+			crc ^= DO_CRC8(t[2], t[1], t[0], tab);
+		} while (--len);
+		b++;
+		len = save_len;
+	}
+#endif
 	if(likely(len >= 4)){
 		/* load data 32 bits wide, xor data 32 bits wide. */
 		size_t save_len = len & 3;
@@ -115,6 +141,7 @@ u32 __attribute_pure__ crc32_le(u32 crc, unsigned char const *p, size_t len)
 	}
 
 	return __le32_to_cpu(crc);
+#undef DO_CRC8
 #undef ENDIAN_SHIFT
 #undef DO_CRC
 
@@ -9,6 +9,7 @@
 
 static uint32_t crc32table_le[LE_TABLE_SIZE];
 static uint32_t crc32table_be[BE_TABLE_SIZE];
+static uint32_t crc32table_le_sb8[7][256];
 
 /**
  * crc32init_le() - allocate and initialize LE table data
@@ -31,6 +32,27 @@ static void crc32init_le(void)
 	}
 }
 
+/**
+ * crc32init_le_sb8() - initialize the slice-by-8 LE tables
+ *
+ * Slice k holds the crc of byte i followed by k + 1 zero bytes, so eight
+ * input bytes can be folded into the crc with eight independent lookups.
+ * Only meaningful for CRC_LE_BITS == 8; crc32init_le() must run first.
+ */
+static void crc32init_le_sb8(void)
+{
+	unsigned i, k;
+	uint32_t crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc32table_le[i];
+		for (k = 0; k < 7; k++) {
+			crc = (crc >> 8) ^ crc32table_le[crc & 0xff];
+			crc32table_le_sb8[k][i] = crc;
+		}
+	}
+}
+
 /**
  * crc32init_be() - allocate and initialize BE table data
  */
@@ -71,6 +93,21 @@ int main(int argc, char** argv)
 		printf("};\n");
 	}
 
+	if (CRC_LE_BITS == 8) {
+		int k;
+
+		crc32init_le_sb8();
+		printf("#ifdef CONFIG_CRC32_SLICEBY8\n");
+		printf("static const u32 crc32table_le_sb8[7][256] = {");
+		for (k = 0; k < 7; k++) {
+			printf("{");
+			output_table(crc32table_le_sb8[k], 256, "tole");
+			printf(k < 6 ? "}, " : "}");
+		}
+		printf("};\n");
+		printf("#endif\n");
+	}
+
 	if (CRC_BE_BITS > 1) {
 		crc32init_be();
 		printf("static const u32 crc32table_be[] = {");
@@ -0,0 +1,186 @@
+/*
+ * lib/lzf.c
+ *
+ * LZF compression, compatible with the liblzf stream format:
+ *
+ *   000LLLLL <L+1 literal bytes>			literal run, 1..32 bytes
+ *   LLLooooo oooooooo				back reference, L = 1..6
+ *   111ooooo LLLLLLLL oooooooo			back reference, L = 7 + n
+ *
+ * A back reference copies L + 2 bytes from o + 1 bytes behind the
+ * current output position, so matches are 3..264 bytes long and reach
+ * back up to 8KB.
+ *
+ * This source code is licensed under the GNU General Public License,
+ * Version 2. See the file COPYING for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+#include <linux/lzf.h>
+
+#define LZF_HSIZE	(1 << LZF_HLOG)
+#define LZF_MAX_LIT	(1 << 5)
+#define LZF_MAX_OFF	(1 << 13)
+#define LZF_MAX_REF	((1 << 8) + (1 << 3))
+
+static inline unsigned int lzf_hash(const u8 *p)
+{
+	u32 v = (p[0] << 16) | (p[1] << 8) | p[2];
+
+	return (v * 2654435761U) >> (32 - LZF_HLOG);
+}
+
+size_t lzf_compress(const void *in, size_t in_len,
+		    void *out, size_t out_len, void *wrkmem)
+{
+	u32 *htab = wrkmem;
+	const u8 *ip = in;
+	const u8 *in_end = ip + in_len;
+	u8 *op = out;
+	u8 *out_end = op + out_len;
+	u8 *lit;
+	unsigned int nlit = 0;
+
+	if (!in_len || !out_len)
+		return 0;
+
+	/*
+	 * The hash table is not cleared: a stale entry is only used once
+	 * the bytes it points at have been compared with the input.
+	 */
+	lit = op++;
+
+	while (ip + 2 < in_end) {
+		unsigned int h = lzf_hash(ip);
+		u32 pos = ip - (const u8 *)in;
+		u32 ref = htab[h];
+		unsigned long off = pos - ref - 1;
+
+		htab[h] = pos;
+
+		if (ref < pos && off < LZF_MAX_OFF) {
+			const u8 *rp = (const u8 *)in + ref;
+
+			if (rp[0] == ip[0] && rp[1] == ip[1] &&
+			    rp[2] == ip[2]) {
+				unsigned int len = 3;
+				unsigned int max = in_end - ip;
+
+				if (max > LZF_MAX_REF)
+					max = LZF_MAX_REF;
+				while (len < max && rp[len] == ip[len])
+					len++;
+
+				/* close the literal run, or drop its header */
+				if (nlit)
+					*lit = nlit - 1;
+				else
+					op--;
+				ip += len;
+				len -= 2;
+				if (op + (len < 7 ? 2 : 3) > out_end)
+					return 0;
+				if (len < 7) {
+					*op++ = (off >> 8) + (len << 5);
+				} else {
+					*op++ = (off >> 8) + (7 << 5);
+					*op++ = len - 7;
+				}
+				*op++ = off;
+
+				/* seed the table with the end of the match */
+				if (ip + 2 < in_end)
+					htab[lzf_hash(ip - 1)] =
+						ip - 1 - (const u8 *)in;
+
+				lit = op++;
+				nlit = 0;
+				continue;
+			}
+		}
+
+		if (op >= out_end)
+			return 0;
+		*op++ = *ip++;
+		if (++nlit == LZF_MAX_LIT) {
+			*lit = nlit - 1;
+			lit = op++;
+			nlit = 0;
+		}
+	}
+
+	while (ip < in_end) {
+		if (op >= out_end)
+			return 0;
+		*op++ = *ip++;
+		if (++nlit == LZF_MAX_LIT) {
+			*lit = nlit - 1;
+			lit = op++;
+			nlit = 0;
+		}
+	}
+
+	if (nlit)
+		*lit = nlit - 1;
+	else
+		op--;
+
+	return op - (u8 *)out;
+}
+EXPORT_SYMBOL(lzf_compress);
+
+int lzf_decompress(const void *in, size_t in_len, void *out, size_t out_len)
+{
+	const u8 *ip = in;
+	const u8 *in_end = ip + in_len;
+	u8 *op = out;
+	u8 *out_end = op + out_len;
+
+	while (ip < in_end) {
+		unsigned int ctrl = *ip++;
+		unsigned int len;
+
+		if (ctrl < LZF_MAX_LIT) {
+			len = ctrl + 1;
+			if (op + len > out_end)
+				return -E2BIG;
+			if (ip + len > in_end)
+				return -EINVAL;
+			memcpy(op, ip, len);
+			op += len;
+			ip += len;
+		} else {
+			const u8 *ref;
+
+			len = ctrl >> 5;
+			if (ip >= in_end)
+				return -EINVAL;
+			if (len == 7) {
+				len += *ip++;
+				if (ip >= in_end)
+					return -EINVAL;
+			}
+			ref = op - ((ctrl & 0x1f) << 8) - 1 - *ip++;
+			len += 2;
+
+			if (op + len > out_end)
+				return -E2BIG;
+			if (ref < (u8 *)out)
+				return -EINVAL;
+
+			/* may overlap the output, so copy bytewise */
+			do {
+				*op++ = *ref++;
+			} while (--len);
+		}
+	}
+
+	return op - (u8 *)out;
+}
+EXPORT_SYMBOL(lzf_decompress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZF compression");
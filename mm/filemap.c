@@ -866,7 +866,6 @@ void do_generic_mapping_read(struct address_space *mapping,
 	unsigned long end_index;
 	unsigned long offset;
 	unsigned long last_index;
-	unsigned long next_index;
 	unsigned long prev_index;
 	loff_t isize;
 	struct page *cached_page;
@@ -875,8 +874,7 @@ void do_generic_mapping_read(struct address_space *mapping,
 
 	cached_page = NULL;
 	index = *ppos >> PAGE_CACHE_SHIFT;
-	next_index = index;
-	prev_index = ra.prev_page;
+	prev_index = ra.prev_index;
 	last_index = (*ppos + desc->count + PAGE_CACHE_SIZE-1) >> PAGE_CACHE_SHIFT;
 	offset = *ppos & ~PAGE_CACHE_MASK;
 
@@ -902,15 +900,20 @@ void do_generic_mapping_read(struct address_space *mapping,
 		nr = nr - offset;
 
 		cond_resched();
-		if (index == next_index)
-			next_index = page_cache_readahead(mapping, &ra, filp,
-					index, last_index - index);
-
 find_page:
 		page = find_get_page(mapping, index);
-		if (unlikely(page == NULL)) {
-			handle_ra_miss(mapping, &ra, index);
-			goto no_cached_page;
+		if (!page) {
+			page_cache_sync_readahead(mapping,
+					&ra, filp,
+					index, last_index - index);
+			page = find_get_page(mapping, index);
+			if (unlikely(page == NULL))
+				goto no_cached_page;
+		}
+		if (PageReadahead(page)) {
+			page_cache_async_readahead(mapping,
+					&ra, filp, page,
+					index, last_index - index);
 		}
 		if (!PageUptodate(page))
 			goto page_not_up_to_date;
@@ -1059,6 +1062,7 @@ no_cached_page:
 
 out:
 	*_ra = ra;
+	_ra->prev_index = prev_index;
 
 	*ppos = ((loff_t) index << PAGE_CACHE_SHIFT) + offset;
 	if (cached_page)
@@ -1338,27 +1342,22 @@ retry_all:
 	if (VM_RandomReadHint(area))
 		goto no_cached_page;
 
-	/*
-	 * The readahead code wants to be told about each and every page
-	 * so it can build and shrink its windows appropriately
-	 *
-	 * For sequential accesses, we use the generic readahead logic.
-	 */
-	if (VM_SequentialReadHint(area))
-		page_cache_readahead(mapping, ra, file, pgoff, 1);
-
 	/*
 	 * Do we have something in the page cache already?
 	 */
 retry_find:
 	page = find_get_page(mapping, pgoff);
-	if (!page) {
-		unsigned long ra_pages;
-
-		if (VM_SequentialReadHint(area)) {
-			handle_ra_miss(mapping, ra, pgoff);
+	/*
+	 * For sequential accesses, we use the generic readahead logic.
+	 */
+	if (!page && VM_SequentialReadHint(area)) {
+		page_cache_sync_readahead(mapping, ra, file, pgoff, 1);
+		page = find_get_page(mapping, pgoff);
+		if (!page)
 			goto no_cached_page;
-		}
+	}
+
+	if (!page) {
 		ra->mmap_miss++;
 
 		/*
@@ -1377,19 +1376,20 @@ retry_find:
 			count_vm_event(PGMAJFAULT);
 		}
 		did_readaround = 1;
-		ra_pages = max_sane_readahead(file->f_ra.ra_pages);
-		if (ra_pages) {
-			pgoff_t start = 0;
-
-			if (pgoff > ra_pages / 2)
-				start = pgoff - ra_pages / 2;
-			do_page_cache_readahead(mapping, file, start, ra_pages);
-		}
+		page_cache_mmap_readaround(mapping, ra, file, pgoff);
 		page = find_get_page(mapping, pgoff);
 		if (!page)
 			goto no_cached_page;
 	}
 
+	/*
+	 * The fault walked into the tail of a readahead window: keep the
+	 * stream going ahead of it.
+	 */
+	if (PageReadahead(page))
+		page_cache_async_readahead(mapping, ra, file, page, pgoff, 1);
+	ra->prev_index = pgoff;
+
 	if (!did_readaround)
 		ra->mmap_hit++;
 
@@ -1894,7 +1894,8 @@ unsigned long do_brk(unsigned long addr, unsigned long len)
 
 	flags = VM_DATA_DEFAULT_FLAGS | VM_ACCOUNT | mm->def_flags;
 
-	error = arch_mmap_check(addr, len, flags);
+	/* the hook takes MAP_* flags, and brk is always fixed */
+	error = arch_mmap_check(addr, len, MAP_FIXED);
 	if (error)
 		return error;
 
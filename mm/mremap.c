@@ -23,6 +23,10 @@
 #include <asm/cacheflush.h>
 #include <asm/tlbflush.h>
 
+#ifndef arch_mmap_check
+#define arch_mmap_check(addr, len, flags)	(0)
+#endif
+
 static pmd_t *get_old_pmd(struct mm_struct *mm, unsigned long addr)
 {
 	pgd_t *pgd;
@@ -282,6 +286,11 @@ unsigned long do_mremap(unsigned long addr,
 		if (new_len > TASK_SIZE || new_addr > TASK_SIZE - new_len)
 			goto out;
 
+		ret = arch_mmap_check(new_addr, new_len, MAP_FIXED);
+		if (ret)
+			goto out;
+		ret = -EINVAL;
+
 		/* Check if the location we're moving into overlaps the
 		 * old location at all, and fail if it does.
 		 */
@@ -362,6 +371,10 @@ unsigned long do_mremap(unsigned long addr,
 		if (max_addr - addr >= new_len) {
 			int pages = (new_len - old_len) >> PAGE_SHIFT;
 
+			ret = arch_mmap_check(addr, new_len, MAP_FIXED);
+			if (ret)
+				goto out;
+
 			vma_adjust(vma, vma->vm_start,
 				addr + new_len, vma->vm_pgoff, NULL);
 
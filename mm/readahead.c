@@ -37,86 +37,10 @@ void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
-	ra->prev_page = -1;
+	ra->prev_index = -1;
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
 
-/*
- * Return max readahead size for this inode in number-of-pages.
- */
-static inline unsigned long get_max_readahead(struct file_ra_state *ra)
-{
-	return ra->ra_pages;
-}
-
-static inline unsigned long get_min_readahead(struct file_ra_state *ra)
-{
-	return (VM_MIN_READAHEAD * 1024) / PAGE_CACHE_SIZE;
-}
-
-static inline void reset_ahead_window(struct file_ra_state *ra)
-{
-	/*
-	 * ... but preserve ahead_start + ahead_size value,
-	 * see 'recheck:' label in page_cache_readahead().
-	 * Note: We never use ->ahead_size as rvalue without
-	 * checking ->ahead_start != 0 first.
-	 */
-	ra->ahead_size += ra->ahead_start;
-	ra->ahead_start = 0;
-}
-
-static inline void ra_off(struct file_ra_state *ra)
-{
-	ra->start = 0;
-	ra->flags = 0;
-	ra->size = 0;
-	reset_ahead_window(ra);
-	return;
-}
-
-/*
- * Set the initial window size, round to next power of 2 and square
- * for small size, x 4 for medium, and x 2 for large
- * for 128k (32 page) max ra
- * 1-8 page = 32k initial, > 8 page = 128k initial
- */
-static unsigned long get_init_ra_size(unsigned long size, unsigned long max)
-{
-	unsigned long newsize = roundup_pow_of_two(size);
-
-	if (newsize <= max / 32)
-		newsize = newsize * 4;
-	else if (newsize <= max / 4)
-		newsize = newsize * 2;
-	else
-		newsize = max;
-	return newsize;
-}
-
-/*
- * Set the new window size, this is called only when I/O is to be submitted,
- * not for each call to readahead.  If a cache miss occured, reduce next I/O
- * size, else increase depending on how close to max we are.
- */
-static inline unsigned long get_next_ra_size(struct file_ra_state *ra)
-{
-	unsigned long max = get_max_readahead(ra);
-	unsigned long min = get_min_readahead(ra);
-	unsigned long cur = ra->size;
-	unsigned long newsize;
-
-	if (ra->flags & RA_FLAG_MISS) {
-		ra->flags &= ~RA_FLAG_MISS;
-		newsize = max((cur - 2), min);
-	} else if (cur < max / 16) {
-		newsize = 4 * cur;
-	} else {
-		newsize = 2 * cur;
-	}
-	return min(newsize, max);
-}
-
 #define list_to_page(head) (list_entry((head)->prev, struct page, lru))
 
 /**
@@ -195,75 +119,58 @@ out:
 /*
  * Readahead design.
  *
- * The fields in struct file_ra_state represent the most-recently-executed
- * readahead attempt:
- *
- * start:	Page index at which we started the readahead
- * size:	Number of pages in that read
- *              Together, these form the "current window".
- *              Together, start and size represent the `readahead window'.
- * prev_page:   The page which the readahead algorithm most-recently inspected.
- *              It is mainly used to detect sequential file reading.
- *              If page_cache_readahead sees that it is again being called for
- *              a page which it just looked at, it can return immediately without
- *              making any state changes.
- * ahead_start,
- * ahead_size:  Together, these form the "ahead window".
- * ra_pages:	The externally controlled max readahead for this fd.
+ * Readahead is done on demand: nothing is remembered between calls except
+ * the most recent readahead window, and the decision to read ahead is made
+ * at the point where the reader actually needs it.  There are two trigger
+ * points:
  *
- * When readahead is in the off state (size == 0), readahead is disabled.
- * In this state, prev_page is used to detect the resumption of sequential I/O.
+ * - a page cache miss (page_cache_sync_readahead), where the reader has to
+ *   wait for I/O anyway, so we submit the page it wants plus whatever the
+ *   access pattern suggests will follow;
  *
- * The readahead code manages two windows - the "current" and the "ahead"
- * windows.  The intent is that while the application is walking the pages
- * in the current window, I/O is underway on the ahead window.  When the
- * current window is fully traversed, it is replaced by the ahead window
- * and the ahead window is invalidated.  When this copying happens, the
- * new current window's pages are probably still locked.  So
- * we submit a new batch of I/O immediately, creating a new ahead window.
+ * - a hit on a page marked PG_readahead (page_cache_async_readahead).  The
+ *   marker is planted async_size pages before the end of each window, so
+ *   that the next window goes out while the reader is still walking the
+ *   current one.
  *
- * So:
+ * The fields in struct file_ra_state describe the last window submitted:
  *
- *   ----|----------------|----------------|-----
- *       ^start           ^start+size
- *                        ^ahead_start     ^ahead_start+ahead_size
+ *                        |<----- async_size ---------|
+ *     |------------------- size -------------------->|
+ *     |==================#===========================|
+ *     ^start             ^page marked with PG_readahead
  *
- *         ^ When this page is read, we submit I/O for the
- *           ahead window.
+ * prev_index is the last page read through this file and is used to tell a
+ * sequential cache miss from a random one.
  *
- * A `readahead hit' occurs when a read request is made against a page which is
- * the next sequential page. Ahead window calculations are done only when it
- * is time to submit a new IO.  The code ramps up the size agressively at first,
- * but slow down as it approaches max_readhead.
+ * Because a marker stands on its own, losing the window state costs little:
+ * interleaved or concurrent streams over one struct file overwrite each
+ * other's state, but whichever stream next hits a marker rebuilds its window
+ * from what is in the page cache.  The same trick covers a random-looking
+ * miss: if the pages just in front of it are cached, somebody is probably
+ * streaming through here, and the length of that history is taken as a
+ * hint for the window size.
  *
- * Any seek/ramdom IO will result in readahead being turned off.  It will resume
- * at the first sequential access.
- *
- * There is a special-case: if the first page which the application tries to
- * read happens to be the first page of the file, it is assumed that a linear
- * read is about to happen and the window is immediately set to the initial size
- * based on I/O request size and the max_readahead.
- *
- * This function is to be called for every read request, rather than when
- * it is time to perform readahead.  It is called only once for the entire I/O
- * regardless of size unless readahead is unable to start enough I/O to satisfy
- * the request (I/O request > max_readahead).
+ * Windows start at a few times the request size and double (or quadruple
+ * while small) on each marker hit, up to ra_pages.  A single read larger
+ * than ra_pages may go up to the backing device's optimal request size.
  */
 
 /*
- * do_page_cache_readahead actually reads a chunk of disk.  It allocates all
+ * __do_page_cache_readahead actually reads a chunk of disk.  It allocates all
  * the pages first, then submits them all for I/O. This avoids the very bad
  * behaviour which would occur if page allocations are causing VM writeback.
  * We really don't want to intermingle reads and writes like that.
  *
- * Returns the number of pages requested, or the maximum amount of I/O allowed.
+ * The page @lookahead_size pages before the end of the chunk is marked
+ * PG_readahead, if we had to allocate it.
  *
- * do_page_cache_readahead() returns -1 if it encountered request queue
- * congestion.
+ * Returns the number of pages requested, or the maximum amount of I/O allowed.
  */
 static int
 __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read)
+			pgoff_t offset, unsigned long nr_to_read,
+			unsigned long lookahead_size)
 {
 	struct inode *inode = mapping->host;
 	struct page *page;
@@ -284,7 +191,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	read_lock_irq(&mapping->tree_lock);
 	for (page_idx = 0; page_idx < nr_to_read; page_idx++) {
 		pgoff_t page_offset = offset + page_idx;
-		
+
 		if (page_offset > end_index)
 			break;
 
@@ -299,6 +206,8 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			break;
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
+		if (page_idx == nr_to_read - lookahead_size)
+			SetPageReadahead(page);
 		ret++;
 	}
 	read_unlock_irq(&mapping->tree_lock);
@@ -308,8 +217,10 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	 * uptodate then the caller will launch readpage again, and
 	 * will then handle the error.
 	 */
-	if (ret)
+	if (ret) {
 		read_pages(mapping, filp, &page_pool, ret);
+		count_vm_events(RA_PAGES, ret);
+	}
 	BUG_ON(!list_empty(&page_pool));
 out:
 	return ret;
@@ -335,7 +246,7 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (this_chunk > nr_to_read)
 			this_chunk = nr_to_read;
 		err = __do_page_cache_readahead(mapping, filp,
-						offset, this_chunk);
+						offset, this_chunk, 0);
 		if (err < 0) {
 			ret = err;
 			break;
@@ -348,98 +259,226 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 }
 
 /*
- * Check how effective readahead is being.  If the amount of started IO is
- * less than expected then the file is partly or fully in pagecache and
- * readahead isn't helping.
- *
+ * Submit I/O for the window described by @ra.
  */
-static inline int check_ra_success(struct file_ra_state *ra,
-			unsigned long nr_to_read, unsigned long actual)
+static unsigned long ra_submit(struct file_ra_state *ra,
+		struct address_space *mapping, struct file *filp)
 {
-	if (actual == 0) {
-		ra->cache_hit += nr_to_read;
-		if (ra->cache_hit >= VM_MAX_CACHE_HIT) {
-			ra_off(ra);
-			ra->flags |= RA_FLAG_INCACHE;
-			return 0;
-		}
-	} else {
-		ra->cache_hit=0;
-	}
-	return 1;
+	return __do_page_cache_readahead(mapping, filp,
+					ra->start, ra->size, ra->async_size);
 }
 
 /*
- * This version skips the IO if the queue is read-congested, and will tell the
- * block layer to abandon the readahead if request allocation would block.
- *
- * force_page_cache_readahead() will ignore queue congestion and will block on
- * request queues.
+ * Set the initial window size, round to next power of 2 and square
+ * for small size, x 4 for medium, and x 2 for large
+ * for 128k (32 page) max ra
+ * 1-8 page = 32k initial, > 8 page = 128k initial
  */
-int do_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read)
+static unsigned long get_init_ra_size(unsigned long size, unsigned long max)
 {
-	if (bdi_read_congested(mapping->backing_dev_info))
-		return -1;
+	unsigned long newsize = roundup_pow_of_two(size);
 
-	return __do_page_cache_readahead(mapping, filp, offset, nr_to_read);
+	if (newsize <= max / 32)
+		newsize = newsize * 4;
+	else if (newsize <= max / 4)
+		newsize = newsize * 2;
+	else
+		newsize = max;
+	return newsize;
 }
 
 /*
- * Read 'nr_to_read' pages starting at page 'offset'. If the flag 'block'
- * is set wait till the read completes.  Otherwise attempt to read without
- * blocking.
- * Returns 1 meaning 'success' if read is successful without switching off
- * readahead mode. Otherwise return failure.
+ * Get the previous window size, ramp it up, and
+ * return it as the new window size.
  */
-static int
-blockable_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read,
-			struct file_ra_state *ra, int block)
+static unsigned long get_next_ra_size(struct file_ra_state *ra,
+				      unsigned long max)
+{
+	unsigned long cur = ra->size;
+	unsigned long newsize;
+
+	if (cur < max / 16)
+		newsize = 4 * cur;
+	else
+		newsize = 2 * cur;
+
+	return min(newsize, max);
+}
+
+/*
+ * Count the contiguously cached pages in front of @offset, looking back at
+ * most @max pages.  This is a conservative estimate of either the length of
+ * the sequential stream that led here, or of how much the page cache can
+ * hold before a stream starts thrashing.
+ */
+static unsigned long count_history_pages(struct address_space *mapping,
+					 pgoff_t offset, unsigned long max)
+{
+	unsigned long count = 0;
+
+	read_lock_irq(&mapping->tree_lock);
+	while (count < max && offset > count &&
+	       radix_tree_lookup(&mapping->page_tree, offset - count - 1))
+		count++;
+	read_unlock_irq(&mapping->tree_lock);
+
+	return count;
+}
+
+/*
+ * Return the index of the first page not in the page cache after @offset,
+ * looking at most @max pages ahead.  Returns 0 if there is no hole in range.
+ */
+static pgoff_t next_cache_hole(struct address_space *mapping,
+			       pgoff_t offset, unsigned long max)
+{
+	unsigned long i;
+
+	read_lock_irq(&mapping->tree_lock);
+	for (i = 1; i <= max; i++)
+		if (!radix_tree_lookup(&mapping->page_tree, offset + i))
+			break;
+	read_unlock_irq(&mapping->tree_lock);
+
+	return i <= max ? offset + i : 0;
+}
+
+/*
+ * Page cache context based readahead: a miss with no usable state, but
+ * with cached history right behind it, is most likely one of several
+ * streams interleaved over the same file.
+ */
+static int try_context_readahead(struct address_space *mapping,
+				 struct file_ra_state *ra, pgoff_t offset,
+				 unsigned long req_size, unsigned long max)
 {
-	int actual;
+	unsigned long size;
+
+	size = count_history_pages(mapping, offset, max);
 
-	if (!block && bdi_read_congested(mapping->backing_dev_info))
+	/* No history pages: could be a random read */
+	if (!size)
 		return 0;
 
-	actual = __do_page_cache_readahead(mapping, filp, offset, nr_to_read);
+	/*
+	 * The history goes back to the start of the file: a strong hint of a
+	 * long-running stream or a whole-file read.
+	 */
+	if (size >= offset)
+		size *= 2;
+
+	ra->start = offset;
+	ra->size = get_init_ra_size(size + req_size, max);
+	ra->async_size = ra->size;
 
-	return check_ra_success(ra, nr_to_read, actual);
+	count_vm_event(RA_CONTEXT);
+	return 1;
 }
 
-static int make_ahead_window(struct address_space *mapping, struct file *filp,
-				struct file_ra_state *ra, int force)
+/*
+ * A minimal readahead algorithm for trivial sequential/random reads.
+ */
+static unsigned long
+ondemand_readahead(struct address_space *mapping,
+		   struct file_ra_state *ra, struct file *filp,
+		   int hit_readahead_marker, pgoff_t offset,
+		   unsigned long req_size)
 {
-	int block, ret;
-
-	ra->ahead_size = get_next_ra_size(ra);
-	ra->ahead_start = ra->start + ra->size;
-
-	block = force || (ra->prev_page >= ra->ahead_start);
-	ret = blockable_page_cache_readahead(mapping, filp,
-			ra->ahead_start, ra->ahead_size, ra, block);
-
-	if (!ret && !force) {
-		/* A read failure in blocking mode, implies pages are
-		 * all cached. So we can safely assume we have taken
-		 * care of all the pages requested in this call.
-		 * A read failure in non-blocking mode, implies we are
-		 * reading more pages than requested in this call.  So
-		 * we safely assume we have taken care of all the pages
-		 * requested in this call.
-		 *
-		 * Just reset the ahead window in case we failed due to
-		 * congestion.  The ahead window will any way be closed
-		 * in case we failed due to excessive page cache hits.
-		 */
-		reset_ahead_window(ra);
+	unsigned long max = ra->ra_pages;
+	unsigned long io_pages = mapping->backing_dev_info->io_pages;
+
+	/*
+	 * Let a large read go out in one window, as long as the device can
+	 * take it in one request.
+	 */
+	if (req_size > max && io_pages > max)
+		max = min(req_size, io_pages);
+	max = max_sane_readahead(max);
+
+	/*
+	 * Start of file.
+	 */
+	if (!offset)
+		goto initial_readahead;
+
+	/*
+	 * It's the expected callback offset, assume sequential access.
+	 * Ramp up sizes, and push forward the readahead window.
+	 */
+	if (offset == (ra->start + ra->size - ra->async_size) ||
+	    offset == (ra->start + ra->size)) {
+		ra->start += ra->size;
+		ra->size = get_next_ra_size(ra, max);
+		ra->async_size = ra->size;
+		goto readit;
 	}
 
-	return ret;
+	/*
+	 * Hit a marked page without valid readahead state, e.g. interleaved
+	 * reads.  The cached run after the marker is normally the previous
+	 * async_size: ramp it up and use it as the new window size.
+	 */
+	if (hit_readahead_marker) {
+		pgoff_t start;
+
+		start = next_cache_hole(mapping, offset, max);
+		if (!start)
+			return 0;
+
+		ra->start = start;
+		ra->size = start - offset;	/* old async_size */
+		ra->size += req_size;
+		ra->size = get_next_ra_size(ra, max);
+		ra->async_size = ra->size;
+		goto readit;
+	}
+
+	/*
+	 * Oversize read.
+	 */
+	if (req_size > max)
+		goto initial_readahead;
+
+	/*
+	 * Sequential cache miss.
+	 */
+	if (offset - ra->prev_index <= 1UL)
+		goto initial_readahead;
+
+	/*
+	 * Look for the trail of cached pages a sequential stream would have
+	 * left behind.
+	 */
+	if (try_context_readahead(mapping, ra, offset, req_size, max))
+		goto readit;
+
+	/*
+	 * Standalone, small random read.
+	 * Read as is, and do not pollute the readahead state.
+	 */
+	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+
+initial_readahead:
+	ra->start = offset;
+	ra->size = get_init_ra_size(req_size, max);
+	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
+
+readit:
+	/*
+	 * Will this read hit the readahead marker made by itself?
+	 * If so, trigger the readahead marker hit now, and merge
+	 * the resulting next window into the current one.
+	 */
+	if (offset == ra->start && ra->size == ra->async_size) {
+		ra->async_size = get_next_ra_size(ra, max);
+		ra->size += ra->async_size;
+	}
+
+	return ra_submit(ra, mapping, filp);
 }
 
 /**
- * page_cache_readahead - generic adaptive readahead
+ * page_cache_sync_readahead - generic file readahead
  * @mapping: address_space which holds the pagecache and I/O vectors
  * @ra: file_ra_state which holds the readahead state
  * @filp: passed on to ->readpage() and ->readpages()
@@ -447,126 +486,104 @@ static int make_ahead_window(struct address_space *mapping, struct file *filp,
  * @req_size: hint: total size of the read which the caller is performing in
  *            PAGE_CACHE_SIZE units
  *
- * page_cache_readahead() is the main function.  If performs the adaptive
- * readahead window size management and submits the readahead I/O.
+ * page_cache_sync_readahead() should be called when a cache miss happened:
+ * it will submit the read.  The readahead logic may decide to piggyback more
+ * pages onto the read request if access patterns suggest it will improve
+ * performance.
  *
  * Note that @filp is purely used for passing on to the ->readpage[s]()
  * handler: it may refer to a different file from @mapping (so we may not use
  * @filp->f_mapping or @filp->f_path.dentry->d_inode here).
  * Also, @ra may not be equal to &@filp->f_ra.
- *
  */
-unsigned long
-page_cache_readahead(struct address_space *mapping, struct file_ra_state *ra,
-		     struct file *filp, pgoff_t offset, unsigned long req_size)
+void page_cache_sync_readahead(struct address_space *mapping,
+			       struct file_ra_state *ra, struct file *filp,
+			       pgoff_t offset, unsigned long req_size)
 {
-	unsigned long max, newsize;
-	int sequential;
-
-	/*
-	 * We avoid doing extra work and bogusly perturbing the readahead
-	 * window expansion logic.
-	 */
-	if (offset == ra->prev_page && --req_size)
-		++offset;
-
-	/* Note that prev_page == -1 if it is a first read */
-	sequential = (offset == ra->prev_page + 1);
-	ra->prev_page = offset;
+	/* no read-ahead */
+	if (!ra->ra_pages)
+		return;
 
-	max = get_max_readahead(ra);
-	newsize = min(req_size, max);
-
-	/* No readahead or sub-page sized read or file already in cache */
-	if (newsize == 0 || (ra->flags & RA_FLAG_INCACHE))
-		goto out;
-
-	ra->prev_page += newsize - 1;
+	count_vm_event(RA_SYNC);
 
 	/*
-	 * Special case - first read at start of file. We'll assume it's
-	 * a whole-file read and grow the window fast.  Or detect first
-	 * sequential access
+	 * A miss inside the window we last read ahead means the rest of it
+	 * was reclaimed before the reader got there.
 	 */
-	if (sequential && ra->size == 0) {
-		ra->size = get_init_ra_size(newsize, max);
-		ra->start = offset;
-		if (!blockable_page_cache_readahead(mapping, filp, offset,
-							 ra->size, ra, 1))
-			goto out;
-
-		/*
-		 * If the request size is larger than our max readahead, we
-		 * at least want to be sure that we get 2 IOs in flight and
-		 * we know that we will definitly need the new I/O.
-		 * once we do this, subsequent calls should be able to overlap
-		 * IOs,* thus preventing stalls. so issue the ahead window
-		 * immediately.
-		 */
-		if (req_size >= max)
-			make_ahead_window(mapping, filp, ra, 1);
+	if (ra_has_index(ra, offset))
+		count_vm_events(RA_THRASH, ra->start + ra->size - offset);
 
-		goto out;
-	}
+	ondemand_readahead(mapping, ra, filp, 0, offset, req_size);
+}
+EXPORT_SYMBOL_GPL(page_cache_sync_readahead);
 
-	/*
-	 * Now handle the random case:
-	 * partial page reads and first access were handled above,
-	 * so this must be the next page otherwise it is random
-	 */
-	if (!sequential) {
-		ra_off(ra);
-		blockable_page_cache_readahead(mapping, filp, offset,
-				 newsize, ra, 1);
-		goto out;
-	}
+/**
+ * page_cache_async_readahead - file readahead for marked pages
+ * @mapping: address_space which holds the pagecache and I/O vectors
+ * @ra: file_ra_state which holds the readahead state
+ * @filp: passed on to ->readpage() and ->readpages()
+ * @page: the page at @offset which has the PG_readahead flag set
+ * @offset: start offset into @mapping, in PAGE_CACHE_SIZE units
+ * @req_size: hint: total size of the read which the caller is performing in
+ *            PAGE_CACHE_SIZE units
+ *
+ * page_cache_async_readahead() should be called when a page is used which
+ * has the PG_readahead flag set: this is a marker to suggest that the
+ * application has used up enough of the readahead window that we should
+ * start pulling in more pages.
+ */
+void page_cache_async_readahead(struct address_space *mapping,
+				struct file_ra_state *ra, struct file *filp,
+				struct page *page, pgoff_t offset,
+				unsigned long req_size)
+{
+	/* no read-ahead */
+	if (!ra->ra_pages)
+		return;
 
-	/*
-	 * If we get here we are doing sequential IO and this was not the first
-	 * occurence (ie we have an existing window)
-	 */
-	if (ra->ahead_start == 0) {	 /* no ahead window yet */
-		if (!make_ahead_window(mapping, filp, ra, 0))
-			goto recheck;
-	}
+	ClearPageReadahead(page);
 
 	/*
-	 * Already have an ahead window, check if we crossed into it.
-	 * If so, shift windows and issue a new ahead window.
-	 * Only return the #pages that are in the current window, so that
-	 * we get called back on the first page of the ahead window which
-	 * will allow us to submit more IO.
+	 * Defer asynchronous read-ahead on IO congestion.
 	 */
-	if (ra->prev_page >= ra->ahead_start) {
-		ra->start = ra->ahead_start;
-		ra->size = ra->ahead_size;
-		make_ahead_window(mapping, filp, ra, 0);
-recheck:
-		/* prev_page shouldn't overrun the ahead window */
-		ra->prev_page = min(ra->prev_page,
-			ra->ahead_start + ra->ahead_size - 1);
-	}
+	if (bdi_read_congested(mapping->backing_dev_info))
+		return;
 
-out:
-	return ra->prev_page + 1;
+	count_vm_event(RA_ASYNC);
+
+	/* do read-ahead */
+	ondemand_readahead(mapping, ra, filp, 1, offset, req_size);
 }
-EXPORT_SYMBOL_GPL(page_cache_readahead);
+EXPORT_SYMBOL_GPL(page_cache_async_readahead);
 
-/*
- * handle_ra_miss() is called when it is known that a page which should have
- * been present in the pagecache (we just did some readahead there) was in fact
- * not found.  This will happen if it was evicted by the VM (readahead
- * thrashing)
+/**
+ * page_cache_mmap_readaround - readahead for a page fault
+ * @mapping: address_space which holds the pagecache and I/O vectors
+ * @ra: file_ra_state which holds the readahead state
+ * @filp: passed on to ->readpage() and ->readpages()
+ * @offset: faulting page offset into @mapping, in PAGE_CACHE_SIZE units
  *
- * Turn on the cache miss flag in the RA struct, this will cause the RA code
- * to reduce the RA size on the next read.
+ * Reads a full ra_pages window centred on the faulting page.  The window is
+ * recorded in @ra and carries a PG_readahead marker, so that a program
+ * faulting its way through a mapping (executables and libraries, mostly)
+ * picks up async readahead and ramps from there instead of paying a major
+ * fault per window.
  */
-void handle_ra_miss(struct address_space *mapping,
-		struct file_ra_state *ra, pgoff_t offset)
+void page_cache_mmap_readaround(struct address_space *mapping,
+				struct file_ra_state *ra, struct file *filp,
+				pgoff_t offset)
 {
-	ra->flags |= RA_FLAG_MISS;
-	ra->flags &= ~RA_FLAG_INCACHE;
-	ra->cache_hit = 0;
+	unsigned long ra_pages = max_sane_readahead(ra->ra_pages);
+
+	if (!ra_pages)
+		return;
+
+	count_vm_event(RA_MMAP);
+
+	ra->start = offset > ra_pages / 2 ? offset - ra_pages / 2 : 0;
+	ra->size = ra_pages;
+	ra->async_size = ra_pages / 4;
+	ra_submit(ra, mapping, filp);
 }
 
 /*
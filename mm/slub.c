@@ -0,0 +1,1679 @@
+/*
+ * linux/mm/slub.c
+ *
+ * SLUB: an unqueued slab allocator for systems where memory, not cpu
+ * count, is the scarce resource.
+ *
+ * SLAB keeps per cpu, shared and alien object queues plus a slab
+ * management structure for every slab.  On a machine with a few
+ * megabytes of RAM those queues pin a surprising amount of memory.
+ * SLUB keeps none of them:
+ *
+ * - The free objects of a slab are chained through a free pointer stored
+ *   in the object itself (or just behind it if the object must survive
+ *   being free).  The struct page of the slab holds the list head, the
+ *   number of objects in use and the owning cache, so there is no off or
+ *   on slab management data at all.
+ *
+ * - Each cpu allocates from one "cpu slab".  Other slabs that have free
+ *   objects sit on a per cache partial list.  Full slabs are on no list.
+ *   A slab that becomes empty is handed back to the page allocator at
+ *   once unless it is the only partial slab of its cache.
+ *
+ * - kmem_cache_create() reuses an existing cache whose objects are no
+ *   more than a word bigger and whose alignment and flags are compatible
+ *   instead of opening a new one.  slub_nomerge on the command line
+ *   disables this.
+ *
+ * Locking:
+ *
+ *   slub_lock (mutex) protects the list of caches and the per cache
+ *   debug settings.
+ *
+ *   The slab lock is a bit spinlock on PG_locked of the slab page and
+ *   protects freelist and inuse.  The list_lock of the cache protects the
+ *   partial list and is taken inside the slab lock; code that walks the
+ *   partial list only trylocks slabs.
+ *
+ *   A cpu slab is "frozen" (PG_active) while it is assigned to a cpu, so
+ *   frees to it never move it to or off the partial list.  cpu_slab[] is
+ *   only touched by its own cpu with interrupts disabled.
+ *
+ * Debugging (CONFIG_SLUB_DEBUG) is compiled in but off by default.  It is
+ * switched on at boot with slub_debug=<flags>[,<cache prefix>] or per
+ * cache by writing "<cache> <flags>" to /proc/slabinfo.  Flags are
+ *
+ *	F	sanity checks on free (SLAB_DEBUG_FREE)
+ *	Z	red zoning (SLAB_RED_ZONE)
+ *	P	poisoning (SLAB_POISON)
+ *	U	track last alloc/free owner (SLAB_STORE_USER)
+ *	T	trace every alloc and free
+ *	-	none of the above
+ *
+ * Z, P and U change the object layout that the lockless fast paths
+ * rely on, so they can only be set at boot.  At run time F and T may
+ * be switched as long as Z, P and U are given as they are.  Writing
+ * "<cache> shrink" releases all empty slabs of a cache.
+ */
+
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/cache.h>
+#include <linux/ctype.h>
+#include <linux/bit_spinlock.h>
+#include <linux/interrupt.h>
+#include <linux/bitops.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+#include <linux/cpu.h>
+#include <linux/mutex.h>
+#include <linux/kallsyms.h>
+#include <linux/poison.h>
+#include <linux/rcupdate.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#include <asm/cache.h>
+
+/* Not a user visible flag: print every alloc and free of the cache */
+#define SLAB_TRACE		0x80000000UL
+
+#define SLAB_DEBUG_FLAGS	(SLAB_DEBUG_FREE | SLAB_RED_ZONE | \
+				 SLAB_POISON | SLAB_STORE_USER | SLAB_TRACE)
+
+/* Debug flags that change the object layout */
+#define SLAB_LAYOUT_FLAGS	(SLAB_RED_ZONE | SLAB_POISON | SLAB_STORE_USER)
+
+/* Caches with these flags are never merged with others */
+#define SLAB_NEVER_MERGE	(SLAB_DEBUG_FLAGS | SLAB_DESTROY_BY_RCU)
+
+/* Merged caches must agree on these */
+#define SLAB_MERGE_SAME		(SLAB_RECLAIM_ACCOUNT | SLAB_CACHE_DMA)
+
+#ifndef ARCH_KMALLOC_MINALIGN
+#define ARCH_KMALLOC_MINALIGN	__alignof__(unsigned long long)
+#endif
+
+#ifndef ARCH_SLAB_MINALIGN
+#define ARCH_SLAB_MINALIGN	__alignof__(unsigned long long)
+#endif
+
+#ifndef cache_line_size
+#define cache_line_size()	L1_CACHE_BYTES
+#endif
+
+/*
+ * Slab sizing.  Small orders keep the page allocator happy on machines
+ * with little memory; slub_min_objects only bounds the free pointer
+ * chase, it is not a queue.
+ */
+static int slub_min_order;
+static int slub_max_order = 1;
+static int slub_min_objects = 4;
+static int slub_nomerge;
+
+#ifdef CONFIG_SLUB_DEBUG
+static unsigned long slub_debug;
+static char *slub_debug_slabs;
+#endif
+
+static DEFINE_MUTEX(slub_lock);
+static LIST_HEAD(slab_caches);
+static int slab_state;			/* 1 once kmalloc works */
+
+struct kmem_cache kmalloc_caches[KMALLOC_SHIFT_HIGH + 1] __cacheline_aligned;
+EXPORT_SYMBOL(kmalloc_caches);
+
+#ifdef CONFIG_ZONE_DMA
+static struct kmem_cache kmalloc_caches_dma[KMALLOC_SHIFT_HIGH + 1];
+#endif
+
+/********************************************************************
+ * 			Core slab cache functions
+ *******************************************************************/
+
+/* The slab page an object belongs to; tail pages point at the head. */
+static inline struct page *slab_page(const void *x)
+{
+	struct page *page = virt_to_page(x);
+
+	if (unlikely(PageCompound(page)))
+		page = (struct page *)page_private(page);
+	return page;
+}
+
+static inline void slab_lock(struct page *page)
+{
+	bit_spin_lock(PG_locked, &page->flags);
+}
+
+static inline void slab_unlock(struct page *page)
+{
+	bit_spin_unlock(PG_locked, &page->flags);
+}
+
+static inline int slab_trylock(struct page *page)
+{
+	return bit_spin_trylock(PG_locked, &page->flags);
+}
+
+#define SlabFrozen(page)	PageActive(page)
+#define SetSlabFrozen(page)	SetPageActive(page)
+#define ClearSlabFrozen(page)	ClearPageActive(page)
+
+static inline void *get_freepointer(struct kmem_cache *s, void *object)
+{
+	return *(void **)(object + s->offset * sizeof(void *));
+}
+
+static inline void set_freepointer(struct kmem_cache *s, void *object,
+				   void *fp)
+{
+	*(void **)(object + s->offset * sizeof(void *)) = fp;
+}
+
+#define for_each_object(__p, __s, __addr) \
+	for (__p = (__addr); __p < (__addr) + (__s)->objects * (__s)->size;\
+			__p += (__s)->size)
+
+/* Is p a valid object address of this slab (or NULL)? */
+static inline int check_valid_pointer(struct kmem_cache *s,
+				      struct page *page, const void *p)
+{
+	void *base;
+
+	if (!p)
+		return 1;
+
+	base = page_address(page);
+	if (p < base || p >= base + s->objects * s->size ||
+	    (p - base) % s->size)
+		return 0;
+	return 1;
+}
+
+/********************************************************************
+ * 			Debug support
+ *******************************************************************/
+
+#ifdef CONFIG_SLUB_DEBUG
+
+struct track {
+	void *addr;		/* Caller */
+	int cpu;
+	int pid;
+	unsigned long when;	/* jiffies */
+};
+
+enum track_item { TRACK_ALLOC, TRACK_FREE };
+
+static struct track *get_track(struct kmem_cache *s, void *object,
+			       enum track_item alloc)
+{
+	struct track *p;
+
+	if (s->offset)
+		p = object + (s->offset + 1) * sizeof(void *);
+	else
+		p = object + s->inuse;
+	return p + alloc;
+}
+
+static void set_track(struct kmem_cache *s, void *object,
+		      enum track_item alloc, void *addr)
+{
+	struct track *p = get_track(s, object, alloc);
+
+	if (addr) {
+		p->addr = addr;
+		p->cpu = smp_processor_id();
+		p->pid = in_interrupt() ? -1 : current->pid;
+		p->when = jiffies;
+	} else
+		memset(p, 0, sizeof(struct track));
+}
+
+static void init_tracking(struct kmem_cache *s, void *object)
+{
+	if (s->flags & SLAB_STORE_USER) {
+		set_track(s, object, TRACK_FREE, NULL);
+		set_track(s, object, TRACK_ALLOC, NULL);
+	}
+}
+
+static void print_track(const char *s, struct track *t)
+{
+	if (!t->addr)
+		return;
+
+	printk(KERN_ERR "%s: ", s);
+	print_symbol("%s", (unsigned long)t->addr);
+	printk(" jiffies_ago=%lu cpu=%u pid=%d\n",
+	       jiffies - t->when, t->cpu, t->pid);
+}
+
+static void print_section(const char *text, u8 *addr, unsigned int length)
+{
+	int i, offset;
+	int newline = 1;
+	char ascii[17];
+
+	ascii[16] = 0;
+
+	for (i = 0; i < length; i++) {
+		if (newline) {
+			printk(KERN_ERR "%10s 0x%p: ", text, addr + i);
+			newline = 0;
+		}
+		printk(" %02x", addr[i]);
+		offset = i % 16;
+		ascii[offset] = isgraph(addr[i]) ? addr[i] : '.';
+		if (offset == 15) {
+			printk(" %s\n", ascii);
+			newline = 1;
+		}
+	}
+	if (!newline) {
+		i %= 16;
+		while (i < 16) {
+			printk("   ");
+			ascii[i] = ' ';
+			i++;
+		}
+		printk(" %s\n", ascii);
+	}
+}
+
+static void print_trailer(struct kmem_cache *s, u8 *p)
+{
+	if (s->flags & SLAB_RED_ZONE)
+		print_section("Redzone", p + s->objsize,
+			      s->inuse - s->objsize);
+
+	printk(KERN_ERR "FreePointer 0x%p -> 0x%p\n",
+	       p + s->offset * sizeof(void *), get_freepointer(s, p));
+
+	if (s->flags & SLAB_STORE_USER) {
+		print_track("Last alloc", get_track(s, p, TRACK_ALLOC));
+		print_track("Last free ", get_track(s, p, TRACK_FREE));
+	}
+}
+
+static void object_err(struct kmem_cache *s, struct page *page,
+		       u8 *object, const char *reason)
+{
+	printk(KERN_ERR "*** SLUB %s: %s @0x%p slab 0x%p\n",
+	       s->name, reason, object, page);
+	printk(KERN_ERR "    offset=%td flags=0x%04lx inuse=%u freelist=0x%p\n",
+	       object - (u8 *)page_address(page), page->flags, page->inuse,
+	       page->freelist);
+	print_section("Object", object, min(s->objsize, 128));
+	print_trailer(s, object);
+	dump_stack();
+}
+
+static void slab_err(struct kmem_cache *s, struct page *page,
+		     const char *reason)
+{
+	printk(KERN_ERR "*** SLUB %s: %s in slab @0x%p\n",
+	       s->name, reason, page);
+	printk(KERN_ERR "    flags=0x%04lx inuse=%u freelist=0x%p\n",
+	       page->flags, page->inuse, page->freelist);
+	dump_stack();
+}
+
+static void init_object(struct kmem_cache *s, void *object, int active)
+{
+	u8 *p = object;
+
+	if (s->flags & SLAB_POISON) {
+		memset(p, POISON_FREE, s->objsize - 1);
+		p[s->objsize - 1] = POISON_END;
+	}
+
+	if (s->flags & SLAB_RED_ZONE)
+		memset(p + s->objsize,
+		       active ? SLUB_RED_ACTIVE : SLUB_RED_INACTIVE,
+		       s->inuse - s->objsize);
+}
+
+/* Returns the first byte in [start, start + bytes) that is not value */
+static u8 *check_bytes(u8 *start, unsigned int value, unsigned int bytes)
+{
+	while (bytes) {
+		if (*start != (u8)value)
+			return start;
+		start++;
+		bytes--;
+	}
+	return NULL;
+}
+
+/*
+ * Check one object.  Damaged red zones and poison are reported and then
+ * restored so that the same corruption is not reported over and over.
+ */
+static int check_object(struct kmem_cache *s, struct page *page,
+			void *object, int active)
+{
+	u8 *p = object;
+	u8 *endobject = object + s->objsize;
+	u8 *fault;
+
+	if (s->flags & SLAB_RED_ZONE) {
+		unsigned int red = active ? SLUB_RED_ACTIVE : SLUB_RED_INACTIVE;
+
+		fault = check_bytes(endobject, red, s->inuse - s->objsize);
+		if (fault) {
+			object_err(s, page, object, active ?
+				   "Redzone overwritten" :
+				   "Redzone of free object overwritten");
+			memset(endobject, red, s->inuse - s->objsize);
+			return 0;
+		}
+	}
+
+	if ((s->flags & SLAB_POISON) && !active) {
+		if (check_bytes(p, POISON_FREE, s->objsize - 1) ||
+		    p[s->objsize - 1] != POISON_END) {
+			object_err(s, page, object, "Poison overwritten");
+			init_object(s, object, 0);
+			return 0;
+		}
+	}
+
+	/* A live object with the free pointer at offset 0 holds user data */
+	if (!s->offset && active)
+		return 1;
+
+	if (!check_valid_pointer(s, page, get_freepointer(s, object))) {
+		object_err(s, page, object, "Freepointer corrupt");
+		/*
+		 * Cut off the rest of the freelist; the objects on it are
+		 * lost but the slab can still be used.
+		 */
+		set_freepointer(s, object, NULL);
+		return 0;
+	}
+	return 1;
+}
+
+static int check_slab(struct kmem_cache *s, struct page *page)
+{
+	if (!PageSlab(page)) {
+		slab_err(s, page, "Not a valid slab page");
+		return 0;
+	}
+	if (page->slab != s) {
+		slab_err(s, page, "Slab belongs to another cache");
+		return 0;
+	}
+	if (page->inuse > s->objects) {
+		slab_err(s, page, "inuse exceeds number of objects");
+		return 0;
+	}
+	return 1;
+}
+
+/* Is search on the freelist of page?  Caller holds the slab lock. */
+static int on_freelist(struct kmem_cache *s, struct page *page, void *search)
+{
+	void *fp = page->freelist;
+	int nr = 0;
+
+	while (fp && nr <= s->objects) {
+		if (fp == search)
+			return 1;
+		if (!check_valid_pointer(s, page, fp)) {
+			slab_err(s, page, "Freelist corrupt");
+			return 0;
+		}
+		fp = get_freepointer(s, fp);
+		nr++;
+	}
+	return 0;
+}
+
+static void trace(struct kmem_cache *s, struct page *page, void *object,
+		  int alloc)
+{
+	if (s->flags & SLAB_TRACE) {
+		printk(KERN_INFO "TRACE %s %s 0x%p inuse=%d fp=0x%p\n",
+		       s->name, alloc ? "alloc" : "free", object,
+		       page->inuse, page->freelist);
+		if (!alloc)
+			print_section("Object", object, min(s->objsize, 32));
+		dump_stack();
+	}
+}
+
+static void setup_object_debug(struct kmem_cache *s, struct page *page,
+			       void *object)
+{
+	if (!(s->flags & (SLAB_STORE_USER | SLAB_RED_ZONE | SLAB_POISON)))
+		return;
+
+	init_object(s, object, 0);
+	init_tracking(s, object);
+}
+
+static int alloc_debug_processing(struct kmem_cache *s, struct page *page,
+				  void *object, void *addr)
+{
+	if (!check_slab(s, page))
+		goto bad;
+
+	if (!check_valid_pointer(s, page, object)) {
+		object_err(s, page, object, "Freelist pointer check fails");
+		goto bad;
+	}
+
+	if (!check_object(s, page, object, 0))
+		goto bad;
+
+	if (s->flags & SLAB_STORE_USER)
+		set_track(s, object, TRACK_ALLOC, addr);
+	trace(s, page, object, 1);
+	init_object(s, object, 1);
+	return 1;
+
+bad:
+	if (PageSlab(page)) {
+		/*
+		 * Leak the rest of the slab rather than hand out objects
+		 * from a freelist that is known to be damaged.
+		 */
+		printk(KERN_ERR "SLUB %s: marking all objects used\n", s->name);
+		page->inuse = s->objects;
+		page->freelist = NULL;
+	}
+	return 0;
+}
+
+static int free_debug_processing(struct kmem_cache *s, struct page *page,
+				 void *object, void *addr)
+{
+	if (!check_slab(s, page))
+		return 0;
+
+	if (!check_valid_pointer(s, page, object)) {
+		slab_err(s, page, "Invalid object pointer freed");
+		return 0;
+	}
+
+	if (on_freelist(s, page, object)) {
+		object_err(s, page, object, "Object already free");
+		return 0;
+	}
+
+	if (!check_object(s, page, object, 1))
+		return 0;
+
+	if (s->flags & SLAB_STORE_USER)
+		set_track(s, object, TRACK_FREE, addr);
+	trace(s, page, object, 0);
+	init_object(s, object, 0);
+	return 1;
+}
+
+/* Tail of the slab behind the last object, filled on slab creation */
+static void slab_pad_check(struct kmem_cache *s, struct page *page)
+{
+	u8 *start, *end;
+	unsigned int length;
+
+	if (!(s->flags & SLAB_POISON))
+		return;
+
+	start = page_address(page);
+	end = start + (PAGE_SIZE << s->order);
+	start += s->objects * s->size;
+	length = end - start;
+	if (check_bytes(start, POISON_INUSE, length)) {
+		slab_err(s, page, "Padding overwritten");
+		print_section("Padding", start, min(length, 64U));
+		memset(start, POISON_INUSE, length);
+	}
+}
+
+static void slab_pad_init(struct kmem_cache *s, struct page *page)
+{
+	u8 *start = page_address(page);
+
+	if (s->flags & SLAB_POISON)
+		memset(start + s->objects * s->size, POISON_INUSE,
+		       (PAGE_SIZE << s->order) - s->objects * s->size);
+}
+
+/*
+ * Parse a debug flag string.  Returns -1 on an unknown character.
+ */
+static long parse_debug_flags(const char *str)
+{
+	unsigned long flags = 0;
+
+	for (; *str && *str != ','; str++) {
+		switch (tolower(*str)) {
+		case '-':
+			break;
+		case 'f':
+			flags |= SLAB_DEBUG_FREE;
+			break;
+		case 'z':
+			flags |= SLAB_RED_ZONE;
+			break;
+		case 'p':
+			flags |= SLAB_POISON;
+			break;
+		case 'u':
+			flags |= SLAB_STORE_USER;
+			break;
+		case 't':
+			flags |= SLAB_TRACE;
+			break;
+		default:
+			return -1;
+		}
+	}
+	return flags;
+}
+
+static int __init setup_slub_debug(char *str)
+{
+	long flags;
+
+	if (!str || *str != '=') {
+		/* Plain "slub_debug": everything but tracing */
+		slub_debug = SLAB_DEBUG_FLAGS & ~SLAB_TRACE;
+		return 1;
+	}
+	str++;
+	flags = *str == ',' ? SLAB_DEBUG_FLAGS & ~SLAB_TRACE :
+			      parse_debug_flags(str);
+	if (flags < 0) {
+		printk(KERN_ERR "slub_debug option '%s' unknown\n", str);
+		return 1;
+	}
+	slub_debug = flags;
+
+	str = strchr(str, ',');
+	if (str && *++str)
+		slub_debug_slabs = str;
+	return 1;
+}
+__setup("slub_debug", setup_slub_debug);
+
+static unsigned long kmem_cache_flags(unsigned long flags, const char *name)
+{
+	if (slub_debug && (!slub_debug_slabs ||
+	    !strncmp(slub_debug_slabs, name, strlen(slub_debug_slabs))))
+		flags |= slub_debug;
+	return flags;
+}
+
+#else /* !CONFIG_SLUB_DEBUG */
+
+static inline void setup_object_debug(struct kmem_cache *s,
+				      struct page *page, void *object) {}
+static inline int alloc_debug_processing(struct kmem_cache *s,
+					 struct page *page, void *object,
+					 void *addr) { return 0; }
+static inline int free_debug_processing(struct kmem_cache *s,
+					struct page *page, void *object,
+					void *addr) { return 0; }
+static inline int check_object(struct kmem_cache *s, struct page *page,
+			       void *object, int active) { return 1; }
+static inline void slab_pad_check(struct kmem_cache *s,
+				  struct page *page) {}
+static inline void slab_pad_init(struct kmem_cache *s, struct page *page) {}
+
+static inline unsigned long kmem_cache_flags(unsigned long flags,
+					     const char *name)
+{
+	return flags & ~SLAB_DEBUG_FLAGS;
+}
+
+#endif /* CONFIG_SLUB_DEBUG */
+
+/********************************************************************
+ * 			Slab allocation and freeing
+ *******************************************************************/
+
+static inline int slab_account(struct kmem_cache *s)
+{
+	return (s->flags & SLAB_RECLAIM_ACCOUNT) ?
+		NR_SLAB_RECLAIMABLE : NR_SLAB_UNRECLAIMABLE;
+}
+
+static struct page *allocate_slab(struct kmem_cache *s, gfp_t flags)
+{
+	struct page *page;
+
+	if (s->order)
+		flags |= __GFP_COMP;
+	if (s->flags & SLAB_CACHE_DMA)
+		flags |= GFP_DMA;
+
+	page = alloc_pages(flags, s->order);
+	if (!page)
+		return NULL;
+
+	mod_zone_page_state(page_zone(page), slab_account(s), 1 << s->order);
+	return page;
+}
+
+static void setup_object(struct kmem_cache *s, struct page *page,
+			 void *object, unsigned long ctor_flags)
+{
+	setup_object_debug(s, page, object);
+	if (unlikely(s->ctor))
+		s->ctor(object, s, ctor_flags);
+}
+
+static struct page *new_slab(struct kmem_cache *s, gfp_t flags)
+{
+	struct page *page;
+	unsigned long ctor_flags = SLAB_CTOR_CONSTRUCTOR;
+	void *start, *last, *p;
+
+	flags &= GFP_LEVEL_MASK;
+	if (!(flags & __GFP_WAIT))
+		ctor_flags |= SLAB_CTOR_ATOMIC;
+
+	page = allocate_slab(s, flags);
+	if (!page)
+		return NULL;
+
+	atomic_long_inc(&s->nr_slabs);
+	page->slab = s;
+	__SetPageSlab(page);
+
+	start = page_address(page);
+	slab_pad_init(s, page);
+
+	last = start;
+	for_each_object(p, s, start + s->size) {
+		setup_object(s, page, last, ctor_flags);
+		set_freepointer(s, last, p);
+		last = p;
+	}
+	setup_object(s, page, last, ctor_flags);
+	set_freepointer(s, last, NULL);
+
+	page->freelist = start;
+	page->inuse = 0;
+	return page;
+}
+
+static void __free_slab(struct kmem_cache *s, struct page *page)
+{
+	int pages = 1 << s->order;
+
+	if (unlikely((s->flags & SLAB_LAYOUT_FLAGS) || s->dtor)) {
+		void *p;
+
+		slab_pad_check(s, page);
+		for_each_object(p, s, page_address(page)) {
+			if (s->dtor)
+				s->dtor(p, s, 0);
+			check_object(s, page, p, 0);
+		}
+	}
+
+	mod_zone_page_state(page_zone(page), slab_account(s), -pages);
+
+	page->mapping = NULL;
+	reset_page_mapcount(page);
+	__ClearPageSlab(page);
+	__free_pages(page, s->order);
+}
+
+static void rcu_free_slab(struct rcu_head *h)
+{
+	struct page *page;
+
+	page = container_of((struct list_head *)h, struct page, lru);
+	__free_slab(page->slab, page);
+}
+
+static void free_slab(struct kmem_cache *s, struct page *page)
+{
+	if (unlikely(s->flags & SLAB_DESTROY_BY_RCU)) {
+		/* page->lru is free once the slab is off the partial list */
+		struct rcu_head *head = (void *)&page->lru;
+
+		call_rcu(head, rcu_free_slab);
+	} else
+		__free_slab(s, page);
+}
+
+static void discard_slab(struct kmem_cache *s, struct page *page)
+{
+	atomic_long_dec(&s->nr_slabs);
+	free_slab(s, page);
+}
+
+/********************************************************************
+ * 			Partial list management
+ *******************************************************************/
+
+static void add_partial(struct kmem_cache *s, struct page *page)
+{
+	spin_lock(&s->list_lock);
+	s->nr_partial++;
+	list_add(&page->lru, &s->partial);
+	spin_unlock(&s->list_lock);
+}
+
+/* Empty slabs go to the tail so that partial slabs fill up first */
+static void add_partial_tail(struct kmem_cache *s, struct page *page)
+{
+	spin_lock(&s->list_lock);
+	s->nr_partial++;
+	list_add_tail(&page->lru, &s->partial);
+	spin_unlock(&s->list_lock);
+}
+
+static void remove_partial(struct kmem_cache *s, struct page *page)
+{
+	spin_lock(&s->list_lock);
+	list_del(&page->lru);
+	s->nr_partial--;
+	spin_unlock(&s->list_lock);
+}
+
+/*
+ * Take a partial slab off the list, locked and frozen, for use as a cpu
+ * slab.  Called with interrupts disabled.
+ */
+static struct page *get_partial(struct kmem_cache *s)
+{
+	struct page *page;
+
+	/* Racy check, an empty list is the common case worth skipping */
+	if (!s->nr_partial)
+		return NULL;
+
+	spin_lock(&s->list_lock);
+	list_for_each_entry(page, &s->partial, lru) {
+		if (slab_trylock(page)) {
+			list_del(&page->lru);
+			s->nr_partial--;
+			SetSlabFrozen(page);
+			spin_unlock(&s->list_lock);
+			return page;
+		}
+	}
+	spin_unlock(&s->list_lock);
+	return NULL;
+}
+
+/*
+ * Give a cpu slab back.  Called with the slab locked and interrupts
+ * disabled; drops the slab lock.
+ */
+static void unfreeze_slab(struct kmem_cache *s, struct page *page)
+{
+	ClearSlabFrozen(page);
+	if (page->inuse) {
+		if (page->freelist)
+			add_partial(s, page);
+		slab_unlock(page);
+	} else if (!s->nr_partial) {
+		/* Keep one empty slab around rather than thrash */
+		add_partial_tail(s, page);
+		slab_unlock(page);
+	} else {
+		slab_unlock(page);
+		discard_slab(s, page);
+	}
+}
+
+static void deactivate_slab(struct kmem_cache *s, struct page *page, int cpu)
+{
+	s->cpu_slab[cpu] = NULL;
+	unfreeze_slab(s, page);
+}
+
+static void __flush_cpu_slab(struct kmem_cache *s, int cpu)
+{
+	struct page *page = s->cpu_slab[cpu];
+
+	if (page) {
+		slab_lock(page);
+		deactivate_slab(s, page, cpu);
+	}
+}
+
+static void flush_cpu_slab(void *d)
+{
+	__flush_cpu_slab(d, smp_processor_id());
+}
+
+static void flush_all(struct kmem_cache *s)
+{
+#ifdef CONFIG_SMP
+	on_each_cpu(flush_cpu_slab, s, 1, 1);
+#else
+	unsigned long flags;
+
+	local_irq_save(flags);
+	flush_cpu_slab(s);
+	local_irq_restore(flags);
+#endif
+}
+
+/********************************************************************
+ * 			Object allocation and freeing
+ *******************************************************************/
+
+static void *slab_alloc(struct kmem_cache *s, gfp_t gfpflags, void *addr)
+{
+	struct page *page;
+	void **object;
+	unsigned long flags;
+	int cpu;
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	page = s->cpu_slab[cpu];
+	if (!page)
+		goto new_slab;
+
+	slab_lock(page);
+redo:
+	object = page->freelist;
+	if (unlikely(!object))
+		goto another_slab;
+	if (unlikely(s->flags & SLAB_DEBUG_FLAGS))
+		goto debug;
+
+have_object:
+	page->inuse++;
+	page->freelist = get_freepointer(s, object);
+	/*
+	 * A full cpu slab is let go at once, so that it is discarded as
+	 * soon as its objects are freed instead of sitting on this cpu.
+	 */
+	if (unlikely(!page->freelist))
+		deactivate_slab(s, page, cpu);
+	else
+		slab_unlock(page);
+	local_irq_restore(flags);
+	return object;
+
+another_slab:
+	deactivate_slab(s, page, cpu);
+
+new_slab:
+	page = get_partial(s);
+	if (page) {
+		s->cpu_slab[cpu] = page;
+		goto redo;
+	}
+
+	if (gfpflags & __GFP_WAIT)
+		local_irq_enable();
+	page = new_slab(s, gfpflags);
+	if (gfpflags & __GFP_WAIT)
+		local_irq_disable();
+
+	if (page) {
+		cpu = smp_processor_id();
+		/* We may have been preempted and refilled meanwhile */
+		if (s->cpu_slab[cpu])
+			__flush_cpu_slab(s, cpu);
+		slab_lock(page);
+		SetSlabFrozen(page);
+		s->cpu_slab[cpu] = page;
+		goto redo;
+	}
+	local_irq_restore(flags);
+	return NULL;
+
+debug:
+	if (!alloc_debug_processing(s, page, object, addr))
+		goto another_slab;
+	goto have_object;
+}
+
+static void slab_free(struct kmem_cache *s, struct page *page,
+		      void *x, void *addr)
+{
+	void *prior;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	slab_lock(page);
+
+	if (unlikely(s->flags & SLAB_DEBUG_FLAGS))
+		goto debug;
+
+checks_ok:
+	prior = page->freelist;
+	set_freepointer(s, x, prior);
+	page->freelist = x;
+	page->inuse--;
+
+	if (unlikely(SlabFrozen(page)))
+		goto out_unlock;
+
+	if (unlikely(!page->inuse))
+		goto slab_empty;
+
+	/* A full slab got a free object, it is partial now */
+	if (unlikely(!prior))
+		add_partial(s, page);
+
+out_unlock:
+	slab_unlock(page);
+	local_irq_restore(flags);
+	return;
+
+slab_empty:
+	if (prior) {
+		/* Keep the last partial slab rather than thrash */
+		if (s->nr_partial == 1)
+			goto out_unlock;
+		remove_partial(s, page);
+	}
+	slab_unlock(page);
+	local_irq_restore(flags);
+	discard_slab(s, page);
+	return;
+
+debug:
+	if (!free_debug_processing(s, page, x, addr))
+		goto out_unlock;
+	goto checks_ok;
+}
+
+void *kmem_cache_alloc(struct kmem_cache *s, gfp_t gfpflags)
+{
+	return slab_alloc(s, gfpflags, __builtin_return_address(0));
+}
+EXPORT_SYMBOL(kmem_cache_alloc);
+
+void *kmem_cache_zalloc(struct kmem_cache *s, gfp_t gfpflags)
+{
+	void *x = slab_alloc(s, gfpflags, __builtin_return_address(0));
+
+	if (x)
+		memset(x, 0, s->objsize);
+	return x;
+}
+EXPORT_SYMBOL(kmem_cache_zalloc);
+
+void kmem_cache_free(struct kmem_cache *s, void *x)
+{
+	slab_free(s, slab_page(x), x, __builtin_return_address(0));
+}
+EXPORT_SYMBOL(kmem_cache_free);
+
+unsigned int kmem_cache_size(struct kmem_cache *s)
+{
+	return s->objsize;
+}
+EXPORT_SYMBOL(kmem_cache_size);
+
+const char *kmem_cache_name(struct kmem_cache *s)
+{
+	return s->name;
+}
+EXPORT_SYMBOL(kmem_cache_name);
+
+/*
+ * See the comment in mm/slab.c: only checks that ptr may be an object
+ * of cachep, not that it is allocated.
+ */
+int kmem_ptr_validate(struct kmem_cache *s, const void *ptr)
+{
+	unsigned long addr = (unsigned long)ptr;
+	struct page *page;
+
+	if (unlikely(addr < PAGE_OFFSET))
+		return 0;
+	if (unlikely(addr > (unsigned long)high_memory - s->size))
+		return 0;
+	if (unlikely(addr & (sizeof(void *) - 1)))
+		return 0;
+	if (unlikely(!kern_addr_valid(addr)))
+		return 0;
+	if (unlikely(!kern_addr_valid(addr + s->size - 1)))
+		return 0;
+	page = slab_page(ptr);
+	if (unlikely(!PageSlab(page) || page->slab != s))
+		return 0;
+	return check_valid_pointer(s, page, ptr);
+}
+EXPORT_SYMBOL(kmem_ptr_validate);
+
+/********************************************************************
+ * 			Cache setup
+ *******************************************************************/
+
+/*
+ * Alignment as SLAB does it: cache line alignment for
+ * SLAB_HWCACHE_ALIGN, halved while two objects still fit in a line.
+ */
+static unsigned long calculate_alignment(unsigned long flags,
+					 unsigned long align,
+					 unsigned long size)
+{
+	if (flags & (SLAB_HWCACHE_ALIGN | SLAB_MUST_HWCACHE_ALIGN)) {
+		unsigned long ralign = cache_line_size();
+
+		while (size <= ralign / 2)
+			ralign /= 2;
+		align = max(align, ralign);
+	}
+	if (align < ARCH_SLAB_MINALIGN)
+		align = ARCH_SLAB_MINALIGN;
+	return ALIGN(align, sizeof(void *));
+}
+
+/*
+ * Pick the slab order.  The first order from slub_min_order up that
+ * holds slub_min_objects with no more than 1/8 of the slab left over
+ * wins; otherwise the order wasting the smallest fraction.  Objects too
+ * big for slub_max_order get a slab of their own.
+ */
+static int calculate_order(unsigned long size)
+{
+	int order, best = -1;
+	unsigned long best_rem = 0;
+
+	for (order = slub_min_order; order <= slub_max_order; order++) {
+		unsigned long slab_size = PAGE_SIZE << order;
+		unsigned long rem;
+
+		if (slab_size < size)
+			continue;
+		rem = slab_size % size;
+		if (slab_size / size >= slub_min_objects && rem * 8 <= slab_size)
+			return order;
+		/* compare waste as a fraction of slub_max_order slabs */
+		rem <<= slub_max_order - order;
+		if (best < 0 || rem < best_rem) {
+			best = order;
+			best_rem = rem;
+		}
+	}
+	if (best < 0)
+		best = get_order(size);
+	return best;
+}
+
+/*
+ * Lay out an object:
+ *
+ *	object		s->objsize bytes
+ *	red zone	up to s->inuse, at least one word (SLAB_RED_ZONE)
+ *	free pointer	at s->offset words if the object must stay intact
+ *			while free (poison, ctor/dtor, RCU); else offset 0
+ *	tracking	two struct track (SLAB_STORE_USER)
+ *	padding		up to s->size, for alignment
+ */
+static int calculate_sizes(struct kmem_cache *s)
+{
+	unsigned long size = ALIGN(s->objsize, sizeof(void *));
+	unsigned long align;
+
+	/* Poison would destroy what a ctor set up or an RCU reader sees */
+	if (s->ctor || s->dtor || (s->flags & SLAB_DESTROY_BY_RCU))
+		s->flags &= ~SLAB_POISON;
+
+	if ((s->flags & SLAB_RED_ZONE) && size == s->objsize)
+		size += sizeof(void *);
+	s->inuse = size;
+
+	if ((s->flags & (SLAB_POISON | SLAB_DESTROY_BY_RCU)) ||
+	    s->ctor || s->dtor) {
+		s->offset = size / sizeof(void *);
+		size += sizeof(void *);
+	} else
+		s->offset = 0;
+
+#ifdef CONFIG_SLUB_DEBUG
+	if (s->flags & SLAB_STORE_USER)
+		size += 2 * sizeof(struct track);
+#endif
+
+	align = calculate_alignment(s->flags, s->align, s->objsize);
+	s->size = ALIGN(size, align);
+
+	s->order = calculate_order(s->size);
+	if (s->order < 0 || s->order >= MAX_ORDER)
+		return 0;
+
+	s->objects = (PAGE_SIZE << s->order) / s->size;
+	return s->objects != 0;
+}
+
+static int kmem_cache_open(struct kmem_cache *s, const char *name,
+		size_t size, size_t align, unsigned long flags,
+		void (*ctor)(void *, struct kmem_cache *, unsigned long),
+		void (*dtor)(void *, struct kmem_cache *, unsigned long))
+{
+	memset(s, 0, sizeof(struct kmem_cache));
+	s->name = name;
+	s->ctor = ctor;
+	s->dtor = dtor;
+	s->objsize = size;
+	s->align = align;
+	s->flags = kmem_cache_flags(flags, name);
+
+	if (!calculate_sizes(s)) {
+		if (flags & SLAB_PANIC)
+			panic("Cannot open slab %s size=%lu realsize=%u "
+			      "order=%d offset=%u flags=%lx\n", name,
+			      (unsigned long)size, s->size, s->order,
+			      s->offset, flags);
+		return 0;
+	}
+
+	s->refcount = 1;
+	spin_lock_init(&s->list_lock);
+	INIT_LIST_HEAD(&s->partial);
+	atomic_long_set(&s->nr_slabs, 0);
+	return 1;
+}
+
+/* Free all empty partial slabs.  Returns the number of slabs left. */
+static unsigned long free_empty_partials(struct kmem_cache *s)
+{
+	struct page *page, *t;
+	unsigned long flags;
+	LIST_HEAD(empty);
+
+	spin_lock_irqsave(&s->list_lock, flags);
+	list_for_each_entry_safe(page, t, &s->partial, lru) {
+		if (page->inuse || !slab_trylock(page))
+			continue;
+		if (!page->inuse) {
+			list_move(&page->lru, &empty);
+			s->nr_partial--;
+		}
+		slab_unlock(page);
+	}
+	spin_unlock_irqrestore(&s->list_lock, flags);
+
+	/* Nobody can reach these slabs any more */
+	list_for_each_entry_safe(page, t, &empty, lru) {
+		list_del(&page->lru);
+		discard_slab(s, page);
+	}
+	return atomic_long_read(&s->nr_slabs);
+}
+
+int kmem_cache_shrink(struct kmem_cache *s)
+{
+	flush_all(s);
+	free_empty_partials(s);
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_shrink);
+
+/*
+ * Look for a cache that objects of this kind can share.  Called with
+ * slub_lock held.
+ */
+static struct kmem_cache *find_mergeable(const char *name, size_t size,
+		size_t align, unsigned long flags,
+		void (*ctor)(void *, struct kmem_cache *, unsigned long),
+		void (*dtor)(void *, struct kmem_cache *, unsigned long))
+{
+	struct kmem_cache *s;
+
+	if (slub_nomerge || ctor || dtor)
+		return NULL;
+	if (kmem_cache_flags(flags, name) & SLAB_NEVER_MERGE)
+		return NULL;
+
+	size = ALIGN(size, sizeof(void *));
+	align = calculate_alignment(flags, align, size);
+	size = ALIGN(size, align);
+
+	list_for_each_entry(s, &slab_caches, list) {
+		if (s->ctor || s->dtor || (s->flags & SLAB_NEVER_MERGE))
+			continue;
+		if (size > s->size)
+			continue;
+		if ((flags & SLAB_MERGE_SAME) != (s->flags & SLAB_MERGE_SAME))
+			continue;
+		/* s must be at least as aligned as asked for */
+		if (s->size & (align - 1))
+			continue;
+		/* and not waste more than a word per object */
+		if (s->size - size >= sizeof(void *))
+			continue;
+		return s;
+	}
+	return NULL;
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size,
+		size_t align, unsigned long flags,
+		void (*ctor)(void *, struct kmem_cache *, unsigned long),
+		void (*dtor)(void *, struct kmem_cache *, unsigned long))
+{
+	struct kmem_cache *s;
+
+	BUG_ON(!name || in_interrupt() || (dtor && !ctor));
+
+	mutex_lock(&slub_lock);
+	s = find_mergeable(name, size, align, flags, ctor, dtor);
+	if (s) {
+		s->refcount++;
+		s->objsize = max(s->objsize, (int)size);
+		s->inuse = max_t(int, s->inuse, ALIGN(size, sizeof(void *)));
+		mutex_unlock(&slub_lock);
+		return s;
+	}
+
+	/*
+	 * The name is copied: a merged cache outlives the kmem_cache_create()
+	 * caller that named it, which may be a module.
+	 */
+	s = kmalloc(sizeof(struct kmem_cache) + strlen(name) + 1, GFP_KERNEL);
+	if (s) {
+		char *n = (char *)(s + 1);
+
+		strcpy(n, name);
+		if (kmem_cache_open(s, n, size, align, flags, ctor, dtor)) {
+			list_add(&s->list, &slab_caches);
+			mutex_unlock(&slub_lock);
+			return s;
+		}
+		kfree(s);
+	}
+	mutex_unlock(&slub_lock);
+
+	if (flags & SLAB_PANIC)
+		panic("kmem_cache_create(): failed to create slab `%s'\n", name);
+	return NULL;
+}
+EXPORT_SYMBOL(kmem_cache_create);
+
+void kmem_cache_destroy(struct kmem_cache *s)
+{
+	mutex_lock(&slub_lock);
+	if (--s->refcount) {
+		mutex_unlock(&slub_lock);
+		return;
+	}
+
+	flush_all(s);
+	if (free_empty_partials(s)) {
+		/* Like SLAB, leave a cache with live objects in place */
+		s->refcount++;
+		mutex_unlock(&slub_lock);
+		printk(KERN_ERR "slab error in kmem_cache_destroy(): "
+		       "cache `%s': Can't free all objects\n", s->name);
+		dump_stack();
+		return;
+	}
+	list_del(&s->list);
+	mutex_unlock(&slub_lock);
+
+	/* rcu_free_slab() still needs s */
+	if (s->flags & SLAB_DESTROY_BY_RCU)
+		rcu_barrier();
+	kfree(s);
+}
+EXPORT_SYMBOL(kmem_cache_destroy);
+
+/********************************************************************
+ * 			Kmalloc subsystem
+ *******************************************************************/
+
+static struct kmem_cache *get_slab(size_t size, gfp_t flags)
+{
+	int index = kmalloc_index(size);
+
+	if (unlikely(index < 0))
+		return NULL;
+#ifdef CONFIG_ZONE_DMA
+	if (unlikely(flags & __GFP_DMA))
+		return &kmalloc_caches_dma[index];
+#endif
+	return &kmalloc_caches[index];
+}
+
+void *__kmalloc(size_t size, gfp_t flags)
+{
+	struct kmem_cache *s = get_slab(size, flags);
+
+	if (unlikely(!s))
+		return NULL;
+	return slab_alloc(s, flags, __builtin_return_address(0));
+}
+EXPORT_SYMBOL(__kmalloc);
+
+void kfree(const void *x)
+{
+	struct page *page;
+
+	if (unlikely(!x))
+		return;
+
+	page = slab_page(x);
+	slab_free(page->slab, page, (void *)x, __builtin_return_address(0));
+}
+EXPORT_SYMBOL(kfree);
+
+unsigned int ksize(const void *x)
+{
+	struct kmem_cache *s;
+
+	if (unlikely(!x))
+		return 0;
+
+	s = slab_page(x)->slab;
+
+	/* Red zone and poison checks start right behind the object */
+	if (s->flags & (SLAB_RED_ZONE | SLAB_POISON))
+		return s->objsize;
+
+	/* Metadata follows at s->inuse */
+	if (s->offset || (s->flags & SLAB_STORE_USER))
+		return s->inuse;
+
+	return s->size;
+}
+EXPORT_SYMBOL(ksize);
+
+int slab_is_available(void)
+{
+	return slab_state;
+}
+
+static char kmalloc_names[2][KMALLOC_SHIFT_HIGH + 1][16];
+
+static void __init create_kmalloc_cache(struct kmem_cache *s, int index,
+					int size, int dma)
+{
+	char *name = kmalloc_names[dma][index];
+	unsigned long flags = SLAB_PANIC;
+
+	sprintf(name, dma ? "size-%d(DMA)" : "size-%d", size);
+	if (dma)
+		flags |= SLAB_CACHE_DMA;
+	kmem_cache_open(s, name, size, ARCH_KMALLOC_MINALIGN, flags,
+			NULL, NULL);
+	list_add(&s->list, &slab_caches);
+}
+
+static void __init create_kmalloc_caches(struct kmem_cache *caches, int dma)
+{
+	int i;
+
+	for (i = KMALLOC_SHIFT_LOW; i <= KMALLOC_SHIFT_HIGH; i++)
+		create_kmalloc_cache(&caches[i], i, 1 << i, dma);
+	if (KMALLOC_MIN_SIZE <= 32)
+		create_kmalloc_cache(&caches[1], 1, 96, dma);
+	if (KMALLOC_MIN_SIZE <= 64)
+		create_kmalloc_cache(&caches[2], 2, 192, dma);
+}
+
+static int __init setup_slub_min_order(char *str)
+{
+	get_option(&str, &slub_min_order);
+	return 1;
+}
+__setup("slub_min_order=", setup_slub_min_order);
+
+static int __init setup_slub_max_order(char *str)
+{
+	get_option(&str, &slub_max_order);
+	return 1;
+}
+__setup("slub_max_order=", setup_slub_max_order);
+
+static int __init setup_slub_min_objects(char *str)
+{
+	get_option(&str, &slub_min_objects);
+	return 1;
+}
+__setup("slub_min_objects=", setup_slub_min_objects);
+
+static int __init setup_slub_nomerge(char *str)
+{
+	slub_nomerge = 1;
+	return 1;
+}
+__setup("slub_nomerge", setup_slub_nomerge);
+
+#ifdef CONFIG_HOTPLUG_CPU
+/* Give back the cpu slabs of a cpu that went away */
+static int __cpuinit slab_cpuup_callback(struct notifier_block *nfb,
+					 unsigned long action, void *hcpu)
+{
+	long cpu = (long)hcpu;
+	struct kmem_cache *s;
+	unsigned long flags;
+
+	switch (action) {
+	case CPU_UP_CANCELED:
+	case CPU_DEAD:
+		mutex_lock(&slub_lock);
+		list_for_each_entry(s, &slab_caches, list) {
+			local_irq_save(flags);
+			__flush_cpu_slab(s, cpu);
+			local_irq_restore(flags);
+		}
+		mutex_unlock(&slub_lock);
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata slab_notifier = {
+	&slab_cpuup_callback, NULL, 0
+};
+#endif
+
+void __init kmem_cache_init(void)
+{
+	if (slub_max_order < slub_min_order)
+		slub_max_order = slub_min_order;
+
+	create_kmalloc_caches(kmalloc_caches, 0);
+#ifdef CONFIG_ZONE_DMA
+	create_kmalloc_caches(kmalloc_caches_dma, 1);
+#endif
+	slab_state = 1;
+
+#ifdef CONFIG_HOTPLUG_CPU
+	register_cpu_notifier(&slab_notifier);
+#endif
+
+	printk(KERN_INFO "SLUB: HWalign=%d, Order=%d-%d, MinObjects=%d,"
+	       " CPUs=%d\n", cache_line_size(), slub_min_order,
+	       slub_max_order, slub_min_objects, num_possible_cpus());
+}
+
+/********************************************************************
+ * 			/proc/slabinfo
+ *******************************************************************/
+
+#ifdef CONFIG_PROC_FS
+
+static void print_slabinfo_header(struct seq_file *m)
+{
+	seq_puts(m, "slabinfo - version: 2.1\n");
+	seq_puts(m, "# name            <active_objs> <num_objs> <objsize> "
+		 "<objperslab> <pagesperslab>");
+	seq_puts(m, " : tunables <limit> <batchcount> <sharedfactor>");
+	seq_puts(m, " : slabdata <active_slabs> <num_slabs> <sharedavail>");
+	seq_puts(m, " : waste <total> <free> <overhead> <tail>");
+	seq_puts(m, " : aliases <count>");
+	seq_putc(m, '\n');
+}
+
+static void *s_start(struct seq_file *m, loff_t *pos)
+{
+	loff_t n = *pos;
+	struct list_head *p;
+
+	mutex_lock(&slub_lock);
+	if (!n)
+		print_slabinfo_header(m);
+	p = slab_caches.next;
+	while (n--) {
+		p = p->next;
+		if (p == &slab_caches)
+			return NULL;
+	}
+	return list_entry(p, struct kmem_cache, list);
+}
+
+static void *s_next(struct seq_file *m, void *p, loff_t *pos)
+{
+	struct kmem_cache *s = p;
+
+	++*pos;
+	return s->list.next == &slab_caches ?
+		NULL : list_entry(s->list.next, struct kmem_cache, list);
+}
+
+static void s_stop(struct seq_file *m, void *p)
+{
+	mutex_unlock(&slub_lock);
+}
+
+/*
+ * Free objects live in partial and cpu slabs only.  The cpu slab counts
+ * are read without locks, the result is a snapshot anyway.
+ */
+static unsigned long count_free(struct kmem_cache *s)
+{
+	struct page *page;
+	unsigned long nr_free = 0;
+	unsigned long flags;
+	int cpu;
+
+	spin_lock_irqsave(&s->list_lock, flags);
+	list_for_each_entry(page, &s->partial, lru)
+		nr_free += s->objects - page->inuse;
+	spin_unlock_irqrestore(&s->list_lock, flags);
+
+	for_each_online_cpu(cpu) {
+		page = s->cpu_slab[cpu];
+		if (page)
+			nr_free += s->objects - page->inuse;
+	}
+	return nr_free;
+}
+
+/*
+ * Besides the SLAB compatible columns every cache reports the bytes its
+ * slabs hold beyond what the active objects asked for:
+ *
+ *	free		free objects
+ *	overhead	metadata and alignment padding of all objects
+ *	tail		slab space too small for another object
+ *	total		the sum of the three
+ */
+static int s_show(struct seq_file *m, void *p)
+{
+	struct kmem_cache *s = p;
+	unsigned long nr_slabs, nr_objs, nr_free, nr_active;
+	unsigned long free, overhead, tail;
+
+	nr_slabs = atomic_long_read(&s->nr_slabs);
+	nr_objs = nr_slabs * s->objects;
+	nr_free = min(count_free(s), nr_objs);
+	nr_active = nr_objs - nr_free;
+
+	free = nr_free * s->objsize;
+	overhead = nr_objs * (s->size - s->objsize);
+	tail = nr_slabs * ((PAGE_SIZE << s->order) - s->objects * s->size);
+
+	seq_printf(m, "%-17s %6lu %6lu %6d %4d %4d", s->name, nr_active,
+		   nr_objs, s->size, s->objects, 1 << s->order);
+	seq_printf(m, " : tunables %4u %4u %4u", 0, 0, 0);
+	seq_printf(m, " : slabdata %6lu %6lu %6u", nr_slabs, nr_slabs, 0);
+	seq_printf(m, " : waste %8lu %8lu %8lu %8lu",
+		   free + overhead + tail, free, overhead, tail);
+	seq_printf(m, " : aliases %2d", s->refcount - 1);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+const struct seq_operations slabinfo_op = {
+	.start = s_start,
+	.next = s_next,
+	.stop = s_stop,
+	.show = s_show,
+};
+
+#ifdef CONFIG_SLUB_DEBUG
+/* Called with slub_lock held */
+static int set_debug_flags(struct kmem_cache *s, const char *str)
+{
+	long flags = parse_debug_flags(str);
+
+	if (flags < 0)
+		return -EINVAL;
+
+	/* the layout is fixed once the cache is in use, see slub_debug= */
+	if ((flags ^ s->flags) & SLAB_LAYOUT_FLAGS)
+		return -EBUSY;
+	s->flags = (s->flags & ~SLAB_DEBUG_FLAGS) | flags;
+	return 0;
+}
+#else
+static inline int set_debug_flags(struct kmem_cache *s, const char *str)
+{
+	return -EINVAL;
+}
+#endif
+
+#define MAX_SLABINFO_WRITE 128
+/**
+ * slabinfo_write - Tuning for the slab allocator
+ * @file: unused
+ * @buffer: user buffer, "<cache> <debug flags>" or "<cache> shrink"
+ * @count: data length
+ * @ppos: unused
+ */
+ssize_t slabinfo_write(struct file *file, const char __user *buffer,
+		       size_t count, loff_t *ppos)
+{
+	char kbuf[MAX_SLABINFO_WRITE + 1], *tmp;
+	struct kmem_cache *s;
+	int res;
+
+	if (count > MAX_SLABINFO_WRITE)
+		return -EINVAL;
+	if (copy_from_user(&kbuf, buffer, count))
+		return -EFAULT;
+	kbuf[count] = '\0';
+
+	tmp = strchr(kbuf, ' ');
+	if (!tmp)
+		return -EINVAL;
+	*tmp = '\0';
+	tmp = strstrip(tmp + 1);
+
+	mutex_lock(&slub_lock);
+	res = -EINVAL;
+	list_for_each_entry(s, &slab_caches, list) {
+		if (!strcmp(s->name, kbuf)) {
+			if (!strcmp(tmp, "shrink"))
+				res = kmem_cache_shrink(s);
+			else
+				res = set_debug_flags(s, tmp);
+			break;
+		}
+	}
+	mutex_unlock(&slub_lock);
+	if (res >= 0)
+		res = count;
+	return res;
+}
+
+#endif /* CONFIG_PROC_FS */
@@ -0,0 +1,416 @@
+/*
+ *	Large receive offload in software
+ *
+ *	In-order TCP/IPv4 segments of one flow are chained onto the
+ *	first one's frag_list, and the stack sees a single skb carrying
+ *	a burst of data.  Headers are checked, checksums verified and the
+ *	IP and TCP headers of the first segment rewritten to describe the
+ *	whole chain, so the merged skb is indistinguishable from one big
+ *	segment with CHECKSUM_UNNECESSARY.
+ *
+ *	A flow is handed up on PSH, on anything out of order or not plain
+ *	data, when max_aggr segments have collected, when the driver calls
+ *	lro_flush_all() at the end of a receive batch, or after timeout
+ *	jiffies for drivers that see one frame per interrupt.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version
+ *	2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/if_ether.h>
+#include <linux/inetdevice.h>
+#include <linux/lro.h>
+#include <net/ip.h>
+#include <net/tcp.h>
+#include <net/inet_ecn.h>
+#include <net/checksum.h>
+
+struct lro_seg {
+	struct iphdr	*iph;
+	struct tcphdr	*th;
+	__be32		*ts;		/* tsval, tsecr; NULL if absent */
+	unsigned	hlen;		/* IP and TCP headers */
+	unsigned	len;		/* TCP payload */
+};
+
+#define LRO_TS_OPT	htonl((TCPOPT_NOP << 24) | (TCPOPT_NOP << 16) | \
+			      (TCPOPT_TIMESTAMP << 8) | TCPOLEN_TIMESTAMP)
+
+/* Only option-less IPv4 and plain or timestamped TCP are merged */
+static int lro_parse(struct sk_buff *skb, struct lro_seg *seg)
+{
+	struct iphdr *iph = (struct iphdr *)skb->data;
+	struct tcphdr *th;
+	unsigned tot_len, thlen;
+
+	if (skb->protocol != htons(ETH_P_IP) ||
+	    skb_headlen(skb) < sizeof(*iph) + sizeof(*th))
+		return -1;
+
+	if (iph->version != 4 || iph->ihl != 5 ||
+	    iph->protocol != IPPROTO_TCP ||
+	    (iph->frag_off & htons(IP_MF | IP_OFFSET)) ||
+	    ip_fast_csum((u8 *)iph, iph->ihl))
+		return -1;
+
+	tot_len = ntohs(iph->tot_len);
+	if (tot_len > skb->len)
+		return -1;
+
+	th = (struct tcphdr *)(iph + 1);
+	thlen = th->doff * 4;
+	if (thlen < sizeof(*th) || sizeof(*iph) + thlen > tot_len ||
+	    sizeof(*iph) + thlen > skb_headlen(skb))
+		return -1;
+
+	seg->ts = NULL;
+	if (thlen == sizeof(*th) + TCPOLEN_TSTAMP_ALIGNED) {
+		__be32 *opt = (__be32 *)(th + 1);
+
+		if (*opt != LRO_TS_OPT)
+			return -1;
+		seg->ts = opt + 1;
+	} else if (thlen != sizeof(*th))
+		return -1;
+
+	if (skb->len > tot_len && pskb_trim(skb, tot_len))
+		return -1;
+
+	seg->iph = iph;
+	seg->th = th;
+	seg->hlen = sizeof(*iph) + thlen;
+	seg->len = tot_len - seg->hlen;
+	return 0;
+}
+
+/* Plain data: ACK, maybe PSH, no congestion mark */
+static int lro_mergeable(struct lro_seg *seg)
+{
+	if ((tcp_flag_word(seg->th) & (TCP_FLAG_ACK | TCP_FLAG_SYN |
+				       TCP_FLAG_FIN | TCP_FLAG_RST |
+				       TCP_FLAG_URG | TCP_FLAG_ECE |
+				       TCP_FLAG_CWR)) != TCP_FLAG_ACK)
+		return 0;
+	return !INET_ECN_is_ce(seg->iph->tos);
+}
+
+static int lro_csum_ok(struct sk_buff *skb, struct lro_seg *seg)
+{
+	unsigned len = seg->th->doff * 4 + seg->len;
+
+	if (skb->ip_summed == CHECKSUM_UNNECESSARY)
+		return 1;
+
+	return !csum_tcpudp_magic(seg->iph->saddr, seg->iph->daddr, len,
+				  IPPROTO_TCP,
+				  skb_checksum(skb, sizeof(struct iphdr),
+					       len, 0));
+}
+
+static struct net_lro_desc *lro_find(struct net_lro_mgr *mgr,
+				     struct lro_seg *seg)
+{
+	struct net_lro_desc *desc;
+	int i;
+
+	for (i = 0; i < mgr->max_desc; i++) {
+		desc = &mgr->lro_arr[i];
+		if (desc->active &&
+		    desc->saddr == seg->iph->saddr &&
+		    desc->daddr == seg->iph->daddr &&
+		    desc->source == seg->th->source &&
+		    desc->dest == seg->th->dest)
+			return desc;
+	}
+	return NULL;
+}
+
+static struct net_lro_desc *lro_alloc_desc(struct net_lro_mgr *mgr)
+{
+	int i;
+
+	for (i = 0; i < mgr->max_desc; i++)
+		if (!mgr->lro_arr[i].active)
+			return &mgr->lro_arr[i];
+	return NULL;
+}
+
+static void lro_start(struct net_lro_mgr *mgr, struct net_lro_desc *desc,
+		      struct sk_buff *skb, struct lro_seg *seg)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->parent = skb;
+	desc->last_skb = skb;
+	desc->saddr = seg->iph->saddr;
+	desc->daddr = seg->iph->daddr;
+	desc->source = seg->th->source;
+	desc->dest = seg->th->dest;
+	desc->next_seq = ntohl(seg->th->seq) + seg->len;
+	desc->ack_seq = seg->th->ack_seq;
+	desc->window = seg->th->window;
+	if (seg->ts) {
+		desc->tsval = seg->ts[0];
+		desc->tsecr = seg->ts[1];
+	}
+	desc->tot_len = seg->hlen + seg->len;
+	desc->segs = 1;
+	desc->mss = seg->len;
+	desc->active = 1;
+
+	if (mgr->timeout && !timer_pending(&mgr->timer))
+		mod_timer(&mgr->timer, jiffies + mgr->timeout);
+}
+
+static int lro_append(struct net_lro_mgr *mgr, struct net_lro_desc *desc,
+		      struct sk_buff *skb, struct lro_seg *seg)
+{
+	struct sk_buff *parent = desc->parent;
+
+	if (ntohl(seg->th->seq) != desc->next_seq ||
+	    desc->tot_len + seg->len > 65535 ||
+	    !!seg->ts != (((struct tcphdr *)(parent->data +
+			   sizeof(struct iphdr)))->doff > 5))
+		return -1;
+	if (seg->ts &&
+	    (s32)(ntohl(seg->ts[0]) - ntohl(desc->tsval)) < 0)
+		return -1;
+
+	desc->next_seq += seg->len;
+	desc->tot_len += seg->len;
+	desc->ack_seq = seg->th->ack_seq;
+	desc->window = seg->th->window;
+	desc->psh |= seg->th->psh;
+	if (seg->ts) {
+		desc->tsval = seg->ts[0];
+		desc->tsecr = seg->ts[1];
+	}
+	if (seg->len > desc->mss)
+		desc->mss = seg->len;
+
+	skb_pull(skb, seg->hlen);
+	if (desc->last_skb == parent)
+		skb_shinfo(parent)->frag_list = skb;
+	else
+		desc->last_skb->next = skb;
+	skb->next = NULL;
+	desc->last_skb = skb;
+
+	parent->len += skb->len;
+	parent->data_len += skb->len;
+	parent->truesize += skb->truesize;
+	desc->segs++;
+
+	mgr->stats.aggregated++;
+	return 0;
+}
+
+/* Rewrite the first segment's headers for the whole chain */
+static struct sk_buff *lro_close(struct net_lro_mgr *mgr,
+				 struct net_lro_desc *desc)
+{
+	struct sk_buff *skb = desc->parent;
+	struct iphdr *iph = (struct iphdr *)skb->data;
+	struct tcphdr *th = (struct tcphdr *)(iph + 1);
+
+	desc->active = 0;
+	skb->ip_summed = CHECKSUM_UNNECESSARY;
+	if (desc->segs == 1)
+		return skb;
+
+	iph->tot_len = htons(desc->tot_len);
+	iph->check = 0;
+	iph->check = ip_fast_csum((u8 *)iph, iph->ihl);
+
+	th->ack_seq = desc->ack_seq;
+	th->window = desc->window;
+	if (desc->psh)
+		th->psh = 1;
+	if (th->doff > 5) {
+		__be32 *ts = (__be32 *)(th + 1) + 1;
+
+		ts[0] = desc->tsval;
+		ts[1] = desc->tsecr;
+	}
+
+	/* lets tcp_measure_rcv_mss() see the real segment size */
+	skb_shinfo(skb)->gso_size = desc->mss;
+	skb_shinfo(skb)->gso_type = SKB_GSO_TCPV4;
+
+	mgr->stats.flushed++;
+	return skb;
+}
+
+static int lro_deliver(struct net_lro_mgr *mgr, struct sk_buff *skb)
+{
+	return mgr->napi ? netif_receive_skb(skb) : netif_rx(skb);
+}
+
+/*
+ * Merged skbs are for local delivery only: skb_segment() cannot split
+ * a frag_list chain again for a router or a bridge.
+ */
+static int lro_forwarding(struct net_device *dev)
+{
+	struct in_device *in_dev;
+	int forward = 1;
+
+	if (dev->br_port)
+		return 1;
+
+	rcu_read_lock();
+	in_dev = __in_dev_get_rcu(dev);
+	if (in_dev)
+		forward = IN_DEV_FORWARD(in_dev);
+	rcu_read_unlock();
+	return forward;
+}
+
+/**
+ *	lro_receive_skb - hand a received frame to LRO
+ *	@mgr: the driver's LRO state
+ *	@skb: frame after eth_type_trans(), data at the network header
+ *
+ *	Takes the place of netif_rx() (or netif_receive_skb() with
+ *	mgr->napi set) in the driver's receive path.
+ */
+int lro_receive_skb(struct net_lro_mgr *mgr, struct sk_buff *skb)
+{
+	struct net_lro_desc *desc;
+	struct sk_buff *flushed = NULL;
+	struct lro_seg seg;
+	unsigned long flags;
+
+	if (lro_forwarding(skb->dev) || lro_parse(skb, &seg))
+		return lro_deliver(mgr, skb);
+
+	spin_lock_irqsave(&mgr->lock, flags);
+
+	desc = lro_find(mgr, &seg);
+	if (!lro_mergeable(&seg) || !seg.len || !lro_csum_ok(skb, &seg)) {
+		if (desc)
+			flushed = lro_close(mgr, desc);
+		goto deliver;
+	}
+
+	if (desc) {
+		if (!lro_append(mgr, desc, skb, &seg)) {
+			if (desc->psh || desc->segs >= mgr->max_aggr)
+				flushed = lro_close(mgr, desc);
+			spin_unlock_irqrestore(&mgr->lock, flags);
+			if (flushed)
+				lro_deliver(mgr, flushed);
+			return NET_RX_SUCCESS;
+		}
+		flushed = lro_close(mgr, desc);
+	}
+
+	if (seg.th->psh || skb_cloned(skb) || skb_shinfo(skb)->frag_list)
+		goto deliver;
+
+	desc = lro_alloc_desc(mgr);
+	if (!desc) {
+		mgr->stats.no_desc++;
+		goto deliver;
+	}
+	lro_start(mgr, desc, skb, &seg);
+	spin_unlock_irqrestore(&mgr->lock, flags);
+	if (flushed)
+		lro_deliver(mgr, flushed);
+	return NET_RX_SUCCESS;
+
+deliver:
+	spin_unlock_irqrestore(&mgr->lock, flags);
+	if (flushed)
+		lro_deliver(mgr, flushed);
+	return lro_deliver(mgr, skb);
+}
+EXPORT_SYMBOL(lro_receive_skb);
+
+/**
+ *	lro_flush_all - hand every collected flow to the stack
+ *	@mgr: the driver's LRO state
+ *
+ *	Drivers call this at the end of each receive batch.
+ */
+void lro_flush_all(struct net_lro_mgr *mgr)
+{
+	struct sk_buff_head list;
+	struct sk_buff *skb;
+	unsigned long flags;
+	int i;
+
+	if (!mgr->lro_arr)
+		return;
+
+	skb_queue_head_init(&list);
+
+	spin_lock_irqsave(&mgr->lock, flags);
+	for (i = 0; i < mgr->max_desc; i++)
+		if (mgr->lro_arr[i].active)
+			__skb_queue_tail(&list, lro_close(mgr,
+							  &mgr->lro_arr[i]));
+	spin_unlock_irqrestore(&mgr->lock, flags);
+
+	while ((skb = __skb_dequeue(&list)) != NULL)
+		lro_deliver(mgr, skb);
+}
+EXPORT_SYMBOL(lro_flush_all);
+
+static void lro_timeout(unsigned long data)
+{
+	lro_flush_all((struct net_lro_mgr *)data);
+}
+
+/**
+ *	lro_init - set up LRO for a device
+ *	@mgr: LRO state, usually in the driver's private data
+ *	@dev: the receiving device
+ *	@max_desc: flows collected at the same time
+ *	@max_aggr: segments merged into one skb
+ *	@timeout: jiffies a flow may wait, 0 if the driver flushes
+ */
+int lro_init(struct net_lro_mgr *mgr, struct net_device *dev,
+	     int max_desc, int max_aggr, unsigned long timeout)
+{
+	mgr->lro_arr = kcalloc(max_desc, sizeof(struct net_lro_desc),
+			       GFP_KERNEL);
+	if (!mgr->lro_arr)
+		return -ENOMEM;
+
+	mgr->dev = dev;
+	mgr->max_desc = max_desc;
+	mgr->max_aggr = max_aggr;
+	mgr->timeout = timeout;
+	spin_lock_init(&mgr->lock);
+	setup_timer(&mgr->timer, lro_timeout, (unsigned long)mgr);
+	memset(&mgr->stats, 0, sizeof(mgr->stats));
+	return 0;
+}
+EXPORT_SYMBOL(lro_init);
+
+void lro_release(struct net_lro_mgr *mgr)
+{
+	if (!mgr->lro_arr)
+		return;
+	del_timer_sync(&mgr->timer);
+	lro_flush_all(mgr);
+	kfree(mgr->lro_arr);
+	mgr->lro_arr = NULL;
+}
+EXPORT_SYMBOL(lro_release);
+
+/* Fills LRO_STATS_LEN values for ethtool -S, see LRO_STAT_STRINGS */
+void lro_get_stats(struct net_lro_mgr *mgr, u64 *data)
+{
+	data[0] = mgr->stats.aggregated;
+	data[1] = mgr->stats.flushed;
+	data[2] = mgr->stats.no_desc;
+}
+EXPORT_SYMBOL(lro_get_stats);